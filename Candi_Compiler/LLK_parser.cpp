@@ -1,3 +1,432 @@
 #include "pch.h"
 #include "LLK_parser.hpp"
 
+namespace caoco {
+namespace {
+
+using e_rule = llk_parser::e_rule;
+SL_CXA rule_count = static_cast<sl_size>(e_rule::count_);
+
+// Set of token types, one bit per tk_enum starting from none_ (-1).
+struct llk_token_set {
+	SL_CXS sl_size size = static_cast<sl_size>(tk_enum::on_) + 2;
+	sl_array<sl_uint64, (size + 63) / 64> bits{};
+
+	SL_CXS sl_size column(tk_enum type) { return static_cast<sl_size>(static_cast<int>(type) + 1); }
+	SL_CX void insert(tk_enum type) { bits[column(type) / 64] |= sl_uint64(1) << (column(type) % 64); }
+	SL_CX bool contains(sl_size col) const { return (bits[col / 64] >> (col % 64)) & 1; }
+	SL_CX bool contains(tk_enum type) const { return contains(column(type)); }
+	// <@method:merge> Adds the tokens of other, returns true if any were new.
+	SL_CX bool merge(const llk_token_set& other) {
+		bool changed = false;
+		for (sl_size i = 0; i < bits.size(); i++) {
+			changed |= (bits[i] | other.bits[i]) != bits[i];
+			bits[i] |= other.bits[i];
+		}
+		return changed;
+	}
+};
+
+// A terminal matches any token in its set and may keep the token as a leaf node, a nonterminal is a rule.
+struct llk_symbol {
+	bool terminal{ true };
+	e_rule rule{ e_rule::count_ };
+	llk_token_set tokens{};
+	astnode_enum leaf{ astnode_enum::none_ };
+};
+
+// How a production builds its node once all of its symbols are parsed.
+// type: node type, none_ leaves the children on the value stack for the parent.
+// adopt: number of nodes built before the production which become its first children, ex. the name of a var statement.
+enum class e_llk_range { none_, full_, trim_last_, block_ };
+struct llk_action {
+	astnode_enum type{ astnode_enum::none_ };
+	e_llk_range range{ e_llk_range::none_ };
+	sl_size adopt{ 0 };
+};
+
+struct llk_production {
+	SL_CXS sl_size max_size = 6;
+	e_rule lhs{ e_rule::count_ };
+	llk_action action{};
+	sl_array<llk_symbol, max_size> rhs{};
+	sl_size size{ 0 };
+};
+
+SL_CX llk_symbol tok(tk_enum type) {
+	llk_symbol s;
+	s.tokens.insert(type);
+	return s;
+}
+
+SL_CX llk_symbol keep(tk_enum type, astnode_enum leaf) {
+	llk_symbol s = tok(type);
+	s.leaf = leaf;
+	return s;
+}
+
+SL_CX llk_symbol rule(e_rule r) {
+	llk_symbol s;
+	s.terminal = false;
+	s.rule = r;
+	return s;
+}
+
+// Any token which is not a scope token or in excluded.
+SL_CX llk_symbol any_except(std::initializer_list<tk_enum> excluded) {
+	llk_symbol s;
+	for (int t = static_cast<int>(tk_enum::none_); t <= static_cast<int>(tk_enum::on_); t++) {
+		const tk_enum type = static_cast<tk_enum>(t);
+		switch (type) {
+		case tk_enum::none_: case tk_enum::invalid_: case tk_enum::eof_:
+		case tk_enum::open_scope_: case tk_enum::close_scope_: case tk_enum::open_frame_:
+		case tk_enum::close_frame_: case tk_enum::open_list_: case tk_enum::close_list_:
+			continue;
+		default:
+			if (std::find(excluded.begin(), excluded.end(), type) == excluded.end()) s.tokens.insert(type);
+		}
+	}
+	return s;
+}
+
+SL_CX llk_production prod(e_rule lhs, llk_action action, std::initializer_list<llk_symbol> rhs) {
+	llk_production p;
+	p.lhs = lhs;
+	p.action = action;
+	for (const auto& s : rhs) p.rhs[p.size++] = s;
+	return p;
+}
+
+SL_CXA pass = llk_action{};
+SL_CX llk_action node(astnode_enum type, e_llk_range range = e_llk_range::full_, sl_size adopt = 0) { return { type, range, adopt }; }
+
+//---------------------------------------------------------------------------------------------------------------------//
+// Statement grammar
+//---------------------------------------------------------------------------------------------------------------------//
+// Ranges match parse_program: block_ is the contents of a {} block, an empty block keeps its braces.
+// trim_last_ leaves out the closing eos of the statement.
+SL_CXIN llk_production llk_grammar[] = {
+	// <program> ::= #enter <pragmatic_block> #start <functional_block>
+	prod(e_rule::program_, node(astnode_enum::program_, e_llk_range::none_), {
+		tok(tk_enum::enter_), rule(e_rule::pragmatic_block_), tok(tk_enum::start_), rule(e_rule::functional_block_) }),
+
+	prod(e_rule::pragmatic_block_, node(astnode_enum::pragmatic_block_, e_llk_range::block_), {
+		tok(tk_enum::open_list_), rule(e_rule::pragmatic_statements_), tok(tk_enum::close_list_) }),
+	prod(e_rule::pragmatic_statements_, pass, { rule(e_rule::pragmatic_statement_), rule(e_rule::pragmatic_statements_) }),
+	prod(e_rule::pragmatic_statements_, pass, {}),
+	prod(e_rule::pragmatic_statement_, pass, { rule(e_rule::var_statement_) }),
+	prod(e_rule::pragmatic_statement_, pass, { rule(e_rule::type_alias_) }),
+	prod(e_rule::pragmatic_statement_, pass, { rule(e_rule::class_definition_) }),
+	prod(e_rule::pragmatic_statement_, pass, { rule(e_rule::function_definition_) }),
+
+	// A functional block holds at least one statement.
+	prod(e_rule::functional_block_, node(astnode_enum::functional_block_, e_llk_range::block_), {
+		tok(tk_enum::open_list_), rule(e_rule::functional_statement_), rule(e_rule::functional_statements_), tok(tk_enum::close_list_) }),
+	prod(e_rule::functional_statements_, pass, { rule(e_rule::functional_statement_), rule(e_rule::functional_statements_) }),
+	prod(e_rule::functional_statements_, pass, {}),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::var_statement_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::type_alias_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::class_definition_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::function_definition_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::conditional_statement_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::while_statement_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::for_statement_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::on_statement_) }),
+	prod(e_rule::functional_statement_, pass, { rule(e_rule::return_statement_) }),
+
+	// <var> ::= <alnumus> (<eos> | = <value> <eos> | (<alnumus> | <type_constraints>) (<eos> | = <value> <eos>))
+	// The node type is only known at the tail, which adopts the name and type built before it.
+	prod(e_rule::var_statement_, pass, { keep(tk_enum::alnumus_, astnode_enum::alnumus_), rule(e_rule::var_tail_) }),
+	prod(e_rule::var_tail_, node(astnode_enum::anon_variable_definition_, e_llk_range::trim_last_, 1), {
+		tok(tk_enum::eos_) }),
+	prod(e_rule::var_tail_, node(astnode_enum::anon_variable_definition_assingment_, e_llk_range::full_, 1), {
+		tok(tk_enum::simple_assignment_), rule(e_rule::value_expression_), tok(tk_enum::eos_) }),
+	prod(e_rule::var_tail_, pass, { keep(tk_enum::alnumus_, astnode_enum::alnumus_), rule(e_rule::typed_var_tail_) }),
+	prod(e_rule::var_tail_, pass, { rule(e_rule::type_constraints_), rule(e_rule::typed_var_tail_) }),
+	prod(e_rule::typed_var_tail_, node(astnode_enum::constrained_variable_definition_, e_llk_range::trim_last_, 2), {
+		tok(tk_enum::eos_) }),
+	prod(e_rule::typed_var_tail_, node(astnode_enum::constrained_variable_definition_assingment_, e_llk_range::full_, 2), {
+		tok(tk_enum::simple_assignment_), rule(e_rule::value_expression_), tok(tk_enum::eos_) }),
+
+	// <type_alias> ::= use <alnumus> = <value> <eos>
+	prod(e_rule::type_alias_, node(astnode_enum::type_alias_), {
+		tok(tk_enum::use_), keep(tk_enum::alnumus_, astnode_enum::alnumus_), tok(tk_enum::simple_assignment_),
+		rule(e_rule::value_expression_), tok(tk_enum::eos_) }),
+
+	// <class> ::= #class <alnumus> <pragmatic_block> <eos>
+	prod(e_rule::class_definition_, node(astnode_enum::class_definition_, e_llk_range::trim_last_), {
+		tok(tk_enum::class_), keep(tk_enum::alnumus_, astnode_enum::alnumus_), rule(e_rule::pragmatic_block_), tok(tk_enum::eos_) }),
+
+	// <func> ::= [<capture_list>] <alnumus> <arguments>? (<alnumus> | <type_constraints>)? <functional_block>
+	prod(e_rule::function_definition_, node(astnode_enum::func_), {
+		rule(e_rule::capture_list_), keep(tk_enum::alnumus_, astnode_enum::alnumus_), rule(e_rule::function_arguments_),
+		rule(e_rule::function_type_), rule(e_rule::functional_block_) }),
+	prod(e_rule::capture_list_, node(astnode_enum::capture_list_), {
+		tok(tk_enum::open_frame_), rule(e_rule::tokens_), tok(tk_enum::close_frame_) }),
+	prod(e_rule::function_arguments_, pass, { rule(e_rule::arguments_) }),
+	prod(e_rule::function_arguments_, pass, {}),
+	prod(e_rule::arguments_, node(astnode_enum::arguments_), {
+		tok(tk_enum::open_scope_), rule(e_rule::tokens_), tok(tk_enum::close_scope_) }),
+	prod(e_rule::function_type_, pass, { keep(tk_enum::alnumus_, astnode_enum::alnumus_) }),
+	prod(e_rule::function_type_, pass, { rule(e_rule::type_constraints_) }),
+	prod(e_rule::function_type_, pass, {}),
+	prod(e_rule::type_constraints_, node(astnode_enum::type_constraints_), {
+		tok(tk_enum::open_frame_), rule(e_rule::tokens_), tok(tk_enum::close_frame_) }),
+
+	// <conditional> ::= #if (<expr>) <functional_block> (<eos> | (#elif (<expr>) <functional_block>)* #else <functional_block> <eos>)
+	prod(e_rule::conditional_statement_, node(astnode_enum::conditional_statement_, e_llk_range::none_), {
+		rule(e_rule::if_clause_), rule(e_rule::conditional_tail_) }),
+	prod(e_rule::if_clause_, node(astnode_enum::if_), {
+		tok(tk_enum::if_), rule(e_rule::condition_), rule(e_rule::functional_block_) }),
+	prod(e_rule::conditional_tail_, pass, { tok(tk_enum::eos_) }),
+	prod(e_rule::conditional_tail_, pass, { rule(e_rule::elif_clauses_), rule(e_rule::else_clause_), tok(tk_enum::eos_) }),
+	prod(e_rule::elif_clauses_, pass, { rule(e_rule::elif_clause_), rule(e_rule::elif_clauses_) }),
+	prod(e_rule::elif_clauses_, pass, {}),
+	prod(e_rule::elif_clause_, node(astnode_enum::elif_), {
+		tok(tk_enum::elif_), rule(e_rule::condition_), rule(e_rule::functional_block_) }),
+	prod(e_rule::else_clause_, node(astnode_enum::else_), { tok(tk_enum::else_), rule(e_rule::functional_block_) }),
+	prod(e_rule::condition_, pass, { tok(tk_enum::open_scope_), rule(e_rule::condition_expression_), tok(tk_enum::close_scope_) }),
+	prod(e_rule::condition_expression_, node(astnode_enum::expression_), { rule(e_rule::tokens_) }),
+
+	// <while> ::= #while (<expr>) <functional_block> <eos>
+	prod(e_rule::while_statement_, node(astnode_enum::while_, e_llk_range::trim_last_), {
+		tok(tk_enum::while_), rule(e_rule::condition_), rule(e_rule::functional_block_), tok(tk_enum::eos_) }),
+
+	// <for> ::= #for (<expr> (<eos> <expr>)*) <functional_block> <eos>
+	prod(e_rule::for_statement_, node(astnode_enum::for_, e_llk_range::trim_last_), {
+		tok(tk_enum::for_), rule(e_rule::for_conditions_), rule(e_rule::functional_block_), tok(tk_enum::eos_) }),
+	prod(e_rule::for_conditions_, pass, {
+		tok(tk_enum::open_scope_), rule(e_rule::for_expression_), rule(e_rule::for_expressions_), tok(tk_enum::close_scope_) }),
+	prod(e_rule::for_expression_, node(astnode_enum::expression_), { rule(e_rule::value_tokens_) }),
+	prod(e_rule::for_expressions_, pass, { tok(tk_enum::eos_), rule(e_rule::for_expression_), rule(e_rule::for_expressions_) }),
+	prod(e_rule::for_expressions_, pass, {}),
+
+	// <on> ::= #on (<expr>) { <conditional>* } <eos>
+	// The conditionals are the children of the on_block_.
+	prod(e_rule::on_statement_, node(astnode_enum::on_, e_llk_range::trim_last_), {
+		tok(tk_enum::on_), rule(e_rule::condition_), rule(e_rule::on_block_), tok(tk_enum::eos_) }),
+	prod(e_rule::on_block_, node(astnode_enum::on_block_), {
+		tok(tk_enum::open_list_), rule(e_rule::on_clauses_), tok(tk_enum::close_list_) }),
+	prod(e_rule::on_clauses_, pass, { rule(e_rule::conditional_statement_), rule(e_rule::on_clauses_) }),
+	prod(e_rule::on_clauses_, pass, {}),
+
+	// <return> ::= #return <value> <eos>
+	prod(e_rule::return_statement_, node(astnode_enum::return_), {
+		tok(tk_enum::return_), rule(e_rule::value_expression_), tok(tk_enum::eos_) }),
+
+	// Expressions: any balanced run of tokens, values end at the first eos outside of a scope.
+	prod(e_rule::value_expression_, node(astnode_enum::expression_), { rule(e_rule::value_tokens_) }),
+	prod(e_rule::tokens_, pass, { any_except({}), rule(e_rule::tokens_) }),
+	prod(e_rule::tokens_, pass, { rule(e_rule::token_group_), rule(e_rule::tokens_) }),
+	prod(e_rule::tokens_, pass, {}),
+	prod(e_rule::value_tokens_, pass, { any_except({ tk_enum::eos_ }), rule(e_rule::value_tokens_) }),
+	prod(e_rule::value_tokens_, pass, { rule(e_rule::token_group_), rule(e_rule::value_tokens_) }),
+	prod(e_rule::value_tokens_, pass, {}),
+	prod(e_rule::token_group_, pass, { tok(tk_enum::open_scope_), rule(e_rule::tokens_), tok(tk_enum::close_scope_) }),
+	prod(e_rule::token_group_, pass, { tok(tk_enum::open_frame_), rule(e_rule::tokens_), tok(tk_enum::close_frame_) }),
+	prod(e_rule::token_group_, pass, { tok(tk_enum::open_list_), rule(e_rule::tokens_), tok(tk_enum::close_list_) }),
+};
+
+SL_CXIN sl_string_view llk_rule_names[] = {
+	"program", "pragmatic block", "pragmatic statements", "pragmatic statement",
+	"functional block", "functional statements", "functional statement",
+	"var statement", "var statement", "var statement", "type alias", "class definition",
+	"function definition", "capture list", "function arguments", "arguments", "function type", "type constraints",
+	"conditional statement", "#if clause", "conditional statement", "#elif clause", "#elif clause", "#else clause",
+	"condition", "condition", "#while statement", "#for statement", "#for conditions", "#for conditions", "#for conditions",
+	"#on statement", "#on block", "#on block", "#return statement", "value expression", "tokens", "value tokens", "token group"
+};
+static_assert(std::size(llk_rule_names) == rule_count, "llk_rule_names must have one name per e_rule.");
+
+//---------------------------------------------------------------------------------------------------------------------//
+// Predict table generator
+//---------------------------------------------------------------------------------------------------------------------//
+// The end of the input is looked up in the eof_ column.
+SL_CXA end_column = llk_token_set::column(tk_enum::eof_);
+SL_CXA no_production = sl_int16(-1);
+
+struct llk_table {
+	sl_array<llk_token_set, rule_count> first{};
+	sl_array<bool, rule_count> nullable{};
+	sl_array<llk_token_set, rule_count> follow{};
+	sl_array<sl_array<sl_int16, llk_token_set::size>, rule_count> predict{};
+	// Set when the grammar is not LL(1): the rule and token which predict more than one production.
+	int conflict_rule{ -1 };
+	int conflict_column{ -1 };
+	// Set when a rule has no production.
+	int missing_rule{ -1 };
+};
+
+// <@method:first_of> FIRST set of the symbols [from, size) of a production, nullable is set if they can all be empty.
+SL_CX llk_token_set first_of(const llk_table& table, const llk_production& p, sl_size from, bool& nullable) {
+	llk_token_set first;
+	for (sl_size i = from; i < p.size; i++) {
+		const llk_symbol& s = p.rhs[i];
+		if (s.terminal) {
+			first.merge(s.tokens);
+			nullable = false;
+			return first;
+		}
+		first.merge(table.first[static_cast<sl_size>(s.rule)]);
+		if (!table.nullable[static_cast<sl_size>(s.rule)]) {
+			nullable = false;
+			return first;
+		}
+	}
+	nullable = true;
+	return first;
+}
+
+consteval llk_table make_llk_table() {
+	llk_table table;
+	// FIRST sets and nullable rules, to a fixed point.
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (const auto& p : llk_grammar) {
+			const sl_size lhs = static_cast<sl_size>(p.lhs);
+			bool nullable = false;
+			changed |= table.first[lhs].merge(first_of(table, p, 0, nullable));
+			if (nullable && !table.nullable[lhs]) {
+				table.nullable[lhs] = true;
+				changed = true;
+			}
+		}
+	}
+	// FOLLOW sets, every start rule may be followed by the end of the input.
+	for (auto& follow : table.follow)
+		follow.bits[end_column / 64] |= sl_uint64(1) << (end_column % 64);
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (const auto& p : llk_grammar) {
+			for (sl_size i = 0; i < p.size; i++) {
+				if (p.rhs[i].terminal) continue;
+				const sl_size r = static_cast<sl_size>(p.rhs[i].rule);
+				bool rest_nullable = false;
+				changed |= table.follow[r].merge(first_of(table, p, i + 1, rest_nullable));
+				if (rest_nullable)
+					changed |= table.follow[r].merge(table.follow[static_cast<sl_size>(p.lhs)]);
+			}
+		}
+	}
+	// Predict table: a production is chosen on the tokens which can begin it, or follow it if it can be empty.
+	for (auto& row : table.predict)
+		row.fill(no_production);
+	for (sl_size pi = 0; pi < std::size(llk_grammar); pi++) {
+		const llk_production& p = llk_grammar[pi];
+		const sl_size lhs = static_cast<sl_size>(p.lhs);
+		bool nullable = false;
+		llk_token_set predicts = first_of(table, p, 0, nullable);
+		if (nullable) predicts.merge(table.follow[lhs]);
+		for (sl_size col = 0; col < llk_token_set::size; col++) {
+			if (!predicts.contains(col)) continue;
+			sl_int16& cell = table.predict[lhs][col];
+			if (cell != no_production && table.conflict_rule == -1) {
+				table.conflict_rule = static_cast<int>(lhs);
+				table.conflict_column = static_cast<int>(col);
+			}
+			cell = static_cast<sl_int16>(pi);
+		}
+	}
+	for (sl_size r = 0; r < rule_count; r++) {
+		bool found = false;
+		for (const auto& p : llk_grammar)
+			found |= static_cast<sl_size>(p.lhs) == r;
+		if (!found && table.missing_rule == -1) table.missing_rule = static_cast<int>(r);
+	}
+	return table;
+}
+
+SL_CXIN llk_table llk_parse_table = make_llk_table();
+static_assert(llk_parse_table.conflict_rule == -1, "llk_grammar is not LL(1): a rule predicts two productions on one token.");
+static_assert(llk_parse_table.missing_rule == -1, "llk_grammar has a rule without productions.");
+
+sl_string token_name(tk_vector_cit it, tk_vector_cit end) {
+	if (it == end || it->type() == tk_enum::eof_) return "end of input";
+	return sl_string(tk::type_to_string(it->type())) + " '" + it->literal_str() + "'";
+}
+
+} // end anonymous namespace
+
+sl_string_view llk_parser::rule_name(e_rule rule) {
+	return llk_rule_names[static_cast<sl_size>(rule)];
+}
+
+llk_parser::result_type llk_parser::parse(tk_vector_cit begin, tk_vector_cit end, e_rule start) {
+	// A frame either expands a symbol, or builds the node of a production once its symbols are parsed.
+	struct frame {
+		const llk_symbol* symbol;
+		sl_int16 production;
+		sl_size values;
+		tk_vector_cit first;
+	};
+	const llk_symbol start_symbol = rule(start);
+	sl_vector<frame> stack{ frame{ &start_symbol, no_production, 0, begin } };
+	sl_vector<astnode> values;
+	auto it = begin;
+	auto column = [&it, end]() {
+		return it == end ? end_column : llk_token_set::column(it->type());
+	};
+
+	while (!stack.empty()) {
+		const frame top = stack.back();
+		stack.pop_back();
+
+		if (top.symbol == nullptr) {
+			const llk_action& action = llk_grammar[top.production].action;
+			if (action.type == astnode_enum::none_) continue; // Children belong to the parent.
+			const sl_size first_child = top.values - action.adopt;
+			tk_vector_cit range_begin = action.adopt ? values[first_child].source_begin() : top.first;
+			tk_vector_cit range_end = it;
+			astnode nd(action.type);
+			switch (action.range) {
+			case e_llk_range::full_:
+				nd = astnode(action.type, range_begin, range_end);
+				break;
+			case e_llk_range::trim_last_:
+				nd = astnode(action.type, range_begin, range_end - 1);
+				break;
+			case e_llk_range::block_:
+				nd = range_end - range_begin > 2 ? astnode(action.type, range_begin + 1, range_end - 1)
+					: astnode(action.type, range_begin, range_end);
+				break;
+			default:
+				break;
+			}
+			nd.children_unsafe().reserve(values.size() - first_child);
+			for (sl_size i = first_child; i < values.size(); i++)
+				nd.push_back(std::move(values[i]));
+			values.resize(first_child);
+			values.push_back(std::move(nd));
+			continue;
+		}
+
+		const llk_symbol& symbol = *top.symbol;
+		if (symbol.terminal) {
+			if (!symbol.tokens.contains(column())) {
+				return result_type::make_failure(it, "llk_parser: Unexpected " + token_name(it, end) + " in "
+					+ sl_string(rule_name(llk_grammar[top.production].lhs)) + ".");
+			}
+			if (symbol.leaf != astnode_enum::none_)
+				values.push_back(astnode(symbol.leaf, it, it + 1));
+			it++;
+			continue;
+		}
+
+		const sl_int16 production = llk_parse_table.predict[static_cast<sl_size>(symbol.rule)][column()];
+		if (production == no_production) {
+			return result_type::make_failure(it, "llk_parser: Unexpected " + token_name(it, end) + " in "
+				+ sl_string(rule_name(symbol.rule)) + ".");
+		}
+		const llk_production& p = llk_grammar[production];
+		stack.push_back(frame{ nullptr, production, values.size(), it });
+		for (sl_size i = p.size; i-- > 0;)
+			stack.push_back(frame{ &p.rhs[i], production, 0, it });
+	}
+
+	if (values.size() != 1) {
+		return result_type::make_failure(it, "llk_parser: Rule " + sl_string(rule_name(start)) + " does not build a single node.");
+	}
+	return result_type::make_success(it, std::move(values.back()));
+}
+
+} // end namespace caoco
@@ -1,6 +1,72 @@
 #pragma once
+#include "global_dependencies.hpp"
+#include "token.hpp"
+#include "ast_node.hpp"
 
+namespace caoco {
+
+/// <llk_parser>
+/// Table driven predictive parser of the statement grammar: #enter/#start programs, pragmatic and functional blocks,
+/// var, use, class and function definitions, #if/#elif/#else, #while, #for, #on and #return.
+/// The grammar is described as data in LLK_parser.cpp and its predict table is generated at compile time,
+/// a conflict in the grammar fails the build. Parsing never backtracks: every step is one table lookup on the
+/// next token, and the explicit parse stack replaces recursion.
+/// The trees have the same shape as those of parse_program. Expressions are not part of the statement grammar,
+/// they are kept as expression_ nodes over their tokens for the expression parser.
+/// </llk_parser>
 class llk_parser {
+public:
+	using result_type = sl_partial_expected<astnode, tk_vector_cit>;
+
+	// Nonterminals of the statement grammar, in the order of the rule names in LLK_parser.cpp.
+	enum class e_rule : int {
+		program_,
+		pragmatic_block_,
+		pragmatic_statements_,
+		pragmatic_statement_,
+		functional_block_,
+		functional_statements_,
+		functional_statement_,
+		var_statement_,
+		var_tail_,
+		typed_var_tail_,
+		type_alias_,
+		class_definition_,
+		function_definition_,
+		capture_list_,
+		function_arguments_,
+		arguments_,
+		function_type_,
+		type_constraints_,
+		conditional_statement_,
+		if_clause_,
+		conditional_tail_,
+		elif_clauses_,
+		elif_clause_,
+		else_clause_,
+		condition_,
+		condition_expression_,
+		while_statement_,
+		for_statement_,
+		for_conditions_,
+		for_expression_,
+		for_expressions_,
+		on_statement_,
+		on_block_,
+		on_clauses_,
+		return_statement_,
+		value_expression_,
+		tokens_,
+		value_tokens_,
+		token_group_,
+		count_
+	};
 
+	// <@method:parse> Parses a start rule from begin. The start rule must build a single node, ex. program_,
+	// pragmatic_block_, functional_block_ or functional_statement_. always() is one past the parsed tokens.
+	static result_type parse(tk_vector_cit begin, tk_vector_cit end, e_rule start = e_rule::program_);
+	// <@method:rule_name> Name of a rule for error messages.
+	static sl_string_view rule_name(e_rule rule);
+};
 
-};
\ No newline at end of file
+} // end namespace caoco
@@ -0,0 +1,272 @@
+#pragma once
+#include "cand_syntax.hpp"
+
+/// <ast_arena>
+/// Per-compilation storage for ast nodes.
+/// Nodes are fixed-size records kept in one contiguous vector, they refer to each other
+/// with 32-bit indices. Each record holds up to 3 child indices in place, larger child lists
+/// spill into a contiguous block of the child pool. Literals are stored in a single pool.
+/// Building a subtree only relinks indices, no node is ever copied. Dropping the arena
+/// (or calling release()) frees every node at once.
+/// Only the pratt expression parser builds into an arena, see parse_expression_arena.
+/// parse_program, the llk_parser and the evaluators still build and walk heap allocated caoco::astnode trees.
+/// </ast_arena>
+class ast_arena {
+public:
+	using index_t = sl_uint32;
+	SL_CXS index_t npos = sl_limits<index_t>::max();
+	SL_CXS index_t inline_capacity = 3;
+
+	struct record {
+		e_ast type{ e_ast::invalid_ };
+		index_t parent{ npos };
+		index_t literal_offset{ 0 };
+		index_t literal_size{ 0 };
+		index_t child_count{ 0 };
+		index_t child_capacity{ inline_capacity };
+		// While child_capacity is inline_capacity the children are stored here,
+		// otherwise children[0] is the offset of the node's block in the child pool.
+		index_t children[inline_capacity]{ npos, npos, npos };
+	};
+private:
+	sl_vector<record> nodes_;
+	sl_vector<index_t> child_pool_;
+	sl_u8string literal_pool_;
+
+	record& rec(index_t node) {
+		if (node >= nodes_.size()) throw sl_out_of_range("ast_arena node index out of range.");
+		return nodes_[node];
+	}
+	const record& rec(index_t node) const {
+		if (node >= nodes_.size()) throw sl_out_of_range("ast_arena node index out of range.");
+		return nodes_[node];
+	}
+	void check_orphan(index_t child) const {
+		if (rec(child).parent != npos)
+			throw sl_runtime_error("ast_arena cannot link a node which already has a parent.");
+	}
+	index_t* child_data(record& r) {
+		return r.child_capacity == inline_capacity ? r.children : child_pool_.data() + r.children[0];
+	}
+	const index_t* child_data(const record& r) const {
+		return r.child_capacity == inline_capacity ? r.children : child_pool_.data() + r.children[0];
+	}
+	// Moves the node's children to a block twice the size at the end of the child pool.
+	// The old block is not reused, it is freed with the arena.
+	index_t* grow_children(record& r) {
+		const index_t new_capacity = r.child_capacity * 2;
+		const index_t offset = static_cast<index_t>(child_pool_.size());
+		child_pool_.resize(child_pool_.size() + new_capacity, npos);
+		const index_t* old_data = child_data(r);
+		std::copy(old_data, old_data + r.child_count, child_pool_.data() + offset);
+		r.children[0] = offset;
+		r.child_capacity = new_capacity;
+		return child_pool_.data() + offset;
+	}
+	index_t* reserve_child(record& r) {
+		return r.child_count == r.child_capacity ? grow_children(r) : child_data(r);
+	}
+public:
+	ast_arena() = default;
+	ast_arena(sl_size node_capacity) { reserve(node_capacity); }
+	// The arena owns every node, copying it would silently duplicate a whole compilation.
+	ast_arena(const ast_arena&) = delete;
+	ast_arena& operator=(const ast_arena&) = delete;
+	ast_arena(ast_arena&&) noexcept = default;
+	ast_arena& operator=(ast_arena&&) noexcept = default;
+
+	void reserve(sl_size node_capacity, sl_size literal_capacity = 0) {
+		nodes_.reserve(node_capacity);
+		literal_pool_.reserve(literal_capacity);
+	}
+
+	// <@method:release> Frees every node and literal owned by the arena.
+	void release() {
+		sl_vector<record>().swap(nodes_);
+		sl_vector<index_t>().swap(child_pool_);
+		sl_u8string().swap(literal_pool_);
+	}
+
+	//----------------------------------------------------------------------------------------------------------------//
+	// Construction
+	//----------------------------------------------------------------------------------------------------------------//
+	// <@method:make> Creates a new root node and returns its index.
+	index_t make(e_ast type, sl_u8string_view literal = {}) {
+		if (nodes_.size() >= npos) throw sl_runtime_error("ast_arena node limit reached.");
+		record r;
+		r.type = type;
+		r.literal_offset = static_cast<index_t>(literal_pool_.size());
+		r.literal_size = static_cast<index_t>(literal.size());
+		literal_pool_.append(literal);
+		nodes_.push_back(r);
+		return static_cast<index_t>(nodes_.size() - 1);
+	}
+	index_t make(const tk& t) { return make(tk_type_to_astnode_type(t.type()), t.literal()); }
+
+	// <@method:push_back> Links child as the last child of parent. Returns child.
+	index_t push_back(index_t parent, index_t child) {
+		check_orphan(child);
+		record& p = rec(parent);
+		index_t* data = reserve_child(p);
+		data[p.child_count++] = child;
+		nodes_[child].parent = parent;
+		return child;
+	}
+
+	// <@method:push_front> Links child as the first child of parent. Returns child.
+	index_t push_front(index_t parent, index_t child) {
+		check_orphan(child);
+		record& p = rec(parent);
+		index_t* data = reserve_child(p);
+		std::copy_backward(data, data + p.child_count, data + p.child_count + 1);
+		data[0] = child;
+		p.child_count++;
+		nodes_[child].parent = parent;
+		return child;
+	}
+
+	//----------------------------------------------------------------------------------------------------------------//
+	// Queries
+	//----------------------------------------------------------------------------------------------------------------//
+	const record& at(index_t node) const { return rec(node); }
+	e_ast type(index_t node) const { return rec(node).type; }
+	// Note: the view is invalidated when a new node with a literal is created.
+	sl_u8string_view literal(index_t node) const {
+		const record& r = rec(node);
+		return sl_u8string_view(literal_pool_).substr(r.literal_offset, r.literal_size);
+	}
+	index_t parent(index_t node) const { return rec(node).parent; }
+	index_t size(index_t node) const { return rec(node).child_count; }
+	bool leaf(index_t node) const { return rec(node).child_count == 0; }
+	bool root(index_t node) const { return rec(node).parent == npos; }
+
+	// <@method:children> Contiguous view of the node's child indices.
+	// Note: the view is invalidated when a child is added to any node.
+	sl_span<const index_t> children(index_t node) const {
+		const record& r = rec(node);
+		return sl_span<const index_t>(child_data(r), r.child_count);
+	}
+	// <@method:child> Returns the index-th child of node.
+	index_t child(index_t node, sl_size index) const {
+		const record& r = rec(node);
+		if (index >= r.child_count) throw sl_out_of_range("ast_arena child() called with index out of range.");
+		return child_data(r)[index];
+	}
+	index_t first_child(index_t node) const { const record& r = rec(node); return r.child_count ? child_data(r)[0] : npos; }
+	index_t last_child(index_t node) const { const record& r = rec(node); return r.child_count ? child_data(r)[r.child_count - 1] : npos; }
+
+	sl_size node_count() const { return nodes_.size(); }
+	sl_size literal_bytes() const { return literal_pool_.size(); }
+	// <@method:memory_usage> Bytes reserved by the arena, including unused capacity.
+	sl_size memory_usage() const {
+		return nodes_.capacity() * sizeof(record) 
+			+ child_pool_.capacity() * sizeof(index_t)
+			+ literal_pool_.capacity() * sizeof(char8_t);
+	}
+	double bytes_per_node() const {
+		return nodes_.empty() ? 0.0 : static_cast<double>(memory_usage()) / static_cast<double>(nodes_.size());
+	}
+
+	//----------------------------------------------------------------------------------------------------------------//
+	// Conversion
+	//----------------------------------------------------------------------------------------------------------------//
+	// <@method:adopt> Stores a copy of a heap allocated ast tree in the arena, returns the index of its root.
+	index_t adopt(const ast& tree) {
+		index_t root = make(tree.type(), tree.literal());
+		for (const auto& child : tree.children())
+			push_back(root, adopt(child));
+		return root;
+	}
+
+	// <@method:to_ast> Builds a heap allocated ast tree from the subtree rooted at node.
+	ast to_ast(index_t node) const {
+		ast tree{ type(node), sl_u8string(literal(node)) };
+		for (index_t c : children(node))
+			tree.push_back(to_ast(c));
+		return tree;
+	}
+
+	//----------------------------------------------------------------------------------------------------------------//
+	// Traversal
+	//----------------------------------------------------------------------------------------------------------------//
+	// Walks yield node indices, the pending nodes are kept on a heap allocated stack instead of the call stack.
+	class preorder_iterator {
+		const ast_arena* arena_{ nullptr };
+		sl_vector<index_t> stack_;
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = index_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const index_t*;
+		using reference = const index_t&;
+
+		preorder_iterator() = default;
+		preorder_iterator(const ast_arena& arena, index_t root) : arena_(&arena) { stack_.push_back(root); }
+
+		reference operator*() const { return stack_.back(); }
+		preorder_iterator& operator++() {
+			index_t node = stack_.back();
+			stack_.pop_back();
+			auto children = arena_->children(node);
+			for (auto it = children.rbegin(); it != children.rend(); ++it)
+				stack_.push_back(*it);
+			return *this;
+		}
+		preorder_iterator operator++(int) { preorder_iterator prev = *this; ++(*this); return prev; }
+		bool operator==(const preorder_iterator& other) const {
+			return stack_.empty() ? other.stack_.empty() : (!other.stack_.empty() && stack_.back() == other.stack_.back());
+		}
+	};
+
+	class postorder_iterator {
+		const ast_arena* arena_{ nullptr };
+		// Each entry is a node and the index of the next child to visit.
+		sl_vector<std::pair<index_t, index_t>> stack_;
+
+		void descend() {
+			while (!stack_.empty()) {
+				auto& top = stack_.back();
+				if (top.second >= arena_->size(top.first)) return;
+				index_t next = arena_->child(top.first, top.second);
+				++top.second;
+				stack_.emplace_back(next, 0);
+			}
+		}
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = index_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const index_t*;
+		using reference = const index_t&;
+
+		postorder_iterator() = default;
+		postorder_iterator(const ast_arena& arena, index_t root) : arena_(&arena) {
+			stack_.emplace_back(root, 0);
+			descend();
+		}
+
+		reference operator*() const { return stack_.back().first; }
+		postorder_iterator& operator++() {
+			stack_.pop_back();
+			descend();
+			return *this;
+		}
+		postorder_iterator operator++(int) { postorder_iterator prev = *this; ++(*this); return prev; }
+		bool operator==(const postorder_iterator& other) const {
+			return stack_.empty() ? other.stack_.empty() : (!other.stack_.empty() && stack_.back().first == other.stack_.back().first);
+		}
+	};
+
+	template<typename IteratorT>
+	class walk_view {
+		const ast_arena* arena_;
+		index_t root_;
+	public:
+		walk_view(const ast_arena& arena, index_t root) : arena_(&arena), root_(root) {}
+		IteratorT begin() const { return IteratorT(*arena_, root_); }
+		IteratorT end() const { return IteratorT(); }
+	};
+
+	walk_view<preorder_iterator> preorder(index_t root) const { rec(root); return { *this, root }; }
+	walk_view<postorder_iterator> postorder(index_t root) const { rec(root); return { *this, root }; }
+};
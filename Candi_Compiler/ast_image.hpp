@@ -0,0 +1,333 @@
+#pragma once
+#include <cstring>
+#include <fstream>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "cand_syntax.hpp"
+#include "ast_arena.hpp"
+#include "ast_node.hpp"
+
+/// <ast_image>
+/// Versioned binary format of a syntax tree, meant to be cached on disk and read in place.
+/// Both trees can be written: the ast of the front end and the caoco::astnode walked by the constant evaluator,
+/// the header records which one an image holds.
+/// Layout: a header, then node_count fixed-size node records, then the literal pool.
+/// Nodes are stored breadth first from the root, so the children of a node are consecutive records.
+/// Records refer to each other and to the literal pool by index, never by address, so an image
+/// can be copied, written to a file or mapped at any address and read as is.
+/// The image is written in the byte order of the host, readers reject an image of another byte order.
+/// </ast_image>
+namespace ast_image {
+	using index_t = sl_uint32;
+	SL_CXS index_t npos = sl_limits<index_t>::max();
+	SL_CXS sl_uint32 magic = 0x54534143; // 'CAST'
+	SL_CXS sl_uint32 version = 2;
+	SL_CXS sl_uint32 byte_order_mark = 0x01020304;
+
+	// Tree the node types of an image belong to.
+	enum class e_tree : sl_uint32 { ast_, astnode_ };
+
+	struct header {
+		sl_uint32 magic;
+		sl_uint32 version;
+		sl_uint32 byte_order;
+		sl_uint32 record_size;
+		sl_uint32 node_count;
+		sl_uint32 literal_bytes;
+		sl_uint32 tree;
+		sl_uint32 reserved;
+	};
+
+	struct record {
+		sl_uint32 type;
+		index_t parent;
+		index_t first_child;
+		index_t child_count;
+		index_t literal_offset;
+		index_t literal_size;
+	};
+
+	static_assert(sizeof(header) == 32 && sizeof(record) == 24, "ast_image records must have no padding.");
+	static_assert(std::is_trivially_copyable_v<header> && std::is_trivially_copyable_v<record>);
+
+	// <@method:write_tree> Writes the tree below root as an image. children(node) is the range of the children of
+	// a node, a NodeT is made from the address of each element. type(node) and literal(node) are its type and text.
+	template<typename NodeT, typename ChildrenF, typename TypeF, typename LiteralF>
+	sl_vector<std::byte> write_tree(e_tree tree, NodeT root, ChildrenF&& children, TypeF&& type, LiteralF&& literal) {
+		// Breadth first order, each node's children are queued together.
+		sl_vector<NodeT> order{ root };
+		for (sl_size i = 0; i < order.size(); i++)
+			for (const auto& child : children(order[i]))
+				order.push_back(NodeT(&child));
+
+		sl_vector<record> records(order.size());
+		sl_u8string literals;
+		index_t next_child = 1;
+		for (index_t i = 0; i < order.size(); i++) {
+			const auto node = order[i];
+			const auto text = literal(node);
+			record& r = records[i];
+			r.type = static_cast<sl_uint32>(type(node));
+			r.child_count = static_cast<index_t>(children(node).size());
+			r.first_child = r.child_count ? next_child : npos;
+			r.literal_offset = static_cast<index_t>(literals.size());
+			r.literal_size = static_cast<index_t>(text.size());
+			literals.append(text);
+			for (index_t c = 0; c < r.child_count; c++)
+				records[next_child + c].parent = i;
+			next_child += r.child_count;
+		}
+		records[0].parent = npos;
+
+		const header h{ magic, version, byte_order_mark, sizeof(record),
+			static_cast<sl_uint32>(records.size()), static_cast<sl_uint32>(literals.size()), static_cast<sl_uint32>(tree), 0 };
+		sl_vector<std::byte> image(sizeof(header) + records.size() * sizeof(record) + literals.size());
+		std::memcpy(image.data(), &h, sizeof(header));
+		std::memcpy(image.data() + sizeof(header), records.data(), records.size() * sizeof(record));
+		std::memcpy(image.data() + sizeof(header) + records.size() * sizeof(record), literals.data(), literals.size());
+		return image;
+	}
+
+	// <@method:write> Writes the subtree of the arena rooted at root as an image.
+	inline sl_vector<std::byte> write(const ast_arena& arena, ast_arena::index_t root) {
+		// Nodes are referred to by the address of their entry in the parent's child list, arena nodes by index.
+		struct node_ref {
+			ast_arena::index_t index;
+			node_ref(ast_arena::index_t node) : index(node) {}
+			node_ref(const ast_arena::index_t* node) : index(*node) {}
+		};
+		return write_tree(e_tree::ast_, node_ref(root),
+			[&arena](node_ref n) { return arena.children(n.index); },
+			[&arena](node_ref n) { return arena.type(n.index); },
+			[&arena](node_ref n) { return arena.literal(n.index); });
+	}
+
+	// <@method:write> Writes a heap allocated ast tree as an image.
+	inline sl_vector<std::byte> write(const ast& tree) {
+		return write_tree(e_tree::ast_, &tree,
+			[](const ast* n) -> const sl_vector<ast>& { return n->children(); },
+			[](const ast* n) { return n->type(); },
+			[](const ast* n) -> const sl_u8string& { return n->literal(); });
+	}
+
+	// <@method:write> Writes a caoco::astnode tree as an image. Literals are written out, an image doesn't
+	// refer to the source tokens of the tree.
+	inline sl_vector<std::byte> write(const caoco::astnode& tree) {
+		return write_tree(e_tree::astnode_, &tree,
+			[](const caoco::astnode* n) -> const sl_vector<caoco::astnode>& { return n->children(); },
+			[](const caoco::astnode* n) { return n->type(); },
+			[](const caoco::astnode* n) { return n->literal(); });
+	}
+
+	/// <view>
+	/// Read-only view of an image held in memory owned by someone else, ex. a mapped file.
+	/// Opening the view checks the header and every record, nothing is copied or rebuilt: children come after their
+	/// parent and lie within the image, literals within the literal pool. A walk down from any node ends.
+	/// Every access is bounds checked. The memory must be aligned to 4 bytes and outlive the view.
+	/// </view>
+	class view {
+		const header* header_{ nullptr };
+		const record* records_{ nullptr };
+		const char8_t* literals_{ nullptr };
+
+		const record& rec(index_t node) const {
+			if (node >= header_->node_count) throw sl_out_of_range("ast_image node index out of range.");
+			return records_[node];
+		}
+		void expect_tree(e_tree expected) const {
+			if (tree() != expected) throw sl_runtime_error("ast_image holds another kind of tree.");
+		}
+
+		// <@method:build> Builds the subtree rooted at node without recursion: the subtree is listed breadth
+		// first, then each node is made and takes its children, from the last node to the first.
+		template<typename TreeT, typename MakeF>
+		TreeT build(index_t node, MakeF&& make) const {
+			sl_vector<index_t> order{ node };
+			sl_vector<sl_size> first_child{};
+			for (sl_size i = 0; i < order.size(); i++) {
+				first_child.push_back(order.size());
+				for (index_t c = 0; c < size(order[i]); c++) order.push_back(child(order[i], c));
+			}
+			sl_vector<TreeT> built(order.size());
+			for (sl_size i = order.size(); i-- > 0;) {
+				TreeT tree = make(order[i]);
+				for (sl_size c = first_child[i]; c < first_child[i] + size(order[i]); c++)
+					tree.push_back(std::move(built[c]));
+				built[i] = std::move(tree);
+			}
+			return std::move(built.front());
+		}
+	public:
+		view(sl_span<const std::byte> bytes) {
+			if (bytes.size() < sizeof(header))
+				throw sl_runtime_error("ast_image is smaller than its header.");
+			if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(record) != 0)
+				throw sl_runtime_error("ast_image memory is not aligned.");
+			header_ = reinterpret_cast<const header*>(bytes.data());
+			if (header_->magic != magic)
+				throw sl_runtime_error("ast_image has an invalid magic number.");
+			if (header_->byte_order != byte_order_mark)
+				throw sl_runtime_error("ast_image was written with a different byte order.");
+			if (header_->version != version || header_->record_size != sizeof(record))
+				throw sl_runtime_error("ast_image version is not supported.");
+			if (header_->tree != static_cast<sl_uint32>(e_tree::ast_) && header_->tree != static_cast<sl_uint32>(e_tree::astnode_))
+				throw sl_runtime_error("ast_image holds an unknown kind of tree.");
+			if (header_->node_count == 0
+				|| bytes.size() != sizeof(header) + sl_size(header_->node_count) * sizeof(record) + header_->literal_bytes)
+				throw sl_runtime_error("ast_image size does not match its header.");
+			records_ = reinterpret_cast<const record*>(bytes.data() + sizeof(header));
+			literals_ = reinterpret_cast<const char8_t*>(bytes.data() + sizeof(header) + header_->node_count * sizeof(record));
+			for (index_t node = 0; node < header_->node_count; node++) {
+				const record& r = records_[node];
+				if (r.child_count != 0 && (r.first_child <= node || sl_size(r.first_child) + r.child_count > header_->node_count))
+					throw sl_runtime_error("ast_image node " + std::to_string(node) + " has children out of range.");
+				if (sl_size(r.literal_offset) + r.literal_size > header_->literal_bytes)
+					throw sl_runtime_error("ast_image node " + std::to_string(node) + " has a literal out of range.");
+			}
+		}
+
+		SL_CXS index_t root() { return 0; }
+		sl_size node_count() const { return header_->node_count; }
+		e_tree tree() const { return static_cast<e_tree>(header_->tree); }
+
+		// Type of the node of an ast image.
+		e_ast type(index_t node) const { return static_cast<e_ast>(rec(node).type); }
+		// Type of the node of a caoco::astnode image.
+		caoco::astnode::e_type astnode_type(index_t node) const { return static_cast<caoco::astnode::e_type>(rec(node).type); }
+		sl_u8string_view literal(index_t node) const {
+			const record& r = rec(node);
+			return sl_u8string_view(literals_ + r.literal_offset, r.literal_size);
+		}
+		index_t parent(index_t node) const { return rec(node).parent; }
+		index_t size(index_t node) const { return rec(node).child_count; }
+		bool leaf(index_t node) const { return rec(node).child_count == 0; }
+		// <@method:child> Returns the index-th child of node.
+		index_t child(index_t node, sl_size index) const {
+			const record& r = rec(node);
+			if (index >= r.child_count) throw sl_out_of_range("ast_image child() called with index out of range.");
+			return r.first_child + static_cast<index_t>(index);
+		}
+
+		// <@method:to_ast> Builds a heap allocated ast tree from the subtree rooted at node of an ast image.
+		ast to_ast(index_t node) const {
+			expect_tree(e_tree::ast_);
+			return build<ast>(node, [this](index_t n) { return ast{ type(n), sl_u8string(literal(n)) }; });
+		}
+		// <@method:to_astnode> Builds the caoco::astnode tree the constant evaluator walks from the subtree rooted
+		// at node of a caoco::astnode image. Literals are owned by the nodes, no source tokens are needed.
+		caoco::astnode to_astnode(index_t node) const {
+			expect_tree(e_tree::astnode_);
+			return build<caoco::astnode>(node, [this](index_t n) { return caoco::astnode{ astnode_type(n), sl_u8string(literal(n)) }; });
+		}
+	};
+
+	/// <file>
+	/// An image on disk, mapped into memory or read into memory aligned for a view. map() is the load path for images
+	/// cached on disk: pages are read by the OS as the view touches them, nothing is copied. load() reads the whole
+	/// file, ex. when it may change while in use.
+	/// </file>
+	class file {
+		sl_vector<record> storage_;
+		const std::byte* mapped_{ nullptr };
+		sl_size size_{ 0 };
+
+		void unmap() noexcept {
+			if (mapped_ == nullptr) return;
+#ifdef _WIN32
+			UnmapViewOfFile(mapped_);
+#else
+			munmap(const_cast<std::byte*>(mapped_), size_);
+#endif
+			mapped_ = nullptr;
+		}
+	public:
+		file() = default;
+		file(const file&) = delete;
+		file& operator=(const file&) = delete;
+		file(file&& other) noexcept
+			: storage_(std::move(other.storage_)), mapped_(std::exchange(other.mapped_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+		file& operator=(file&& other) noexcept {
+			if (this != &other) {
+				unmap();
+				storage_ = std::move(other.storage_);
+				mapped_ = std::exchange(other.mapped_, nullptr);
+				size_ = std::exchange(other.size_, 0);
+			}
+			return *this;
+		}
+		~file() { unmap(); }
+
+		// <@method:map> Maps the image at path read only, throws if the file can't be mapped or doesn't hold a
+		// valid image. The file must not be changed while mapped.
+		static file map(const sl_string& path) {
+			file mapped;
+#ifdef _WIN32
+			HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (handle == INVALID_HANDLE_VALUE) throw sl_runtime_error("ast_image could not open " + path + ".");
+			LARGE_INTEGER size{};
+			GetFileSizeEx(handle, &size);
+			mapped.size_ = static_cast<sl_size>(size.QuadPart);
+			// A view keeps the mapping alive, both handles are closed once it is made.
+			HANDLE mapping = mapped.size_ ? CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+			if (mapping) {
+				mapped.mapped_ = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				CloseHandle(mapping);
+			}
+			CloseHandle(handle);
+#else
+			const int descriptor = ::open(path.c_str(), O_RDONLY);
+			if (descriptor < 0) throw sl_runtime_error("ast_image could not open " + path + ".");
+			struct stat status {};
+			if (fstat(descriptor, &status) == 0) {
+				mapped.size_ = static_cast<sl_size>(status.st_size);
+				// The mapping keeps the file alive, the descriptor is closed once it is made.
+				void* address = mapped.size_ ? mmap(nullptr, mapped.size_, PROT_READ, MAP_PRIVATE, descriptor, 0) : MAP_FAILED;
+				if (address != MAP_FAILED) mapped.mapped_ = static_cast<const std::byte*>(address);
+			}
+			::close(descriptor);
+#endif
+			if (mapped.mapped_ == nullptr) throw sl_runtime_error("ast_image could not map " + path + ".");
+			ast_image::view{ mapped.bytes() };
+			return mapped;
+		}
+		// <@method:load> Reads the image at path, throws if the file can't be read or doesn't hold a valid image.
+		static file load(const sl_string& path) {
+			std::ifstream in(path, std::ios::binary | std::ios::ate);
+			if (!in) throw sl_runtime_error("ast_image could not open " + path + ".");
+			file loaded;
+			loaded.size_ = static_cast<sl_size>(in.tellg());
+			loaded.storage_.resize((loaded.size_ + sizeof(record) - 1) / sizeof(record));
+			in.seekg(0);
+			if (!in.read(reinterpret_cast<char*>(loaded.storage_.data()), static_cast<std::streamsize>(loaded.size_)))
+				throw sl_runtime_error("ast_image could not read " + path + ".");
+			ast_image::view{ loaded.bytes() };
+			return loaded;
+		}
+		// <@method:save> Writes an image to path.
+		static void save(const sl_string& path, const sl_vector<std::byte>& image) {
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			if (!out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size())))
+				throw sl_runtime_error("ast_image could not write " + path + ".");
+		}
+
+		bool mapped() const { return mapped_ != nullptr; }
+		sl_span<const std::byte> bytes() const {
+			if (mapped_) return { mapped_, size_ };
+			return { reinterpret_cast<const std::byte*>(storage_.data()), size_ };
+		}
+		// The view refers to the file's memory, the file must outlive it.
+		ast_image::view view() const { return ast_image::view{ bytes() }; }
+	};
+}
@@ -5,67 +5,129 @@
 
 namespace caoco {
 	namespace ca_error {
-		namespace tokenizer {
+		enum class e_code : sl_uint32 {
+			invalid_char_ = 1,
+			lexer_syntax_error_,
+			tokenizer_logic_error_,
+			parser_logic_error_,
+			operation_missing_operand_,
+			invalid_expression_
+		};
 
-			auto invalid_char = [](sl_size line, sl_size col, char8_t c,sl_string error="") {
-				std::stringstream ss;
-				ss << "\n[User Syntax Error]: ";
-				ss << "\nInvalid character at line: " << line << " column: " << col << " \nerror detail: " << error;
-				ss << "\n Offending character: " << static_cast<char>(c);
-				return ss.str();
-			};
+		// Argument slots of a diagnostic. Tokenizer errors use line, col and character, parser errors also
+		// keep the token type and the attempted astnode type. location points to the offending token,
+		// which is only read when the diagnostic is formatted, so the token vector must outlive the report.
+		enum e_arg : sl_size { line_ = 0, col_, char_or_token_, node_ };
 
-			auto lexer_syntax_error = [](sl_size line, sl_size col, char8_t c, sl_string error="") {
-				std::stringstream ss;
+		// <@method:format> Formats a diagnostic made by one of the functions below.
+		inline sl_string format(const sl_diagnostic& d) {
+			const auto token_type = static_cast<tk::e_type>(d.args[char_or_token_]);
+			const auto* token = static_cast<const tk*>(d.location);
+			std::stringstream ss;
+			switch (static_cast<e_code>(d.code)) {
+			case e_code::invalid_char_:
 				ss << "\n[User Syntax Error]: ";
-				ss << "\nLexer syntax error at line: " << line << " column: " << col 
-					<< "\n Offending character: " << static_cast<char>(c) << "\nerror detail: " << error;
-				return ss.str();
-			};
-
-			auto programmer_logic_error = [](sl_size line, sl_size col, char8_t c, sl_string error="") {
-				std::stringstream ss;
+				ss << "\nInvalid character at line: " << d.args[line_] << " column: " << d.args[col_] << " \nerror detail: " << d.detail;
+				ss << "\n Offending character: " << static_cast<char>(d.args[char_or_token_]);
+				break;
+			case e_code::lexer_syntax_error_:
+				ss << "\n[User Syntax Error]: ";
+				ss << "\nLexer syntax error at line: " << d.args[line_] << " column: " << d.args[col_]
+					<< "\n Offending character: " << static_cast<char>(d.args[char_or_token_]) << "\nerror detail: " << d.detail;
+				break;
+			case e_code::tokenizer_logic_error_:
+				ss << "\n[Compiler programmer logic error]: ";
+				ss << "\nFailed to tokenize at line: " << d.args[line_] << " column: " << d.args[col_]
+					<< "\n Offending character: " << static_cast<char>(d.args[char_or_token_]) << " \nerror detail: " << d.detail;
+				break;
+			case e_code::parser_logic_error_:
 				ss << "\n[Compiler programmer logic error]: ";
-				ss << "\nFailed to tokenize at line: " << line << " column: " << col 
-					<< "\n Offending character: " << static_cast<char>(c) << " \nerror detail: " << error;
-				return ss.str();
-			};
+				ss << "\nFailed to parse astnode of type " << astnode::type_to_string(static_cast<astnode_enum>(d.args[node_])) <<
+					" at token: " << tk::type_to_string(token_type)
+					<< "\nline: " << d.args[line_]
+					<< "\ncolumn: " << d.args[col_]
+					<< "\nliteral: " << token->literal_str()
+					<< "\nerror detail: " << d.detail;
+				break;
+			case e_code::operation_missing_operand_:
+				ss << "\n[User Syntax Error]: ";
+				ss << "\nOperation missing operand at token: " << tk::type_to_string(token_type)
+					<< "\noperator: " << astnode::type_to_string(static_cast<astnode_enum>(d.args[node_]))
+					<< "\nline: " << d.args[line_]
+					<< "\ncolumn: " << d.args[col_]
+					<< "\nliteral: " << token->literal_str()
+					<< "\nerror detail: " << d.detail;
+				break;
+			case e_code::invalid_expression_:
+				ss << "\n[User Syntax Error]: ";
+				ss << "\nInvalid expression at token: " << tk::type_to_string(token_type)
+					<< "\nline: " << d.args[line_]
+					<< "\ncolumn: " << d.args[col_]
+					<< "\nliteral: " << token->literal_str()
+					<< "\nerror detail: " << d.detail;
+				break;
+			}
+			return ss.str();
+		}
+
+		// <@method:make_diagnostic> Records a tokenizer error at a character.
+		inline sl_diagnostic make_diagnostic(e_code code, sl_size line, sl_size col, char8_t c, const char* detail) {
+			return sl_diagnostic{ &format, static_cast<sl_uint32>(code), nullptr,
+				{ line, col, static_cast<sl_size>(c), 0 }, detail };
+		}
+
+		// <@method:make_diagnostic> Records a parser error at a token.
+		inline sl_diagnostic make_diagnostic(e_code code, tk_vector_cit error_location, astnode_enum attempted_type, const char* detail) {
+			return sl_diagnostic{ &format, static_cast<sl_uint32>(code), &*error_location,
+				{ error_location->line(), error_location->col(), static_cast<sl_size>(error_location->type()),
+					static_cast<sl_size>(attempted_type) }, detail };
+		}
+
+		// Each error comes in two forms. Given a literal detail it returns an unformatted sl_diagnostic, which
+		// costs nothing when a speculative parse throws it away. Given a built detail string it formats at once.
+		namespace tokenizer {
+			inline sl_diagnostic invalid_char(sl_size line, sl_size col, char8_t c, const char* error = "") {
+				return make_diagnostic(e_code::invalid_char_, line, col, c, error);
+			}
+			inline sl_string invalid_char(sl_size line, sl_size col, char8_t c, const sl_string& error) {
+				return format(invalid_char(line, col, c, error.c_str()));
+			}
+
+			inline sl_diagnostic lexer_syntax_error(sl_size line, sl_size col, char8_t c, const char* error = "") {
+				return make_diagnostic(e_code::lexer_syntax_error_, line, col, c, error);
+			}
+			inline sl_string lexer_syntax_error(sl_size line, sl_size col, char8_t c, const sl_string& error) {
+				return format(lexer_syntax_error(line, col, c, error.c_str()));
+			}
+
+			inline sl_diagnostic programmer_logic_error(sl_size line, sl_size col, char8_t c, const char* error = "") {
+				return make_diagnostic(e_code::tokenizer_logic_error_, line, col, c, error);
+			}
+			inline sl_string programmer_logic_error(sl_size line, sl_size col, char8_t c, const sl_string& error) {
+				return format(programmer_logic_error(line, col, c, error.c_str()));
+			}
 		}
 		namespace parser {
-			auto programmer_logic_error = [](astnode_enum attempted_astnode_type, tk_vector_cit error_location, sl_string error_message = "") {
-				std::stringstream ss;
-				ss << "\n[Compiler programmer logic error]: ";
-				ss << "\nFailed to parse astnode of type " << astnode::type_to_string(attempted_astnode_type) << 
-					" at token: " << tk::type_to_string(error_location->type()) 
-					<< "\nline: " << error_location->line() 
-					<< "\ncolumn: " << error_location->col() 
-					<< "\nliteral: " << error_location->literal_str()
-					<< "\nerror detail: " << error_message;
-				return ss.str();
-			};
+			inline sl_diagnostic programmer_logic_error(astnode_enum attempted_astnode_type, tk_vector_cit error_location, const char* error_message = "") {
+				return make_diagnostic(e_code::parser_logic_error_, error_location, attempted_astnode_type, error_message);
+			}
+			inline sl_string programmer_logic_error(astnode_enum attempted_astnode_type, tk_vector_cit error_location, const sl_string& error_message) {
+				return format(programmer_logic_error(attempted_astnode_type, error_location, error_message.c_str()));
+			}
 
-			auto operation_missing_operand = [](astnode_enum attempted_operator_type,tk_vector_cit error_location, sl_string error_message = "") {
-				std::stringstream ss;
-				ss << "\n[User Syntax Error]: ";
-				ss << "\nOperation missing operand at token: " << tk::type_to_string(error_location->type()) 
-					<< "\noperator: " << astnode::type_to_string(attempted_operator_type)
-					<< "\nline: " << error_location->line() 
-					<< "\ncolumn: " << error_location->col() 
-					<< "\nliteral: " << error_location->literal_str()
-					<< "\nerror detail: " << error_message;
-				return ss.str();
-			};
+			inline sl_diagnostic operation_missing_operand(astnode_enum attempted_operator_type, tk_vector_cit error_location, const char* error_message = "") {
+				return make_diagnostic(e_code::operation_missing_operand_, error_location, attempted_operator_type, error_message);
+			}
+			inline sl_string operation_missing_operand(astnode_enum attempted_operator_type, tk_vector_cit error_location, const sl_string& error_message) {
+				return format(operation_missing_operand(attempted_operator_type, error_location, error_message.c_str()));
+			}
 
-			auto invalid_expression = [](tk_vector_cit error_location, sl_string error_message = "") {
-				std::stringstream ss;
-				ss << "\n[User Syntax Error]: ";
-				ss << "\nInvalid expression at token: " << tk::type_to_string(error_location->type()) 
-					<< "\nline: " << error_location->line() 
-					<< "\ncolumn: " << error_location->col() 
-					<< "\nliteral: " << error_location->literal_str()
-					<< "\nerror detail: " << error_message;
-				return ss.str();
-			};
+			inline sl_diagnostic invalid_expression(tk_vector_cit error_location, const char* error_message = "") {
+				return make_diagnostic(e_code::invalid_expression_, error_location, astnode_enum{}, error_message);
+			}
+			inline sl_string invalid_expression(tk_vector_cit error_location, const sl_string& error_message) {
+				return format(invalid_expression(error_location, error_message.c_str()));
+			}
 		}
 	}
 }
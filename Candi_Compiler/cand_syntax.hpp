@@ -551,6 +551,290 @@ enum class e_ast : int {
 
 };
 
+//---------------------------------------------------------------------------------------------------------------------//
+// Syntax metadata tables
+//---------------------------------------------------------------------------------------------------------------------//
+// One row per enumerator, in enum order starting from none_ (-1). Every per token query is a single indexed load.
+// Adding an enumerator requires adding its row at the same position, the static_asserts below check the order.
+namespace syntax_flag {
+	enum e_syntax_flag : sl_uint32 {
+		none_ = 0,
+		keyword_ = 1 << 0,
+		opening_scope_ = 1 << 1,
+		closing_scope_ = 1 << 2
+	};
+}
+
+struct tk_traits {
+	e_tk type;
+	sl_string_view name;
+	priority::e_priority priority;
+	e_assoc assoc;
+	e_operation operation;
+	e_ast ast_type;
+	sl_uint32 flags;
+};
+
+struct ast_traits {
+	e_ast type;
+	sl_string_view name;
+	sl_uint32 flags;
+};
+
+SL_CXIN tk_traits tk_traits_table[] = {
+	// type, name, priority, assoc, operation, ast type, flags
+	{ e_tk::none_, "none", priority::none_, e_assoc::none_, e_operation::none_, e_ast::none_, syntax_flag::none_ },
+	{ e_tk::invalid_, "invalid", priority::none_, e_assoc::none_, e_operation::none_, e_ast::invalid_, syntax_flag::none_ },
+	{ e_tk::eof_, "eof", priority::none_, e_assoc::none_, e_operation::none_, e_ast::eof_, syntax_flag::none_ },
+	{ e_tk::line_comment_, "line_comment", priority::none_, e_assoc::none_, e_operation::none_, e_ast::line_comment_, syntax_flag::none_ },
+	{ e_tk::block_comment_, "block_comment", priority::none_, e_assoc::none_, e_operation::none_, e_ast::block_comment_, syntax_flag::none_ },
+	{ e_tk::newline_, "newline", priority::none_, e_assoc::none_, e_operation::none_, e_ast::newline_, syntax_flag::none_ },
+	{ e_tk::whitespace_, "whitespace", priority::none_, e_assoc::none_, e_operation::none_, e_ast::whitespace_, syntax_flag::none_ },
+	{ e_tk::string_literal_, "string_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::string_literal_, syntax_flag::none_ },
+	{ e_tk::number_literal_, "number_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::number_literal_, syntax_flag::none_ },
+	{ e_tk::real_literal_, "real_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::real_literal_, syntax_flag::none_ },
+	{ e_tk::byte_literal_, "byte_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::byte_literal_, syntax_flag::none_ },
+	{ e_tk::bit_literal_, "bit_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::bit_literal_, syntax_flag::none_ },
+	{ e_tk::unsigned_literal_, "unsigned_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::unsigned_literal_, syntax_flag::none_ },
+	{ e_tk::alnumus_, "alnumus", priority::max_, e_assoc::none_, e_operation::none_, e_ast::alnumus_, syntax_flag::none_ },
+	{ e_tk::simple_assignment_, "simple_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::simple_assignment_, syntax_flag::none_ },
+	{ e_tk::addition_assignment_, "addition_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::addition_assignment_, syntax_flag::none_ },
+	{ e_tk::subtraction_assignment_, "subtraction_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::subtraction_assignment_, syntax_flag::none_ },
+	{ e_tk::multiplication_assignment_, "multiplication_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::multiplication_assignment_, syntax_flag::none_ },
+	{ e_tk::division_assignment_, "division_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::division_assignment_, syntax_flag::none_ },
+	{ e_tk::remainder_assignment_, "remainder_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::remainder_assignment_, syntax_flag::none_ },
+	{ e_tk::bitwise_and_assignment_, "bitwise_and_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::bitwise_and_assignment_, syntax_flag::none_ },
+	{ e_tk::bitwise_or_assignment_, "bitwise_or_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::bitwise_or_assignment_, syntax_flag::none_ },
+	{ e_tk::bitwise_xor_assignment_, "bitwise_xor_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::bitwise_xor_assignment_, syntax_flag::none_ },
+	{ e_tk::left_shift_assignment_, "left_shift_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::left_shift_assignment_, syntax_flag::none_ },
+	{ e_tk::right_shift_assignment_, "right_shift_assignment", priority::assignment_, e_assoc::right_, e_operation::binary_, e_ast::right_shift_assignment_, syntax_flag::none_ },
+	{ e_tk::increment_, "increment", priority::postfix_, e_assoc::left_, e_operation::postfix_, e_ast::increment_, syntax_flag::none_ },
+	{ e_tk::decrement_, "decrement", priority::postfix_, e_assoc::left_, e_operation::postfix_, e_ast::decrement_, syntax_flag::none_ },
+	{ e_tk::addition_, "addition", priority::term_, e_assoc::left_, e_operation::binary_, e_ast::addition_, syntax_flag::none_ },
+	{ e_tk::subtraction_, "subtraction", priority::term_, e_assoc::left_, e_operation::binary_, e_ast::subtraction_, syntax_flag::none_ },
+	{ e_tk::multiplication_, "multiplication", priority::factor_, e_assoc::left_, e_operation::binary_, e_ast::multiplication_, syntax_flag::none_ },
+	{ e_tk::division_, "division", priority::factor_, e_assoc::left_, e_operation::binary_, e_ast::division_, syntax_flag::none_ },
+	{ e_tk::remainder_, "remainder", priority::factor_, e_assoc::left_, e_operation::binary_, e_ast::remainder_, syntax_flag::none_ },
+	{ e_tk::bitwise_and_, "bitwise_and", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::bitwise_and_, syntax_flag::none_ },
+	{ e_tk::bitwise_or_, "bitwise_or", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::bitwise_or_, syntax_flag::none_ },
+	{ e_tk::bitwise_xor_, "bitwise_xor", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::bitwise_xor_, syntax_flag::none_ },
+	{ e_tk::bitwise_left_shift_, "bitwise_left_shift", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::bitwise_left_shift_, syntax_flag::none_ },
+	{ e_tk::bitwise_right_shift_, "bitwise_right_shift", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::bitwise_right_shift_, syntax_flag::none_ },
+	{ e_tk::negation_, "negation", priority::prefix_, e_assoc::right_, e_operation::prefix_, e_ast::negation_, syntax_flag::none_ },
+	{ e_tk::bitwise_not_, "bitwise_not", priority::prefix_, e_assoc::right_, e_operation::prefix_, e_ast::bitwise_not_, syntax_flag::none_ },
+	{ e_tk::logical_and_, "logical_and", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::logical_and_, syntax_flag::none_ },
+	{ e_tk::logical_or_, "logical_or", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::logical_or_, syntax_flag::none_ },
+	{ e_tk::equal_, "equal", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::equal_, syntax_flag::none_ },
+	{ e_tk::not_equal_, "not_equal", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::not_equal_, syntax_flag::none_ },
+	{ e_tk::less_than_, "less_than", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::less_than_, syntax_flag::none_ },
+	{ e_tk::greater_than_, "greater_than", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::greater_than_, syntax_flag::none_ },
+	{ e_tk::less_than_or_equal_, "less_than_or_equal", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::less_than_or_equal_, syntax_flag::none_ },
+	{ e_tk::greater_than_or_equal_, "greater_than_or_equal", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::greater_than_or_equal_, syntax_flag::none_ },
+	{ e_tk::three_way_comparison_, "three_way_comparison", priority::comparison_, e_assoc::left_, e_operation::binary_, e_ast::three_way_comparison_, syntax_flag::none_ },
+	{ e_tk::open_paren_, "(", priority::postfix_, e_assoc::none_, e_operation::postfix_, e_ast::open_paren_, syntax_flag::opening_scope_ },
+	{ e_tk::close_paren_, ")", priority::postfix_, e_assoc::none_, e_operation::postfix_, e_ast::close_paren_, syntax_flag::closing_scope_ },
+	{ e_tk::open_brace_, "open_brace", priority::postfix_, e_assoc::none_, e_operation::postfix_, e_ast::open_brace_, syntax_flag::opening_scope_ },
+	{ e_tk::close_brace_, "close_brace", priority::postfix_, e_assoc::none_, e_operation::postfix_, e_ast::close_brace_, syntax_flag::closing_scope_ },
+	{ e_tk::open_bracket_, "open_bracket", priority::postfix_, e_assoc::none_, e_operation::postfix_, e_ast::open_bracket_, syntax_flag::opening_scope_ },
+	{ e_tk::close_bracket_, "close_bracket", priority::postfix_, e_assoc::none_, e_operation::postfix_, e_ast::close_bracket_, syntax_flag::closing_scope_ },
+	{ e_tk::semicolon_, "semicolon", priority::max_, e_assoc::none_, e_operation::none_, e_ast::semicolon_, syntax_flag::none_ },
+	{ e_tk::colon_, "colon", priority::max_, e_assoc::none_, e_operation::none_, e_ast::colon_, syntax_flag::none_ },
+	{ e_tk::comma_, "comma", priority::max_, e_assoc::none_, e_operation::none_, e_ast::comma_, syntax_flag::none_ },
+	{ e_tk::period_, "period", priority::access_, e_assoc::left_, e_operation::binary_, e_ast::period_, syntax_flag::none_ },
+	{ e_tk::ellipsis_, "ellipsis", priority::max_, e_assoc::right_, e_operation::binary_, e_ast::ellipsis_, syntax_flag::none_ },
+	{ e_tk::commerical_at_, "commerical_at", priority::max_, e_assoc::right_, e_operation::prefix_, e_ast::commerical_at_, syntax_flag::none_ },
+	{ e_tk::none_literal_, "none_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::none_literal_, syntax_flag::keyword_ },
+	{ e_tk::true_literal_, "true_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::true_literal_, syntax_flag::keyword_ },
+	{ e_tk::false_literal_, "false_literal", priority::max_, e_assoc::none_, e_operation::none_, e_ast::false_literal_, syntax_flag::keyword_ },
+	{ e_tk::type_, "type", priority::max_, e_assoc::none_, e_operation::none_, e_ast::type_, syntax_flag::keyword_ },
+	{ e_tk::identity_, "identity", priority::max_, e_assoc::none_, e_operation::none_, e_ast::identity_, syntax_flag::keyword_ },
+	{ e_tk::value_, "value", priority::max_, e_assoc::none_, e_operation::none_, e_ast::value_, syntax_flag::keyword_ },
+	{ e_tk::int_, "int", priority::max_, e_assoc::none_, e_operation::none_, e_ast::int_, syntax_flag::keyword_ },
+	{ e_tk::uint_, "uint", priority::max_, e_assoc::none_, e_operation::none_, e_ast::uint_, syntax_flag::keyword_ },
+	{ e_tk::real_, "real", priority::max_, e_assoc::none_, e_operation::none_, e_ast::real_, syntax_flag::keyword_ },
+	{ e_tk::byte_, "byte", priority::max_, e_assoc::none_, e_operation::none_, e_ast::byte_, syntax_flag::keyword_ },
+	{ e_tk::bit_, "bit", priority::max_, e_assoc::none_, e_operation::none_, e_ast::bit_, syntax_flag::keyword_ },
+	{ e_tk::str_, "str", priority::max_, e_assoc::none_, e_operation::none_, e_ast::str_, syntax_flag::keyword_ },
+	{ e_tk::array_, "array", priority::max_, e_assoc::none_, e_operation::none_, e_ast::array_, syntax_flag::none_ },
+	{ e_tk::pointer_, "pointer", priority::max_, e_assoc::none_, e_operation::none_, e_ast::pointer_, syntax_flag::none_ },
+	{ e_tk::memory_, "memory", priority::max_, e_assoc::none_, e_operation::none_, e_ast::memory_, syntax_flag::none_ },
+	{ e_tk::function_, "function", priority::max_, e_assoc::none_, e_operation::none_, e_ast::function_, syntax_flag::none_ },
+	{ e_tk::include_, "include", priority::max_, e_assoc::none_, e_operation::none_, e_ast::include_, syntax_flag::keyword_ },
+	{ e_tk::macro_, "macro", priority::max_, e_assoc::none_, e_operation::none_, e_ast::macro_, syntax_flag::keyword_ },
+	{ e_tk::endmacro_, "endmacro", priority::max_, e_assoc::none_, e_operation::none_, e_ast::endmacro_, syntax_flag::keyword_ },
+	{ e_tk::enter_, "enter", priority::max_, e_assoc::none_, e_operation::none_, e_ast::enter_, syntax_flag::keyword_ },
+	{ e_tk::start_, "start", priority::max_, e_assoc::none_, e_operation::none_, e_ast::start_, syntax_flag::keyword_ },
+	{ e_tk::use_, "use", priority::max_, e_assoc::none_, e_operation::none_, e_ast::use_, syntax_flag::keyword_ },
+	{ e_tk::class_, "class", priority::max_, e_assoc::none_, e_operation::none_, e_ast::class_, syntax_flag::keyword_ },
+	{ e_tk::obj_, "obj", priority::max_, e_assoc::none_, e_operation::none_, e_ast::obj_, syntax_flag::keyword_ },
+	{ e_tk::print_, "print", priority::max_, e_assoc::none_, e_operation::none_, e_ast::print_, syntax_flag::keyword_ },
+	{ e_tk::private_, "private", priority::max_, e_assoc::none_, e_operation::none_, e_ast::private_, syntax_flag::keyword_ },
+	{ e_tk::public_, "public", priority::max_, e_assoc::none_, e_operation::none_, e_ast::public_, syntax_flag::keyword_ },
+	{ e_tk::const_, "const", priority::max_, e_assoc::none_, e_operation::none_, e_ast::const_, syntax_flag::keyword_ },
+	{ e_tk::static_, "static", priority::max_, e_assoc::none_, e_operation::none_, e_ast::static_, syntax_flag::keyword_ },
+	{ e_tk::ref_, "ref", priority::max_, e_assoc::none_, e_operation::none_, e_ast::ref_, syntax_flag::none_ },
+	{ e_tk::if_, "if", priority::max_, e_assoc::none_, e_operation::none_, e_ast::if_, syntax_flag::keyword_ },
+	{ e_tk::else_, "else", priority::max_, e_assoc::none_, e_operation::none_, e_ast::else_, syntax_flag::keyword_ },
+	{ e_tk::elif_, "elif", priority::max_, e_assoc::none_, e_operation::none_, e_ast::elif_, syntax_flag::keyword_ },
+	{ e_tk::while_, "while", priority::max_, e_assoc::none_, e_operation::none_, e_ast::while_, syntax_flag::keyword_ },
+	{ e_tk::for_, "for", priority::max_, e_assoc::none_, e_operation::none_, e_ast::for_, syntax_flag::keyword_ },
+	{ e_tk::switch_, "switch", priority::max_, e_assoc::none_, e_operation::none_, e_ast::switch_, syntax_flag::keyword_ },
+	{ e_tk::case_, "case", priority::max_, e_assoc::none_, e_operation::none_, e_ast::case_, syntax_flag::keyword_ },
+	{ e_tk::default_, "default", priority::max_, e_assoc::none_, e_operation::none_, e_ast::default_, syntax_flag::keyword_ },
+	{ e_tk::break_, "break", priority::max_, e_assoc::none_, e_operation::none_, e_ast::break_, syntax_flag::keyword_ },
+	{ e_tk::continue_, "continue", priority::max_, e_assoc::none_, e_operation::none_, e_ast::continue_, syntax_flag::keyword_ },
+	{ e_tk::return_, "return", priority::max_, e_assoc::none_, e_operation::none_, e_ast::return_, syntax_flag::keyword_ },
+};
+
+SL_CXIN ast_traits ast_traits_table[] = {
+	// type, name, flags
+	{ e_ast::none_, "none", syntax_flag::none_ },
+	{ e_ast::invalid_, "invalid", syntax_flag::none_ },
+	{ e_ast::eof_, "eof", syntax_flag::none_ },
+	{ e_ast::line_comment_, "line_comment", syntax_flag::none_ },
+	{ e_ast::block_comment_, "block_comment", syntax_flag::none_ },
+	{ e_ast::newline_, "newline", syntax_flag::none_ },
+	{ e_ast::whitespace_, "whitespace", syntax_flag::none_ },
+	{ e_ast::string_literal_, "string_literal", syntax_flag::none_ },
+	{ e_ast::number_literal_, "number_literal", syntax_flag::none_ },
+	{ e_ast::real_literal_, "real_literal", syntax_flag::none_ },
+	{ e_ast::byte_literal_, "byte_literal", syntax_flag::none_ },
+	{ e_ast::bit_literal_, "bit_literal", syntax_flag::none_ },
+	{ e_ast::unsigned_literal_, "unsigned_literal", syntax_flag::none_ },
+	{ e_ast::alnumus_, "alnumus", syntax_flag::none_ },
+	{ e_ast::simple_assignment_, "simple_assignment", syntax_flag::none_ },
+	{ e_ast::addition_assignment_, "addition_assignment", syntax_flag::none_ },
+	{ e_ast::subtraction_assignment_, "subtraction_assignment", syntax_flag::none_ },
+	{ e_ast::multiplication_assignment_, "multiplication_assignment", syntax_flag::none_ },
+	{ e_ast::division_assignment_, "division_assignment", syntax_flag::none_ },
+	{ e_ast::remainder_assignment_, "remainder_assignment", syntax_flag::none_ },
+	{ e_ast::bitwise_and_assignment_, "bitwise_and_assignment", syntax_flag::none_ },
+	{ e_ast::bitwise_or_assignment_, "bitwise_or_assignment", syntax_flag::none_ },
+	{ e_ast::bitwise_xor_assignment_, "bitwise_xor_assignment", syntax_flag::none_ },
+	{ e_ast::left_shift_assignment_, "left_shift_assignment", syntax_flag::none_ },
+	{ e_ast::right_shift_assignment_, "right_shift_assignment", syntax_flag::none_ },
+	{ e_ast::increment_, "increment", syntax_flag::none_ },
+	{ e_ast::decrement_, "decrement", syntax_flag::none_ },
+	{ e_ast::addition_, "addition", syntax_flag::none_ },
+	{ e_ast::subtraction_, "subtraction", syntax_flag::none_ },
+	{ e_ast::multiplication_, "multiplication", syntax_flag::none_ },
+	{ e_ast::division_, "division", syntax_flag::none_ },
+	{ e_ast::remainder_, "remainder", syntax_flag::none_ },
+	{ e_ast::bitwise_and_, "bitwise_and", syntax_flag::none_ },
+	{ e_ast::bitwise_or_, "bitwise_or", syntax_flag::none_ },
+	{ e_ast::bitwise_xor_, "bitwise_xor", syntax_flag::none_ },
+	{ e_ast::bitwise_left_shift_, "bitwise_left_shift", syntax_flag::none_ },
+	{ e_ast::bitwise_right_shift_, "bitwise_right_shift", syntax_flag::none_ },
+	{ e_ast::bitwise_not_, "bitwise_not", syntax_flag::none_ },
+	{ e_ast::negation_, "negation", syntax_flag::none_ },
+	{ e_ast::logical_and_, "logical_and", syntax_flag::none_ },
+	{ e_ast::logical_or_, "logical_or", syntax_flag::none_ },
+	{ e_ast::equal_, "equal", syntax_flag::none_ },
+	{ e_ast::not_equal_, "not_equal", syntax_flag::none_ },
+	{ e_ast::less_than_, "less_than", syntax_flag::none_ },
+	{ e_ast::greater_than_, "greater_than", syntax_flag::none_ },
+	{ e_ast::less_than_or_equal_, "less_than_or_equal", syntax_flag::none_ },
+	{ e_ast::greater_than_or_equal_, "greater_than_or_equal", syntax_flag::none_ },
+	{ e_ast::three_way_comparison_, "three_way_comparison", syntax_flag::none_ },
+	{ e_ast::open_paren_, "open_paren", syntax_flag::none_ },
+	{ e_ast::close_paren_, "close_paren", syntax_flag::none_ },
+	{ e_ast::open_brace_, "open_brace", syntax_flag::none_ },
+	{ e_ast::close_brace_, "close_brace", syntax_flag::none_ },
+	{ e_ast::open_bracket_, "open_bracket", syntax_flag::none_ },
+	{ e_ast::close_bracket_, "close_bracket", syntax_flag::none_ },
+	{ e_ast::semicolon_, "semicolon", syntax_flag::none_ },
+	{ e_ast::colon_, "colon", syntax_flag::none_ },
+	{ e_ast::comma_, "comma", syntax_flag::none_ },
+	{ e_ast::period_, "period", syntax_flag::none_ },
+	{ e_ast::ellipsis_, "ellipsis", syntax_flag::none_ },
+	{ e_ast::commerical_at_, "commerical_at", syntax_flag::none_ },
+	{ e_ast::none_literal_, "none_literal", syntax_flag::keyword_ },
+	{ e_ast::true_literal_, "true_literal", syntax_flag::keyword_ },
+	{ e_ast::false_literal_, "false_literal", syntax_flag::keyword_ },
+	{ e_ast::type_, "type", syntax_flag::keyword_ },
+	{ e_ast::identity_, "identity", syntax_flag::keyword_ },
+	{ e_ast::value_, "value", syntax_flag::keyword_ },
+	{ e_ast::int_, "int", syntax_flag::keyword_ },
+	{ e_ast::uint_, "uint", syntax_flag::keyword_ },
+	{ e_ast::real_, "real", syntax_flag::keyword_ },
+	{ e_ast::byte_, "byte", syntax_flag::keyword_ },
+	{ e_ast::bit_, "bit", syntax_flag::keyword_ },
+	{ e_ast::str_, "str", syntax_flag::keyword_ },
+	{ e_ast::array_, "array", syntax_flag::none_ },
+	{ e_ast::pointer_, "pointer", syntax_flag::none_ },
+	{ e_ast::memory_, "memory", syntax_flag::none_ },
+	{ e_ast::function_, "function", syntax_flag::none_ },
+	{ e_ast::include_, "include", syntax_flag::keyword_ },
+	{ e_ast::macro_, "macro", syntax_flag::keyword_ },
+	{ e_ast::endmacro_, "endmacro", syntax_flag::keyword_ },
+	{ e_ast::enter_, "enter", syntax_flag::keyword_ },
+	{ e_ast::start_, "start", syntax_flag::keyword_ },
+	{ e_ast::use_, "use", syntax_flag::keyword_ },
+	{ e_ast::class_, "class", syntax_flag::keyword_ },
+	{ e_ast::obj_, "obj", syntax_flag::keyword_ },
+	{ e_ast::print_, "print", syntax_flag::keyword_ },
+	{ e_ast::private_, "private", syntax_flag::keyword_ },
+	{ e_ast::public_, "public", syntax_flag::keyword_ },
+	{ e_ast::const_, "const", syntax_flag::keyword_ },
+	{ e_ast::static_, "static", syntax_flag::keyword_ },
+	{ e_ast::ref_, "ref", syntax_flag::none_ },
+	{ e_ast::if_, "if", syntax_flag::keyword_ },
+	{ e_ast::else_, "else", syntax_flag::keyword_ },
+	{ e_ast::elif_, "elif", syntax_flag::keyword_ },
+	{ e_ast::while_, "while", syntax_flag::keyword_ },
+	{ e_ast::for_, "for", syntax_flag::keyword_ },
+	{ e_ast::switch_, "switch", syntax_flag::keyword_ },
+	{ e_ast::case_, "case", syntax_flag::keyword_ },
+	{ e_ast::default_, "default", syntax_flag::keyword_ },
+	{ e_ast::break_, "break", syntax_flag::keyword_ },
+	{ e_ast::continue_, "continue", syntax_flag::keyword_ },
+	{ e_ast::return_, "return", syntax_flag::keyword_ },
+	{ e_ast::statement_, "statement", syntax_flag::none_ },
+	{ e_ast::expression_, "expression", syntax_flag::none_ },
+	{ e_ast::program_, "program", syntax_flag::none_ },
+	{ e_ast::pragmatic_block_, "pragmatic_block", syntax_flag::none_ },
+	{ e_ast::functional_block_, "functional_block", syntax_flag::none_ },
+	{ e_ast::conditional_block_, "conditional_block", syntax_flag::none_ },
+	{ e_ast::iterative_block_, "iterative_block", syntax_flag::none_ },
+	{ e_ast::parameter_, "parameter", syntax_flag::none_ },
+	{ e_ast::parameter_list_, "parameter_list", syntax_flag::none_ },
+	{ e_ast::type_constraints_, "type_constraints", syntax_flag::none_ },
+	{ e_ast::capture_list_, "capture_list", syntax_flag::none_ },
+	{ e_ast::subexpression_, "subexpression", syntax_flag::none_ },
+	{ e_ast::type_list_, "type_list", syntax_flag::none_ },
+	{ e_ast::generic_list_, "generic_list", syntax_flag::none_ },
+	{ e_ast::function_call_, "function_call", syntax_flag::none_ },
+	{ e_ast::arguments_, "arguments", syntax_flag::none_ },
+	{ e_ast::type_call_, "type_call", syntax_flag::none_ },
+	{ e_ast::type_arguments_, "type_arguments", syntax_flag::none_ },
+	{ e_ast::index_operator_, "index_operator", syntax_flag::none_ },
+	{ e_ast::index_arguments_, "index_arguments", syntax_flag::none_ },
+	{ e_ast::unary_minus_, "unary_minus", syntax_flag::none_ },
+	{ e_ast::dereference_, "dereference", syntax_flag::none_ },
+	{ e_ast::address_of_, "address_of", syntax_flag::none_ },
+};
+
+template<typename TableT>
+SL_CE bool syntax_table_in_enum_order(const TableT& table) {
+	for (sl_size i = 0; i < std::size(table); i++)
+		if (static_cast<int>(table[i].type) != static_cast<int>(i) - 1) return false;
+	return true;
+}
+static_assert(std::size(tk_traits_table) == static_cast<sl_size>(e_tk::return_) + 2 && syntax_table_in_enum_order(tk_traits_table),
+	"tk_traits_table must have one row per e_tk enumerator, in enum order.");
+static_assert(std::size(ast_traits_table) == static_cast<sl_size>(e_ast::address_of_) + 2 && syntax_table_in_enum_order(ast_traits_table),
+	"ast_traits_table must have one row per e_ast enumerator, in enum order.");
+
+// Values out of the enum's range get the row of none_.
+SL_CX const tk_traits& tk_type_traits(e_tk t) {
+	const sl_size index = static_cast<sl_size>(static_cast<int>(t) + 1);
+	return index < std::size(tk_traits_table) ? tk_traits_table[index] : tk_traits_table[0];
+}
+SL_CX const ast_traits& ast_type_traits(e_ast a) {
+	const sl_size index = static_cast<sl_size>(static_cast<int>(a) + 1);
+	return index < std::size(ast_traits_table) ? ast_traits_table[index] : ast_traits_table[0];
+}
+
 // enum string conversions
 namespace sl {
 	SL_CXIN sl_string to_str(e_assoc a)
@@ -599,736 +883,17 @@ namespace sl {
 		default: return "priority::e_priority invalid enum value";
 		}
 	}
-	SL_CXIN sl_string to_str(e_tk t) {
-		switch (t) {
-		case e_tk::none_: return "none";
-		case e_tk::invalid_: return "invalid";
-		case e_tk::eof_: return "eof";
-		case e_tk::line_comment_: return "line_comment";
-		case e_tk::block_comment_: return "block_comment";
-		case e_tk::newline_: return "newline";
-		case e_tk::whitespace_: return "whitespace";
-		case e_tk::string_literal_: return "string_literal";
-		case e_tk::number_literal_: return "number_literal";
-		case e_tk::real_literal_: return "real_literal";
-		case e_tk::byte_literal_: return "byte_literal";
-		case e_tk::bit_literal_: return "bit_literal";
-		case e_tk::unsigned_literal_: return "unsigned_literal";
-		case e_tk::alnumus_: return "alnumus";
-		case e_tk::simple_assignment_: return "simple_assignment";
-		case e_tk::addition_assignment_: return "addition_assignment";
-		case e_tk::subtraction_assignment_: return "subtraction_assignment";
-		case e_tk::multiplication_assignment_: return "multiplication_assignment";
-		case e_tk::division_assignment_: return "division_assignment";
-		case e_tk::remainder_assignment_: return "remainder_assignment";
-		case e_tk::bitwise_and_assignment_: return "bitwise_and_assignment";
-		case e_tk::bitwise_or_assignment_: return "bitwise_or_assignment";
-		case e_tk::bitwise_xor_assignment_: return "bitwise_xor_assignment";
-		case e_tk::left_shift_assignment_: return "left_shift_assignment";
-		case e_tk::right_shift_assignment_: return "right_shift_assignment";
-		case e_tk::increment_: return "increment";
-		case e_tk::decrement_: return "decrement";
-		case e_tk::addition_: return "addition";
-		case e_tk::subtraction_: return "subtraction";
-		case e_tk::multiplication_: return "multiplication";
-		case e_tk::division_: return "division";
-		case e_tk::remainder_: return "remainder";
-		case e_tk::bitwise_not_: return "bitwise_not";
-		case e_tk::bitwise_and_: return "bitwise_and";
-		case e_tk::bitwise_or_: return "bitwise_or";
-		case e_tk::bitwise_xor_: return "bitwise_xor";
-		case e_tk::bitwise_left_shift_: return "bitwise_left_shift";
-		case e_tk::bitwise_right_shift_: return "bitwise_right_shift";
-		case e_tk::negation_: return "negation";
-		case e_tk::logical_and_: return "logical_and";
-		case e_tk::logical_or_: return "logical_or";
-		case e_tk::equal_: return "equal";
-		case e_tk::not_equal_: return "not_equal";
-		case e_tk::less_than_: return "less_than";
-		case e_tk::greater_than_: return "greater_than";
-		case e_tk::less_than_or_equal_: return "less_than_or_equal";
-		case e_tk::greater_than_or_equal_: return "greater_than_or_equal";
-		case e_tk::three_way_comparison_: return "three_way_comparison";
-		case e_tk::open_paren_: return "(";//"open_paren";
-		case e_tk::close_paren_: return ")";//"close_paren";
-		case e_tk::open_brace_: return "open_brace";
-		case e_tk::close_brace_: return "close_brace";
-		case e_tk::open_bracket_: return "open_bracket";
-		case e_tk::close_bracket_: return "close_bracket";
-		case e_tk::semicolon_: return "semicolon";
-		case e_tk::colon_: return "colon";
-		case e_tk::comma_: return "comma";
-		case e_tk::period_: return "period";
-		case e_tk::ellipsis_: return "ellipsis";
-		case e_tk::commerical_at_: return "commerical_at";
-		case e_tk::none_literal_: return "none_literal";
-		case e_tk::true_literal_: return "true_literal";
-		case e_tk::false_literal_: return "false_literal";
-		case e_tk::type_: return "type";
-		case e_tk::identity_: return "identity";
-		case e_tk::value_: return "value";
-		case e_tk::int_: return "int";
-		case e_tk::uint_: return "uint";
-		case e_tk::real_: return "real";
-		case e_tk::byte_: return "byte";
-		case e_tk::bit_: return "bit";
-		case e_tk::str_: return "str";
-		case e_tk::array_: return "array";
-		case e_tk::pointer_: return "pointer";
-		case e_tk::memory_: return "memory";
-		case e_tk::function_: return "function";
-		case e_tk::include_: return "include";
-		case e_tk::macro_: return "macro";
-		case e_tk::endmacro_: return "endmacro";
-		case e_tk::enter_: return "enter";
-		case e_tk::start_: return "start";
-		case e_tk::use_: return "use";
-		case e_tk::class_: return "class";
-		case e_tk::obj_: return "obj";
-		case e_tk::print_: return "print";
-		case e_tk::private_: return "private";
-		case e_tk::public_: return "public";
-		case e_tk::const_: return "const";
-		case e_tk::static_: return "static";
-		case e_tk::ref_: return "ref";
-		case e_tk::if_: return "if";
-		case e_tk::else_: return "else";
-		case e_tk::elif_: return "elif";
-		case e_tk::while_: return "while";
-		case e_tk::for_: return "for";
-		case e_tk::switch_: return "switch";
-		case e_tk::case_: return "case";
-		case e_tk::default_: return "default";
-		case e_tk::break_: return "break";
-		case e_tk::continue_: return "continue";
-		case e_tk::return_: return "return";
-		default: return "e_tk invalid enum value";
-		}
-	}
-	SL_CXIN sl_string to_str(e_ast t) {
-		switch (t) {
-		case e_ast::none_: return "none";
-		case e_ast::invalid_: return "invalid";
-		case e_ast::eof_: return "eof";
-		case e_ast::line_comment_: return "line_comment";
-		case e_ast::block_comment_: return "block_comment";
-		case e_ast::newline_: return "newline";
-		case e_ast::whitespace_: return "whitespace";
-		case e_ast::string_literal_: return "string_literal";
-		case e_ast::number_literal_: return "number_literal";
-		case e_ast::real_literal_: return "real_literal";
-		case e_ast::byte_literal_: return "byte_literal";
-		case e_ast::bit_literal_: return "bit_literal";
-		case e_ast::unsigned_literal_: return "unsigned_literal";
-		case e_ast::alnumus_: return "alnumus";
-		case e_ast::simple_assignment_: return "simple_assignment";
-		case e_ast::addition_assignment_: return "addition_assignment";
-		case e_ast::subtraction_assignment_: return "subtraction_assignment";
-		case e_ast::multiplication_assignment_: return "multiplication_assignment";
-		case e_ast::division_assignment_: return "division_assignment";
-		case e_ast::remainder_assignment_: return "remainder_assignment";
-		case e_ast::bitwise_and_assignment_: return "bitwise_and_assignment";
-		case e_ast::bitwise_or_assignment_: return "bitwise_or_assignment";
-		case e_ast::bitwise_xor_assignment_: return "bitwise_xor_assignment";
-		case e_ast::left_shift_assignment_: return "left_shift_assignment";
-		case e_ast::right_shift_assignment_: return "right_shift_assignment";
-		case e_ast::increment_: return "increment";
-		case e_ast::decrement_: return "decrement";
-		case e_ast::addition_: return "addition";
-		case e_ast::subtraction_: return "subtraction";
-		case e_ast::multiplication_: return "multiplication";
-		case e_ast::division_: return "division";
-		case e_ast::remainder_: return "remainder";
-		case e_ast::bitwise_not_: return "bitwise_not";
-		case e_ast::bitwise_and_: return "bitwise_and";
-		case e_ast::bitwise_or_: return "bitwise_or";
-		case e_ast::bitwise_xor_: return "bitwise_xor";
-		case e_ast::bitwise_left_shift_: return "bitwise_left_shift";
-		case e_ast::bitwise_right_shift_: return "bitwise_right_shift";
-		case e_ast::negation_: return "negation";
-		case e_ast::logical_and_: return "logical_and";
-		case e_ast::logical_or_: return "logical_or";
-		case e_ast::equal_: return "equal";
-		case e_ast::not_equal_: return "not_equal";
-		case e_ast::less_than_: return "less_than";
-		case e_ast::greater_than_: return "greater_than";
-		case e_ast::less_than_or_equal_: return "less_than_or_equal";
-		case e_ast::greater_than_or_equal_: return "greater_than_or_equal";
-		case e_ast::three_way_comparison_: return "three_way_comparison";
-		case e_ast::open_paren_: return "open_paren";
-		case e_ast::close_paren_: return "close_paren";
-		case e_ast::open_brace_: return "open_brace";
-		case e_ast::close_brace_: return "close_brace";
-		case e_ast::open_bracket_: return "open_bracket";
-		case e_ast::close_bracket_: return "close_bracket";
-		case e_ast::semicolon_: return "semicolon";
-		case e_ast::colon_: return "colon";
-		case e_ast::comma_: return "comma";
-		case e_ast::period_: return "period";
-		case e_ast::ellipsis_: return "ellipsis";
-		case e_ast::commerical_at_: return "commerical_at";
-		case e_ast::none_literal_: return "none_literal";
-		case e_ast::true_literal_: return "true_literal";
-		case e_ast::false_literal_: return "false_literal";
-		case e_ast::type_: return "type";
-		case e_ast::identity_: return "identity";
-		case e_ast::value_: return "value";
-		case e_ast::int_: return "int";
-		case e_ast::uint_: return "uint";
-		case e_ast::real_: return "real";
-		case e_ast::byte_: return "byte";
-		case e_ast::bit_: return "bit";
-		case e_ast::str_: return "str";
-		case e_ast::array_: return "array";
-		case e_ast::pointer_: return "pointer";
-		case e_ast::memory_: return "memory";
-		case e_ast::function_: return "function";
-		case e_ast::include_: return "include";
-		case e_ast::macro_: return "macro";
-		case e_ast::endmacro_: return "endmacro";
-		case e_ast::enter_: return "enter";
-		case e_ast::start_: return "start";
-		case e_ast::use_: return "use";
-		case e_ast::class_: return "class";
-		case e_ast::obj_: return "obj";
-		case e_ast::print_: return "print";
-		case e_ast::private_: return "private";
-		case e_ast::public_: return "public";
-		case e_ast::const_: return "const";
-		case e_ast::static_: return "static";
-		case e_ast::ref_: return "ref";
-		case e_ast::if_: return "if";
-		case e_ast::else_: return "else";
-		case e_ast::elif_: return "elif";
-		case e_ast::while_: return "while";
-		case e_ast::for_: return "for";
-		case e_ast::switch_: return "switch";
-		case e_ast::case_: return "case";
-		case e_ast::default_: return "default";
-		case e_ast::break_: return "break";
-		case e_ast::continue_: return "continue";
-		case e_ast::return_: return "return";
-			// astnode intermediates
-		case  e_ast::statement_: return "statement";
-		case  e_ast::expression_: return "expression";
-		case  e_ast::program_: return "program";
-		case  e_ast::pragmatic_block_: return "pragmatic_block";
-		case  e_ast::functional_block_: return "functional_block";
-		case  e_ast::conditional_block_: return "conditional_block";
-		case  e_ast::iterative_block_: return "iterative_block";
-		case  e_ast::arguments_: return "arguments";
-		case  e_ast::parameter_: return "parameter";
-		case  e_ast::parameter_list_: return "parameter_list";
-		case  e_ast::type_constraints_: return "type_constraints";
-		case  e_ast::capture_list_: return "capture_list";
-		case  e_ast::subexpression_: return "subexpression";
-		case  e_ast::type_list_: return "type_list";
-		case  e_ast::generic_list_: return "generic_list";
-		case  e_ast::function_call_: return "function_call";
-		case  e_ast::type_call_: return "type_call";
-		case  e_ast::type_arguments_: return "type_arguments";
-		case  e_ast::index_operator_: return "index_operator";
-		case e_ast::index_arguments_: return "index_arguments";
-		case  e_ast::unary_minus_: return "unary_minus";
-		case  e_ast::dereference_: return "dereference";
-		case  e_ast::address_of_: return "address_of";
-		default: return "e_ast invalid enum value";
-		}
-	}
+	SL_CXIN sl_string to_str(e_tk t) { return sl_string(tk_type_traits(t).name); }
+	SL_CXIN sl_string to_str(e_ast t) { return sl_string(ast_type_traits(t).name); }
+	// Names without building a string.
+	SL_CX sl_string_view to_sv(e_tk t) { return tk_type_traits(t).name; }
+	SL_CX sl_string_view to_sv(e_ast t) { return ast_type_traits(t).name; }
 }
 
-SL_CX e_ast tk_type_to_astnode_type(e_tk t) {
-    switch(t) {
-        case e_tk::none_: return e_ast::none_;
-        case e_tk::invalid_: return e_ast::invalid_;
-        case e_tk::eof_: return e_ast::eof_;
-        case e_tk::line_comment_: return e_ast::line_comment_;
-        case e_tk::block_comment_: return e_ast::block_comment_;
-        case e_tk::newline_: return e_ast::newline_;
-        case e_tk::whitespace_: return e_ast::whitespace_;
-        case e_tk::string_literal_: return e_ast::string_literal_;
-        case e_tk::number_literal_: return e_ast::number_literal_;
-        case e_tk::real_literal_: return e_ast::real_literal_;
-        case e_tk::byte_literal_: return e_ast::byte_literal_;
-        case e_tk::bit_literal_: return e_ast::bit_literal_;
-        case e_tk::unsigned_literal_: return e_ast::unsigned_literal_;
-        case e_tk::alnumus_: return e_ast::alnumus_;
-        case e_tk::simple_assignment_: return e_ast::simple_assignment_;
-        case e_tk::addition_assignment_: return e_ast::addition_assignment_;
-        case e_tk::subtraction_assignment_: return e_ast::subtraction_assignment_;
-        case e_tk::multiplication_assignment_: return e_ast::multiplication_assignment_;
-        case e_tk::division_assignment_: return e_ast::division_assignment_;
-        case e_tk::remainder_assignment_: return e_ast::remainder_assignment_;
-        case e_tk::bitwise_and_assignment_: return e_ast::bitwise_and_assignment_;
-        case e_tk::bitwise_or_assignment_: return e_ast::bitwise_or_assignment_;
-        case e_tk::bitwise_xor_assignment_: return e_ast::bitwise_xor_assignment_;
-        case e_tk::left_shift_assignment_: return e_ast::left_shift_assignment_;
-        case e_tk::right_shift_assignment_: return e_ast::right_shift_assignment_;
-        case e_tk::increment_: return e_ast::increment_;
-        case e_tk::decrement_: return e_ast::decrement_;
-        case e_tk::addition_: return e_ast::addition_;
-        case e_tk::subtraction_: return e_ast::subtraction_;
-        case e_tk::multiplication_: return e_ast::multiplication_;
-        case e_tk::division_: return e_ast::division_;
-        case e_tk::remainder_: return e_ast::remainder_;
-        case e_tk::bitwise_not_: return e_ast::bitwise_not_;
-        case e_tk::bitwise_and_: return e_ast::bitwise_and_;
-        case e_tk::bitwise_or_: return e_ast::bitwise_or_;
-        case e_tk::bitwise_xor_: return e_ast::bitwise_xor_;
-        case e_tk::bitwise_left_shift_: return e_ast::bitwise_left_shift_;
-        case e_tk::bitwise_right_shift_: return e_ast::bitwise_right_shift_;
-        case e_tk::negation_: return e_ast::negation_;
-        case e_tk::logical_and_: return e_ast::logical_and_;
-        case e_tk::logical_or_: return e_ast::logical_or_;
-        case e_tk::equal_: return e_ast::equal_;
-        case e_tk::not_equal_: return e_ast::not_equal_;
-        case e_tk::less_than_: return e_ast::less_than_;
-        case e_tk::greater_than_: return e_ast::greater_than_;
-        case e_tk::less_than_or_equal_: return e_ast::less_than_or_equal_;
-        case e_tk::greater_than_or_equal_: return e_ast::greater_than_or_equal_;
-        case e_tk::three_way_comparison_: return e_ast::three_way_comparison_;
-        case e_tk::open_paren_: return e_ast::open_paren_;
-        case e_tk::close_paren_: return e_ast::close_paren_;
-        case e_tk::open_brace_: return e_ast::open_brace_;
-        case e_tk::close_brace_: return e_ast::close_brace_;
-        case e_tk::open_bracket_: return e_ast::open_bracket_;
-        case e_tk::close_bracket_: return e_ast::close_bracket_;
-        case e_tk::semicolon_: return e_ast::semicolon_;
-        case e_tk::colon_: return e_ast::colon_;
-        case e_tk::comma_: return e_ast::comma_;
-        case e_tk::period_: return e_ast::period_;
-        case e_tk::ellipsis_: return e_ast::ellipsis_;
-        case e_tk::commerical_at_: return e_ast::commerical_at_;
-        case e_tk::none_literal_: return e_ast::none_literal_;
-        case e_tk::true_literal_: return e_ast::true_literal_;
-        case e_tk::false_literal_: return e_ast::false_literal_;
-        case e_tk::type_: return e_ast::type_;
-        case e_tk::identity_: return e_ast::identity_;
-        case e_tk::value_: return e_ast::value_;
-        case e_tk::int_: return e_ast::int_;
-        case e_tk::uint_: return e_ast::uint_;
-        case e_tk::real_: return e_ast::real_;
-        case e_tk::byte_: return e_ast::byte_;
-        case e_tk::bit_: return e_ast::bit_;
-        case e_tk::str_: return e_ast::str_;
-        case e_tk::array_: return e_ast::array_;
-        case e_tk::pointer_: return e_ast::pointer_;
-        case e_tk::memory_: return e_ast::memory_;
-        case e_tk::function_: return e_ast::function_;
-        case e_tk::include_: return e_ast::include_;
-        case e_tk::macro_: return e_ast::macro_;
-        case e_tk::endmacro_: return e_ast::endmacro_;
-        case e_tk::enter_: return e_ast::enter_;
-        case e_tk::start_: return e_ast::start_;
-        case e_tk::use_: return e_ast::use_;
-        case e_tk::class_: return e_ast::class_;
-        case e_tk::obj_: return e_ast::obj_;
-        case e_tk::print_: return e_ast::print_;
-        case e_tk::private_: return e_ast::private_;
-        case e_tk::public_: return e_ast::public_;
-        case e_tk::const_: return e_ast::const_;
-        case e_tk::static_: return e_ast::static_;
-        case e_tk::ref_: return e_ast::ref_;
-        case e_tk::if_: return e_ast::if_;
-        case e_tk::else_: return e_ast::else_;
-        case e_tk::elif_: return e_ast::elif_;
-        case e_tk::while_: return e_ast::while_;
-        case e_tk::for_: return e_ast::for_;
-        case e_tk::switch_: return e_ast::switch_;
-        case e_tk::case_: return e_ast::case_;
-        case e_tk::default_: return e_ast::default_;
-        case e_tk::break_: return e_ast::break_;
-        case e_tk::continue_: return e_ast::continue_;
-        case e_tk::return_: return e_ast::return_;
-        default: return e_ast::none_;
-    }
-}
-SL_CX e_assoc tk_type_assoc(e_tk t) {
-	switch(t) {
-		case e_tk::none_:case e_tk::invalid_:case e_tk::eof_:
-		case e_tk::line_comment_:case e_tk::block_comment_:case e_tk::newline_:case e_tk::whitespace_:
-		case e_tk::string_literal_:case e_tk::number_literal_:case e_tk::real_literal_:case e_tk::byte_literal_:
-		case e_tk::bit_literal_:case e_tk::unsigned_literal_:case e_tk::alnumus_:
-		case e_tk::none_literal_:case e_tk::true_literal_:case e_tk::false_literal_:
-		case e_tk::type_:case e_tk::identity_:case e_tk::value_:case e_tk::int_:case e_tk::uint_:
-		case e_tk::real_:case e_tk::byte_:case e_tk::bit_:case e_tk::str_:case e_tk::array_:case e_tk::pointer_:
-		case e_tk::memory_:case e_tk::function_:case e_tk::include_:case e_tk::macro_:case e_tk::endmacro_:
-		case e_tk::enter_:case e_tk::start_:case e_tk::use_:case e_tk::class_:case e_tk::obj_:case e_tk::print_:
-		case e_tk::private_:case e_tk::public_:case e_tk::const_:case e_tk::static_:case e_tk::ref_:
-		case e_tk::if_:case e_tk::else_:case e_tk::elif_:case e_tk::while_:case e_tk::for_:case e_tk::switch_:
-		case e_tk::case_:case e_tk::default_:case e_tk::break_:case e_tk::continue_:case e_tk::return_:
-			return e_assoc::none_;
-		case e_tk::simple_assignment_:case e_tk::addition_assignment_:case e_tk::subtraction_assignment_:
-		case e_tk::multiplication_assignment_:case e_tk::division_assignment_:case e_tk::remainder_assignment_:
-		case e_tk::bitwise_and_assignment_:case e_tk::bitwise_or_assignment_:case e_tk::bitwise_xor_assignment_:
-		case e_tk::left_shift_assignment_:case e_tk::right_shift_assignment_:
-		case e_tk::negation_:case e_tk::bitwise_not_:
-			return e_assoc::right_;
-		case e_tk::addition_:case e_tk::subtraction_:case e_tk::multiplication_:case e_tk::division_:
-		case e_tk::remainder_:case e_tk::bitwise_and_:case e_tk::bitwise_or_:case e_tk::bitwise_xor_:
-		case e_tk::bitwise_left_shift_:case e_tk::bitwise_right_shift_:
-		case e_tk::logical_and_:case e_tk::logical_or_:case e_tk::equal_:case e_tk::not_equal_:case e_tk::less_than_:
-		case e_tk::greater_than_:case e_tk::less_than_or_equal_:case e_tk::greater_than_or_equal_:case e_tk::three_way_comparison_:
-		case e_tk::increment_: case e_tk::decrement_:case e_tk::period_:
-			return e_assoc::left_;
-		case e_tk::open_paren_:case e_tk::close_paren_:case e_tk::open_brace_:case e_tk::close_brace_:
-		case e_tk::open_bracket_:case e_tk::close_bracket_:case e_tk::semicolon_:case e_tk::colon_:case e_tk::comma_:
-		return e_assoc::none_;
-		case e_tk::ellipsis_:case e_tk::commerical_at_:
-			return e_assoc::right_;
-		default: return e_assoc::none_;
-	}
-}
-SL_CX e_operation tk_type_operation(e_tk t) {
-	switch (t)
-	{
-	case e_tk::none_:
-		
-	case e_tk::invalid_:
-		
-	case e_tk::eof_:
-		
-	case e_tk::line_comment_:
-		
-	case e_tk::block_comment_:
-		
-	case e_tk::newline_:
-		
-	case e_tk::whitespace_:
-		
-	case e_tk::string_literal_:
-		
-	case e_tk::number_literal_:
-		
-	case e_tk::real_literal_:
-		
-	case e_tk::byte_literal_:
-		
-	case e_tk::bit_literal_:
-		
-	case e_tk::unsigned_literal_:
-		
-	case e_tk::alnumus_:
-		return e_operation::none_;
-		break;
-	case e_tk::simple_assignment_:
-		
-	case e_tk::addition_assignment_:
-		
-	case e_tk::subtraction_assignment_:
-		
-	case e_tk::multiplication_assignment_:
-		
-	case e_tk::division_assignment_:
-		
-	case e_tk::remainder_assignment_:
-		
-	case e_tk::bitwise_and_assignment_:
-		
-	case e_tk::bitwise_or_assignment_:
-		
-	case e_tk::bitwise_xor_assignment_:
-		
-	case e_tk::left_shift_assignment_:
-	case e_tk::right_shift_assignment_:
-		return e_operation::binary_;
-		break;
-	case e_tk::increment_:
-	case e_tk::decrement_:
-		return e_operation::postfix_;
-		break;
-	case e_tk::addition_:
-		
-	case e_tk::subtraction_:
-		
-	case e_tk::multiplication_:
-		
-	case e_tk::division_:
-		
-	case e_tk::remainder_:
-		
-	case e_tk::bitwise_and_:
-		
-	case e_tk::bitwise_or_:
-		
-	case e_tk::bitwise_xor_:
-		
-	case e_tk::bitwise_left_shift_:
-		
-	case e_tk::bitwise_right_shift_:
-		return e_operation::binary_;
-		break;
-	case e_tk::negation_:
-	case e_tk::bitwise_not_:
-		return e_operation::prefix_;
-		break;
-	case e_tk::logical_and_:
-		
-	case e_tk::logical_or_:
-		
-	case e_tk::equal_:
-		
-	case e_tk::not_equal_:
-		
-	case e_tk::less_than_:
-		
-	case e_tk::greater_than_:
-		
-	case e_tk::less_than_or_equal_:
-		
-	case e_tk::greater_than_or_equal_:
-		
-	case e_tk::three_way_comparison_:
-		return e_operation::binary_;
-		break;
-	case e_tk::open_paren_:
-		
-	case e_tk::close_paren_:
-		
-	case e_tk::open_brace_:
-		
-	case e_tk::close_brace_:
-		
-	case e_tk::open_bracket_:
-		
-	case e_tk::close_bracket_:
-		return e_operation::postfix_;
-		break;
-	case e_tk::semicolon_:
-		
-	case e_tk::colon_:
-		
-	case e_tk::comma_:
-		return e_operation::none_;
-		break;
-	case e_tk::period_:
-		return e_operation::binary_;
-		break;
-	case e_tk::ellipsis_:
-		return e_operation::binary_;
-		break;
-	case e_tk::commerical_at_:
-		return e_operation::prefix_;
-		break;
-	case e_tk::none_literal_:
-		
-	case e_tk::true_literal_:
-		
-	case e_tk::false_literal_:
-		
-	case e_tk::type_:
-		
-	case e_tk::identity_:
-		
-	case e_tk::value_:
-		
-	case e_tk::int_:
-		
-	case e_tk::uint_:
-		
-	case e_tk::real_:
-		
-	case e_tk::byte_:
-		
-	case e_tk::bit_:
-		
-	case e_tk::str_:
-		
-	case e_tk::array_:
-		
-	case e_tk::pointer_:
-		
-	case e_tk::memory_:
-		
-	case e_tk::function_:
-		
-	case e_tk::include_:
-		
-	case e_tk::macro_:
-		
-	case e_tk::endmacro_:
-		
-	case e_tk::enter_:
-		
-	case e_tk::start_:
-		
-	case e_tk::use_:
-		
-	case e_tk::class_:
-		
-	case e_tk::obj_:
-		
-	case e_tk::print_:
-		
-	case e_tk::private_:
-		
-	case e_tk::public_:
-		
-	case e_tk::const_:
-		
-	case e_tk::static_:
-		
-	case e_tk::ref_:
-		
-	case e_tk::if_:
-		
-	case e_tk::else_:
-		
-	case e_tk::elif_:
-		
-	case e_tk::while_:
-		
-	case e_tk::for_:
-		
-	case e_tk::switch_:
-		
-	case e_tk::case_:
-		
-	case e_tk::default_:
-		
-	case e_tk::break_:
-		
-	case e_tk::continue_:
-		
-	case e_tk::return_:
-		return e_operation::none_;
-		break;
-	default:
-		return e_operation::none_;
-		break;
-	}
-}
-SL_CX priority::e_priority tk_type_priority(e_tk t) {
-	switch (t)
-	{
-	case e_tk::none_:
-	case e_tk::invalid_:
-	case e_tk::eof_:
-	case e_tk::line_comment_:
-	case e_tk::block_comment_:
-	case e_tk::newline_:
-	case e_tk::whitespace_:
-		return priority::e_priority::none_;
-		break;
-	case e_tk::string_literal_:
-	case e_tk::number_literal_:
-	case e_tk::real_literal_:
-	case e_tk::byte_literal_:
-	case e_tk::bit_literal_:
-	case e_tk::unsigned_literal_:
-	case e_tk::alnumus_:
-		return priority::e_priority::max_;
-		break;
-	case e_tk::simple_assignment_:		
-	case e_tk::addition_assignment_:		
-	case e_tk::subtraction_assignment_:		
-	case e_tk::multiplication_assignment_:		
-	case e_tk::division_assignment_:		
-	case e_tk::remainder_assignment_:		
-	case e_tk::bitwise_and_assignment_:		
-	case e_tk::bitwise_or_assignment_:		
-	case e_tk::bitwise_xor_assignment_:		
-	case e_tk::left_shift_assignment_:		
-	case e_tk::right_shift_assignment_:
-		return priority::e_priority::assignment_;
-		break;
-	case e_tk::increment_:
-	case e_tk::decrement_:
-		return priority::e_priority::postfix_;
-		break;
-	case e_tk::addition_:
-	case e_tk::subtraction_:
-		return priority::e_priority::term_;
-		break;
-	case e_tk::multiplication_:
-	case e_tk::division_:
-	case e_tk::remainder_:
-		return priority::e_priority::factor_;
-		break;
-	case e_tk::negation_:
-	case e_tk::bitwise_not_:
-		return priority::e_priority::prefix_;
-		break;
-	case e_tk::bitwise_and_:		
-	case e_tk::bitwise_or_:		
-	case e_tk::bitwise_xor_:		
-	case e_tk::bitwise_left_shift_:		
-	case e_tk::bitwise_right_shift_:		
-	case e_tk::logical_and_:		
-	case e_tk::logical_or_:		
-	case e_tk::equal_:		
-	case e_tk::not_equal_:		
-	case e_tk::less_than_:		
-	case e_tk::greater_than_:		
-	case e_tk::less_than_or_equal_:		
-	case e_tk::greater_than_or_equal_:		
-	case e_tk::three_way_comparison_:
-		return priority::e_priority::comparison_;
-		break;
-	case e_tk::open_paren_:
-	case e_tk::close_paren_:
-	case e_tk::open_brace_:
-	case e_tk::close_brace_:
-	case e_tk::open_bracket_:
-	case e_tk::close_bracket_:
-		return priority::e_priority::postfix_;
-		break;
-	case e_tk::semicolon_:
-	case e_tk::colon_:
-	case e_tk::comma_:
-	case e_tk::ellipsis_:
-	case e_tk::commerical_at_:
-		return priority::e_priority::max_;
-		break;
-	case e_tk::period_:
-		return priority::e_priority::access_;
-		break;
-	case e_tk::none_literal_:		
-	case e_tk::true_literal_:		
-	case e_tk::false_literal_:		
-	case e_tk::type_:		
-	case e_tk::identity_:		
-	case e_tk::value_:		
-	case e_tk::int_:		
-	case e_tk::uint_:		
-	case e_tk::real_:		
-	case e_tk::byte_:		
-	case e_tk::bit_:		
-	case e_tk::str_:		
-	case e_tk::array_:		
-	case e_tk::pointer_:		
-	case e_tk::memory_:		
-	case e_tk::function_:		
-	case e_tk::include_:		
-	case e_tk::macro_:		
-	case e_tk::endmacro_:		
-	case e_tk::enter_:		
-	case e_tk::start_:		
-	case e_tk::use_:		
-	case e_tk::class_:		
-	case e_tk::obj_:		
-	case e_tk::print_:		
-	case e_tk::private_:		
-	case e_tk::public_:		
-	case e_tk::const_:		
-	case e_tk::static_:		
-	case e_tk::ref_:		
-	case e_tk::if_:		
-	case e_tk::else_:		
-	case e_tk::elif_:		
-	case e_tk::while_:		
-	case e_tk::for_:		
-	case e_tk::switch_:		
-	case e_tk::case_:		
-	case e_tk::default_:		
-	case e_tk::break_:		
-	case e_tk::continue_:		
-	case e_tk::return_:
-		return priority::e_priority::max_;
-	default:
-		break;
-	}
-}
+SL_CX e_ast tk_type_to_astnode_type(e_tk t) { return tk_type_traits(t).ast_type; }
+SL_CX e_assoc tk_type_assoc(e_tk t) { return tk_type_traits(t).assoc; }
+SL_CX e_operation tk_type_operation(e_tk t) { return tk_type_traits(t).operation; }
+SL_CX priority::e_priority tk_type_priority(e_tk t) { return tk_type_traits(t).priority; }
 
 SL_CX e_assoc ast_type_assoc(e_ast a) {
 return e_assoc::none_;
@@ -1340,114 +905,10 @@ SL_CX priority::e_priority ast_type_priority(e_ast a) {
 	return priority::e_priority::none_;
 }
 
-SL_CX bool tk_type_is_keyword(e_tk t) {
-	switch (t) {
-	case e_tk::include_:
-	case e_tk::macro_:
-	case e_tk::endmacro_:
-	case e_tk::enter_:
-	case e_tk::start_:
-	case e_tk::use_:
-	case e_tk::class_:
-	case e_tk::obj_:
-	case e_tk::private_:
-	case e_tk::public_:
-	case e_tk::const_:
-	case e_tk::static_:
-	case e_tk::if_:
-	case e_tk::else_:
-	case e_tk::elif_:
-	case e_tk::while_:
-	case e_tk::for_:
-	case e_tk::switch_:
-	case e_tk::case_:
-	case e_tk::default_:
-	case e_tk::break_:
-	case e_tk::continue_:
-	case e_tk::return_:
-	case e_tk::print_:
-	case e_tk::none_literal_:
-	case e_tk::true_literal_:
-	case e_tk::false_literal_:
-	case e_tk::type_:
-	case e_tk::identity_:
-	case e_tk::value_:
-	case e_tk::int_:
-	case e_tk::uint_:
-	case e_tk::real_:
-	case e_tk::byte_:
-	case e_tk::bit_:
-	case e_tk::str_:
-		return true;
-	default:
-		return false;
-	}
-}
-SL_CX bool ast_type_is_keyword(e_ast a) {
-	switch (a) {
-	case e_ast::include_:
-	case e_ast::macro_:
-	case e_ast::endmacro_:
-	case e_ast::enter_:
-	case e_ast::start_:
-	case e_ast::use_:
-	case e_ast::class_:
-	case e_ast::obj_:
-	case e_ast::private_:
-	case e_ast::public_:
-	case e_ast::const_:
-	case e_ast::static_:
-	case e_ast::if_:
-	case e_ast::else_:
-	case e_ast::elif_:
-	case e_ast::while_:
-	case e_ast::for_:
-	case e_ast::switch_:
-	case e_ast::case_:
-	case e_ast::default_:
-	case e_ast::break_:
-	case e_ast::continue_:
-	case e_ast::return_:
-	case e_ast::print_:
-	case e_ast::none_literal_:
-	case e_ast::true_literal_:
-	case e_ast::false_literal_:
-	case e_ast::type_:
-	case e_ast::identity_:
-	case e_ast::value_:
-	case e_ast::int_:
-	case e_ast::uint_:
-	case e_ast::real_:
-	case e_ast::byte_:
-	case e_ast::bit_:
-	case e_ast::str_:
-		return true;
-	default:
-		return false;
-	}
-}
-SL_CX bool tk_type_is_opening_scope(e_tk t) {
-	switch (t)
-	{
-	case(e_tk::open_paren_):
-	case(e_tk::open_brace_):
-	case(e_tk::open_bracket_):
-		return true;
-	default:
-		return false;
-	}
-}
-SL_CX bool tk_type_is_closing_scope(e_tk t) {
-	switch (t)
-	{
-	case(e_tk::close_paren_):
-	case(e_tk::close_brace_):
-	case(e_tk::close_bracket_):
-		return true;
-	default:
-		return false;
-	}
-}
+SL_CX bool tk_type_is_keyword(e_tk t) { return tk_type_traits(t).flags & syntax_flag::keyword_; }
+SL_CX bool ast_type_is_keyword(e_ast a) { return ast_type_traits(a).flags & syntax_flag::keyword_; }
+SL_CX bool tk_type_is_opening_scope(e_tk t) { return tk_type_traits(t).flags & syntax_flag::opening_scope_; }
+SL_CX bool tk_type_is_closing_scope(e_tk t) { return tk_type_traits(t).flags & syntax_flag::closing_scope_; }
 SL_CX bool tk_type_is_closing_scope_of(e_tk topen, e_tk tclose) {
 	return (topen == e_tk::open_paren_ && tclose == e_tk::close_paren_) ||
 		(topen == e_tk::open_brace_ && tclose == e_tk::close_brace_) ||
@@ -1460,16 +921,20 @@ private:
 	sl_u8string literal_{u8""};
 	sl_size line_{ 0 };
 	sl_size col_{ 0 };
+	sl_size offset_{ 0 };
 public:
 	// Modifiers
 	SL_CX void set_line(sl_size line) { line_ = line; }
 	SL_CX void set_col(sl_size col) { col_ = col; }
+	SL_CX void set_offset(sl_size offset) { offset_ = offset; }
 	// Properties
 	SL_CXA type() const noexcept { return type_; }
 	SL_CXA node_type() const noexcept { return tk_type_to_astnode_type(type_); }
 	SL_CXA size() const { return literal_.size(); }
 	SL_CXA line() const noexcept { return line_; }
 	SL_CXA col() const noexcept { return col_; }
+	// Byte offset of the first character of the token in the tokenized source.
+	SL_CXA offset() const noexcept { return offset_; }
 	SL_CX const sl_u8string& literal() const {return literal_;}
 
 	// Parsing Utilities
@@ -1495,7 +960,7 @@ public:
 	}
 
 public:
-	SL_CX tk() noexcept : type_(e_tk::none_), line_(0), col_(0), literal_() {}
+	SL_CX tk() noexcept : type_(e_tk::none_), literal_(), line_(0), col_(0) {}
 	SL_CX tk(e_tk type) noexcept : type_(type), line_(0), col_(0) {}
 	SL_CX tk(e_tk type, sl_char8_vector_cit beg, sl_char8_vector_cit end) noexcept
 		: type_(type), line_(0), col_(0) {
@@ -1506,18 +971,19 @@ public:
 		literal_ = sl_u8string(beg, end);
 	}
 	SL_CX tk(e_tk type, sl_u8string literal)
-		: type_(type), line_(0), col_(0), literal_(literal) {}
+		: type_(type), literal_(literal), line_(0), col_(0) {}
 	SL_CX tk(e_tk type, sl_u8string literal, sl_size line, sl_size col)
-		: type_(type), line_(line), col_(col), literal_(literal) {}
+		: type_(type), literal_(literal), line_(line), col_(col) {}
 
 	SL_CX tk(const tk& other) noexcept
-		: type_(other.type_), line_(other.line_), col_(other.col_), literal_(other.literal_) {}
+		: type_(other.type_), literal_(other.literal_), line_(other.line_), col_(other.col_), offset_(other.offset_) {}
 	SL_CX tk(tk&& other) noexcept
-		: type_(other.type_), line_(other.line_), col_(other.col_), literal_(std::move(other.literal_)) {}
+		: type_(other.type_), literal_(std::move(other.literal_)), line_(other.line_), col_(other.col_), offset_(other.offset_) {}
 	SL_CXA operator=(const tk& other) noexcept {
 		type_ = other.type_;
 		line_ = other.line_;
 		col_ = other.col_;
+		offset_ = other.offset_;
 		literal_ = other.literal_;
 		return *this;
 	}
@@ -1525,6 +991,7 @@ public:
 		type_ = other.type_;
 		line_ = other.line_;
 		col_ = other.col_;
+		offset_ = other.offset_;
 		literal_ = std::move(other.literal_);
 		return *this;
 	}
@@ -1541,10 +1008,22 @@ private:
 	e_ast type_{e_ast::invalid_};
 	sl_u8string literal_{ u8"" };
 	ast* parent_{nullptr};
-	sl_list<ast> children_;
+	sl_vector<ast> children_;
 
 	void set_parent(ast* parent) { parent_ = parent; }
 	void pop_parent() { if(parent_ != nullptr) parent_=nullptr; else throw std::out_of_range("ast node pop_parent() called on node with no parent.");}
+	// Children are stored contiguously, when they move in memory their own children must be pointed at the new location.
+	void relink_children() { for (auto& child : children_) child.parent_ = this; }
+	template<typename NodeT>
+	ast& emplace_child(typename sl_vector<ast>::const_iterator where, NodeT&& nd) {
+		const ast* old_data = children_.data();
+		auto pushed = children_.insert(where, std::forward<NodeT>(nd));
+		if (children_.data() != old_data || pushed + 1 != children_.end())
+			relink_children();
+		else
+			pushed->set_parent(this);
+		return *pushed;
+	}
 public:
 	ast() : type_(e_ast::invalid_) {}
 	ast(e_ast type) : type_(type) {}
@@ -1574,6 +1053,43 @@ public:
 		(push_back(children), ...);
 	}
 
+	ast(const ast& other) : type_(other.type_), literal_(other.literal_), parent_(other.parent_), children_(other.children_) {
+		relink_children();
+	}
+	ast(ast&& other) noexcept : type_(other.type_), literal_(std::move(other.literal_)), parent_(other.parent_), children_(std::move(other.children_)) {
+		relink_children();
+	}
+	// Deep trees, such as long operator chains, are torn down level by level instead of recursively.
+	~ast() {
+		if (children_.empty()) return;
+		sl_vector<sl_vector<ast>> pending;
+		pending.push_back(std::move(children_));
+		while (!pending.empty()) {
+			sl_vector<ast> level = std::move(pending.back());
+			pending.pop_back();
+			for (auto& child : level)
+				if (!child.children_.empty()) pending.push_back(std::move(child.children_));
+		}
+	}
+	// Assignment replaces the node's contents but keeps its place in the tree.
+	ast& operator=(const ast& other) {
+		if (this != &other) {
+			type_ = other.type_;
+			literal_ = other.literal_;
+			children_ = other.children_;
+			relink_children();
+		}
+		return *this;
+	}
+	ast& operator=(ast&& other) noexcept {
+		if (this != &other) {
+			type_ = other.type_;
+			literal_ = std::move(other.literal_);
+			children_ = std::move(other.children_);
+			relink_children();
+		}
+		return *this;
+	}
 
 	SL_CX e_ast type() const noexcept { return type_; }
 	SL_CX const sl_u8string& literal() const noexcept { return literal_; }
@@ -1586,13 +1102,13 @@ public:
 
 	// Child operations.
 	sl_size size() const { return children_.size(); }
-	ast& push_back(const ast& nd) { children_.push_back(nd); auto& pushed = children_.back(); pushed.set_parent(this); return pushed; }
-	ast& push_front(const ast & nd) { children_.push_front(nd); auto& pushed = children_.front(); pushed.set_parent(this); return pushed;}
-	ast& push_back(ast && nd) { children_.push_back(std::move(nd)); auto& pushed = children_.back(); pushed.set_parent(this); return pushed;}
-	ast& push_front(ast && nd) { children_.push_front(std::move(nd)); auto& pushed = children_.front(); pushed.set_parent(this); return pushed;}
+	ast& push_back(const ast& nd) { return emplace_child(children_.cend(), nd); }
+	ast& push_front(const ast & nd) { return emplace_child(children_.cbegin(), nd); }
+	ast& push_back(ast && nd) { return emplace_child(children_.cend(), std::move(nd)); }
+	ast& push_front(ast && nd) { return emplace_child(children_.cbegin(), std::move(nd)); }
 	ast pop_back() { 
 		if (!children_.empty()) {
-			auto popped = children_.back();
+			auto popped = std::move(children_.back());
 			children_.pop_back();
 			popped.pop_parent();
 			return popped;
@@ -1601,8 +1117,8 @@ public:
 			throw std::out_of_range("ast node pop_back() called on node with no children.");}
 	ast pop_front() { 
 		if (!children_.empty()) {
-			auto popped = children_.front();
-			children_.pop_front();
+			auto popped = std::move(children_.front());
+			children_.erase(children_.begin());
 			popped.pop_parent();
 			return popped;
 		}
@@ -1612,30 +1128,22 @@ public:
 	ast& back() { if (!children_.empty()) return children_.back(); else throw std::out_of_range("ast node front() called on node with no children."); }
 	ast& at(sl_size index) {
 		if (index >= children_.size()) throw std::out_of_range("ast node at() called with index out of range.");
-		if (index == 0) return children_.front();
-
-		return [this, &index]()->ast& {auto it = children_.begin();
-		for (sl_size i = 0; i < index; i++) { it++; } return *it;
-		}();
+		return children_[index];
 	}
 	// Index operator accesses children.
 	const ast& operator[](sl_size index) const {
 		if (index >= children_.size()) throw std::out_of_range("ast node [] index operator called with index out of range.");
-		if (index == 0) return children_.front();
-
-		return [this, &index]()->const ast& {auto it = children_.begin();
-		for (sl_size i = 0; i < index; i++) { it++; } return *it;
-		}();
+		return children_[index];
 	}
 	ast& operator[](sl_size index){
 		if (index >= children_.size()) throw std::out_of_range("ast node [] index operator called with index out of range.");
-		if (index == 0) return children_.front();
-
-		return [this, &index]()->ast& {auto it = children_.begin();
-		for (sl_size i = 0; i < index; i++) { it++; } return *it;
-		}();
+		return children_[index];
 	}
 
+	// Traversal. Walks the subtree rooted at this node without recursion.
+	sl_preorder_view<ast> preorder() const { return sl_preorder_view<ast>(*this); }
+	sl_postorder_view<ast> postorder() const { return sl_postorder_view<ast>(*this); }
+
 	// Fast type queries.
 	SL_CX bool type_is(e_ast type) const noexcept { return type_ == type; }
 	SL_CX bool is_keyword() const noexcept { return ast_type_is_keyword(type_); }
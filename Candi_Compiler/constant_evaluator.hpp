@@ -1,11 +1,18 @@
 #pragma once
 #include "ast_node.hpp"
 #include "parser.hpp"
+#include "ast_image.hpp"
 #include <functional>
 #include <variant>
 #include <list>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <shared_mutex>
+#include <cstring>
+#include <bit>
 
 namespace caoco {
 class object_t;
@@ -13,6 +20,7 @@ class function_t;
 struct RTValue;
 class rtenv;
 struct CBinopEval;	
+struct bytecode_chunk;
 struct none_t {
 	bool operator==(const none_t&) const {
 		return true;
@@ -34,8 +42,90 @@ unsigned stou(sl_string const& str, size_t* idx = 0, int base = 10) {
 	return result;
 }
 
+/// <rtcounted>
+/// Base of the heap parts of runtime values: strings too long to be stored inline, objects and functions.
+/// RTValues and rtrefs share them by an intrusive count, the last one to let go deletes them.
+/// The count is not atomic, runtime values belong to the thread which evaluates them.
+/// </rtcounted>
+class rtcounted {
+	mutable sl_uint32 refs_{ 0 };
+public:
+	rtcounted() = default;
+	rtcounted(const rtcounted&) {} // A copy is a new value, with no references yet.
+	rtcounted& operator=(const rtcounted&) { return *this; }
+	virtual ~rtcounted() = default;
+
+	sl_uint32 ref_count() const {
+		return refs_;
+	}
+
+	// <@method:retain> Adds a reference.
+	static void retain(const rtcounted* counted) {
+		if (counted) ++counted->refs_;
+	}
+
+	// <@method:release> Drops a reference, the last one deletes the value.
+	static void release(const rtcounted* counted) {
+		if (counted && --counted->refs_ == 0) delete counted;
+	}
+};
+
+/// <rtref>
+/// Owning handle to an rtcounted value, the handle by which runtime code holds objects and functions.
+/// </rtref>
+template<class T>
+class rtref {
+	T* ptr_{ nullptr };
+public:
+	rtref() = default;
+	explicit rtref(T* ptr) : ptr_(ptr) { rtcounted::retain(ptr_); }
+	rtref(const rtref& other) : ptr_(other.ptr_) { rtcounted::retain(ptr_); }
+	rtref(rtref&& other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {}
+	rtref& operator=(rtref other) noexcept {
+		std::swap(ptr_, other.ptr_);
+		return *this;
+	}
+	~rtref() { rtcounted::release(ptr_); }
+
+	T* get() const { return ptr_; }
+	T& operator*() const { return *ptr_; }
+	T* operator->() const { return ptr_; }
+	explicit operator bool() const { return ptr_ != nullptr; }
+	bool operator==(const rtref& other) const { return ptr_ == other.ptr_; }
+};
+
+// <@method:make_rtref> Creates an rtcounted value of type T.
+template<class T, class... ArgTs>
+rtref<T> make_rtref(ArgTs&&... args) {
+	return rtref<T>(new T(std::forward<ArgTs>(args)...));
+}
+
+// Storage of a string value too long to be stored inline.
+struct rtstring : public rtcounted {
+	sl_string text;
+	explicit rtstring(sl_string_view text) : text(text) {}
+};
+
+// <@method:intern_rtstring> The storage shared by all interned strings equal to text on the calling thread.
+// The pool holds a reference, so an interned string lives at least as long as the thread.
+inline rtstring* intern_rtstring(sl_string_view text) {
+	thread_local std::unordered_map<sl_string_view, rtref<rtstring>> pool;
+	auto found = pool.find(text);
+	if (found != pool.end()) return found->second.get();
+	auto interned = make_rtref<rtstring>(text);
+	rtstring* storage = interned.get();
+	pool.emplace(sl_string_view(storage->text), std::move(interned));
+	return storage;
+}
+
+/// <RTValue>
+/// Runtime value: a one byte type tag and an 8 byte payload, 16 bytes in all.
+/// Numbers, reals, bits, bytes and unsigned values are stored in the payload. Strings of up to 8 chars are stored
+/// inline, longer ones in an rtstring shared by copies, string literals are interned. Objects and functions are
+/// held by their rtcounted handle. Copying a value copies 16 bytes and at most adds a reference.
+/// </RTValue>
 struct RTValue {
-	enum eType {
+	enum eType : sl_uint8 {
 		NUMBER = 0,
 		REAL = 1,
 		STRING = 2,
@@ -46,74 +136,248 @@ struct RTValue {
 		OBJECT = 7,
 		FUNCTION = 8
 	} type;
+	SL_CXS sl_size type_count = FUNCTION + 1;
+private:
+	SL_CXS sl_uint8 small_capacity = 8;
+	SL_CXS sl_uint8 heap_string = sl_limits<sl_uint8>::max(); // small_size_ of a string stored in an rtstring.
+
+	sl_uint8 small_size_{ 0 };
+	union payload_t {
+		int number;
+		double real;
+		bool bit;
+		unsigned char byte;
+		unsigned unsigned_number;
+		char small[small_capacity];
+		rtcounted* counted; // rtstring, object_t or function_t
+	} payload_;
+
+	bool holds_counted() const {
+		return type == OBJECT || type == FUNCTION || (type == STRING && small_size_ == heap_string);
+	}
+
+	void expect(eType expected) const {
+		if (type != expected) {
+			throw std::runtime_error("RTValue:Value of type " + std::to_string(static_cast<int>(type)) 
+				+ " accessed as type " + std::to_string(static_cast<int>(expected)));
+		}
+	}
 
-		std::variant<int, double, sl_string, bool, unsigned char, none_t,unsigned, std::shared_ptr<object_t>,std::shared_ptr<function_t>> 
-			value;
-
-RTValue() : type(NONE), value(none_t{}) {}
+	void set_string(sl_string_view text) {
+		if (text.size() <= small_capacity) {
+			small_size_ = static_cast<sl_uint8>(text.size());
+			std::memcpy(payload_.small, text.data(), text.size());
+		}
+		else {
+			small_size_ = heap_string;
+			payload_.counted = new rtstring(text);
+			rtcounted::retain(payload_.counted);
+		}
+	}
+public:
+	RTValue() : type(NONE), payload_{ 0 } {}
+
+	// Stores v as a value of type t: arithmetic values are converted to the type, strings and none_t
+	// must be given with STRING and NONE, rtrefs with OBJECT and FUNCTION.
+	template<typename T>
+	RTValue(eType t, T v) : type(t), payload_{ 0 } {
+		using value_t = std::decay_t<T>;
+		if constexpr (std::is_convertible_v<const value_t&, sl_string_view>) {
+			type = STRING;
+			set_string(sl_string_view(v));
+		}
+		else if constexpr (std::is_same_v<value_t, rtref<object_t>> || std::is_same_v<value_t, rtref<function_t>>) {
+			payload_.counted = v.get();
+			rtcounted::retain(payload_.counted);
+		}
+		else if constexpr (std::is_same_v<value_t, none_t>) {
+			type = NONE;
+		}
+		else {
+			static_assert(std::is_arithmetic_v<value_t>, "RTValue:Unsupported value type.");
+			switch (t) {
+			case NUMBER: payload_.number = static_cast<int>(v); break;
+			case REAL: payload_.real = static_cast<double>(v); break;
+			case BIT: payload_.bit = static_cast<bool>(v); break;
+			case BYTE: payload_.byte = static_cast<unsigned char>(v); break;
+			case UNSIGNED: payload_.unsigned_number = static_cast<unsigned>(v); break;
+			default: throw std::runtime_error("RTValue:Arithmetic value given for a non arithmetic type.");
+			}
+		}
+	}
 
-template<typename T>
-RTValue(eType t, T v) : type(t), value(v) {}
+	RTValue(const RTValue& other) noexcept : type(other.type), small_size_(other.small_size_), payload_(other.payload_) {
+		if (holds_counted()) rtcounted::retain(payload_.counted);
+	}
 
-RTValue(const RTValue& other) {
-	type = other.type;
-	value = other.value;
-}
+	RTValue(RTValue&& other) noexcept : type(other.type), small_size_(other.small_size_), payload_(other.payload_) {
+		other.type = NONE;
+	}
 
-RTValue(RTValue&& other) noexcept {
-	type = other.type;
-	value = std::move(other.value);
-}
+	RTValue& operator=(RTValue other) noexcept {
+		std::swap(type, other.type);
+		std::swap(small_size_, other.small_size_);
+		std::swap(payload_, other.payload_);
+		return *this;
+	}
 
-RTValue& operator=(RTValue&& other)noexcept {
-	type = other.type;
-	value = std::move(other.value);
-	return *this;
-}
+	~RTValue() {
+		if (holds_counted()) rtcounted::release(payload_.counted);
+	}
+
+	// <@method:interned> A string value, long strings share the storage interned for text.
+	static RTValue interned(sl_string_view text) {
+		if (text.size() <= small_capacity) return RTValue(STRING, text);
+		RTValue value;
+		value.type = STRING;
+		value.small_size_ = heap_string;
+		value.payload_.counted = intern_rtstring(text);
+		rtcounted::retain(value.payload_.counted);
+		return value;
+	}
+
+	// <@method:payload_type> The type whose values store their payload as T.
+	template<typename T>
+	SL_CXS eType payload_type() {
+		if constexpr (std::is_same_v<T, int>) return NUMBER;
+		else if constexpr (std::is_same_v<T, double>) return REAL;
+		else if constexpr (std::is_same_v<T, bool>) return BIT;
+		else if constexpr (std::is_same_v<T, unsigned char>) return BYTE;
+		else if constexpr (std::is_same_v<T, unsigned>) return UNSIGNED;
+		else static_assert(sizeof(T) == 0, "RTValue:Unsupported payload type.");
+	}
+
+	// <@method:as> The payload as T, the caller must have checked the type of the value.
+	template<typename T>
+	T as() const {
+		if constexpr (std::is_same_v<T, int>) return payload_.number;
+		else if constexpr (std::is_same_v<T, double>) return payload_.real;
+		else if constexpr (std::is_same_v<T, bool>) return payload_.bit;
+		else if constexpr (std::is_same_v<T, unsigned char>) return payload_.byte;
+		else return payload_.unsigned_number;
+	}
+
+	// <@method:get> The value as T, throws if the value is not of the type T is stored as.
+	template<typename T>
+	T get() const {
+		if constexpr (std::is_same_v<T, sl_string>) return sl_string(string());
+		else if constexpr (std::is_same_v<T, none_t>) {
+			expect(NONE);
+			return none_t{};
+		}
+		else {
+			expect(payload_type<T>());
+			return as<T>();
+		}
+	}
 
-RTValue& operator=(const RTValue& other) {
-	type = other.type;
-	value = other.value;
-	return *this;
-}
+	// <@method:string> The chars of a string value, valid while the value is.
+	sl_string_view string() const {
+		expect(STRING);
+		if (small_size_ == heap_string) return static_cast<const rtstring*>(payload_.counted)->text;
+		return sl_string_view(payload_.small, small_size_);
+	}
+
+	rtref<object_t> object() const;
+	rtref<function_t> function() const;
+
+	// <@method:hash> Hash of the value, identical values have equal hashes.
+	sl_size hash() const {
+		sl_size payload_hash = 0;
+		switch (type) {
+		case NUMBER: payload_hash = std::hash<int>{}(payload_.number); break;
+		case REAL: payload_hash = std::hash<sl_uint64>{}(std::bit_cast<sl_uint64>(payload_.real)); break;
+		case STRING: payload_hash = std::hash<sl_string_view>{}(string()); break;
+		case BIT: payload_hash = std::hash<bool>{}(payload_.bit); break;
+		case BYTE: payload_hash = std::hash<unsigned char>{}(payload_.byte); break;
+		case NONE: break;
+		case UNSIGNED: payload_hash = std::hash<unsigned>{}(payload_.unsigned_number); break;
+		default: payload_hash = std::hash<const void*>{}(payload_.counted);
+		}
+		return payload_hash * 31 + type;
+	}
+
+	bool operator==(const RTValue& other) const {
+		if (type != other.type) return false;
+		switch (type) {
+		case NUMBER: return payload_.number == other.payload_.number;
+		case REAL: return payload_.real == other.payload_.real;
+		case STRING: return string() == other.string();
+		case BIT: return payload_.bit == other.payload_.bit;
+		case BYTE: return payload_.byte == other.payload_.byte;
+		case NONE: return true;
+		case UNSIGNED: return payload_.unsigned_number == other.payload_.unsigned_number;
+		default: return payload_.counted == other.payload_.counted;
+		}
+	}
 
+	// <@method:identical> Equal, and reals have the same bits: 0.0 and -0.0 differ, a NaN is identical to itself.
+	bool identical(const RTValue& other) const {
+		if (type == REAL && other.type == REAL)
+			return std::bit_cast<sl_uint64>(payload_.real) == std::bit_cast<sl_uint64>(other.payload_.real);
+		return *this == other;
+	}
 };
+static_assert(sizeof(RTValue) == 16, "RTValue:Expected a 16 byte tag and payload.");
 
 
 
+// Position of a variable relative to the env a lookup starts from: the number of parents to go up, and the
+// index of the value in that env's frame.
+struct rtslot {
+	sl_uint32 depth;
+	sl_uint32 slot;
+};
+
+/// <rtenv>
+/// Runtime environment. Values live in a contiguous frame, a variable keeps the slot it was created in
+/// until it is deleted. Names map to slots, so code resolved once to an rtslot (see bytecode_compiler)
+/// reads a variable with two array indexings: the ancestor list, then the frame.
+/// Slots of deleted variables are reused, deleting a variable invalidates rtslots resolved to it, declaring one which
+/// shadows it too. Both give the env and its sub environments a new generation, code holding rtslots compares
+/// generations to know they are still valid. Generations are drawn from one counter, an env never gets one it had.
+/// Sub environments are a region owned by their parent: they keep their address until released, a released
+/// one is cleared wholesale and its storage is reused by the next add_subenv. Releasing the newest one gives
+/// its storage back at once, so block and call scopes opened and closed in a loop don't grow the parent.
+/// </rtenv>
 class rtenv {
 	//using string_t = sl_string;
-	using variable_map_t = std::map<sl_string, RTValue>;
+	using variable_map_t = std::map<sl_string, sl_size>; // name -> slot
 	using variable_map_iterator_t = variable_map_t::iterator;
 	using variable_map_const_iterator_t = variable_map_t::const_iterator;
 
-	using rtenv_list = std::list<rtenv>;
-	using rtenv_iterator = rtenv_list::iterator;
-	using rtenv_const_iterator = rtenv_list::const_iterator;
+	using rtenv_region = std::deque<rtenv>; // Stable addresses, unlike a vector.
+	using rtenv_iterator = rtenv_region::iterator;
+	using rtenv_const_iterator = rtenv_region::const_iterator;
 
 	// Purpose of this struct is to avoid testing for the end() iterator. Instead check if the returned iterator is valid. 
 	// Which may be the end() of parent env. Such a comparison will result in an Incompatible Iterator error.
 	struct local_variable_process_result {
 		variable_map_iterator_t it;
 		bool valid;
+		rtenv* owner;
 
 		const sl_string& name() {
 			return it->first;
 		}
 		RTValue& value() {
+			return owner->frame_[it->second];
+		}
+		sl_size slot() const {
 			return it->second;
 		}
 	};
 	struct local_const_variable_process_result {
 		variable_map_const_iterator_t it;
 		bool valid;
+		const rtenv* owner;
 
 		const sl_string& name() const {
 			return it->first;
 		}
 
 		const RTValue& value() const {
-			return it->second;
+			return owner->frame_[it->second];
 		}
 	};
 
@@ -160,8 +424,15 @@ class rtenv {
 
 	sl_string name_{};
 	rtenv* parent_{nullptr};
-	std::list<rtenv> children_{};
+	sl_vector<rtenv*> ancestors_{}; // parent first
+	// Declared before the frame: values destroyed with the frame may release sub environments.
+	rtenv_region children_{};
+	sl_vector<rtenv*> released_children_{};
 	variable_map_t variables_{};
+	sl_vector<RTValue> frame_{};
+	sl_vector<sl_size> free_slots_{};
+	bool clearing_{ false }; // Releases into an env being cleared are dropped, its children go with it.
+	sl_size generation_{ next_generation() }; // New on a deletion, shadowing declaration or clear in this env or a parent.
 
 
 	variable_map_iterator_t vari_end() {
@@ -191,25 +462,141 @@ class rtenv {
 	rtenv_const_iterator subenv_begin() const {
 		return children_.begin();
 	}
+	static sl_size& live_counter() {
+		thread_local sl_size count{ 0 };
+		return count;
+	}
+
+	static sl_size next_generation() {
+		static std::atomic<sl_size> counter{ 0 };
+		return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	// <@method:invalidate> Gives this env and its sub environments a new generation.
+	void invalidate() {
+		invalidate(next_generation());
+	}
+	void invalidate(sl_size generation) {
+		generation_ = generation;
+		for (auto& child : children_) child.invalidate(generation);
+	}
+
+	void attach(rtenv& parent) {
+		parent_ = &parent;
+		ancestors_.clear();
+		ancestors_.reserve(parent.ancestors_.size() + 1);
+		ancestors_.push_back(&parent);
+		ancestors_.insert(ancestors_.end(), parent.ancestors_.begin(), parent.ancestors_.end());
+	}
+
+	// <@method:drop_variables> Drops the variables, sub environments released by their values are freed.
+	void drop_variables() {
+		invalidate();
+		frame_.clear();
+		variables_.clear();
+		free_slots_.clear();
+	}
+
+	// <@method:clear> Drops the variables and sub environments, values first.
+	void clear() {
+		invalidate();
+		clearing_ = true;
+		frame_.clear();
+		variables_.clear();
+		free_slots_.clear();
+		released_children_.clear();
+		children_.clear();
+		clearing_ = false;
+	}
 	public:
-	rtenv() = default;
-	rtenv(const sl_string& name) : name_(name) {}
-	rtenv(const sl_string& name, rtenv& parent) : name_(name), parent_(&parent) {}
+	rtenv() { ++live_counter(); }
+	rtenv(const sl_string& name) : name_(name) { ++live_counter(); }
+	rtenv(const sl_string& name, rtenv& parent) : name_(name) {
+		++live_counter();
+		attach(parent);
+	}
+	// Sub environments and resolved rtslots point into an env, it can't be copied or moved.
+	rtenv(const rtenv&) = delete;
+	rtenv& operator=(const rtenv&) = delete;
+	~rtenv() {
+		clear();
+		--live_counter();
+	}
+
+	// <@method:live_count> Number of rtenv alive on the calling thread.
+	static sl_size live_count() {
+		return live_counter();
+	}
 	//----------------------------------------------------------------------------------------------------------------------------------------------------------//
 	// Local Environment Operations
 	//----------------------------------------------------------------------------------------------------------------------------------------------------------//
 	
-	// <method:add_subenv> Add a sub environment to the current environment
+	// <method:add_subenv> Add a sub environment to the current environment, it lives until release_subenv or
+	// the end of this one.
 	rtenv& add_subenv(const sl_string& name) {
-		children_.emplace_back(name, *this);
-		return children_.back();
+		if (released_children_.empty()) return children_.emplace_back(name, *this);
+		rtenv& reused = *released_children_.back();
+		released_children_.pop_back();
+		reused.name_ = name;
+		reused.attach(*this);
+		return reused;
+	}
+
+	// <@method:release_subenv> Frees a sub environment returned by add_subenv, with everything declared in it.
+	// A function or object declared in child and still held outside it keeps its scope, a sub environment of child:
+	// child then only drops its variables and stays until this env ends, so the value stays valid. Returns false
+	// in that case.
+	bool release_subenv(rtenv& child) {
+		if (clearing_) return true;
+		if (child.parent_ != this) throw std::runtime_error("rtenv:Released env is not a sub environment of:" + name_);
+		// Values first, functions and objects which die with them release their scopes into child.
+		child.drop_variables();
+		if (child.subenv_count() != 0) return false;
+		child.clear();
+		child.parent_ = nullptr;
+		if (!children_.empty() && &children_.back() == &child) children_.pop_back();
+		else released_children_.push_back(&child);
+		return true;
+	}
+
+	// <@method:subenv_count> Number of sub environments in use.
+	sl_size subenv_count() const {
+		return children_.size() - released_children_.size();
+	}
+
+	// <@method:subenv_capacity> Number of sub environments allocated, in use or waiting for reuse.
+	sl_size subenv_capacity() const {
+		return children_.size();
+	}
+
+	// <@method:parent> The environment this one was added to, nullptr for a root.
+	rtenv* parent() const {
+		return parent_;
+	}
+
+	const sl_string& name() const {
+		return name_;
 	}
 
-	// <@method:create_variable> Create a variable in the current environment
+	// <@method:create_variable> Create a variable in the current environment. A variable which shadows one of a
+	// parent changes the generation, slots resolved to the parent's variable are stale.
 	local_variable_process_result create_variable(const sl_string& name, const RTValue& value) {
 		// local vars will shadow parent vars
-		auto inserted = variables_.insert({ name, value });
-		return { inserted.first, inserted.second };
+		auto inserted = variables_.insert({ name, free_slots_.empty() ? frame_.size() : free_slots_.back() });
+		if (inserted.second) {
+			if (has_parent() && parent_->resolve_slot(name)) invalidate();
+			if (inserted.first->second == frame_.size()) frame_.push_back(value);
+			else {
+				free_slots_.pop_back();
+				frame_[inserted.first->second] = value;
+			}
+		}
+		return { inserted.first, inserted.second, this };
+	}
+
+	// <@method:frame_size> Number of slots in the frame, including free ones.
+	sl_size frame_size() const {
+		return frame_.size();
 	}
 
 	//----------------------------------------------------------------------------------------------------------------------------------------------------------//
@@ -220,12 +607,40 @@ class rtenv {
 	env_const_variable_process_result resolve_variable(const sl_string& name) const {
 		auto it = find_variable(name);
 		if (it != vari_cend()) {
-			return { { it,true },*this };
+			return { { it,true,this },*this };
 		}
 		if (has_parent()) {
 			return parent_->resolve_variable(name);
 		}
-		return {{ vari_cend(),false },*this };
+		return {{ vari_cend(),false,this },*this };
+	}
+
+	// <@method:resolve_slot> The slot of the variable visible from this environment, by the same rules as resolve_variable.
+	sl_opt<rtslot> resolve_slot(const sl_string& name) const {
+		const rtenv* env = this;
+		for (sl_uint32 depth = 0; env != nullptr; depth++, env = env->parent_) {
+			auto it = env->find_variable(name);
+			if (it != env->vari_cend()) return rtslot{ depth, static_cast<sl_uint32>(it->second) };
+		}
+		return sl::nullopt;
+	}
+
+	// <@method:at> The value in a slot returned by resolve_slot on this environment.
+	RTValue& at(rtslot slot) {
+		return (slot.depth == 0 ? this : ancestors_[slot.depth - 1])->frame_[slot.slot];
+	}
+
+	// <@method:ancestor> The env depth levels up from this one, as counted by rtslot::depth. nullptr past the root.
+	const rtenv* ancestor(sl_size depth) const {
+		if (depth == 0) return this;
+		return depth <= ancestors_.size() ? ancestors_[depth - 1] : nullptr;
+	}
+
+	// <@method:generation> Changes whenever a slot resolve_slot returned on this env may have been invalidated: on a
+	// deletion or a shadowing declaration in this env or one of its parents. The parents pass theirs down, so
+	// reading it doesn't walk them.
+	sl_size generation() const {
+		return generation_;
 	}
 
 	// <@method:delete_variable> Delete a variable in the current or parent environment
@@ -233,7 +648,12 @@ class rtenv {
 		auto resolved_var = get_variable(name);
 		// The env which owns the var must delete it!!!
 		if (resolved_var.valid()) {
-			resolved_var.env.variables_.erase(resolved_var.iterator());
+			rtenv& owner = *resolved_var.local.owner;
+			const sl_size slot = resolved_var.iterator()->second;
+			owner.frame_[slot] = RTValue{};
+			owner.free_slots_.push_back(slot);
+			owner.invalidate();
+			owner.variables_.erase(resolved_var.iterator());
 			return true; // Deleted Successfully
 		}
 		else { // cant delete a non-existing var
@@ -246,14 +666,14 @@ class rtenv {
 	env_variable_process_result get_variable(const sl_string& name) {
 		auto it = variables_.find(name);
 		if (it != variables_.end()) { // Found locally
-			return { { it,true },*this };
+			return { { it,true,this },*this };
 		}
 		else {
 			if (has_parent()) { // Find in the parent
 				return parent_->get_variable(name);
 			}
 			else { // No parent
-				return { { variables_.end(),false },*this };
+				return { { variables_.end(),false,this },*this };
 			}
 		}
 	}
@@ -266,55 +686,221 @@ class rtenv {
 			return resolved_var;
 		}
 		else { // Could not find var in the current env or in the parent env
-			return { {vari_end(),false},*this };
+			return { {vari_end(),false,this},*this };
 		}
 	}
 
 };
 
-// The C& class object type.
-class object_t {
-	sl_string name_;
-	rtenv& scope_;
+/// <rtenv_scope>
+/// A sub environment for the lifetime of the scope, for blocks and temporaries. Everything declared in it is
+/// freed when the scope ends. Functions and objects declared in it must not outlive it: close reports one still
+/// held outside, the env is then kept until the parent ends so the value stays valid, see release_subenv.
+/// </rtenv_scope>
+class rtenv_scope {
+	rtenv& parent_;
+	rtenv* env_;
+public:
+	rtenv_scope(rtenv& parent, const sl_string& name = "block") : parent_(parent), env_(&parent.add_subenv(name)) {}
+	// Ending the scope by an exception doesn't report values which outlive it.
+	~rtenv_scope() { if (env_) parent_.release_subenv(*env_); }
+	rtenv_scope(const rtenv_scope&) = delete;
+	rtenv_scope& operator=(const rtenv_scope&) = delete;
+
+	rtenv& env() {
+		return *env_;
+	}
+
+	// <@method:close> Ends the scope, throws if a function or object declared in it is still held outside.
+	void close() {
+		rtenv& env = *std::exchange(env_, nullptr);
+		if (!parent_.release_subenv(env))
+			throw std::runtime_error("rtenv_scope:A value declared in the scope outlives it:" + env.name());
+	}
+};
 
-	std::map<sl_string, RTValue> members_;
+// Releases an env returned by add_subenv, once its owner is destroyed.
+inline void release_owned_env(rtenv& env) {
+	if (auto* parent = env.parent()) parent->release_subenv(env);
+}
+
+/// <object_shape>
+/// Layout shared by objects with the same members added in the same order: member names to slots in the frame
+/// of the object scope. Adding a member moves an object to the shape reached from its current one by that name,
+/// so objects built alike share a shape and the address of a shape identifies a layout.
+/// The shapes form one tree for the process, rooted at empty(), and are never freed: inline caches on astnodes
+/// shared between threads refer to them by address. The tree holds one shape per distinct sequence of member
+/// names declared, so it is bounded by the class declarations a program makes, not by how many objects it
+/// creates or frees. A shape is immutable once created, only the transitions are guarded by a lock.
+/// </object_shape>
+class object_shape {
+	std::map<sl_string, sl_uint32, std::less<>> slots_;
+	mutable std::map<sl_string, std::unique_ptr<object_shape>, std::less<>> transitions_;
+
+	object_shape() = default;
+
+	static std::shared_mutex& transitions_mutex() {
+		static std::shared_mutex mutex;
+		return mutex;
+	}
 public:
-	object_t(const sl_string& name,rtenv& scope) : name_(name), scope_(scope) {}
+	object_shape(const object_shape&) = delete;
+	object_shape& operator=(const object_shape&) = delete;
 
-	object_t(const object_t& other) : scope_(other.scope_) {
-		name_ = other.name_;
-		members_ = other.members_;
-		scope_ = other.scope_;
+	// <@method:empty> The shape of objects without members.
+	static const object_shape& empty() {
+		static const object_shape* root = new object_shape(); // Never freed, caches may be used at exit.
+		return *root;
 	}
 
-	object_t(object_t&& other) noexcept : scope_(other.scope_) {
-		name_ = std::move(other.name_);
-		members_ = std::move(other.members_);
-		scope_ = std::move(other.scope_);
+	// <@method:with_member> The shape with the members of this one followed by name, name must be new.
+	const object_shape& with_member(const sl_string& name) const {
+		{
+			std::shared_lock lock(transitions_mutex());
+			auto found = transitions_.find(name);
+			if (found != transitions_.end()) return *found->second;
+		}
+		std::unique_lock lock(transitions_mutex());
+		auto found = transitions_.find(name); // Another thread may have added it.
+		if (found != transitions_.end()) return *found->second;
+		std::unique_ptr<object_shape> next(new object_shape());
+		next->slots_ = slots_;
+		next->slots_.emplace(name, member_count());
+		return *transitions_.emplace(name, std::move(next)).first->second;
 	}
 
-	object_t& operator=(const object_t& other) {
-		name_ = other.name_;
-		members_ = other.members_;
-		scope_ = other.scope_;
-		return *this;
+	// <@method:find> The slot of a member, none if the shape has no such member.
+	sl_opt<sl_uint32> find(sl_string_view name) const {
+		auto found = slots_.find(name);
+		if (found == slots_.end()) return sl::nullopt;
+		return found->second;
 	}
 
-	object_t& operator=(object_t&& other) noexcept {
-		name_ = std::move(other.name_);
-		members_ = std::move(other.members_);
-		scope_ = std::move(other.scope_);
-		return *this;
+	sl_uint32 member_count() const {
+		return static_cast<sl_uint32>(slots_.size());
 	}
+};
 
-	RTValue& get_member(sl_string name) {
-		return scope_.get_variable(name).value();
+/// <member_cache>
+/// Inline cache of a member access node: the member slot for the last shapes seen at the access. An access which
+/// saw one shape is monomorphic, up to max_shapes polymorphic. Past that it is megamorphic, shapes it did not
+/// cache are looked up by name each time.
+/// </member_cache>
+class member_cache : public node_cache {
+public:
+	enum class e_state : sl_uint8 { uninitialized_, monomorphic_, polymorphic_, megamorphic_ };
+	SL_CXS sl_size max_shapes = 4;
+private:
+	struct entry {
+		const object_shape* shape;
+		sl_uint32 slot;
 	};
+	std::array<entry, max_shapes> entries_{};
+	sl_uint8 size_{ 0 };
+	bool megamorphic_{ false };
+	sl_size hits_{ 0 };
+	sl_size misses_{ 0 };
+public:
+	// <@method:find> The cached slot for shape.
+	sl_opt<sl_uint32> find(const object_shape& shape) {
+		for (sl_uint8 i = 0; i < size_; i++) {
+			if (entries_[i].shape == &shape) {
+				++hits_;
+				return entries_[i].slot;
+			}
+		}
+		++misses_;
+		return sl::nullopt;
+	}
+
+	// <@method:insert> Caches the slot found for shape after a miss.
+	void insert(const object_shape& shape, sl_uint32 slot) {
+		if (size_ == max_shapes) {
+			megamorphic_ = true;
+			return;
+		}
+		entries_[size_++] = { &shape, slot };
+	}
+
+	e_state state() const {
+		if (megamorphic_) return e_state::megamorphic_;
+		if (size_ == 0) return e_state::uninitialized_;
+		return size_ == 1 ? e_state::monomorphic_ : e_state::polymorphic_;
+	}
+	sl_size hits() const { return hits_; }
+	sl_size misses() const { return misses_; }
+};
+
+/// <name_slot>
+/// The slot a name read by a function body resolved to, kept on the alnumus node by resolve_names. Valid while
+/// the env scope_depth levels up from the one evaluating the node is scope, and has the generation it had then.
+/// </name_slot>
+struct name_slot : public node_cache {
+	const rtenv* scope{ nullptr }; // nullptr if the name did not resolve.
+	sl_size generation{ 0 };
+	sl_uint32 scope_depth{ 0 }; // Block envs between the evaluating env and scope.
+	rtslot slot{ 0, 0 };
+
+	void resolve(const rtenv& resolved_scope, sl_uint32 depth, rtslot resolved_slot) {
+		scope = &resolved_scope;
+		generation = resolved_scope.generation();
+		scope_depth = depth;
+		slot = resolved_slot;
+	}
+
+	// <@method:valid_in> True if slot is the variable the name resolves to from env.
+	bool valid_in(const rtenv& env) const {
+		if (scope == nullptr) return false;
+		const rtenv* resolved_scope = env.ancestor(scope_depth);
+		return resolved_scope == scope && resolved_scope->generation() == generation;
+	}
+};
+
+// The C& class object type. Owns its scope, a sub environment of the env the class is declared in.
+// Members are the variables of the scope, in the slots given by the shape. They are only added by add_member.
+class object_t : public rtcounted {
+	sl_string name_;
+	rtenv& scope_;
+	const object_shape* shape_{ &object_shape::empty() };
+public:
+	object_t(const sl_string& name,rtenv& scope) : name_(name), scope_(scope) {}
+	// Handles share an object, the scope has a single owner.
+	object_t(const object_t&) = delete;
+	object_t& operator=(const object_t&) = delete;
+	~object_t() {
+		release_owned_env(scope_);
+	}
+
+	// <@method:add_member> Declares a member in the scope, and moves the object to the shape which has it.
+	RTValue& add_member(const sl_string& name, const RTValue& value) {
+		if (shape_->find(name)) throw std::runtime_error("object_t:Member already declared:" + name);
+		if (scope_.frame_size() != shape_->member_count())
+			throw std::runtime_error("object_t:Scope has variables which are not members:" + name_);
+		const object_shape& next = shape_->with_member(name);
+		auto created = scope_.create_variable(name, value);
+		shape_ = &next;
+		return created.value();
+	}
 
-	//auto& add_member(const sl_string& name, const RTValue& value) {
-	//	auto inserted = members_.insert({ name, value });
-	//	return inserted.first;
-	//}
+	// <@method:member_slot> The slot of a member, none if the object has no such member.
+	sl_opt<sl_uint32> member_slot(sl_string_view name) const {
+		return shape_->find(name);
+	}
+
+	// <@method:member> The member in a slot returned by member_slot.
+	RTValue& member(sl_uint32 slot) {
+		return scope_.at(rtslot{ 0, slot });
+	}
+
+	RTValue& get_member(const sl_string& name) {
+		auto slot = member_slot(name);
+		if (!slot) throw std::runtime_error("object_t:Member not found:" + name);
+		return member(*slot);
+	}
+
+	const object_shape& shape() const {
+		return *shape_;
+	}
 
 	const auto& name() const {
 		return name_;
@@ -323,51 +909,152 @@ public:
 	auto& scope() {
 		return scope_;
 	}
+};
+
+// <@method:resolve_member> The slot of a member of object, from the inline cache of the access if it has seen the
+// shape of object. name_of gives the member name, it is only called on a miss.
+template<class NameF>
+sl_uint32 resolve_member(const object_t& object, member_cache& cache, NameF&& name_of) {
+	if (auto slot = cache.find(object.shape())) return *slot;
+	const sl_string name = name_of();
+	auto slot = object.member_slot(name);
+	if (!slot) throw std::runtime_error("CMemberAccessEval:Member not found:" + name);
+	cache.insert(object.shape(), *slot);
+	return *slot;
+}
+
+/// <call_memo>
+/// Bounded LRU cache of the results of a pure function, keyed by its argument values.
+/// Entries and their arguments live in two flat arrays sized on the first insertion, so a lookup is a scan of
+/// the entry hashes and a miss allocates nothing. Keys compare with RTValue::identical: 0.0 and -0.0 are
+/// different arguments, 1.0 / x gives each its own result.
+/// When full, an insertion replaces the least recently used entry.
+/// </call_memo>
+class call_memo {
+	struct entry {
+		sl_size hash;
+		sl_size last_use;
+		RTValue result;
+	};
+
+	sl_vector<entry> entries_;
+	sl_vector<RTValue> args_; // arity_ values per entry, in the order of entries_.
+	sl_size arity_{ 0 };
+	sl_size capacity_;
+	sl_size clock_{ 0 };
+	sl_size hits_{ 0 };
+	sl_size misses_{ 0 };
 
-	auto& set_scope(rtenv& scope) {
-		scope_ = scope;
-		return scope;
+	sl_span<RTValue> args_of(sl_size index) { return sl_span<RTValue>(args_).subspan(index * arity_, arity_); }
+public:
+	SL_CXS sl_size default_capacity = 64;
+
+	call_memo(sl_size capacity = default_capacity) : capacity_(capacity) {}
+
+	// <@method:hash_args> The key hash of a list of argument values.
+	static sl_size hash_args(sl_span<const RTValue> args) {
+		sl_size hash = args.size();
+		for (const auto& arg : args) hash = hash * 31 + arg.hash();
+		return hash;
+	}
+
+	// <@method:find> The cached result for args, nullptr on a miss. A hit makes the entry the most recently used.
+	const RTValue* find(sl_span<const RTValue> args, sl_size hash) {
+		if (args.size() == arity_) {
+			for (sl_size i = 0; i < entries_.size(); i++) {
+				if (entries_[i].hash != hash) continue;
+				auto cached_args = args_of(i);
+				if (std::equal(cached_args.begin(), cached_args.end(), args.begin(),
+					[](const RTValue& a, const RTValue& b) { return a.identical(b); })) {
+					entries_[i].last_use = ++clock_;
+					hits_++;
+					return &entries_[i].result;
+				}
+			}
+		}
+		misses_++;
+		return nullptr;
 	}
+
+	// <@method:insert> Caches the result for args, replacing the least recently used entry if full.
+	void insert(sl_span<const RTValue> args, sl_size hash, RTValue result) {
+		if (capacity_ == 0) return;
+		if (entries_.empty()) {
+			arity_ = args.size();
+			entries_.reserve(capacity_);
+			args_.reserve(capacity_ * arity_);
+		}
+		else if (args.size() != arity_) {
+			return;
+		}
+		sl_size index = entries_.size();
+		if (index < capacity_) {
+			entries_.push_back(entry{});
+			args_.insert(args_.end(), args.begin(), args.end());
+		}
+		else {
+			index = 0;
+			for (sl_size i = 1; i < entries_.size(); i++)
+				if (entries_[i].last_use < entries_[index].last_use) index = i;
+			std::copy(args.begin(), args.end(), args_of(index).begin());
+		}
+		entries_[index] = entry{ hash, ++clock_, std::move(result) };
+	}
+
+	void clear() {
+		entries_.clear();
+		args_.clear();
+	}
+
+	sl_size hits() const { return hits_; }
+	sl_size misses() const { return misses_; }
+	sl_size size() const { return entries_.size(); }
+	sl_size capacity() const { return capacity_; }
+};
+
+/// <purity_analysis>
+/// State of one function_t::is_pure query. A function being analysed is assumed pure, so recursive and mutually
+/// recursive calls end the walk. A pure result which relied on that assumption for a caller still being analysed
+/// is not kept, the function is analysed again on its own. An impure result never relies on it and is kept.
+/// </purity_analysis>
+struct purity_analysis {
+	sl_size depth{ 0 }; // Functions being analysed.
+	sl_size lowest_assumed{ sl_limits<sl_size>::max() }; // Depth of the outermost assumption the result relied on.
 };
 
-class function_t {
+/// <e_purity>
+/// What is known of a function body, see function_t::is_pure.
+/// </e_purity>
+enum class e_purity : sl_uint8 { unknown_, analysing_, pure_, impure_ };
+
+// A C& function. Owns its scope, a sub environment of the env the function is declared in.
+class function_t : public rtcounted {
 	sl_string name_;
 	rtenv& scope_;
 	sl_vector<sl_string> args_;
+	sl_vector<rtslot> arg_slots_; // Declared in scope_ when the function is created, bound by each call.
 	astnode body_;
+	// Body compiled by the bytecode_compiler on the first call through the bytecode_vm.
+	std::shared_ptr<const bytecode_chunk> compiled_body_;
+	e_purity purity_{ e_purity::unknown_ };
+	sl_size analysis_depth_{ 0 }; // Depth in the purity_analysis while analysing_.
+	sl_size analysed_generation_{ 0 }; // Generation of scope_ when purity_ was found, see is_pure.
+	sl_size resolved_generation_{ 0 }; // Generation of scope_ when the names of the body were resolved, 0 if never.
+	call_memo memo_;
 
 public:
 	function_t(const sl_string& name, rtenv& scope, const sl_vector<sl_string>& args, const astnode& body) 
-		: name_(name), scope_(scope), args_(args), body_(body) {}
-
-	function_t(const function_t& other) : scope_(other.scope_) {
-		name_ = other.name_;
-		args_ = other.args_;
-		body_ = other.body_;
-		scope_ = other.scope_;
-	}
-
-	function_t(function_t&& other) noexcept  : scope_(other.scope_) {
-		name_ = std::move(other.name_);
-		args_ = std::move(other.args_);
-		body_ = std::move(other.body_);
-		scope_ = std::move(other.scope_);
-	}
-
-	function_t& operator=(const function_t& other) {
-		name_ = other.name_;
-		args_ = other.args_;
-		body_ = other.body_;
-		scope_ = other.scope_;
-		return *this;
+		: name_(name), scope_(scope), args_(args), body_(body) {
+		for (auto& arg : args_) {
+			arg_slots_.push_back(rtslot{ 0, static_cast<sl_uint32>(scope_.create_variable(arg, RTValue{}).slot()) });
+		}
 	}
 
-	function_t& operator=(function_t&& other) noexcept {
-		name_ = std::move(other.name_);
-		args_ = std::move(other.args_);
-		body_ = std::move(other.body_);
-		scope_ = std::move(other.scope_);
-		return *this;
+	// Handles share a function, the scope has a single owner.
+	function_t(const function_t&) = delete;
+	function_t& operator=(const function_t&) = delete;
+	~function_t() {
+		release_owned_env(scope_);
 	}
 
 	const auto& name() const {
@@ -378,20 +1065,151 @@ public:
 		return scope_;
 	}
 
-	auto& set_scope(rtenv& scope) {
-		scope_ = scope;
-		return scope;
-	}
-
 	const auto& args() const {
 		return args_;
 	}
 
+	const auto& arg_slots() const {
+		return arg_slots_;
+	}
+
 	const auto& children() const {
 		return body_;
 	}
+
+	// <@method:body> The function body, a body deferred by the parser is parsed on first use.
+	const astnode& body() {
+		if (body_.type() == astnode_enum::deferred_functional_block_) {
+			auto parsed_body = parse_deferred_block(body_);
+			if (!parsed_body.valid()) {
+				throw std::runtime_error("function_t:Invalid function body:" + name_ + ":" + parsed_body.error_message());
+			}
+			body_ = parsed_body.extract();
+		}
+		return body_;
+	}
+
+	// <@method:resolved_body> The body, with the names it reads resolved to slots of the scope, see resolve_names.
+	// Resolved again once the generation of the scope changed.
+	const astnode& resolved_body();
+
+	const auto& compiled_body() const {
+		return compiled_body_;
+	}
+
+	void set_compiled_body(std::shared_ptr<const bytecode_chunk> compiled_body) {
+		compiled_body_ = std::move(compiled_body);
+	}
+
+	// <@method:is_pure> True if the result of a call depends only on the arguments, see is_pure_body.
+	// The result and the memo are dropped when the generation of the scope changes: a callee the analysis
+	// resolved may have been deleted and declared again.
+	bool is_pure() {
+		purity_analysis analysis;
+		return is_pure(analysis);
+	}
+	bool is_pure(purity_analysis& analysis);
+
+	// <@method:memoised> True if calls look up and store their result in memo: the function is pure and the memo
+	// has room for entries.
+	bool memoised() {
+		return memo_.capacity() != 0 && is_pure();
+	}
+
+	// <@method:memo> Results of the calls to a pure function, by argument values.
+	call_memo& memo() {
+		return memo_;
+	}
+};
+
+/// <call_frame>
+/// Activation of a function call. The caller pushes the argument values onto a contiguous value stack, entering
+/// the frame swaps them with the values in the argument slots of the function scope, so the stack then holds the
+/// arguments of the suspended activation. Leaving swaps them back and pops them, also when the call throws.
+/// Recursive and mutually recursive calls each see their own arguments, and once the stack has grown to the
+/// deepest call a call allocates nothing.
+/// </call_frame>
+class call_frame {
+	function_t& function_;
+	sl_vector<RTValue>& stack_;
+	sl_size base_;
+	bool entered_{ false };
+
+	static sl_size& depth() {
+		thread_local sl_size depth = 0;
+		return depth;
+	}
+public:
+	SL_CXS sl_size max_depth = 256; // Each C& call nests a few native calls, keep well inside a 1MB thread stack.
+
+	// <@method:local_stack> The value stack of tree walking calls on the calling thread.
+	static sl_vector<RTValue>& local_stack() {
+		thread_local sl_vector<RTValue> stack;
+		return stack;
+	}
+
+	// The arguments are the values pushed on stack from base on.
+	call_frame(function_t& function, sl_vector<RTValue>& stack, sl_size base) : function_(function), stack_(stack), base_(base) {}
+	call_frame(function_t& function, sl_vector<RTValue>& stack) : call_frame(function, stack, stack.size()) {}
+	call_frame(const call_frame&) = delete;
+	call_frame& operator=(const call_frame&) = delete;
+	~call_frame() {
+		leave();
+		stack_.resize(base_);
+	}
+
+	void push_argument(RTValue value) {
+		stack_.push_back(std::move(value));
+	}
+
+	// <@method:args> The argument values, valid outside of the frame.
+	sl_span<const RTValue> args() const {
+		return sl_span<const RTValue>(stack_.data() + base_, stack_.size() - base_);
+	}
+
+	// <@method:enter> Binds the arguments to the function's argument slots.
+	void enter() {
+		const sl_size argc = stack_.size() - base_;
+		if (argc != function_.arg_slots().size()) {
+			throw std::runtime_error("CFunctionCallEval:Function " + function_.name() + " takes "
+				+ std::to_string(function_.arg_slots().size()) + " arguments, " + std::to_string(argc) + " given.");
+		}
+		if (depth() == max_depth)
+			throw std::runtime_error("CFunctionCallEval:Call depth limit exceeded:" + function_.name());
+		depth()++;
+		for (sl_size i = 0; i < argc; i++) std::swap(stack_[base_ + i], function_.scope().at(function_.arg_slots()[i]));
+		entered_ = true;
+	}
+
+	// <@method:leave> Restores the arguments of the suspended activation.
+	void leave() {
+		if (!entered_) return;
+		for (sl_size i = 0; i < function_.arg_slots().size(); i++)
+			std::swap(stack_[base_ + i], function_.scope().at(function_.arg_slots()[i]));
+		depth()--;
+		entered_ = false;
+	}
 };
 
+// <@method:call_arguments> Argument expressions of a call node: the children after the function name, or the
+// children of an arguments_ node following it.
+inline sl_span<const astnode> call_arguments(const astnode& call) {
+	const auto& children = call.children();
+	if (children.size() == 2 && children.back().type() == astnode_enum::arguments_)
+		return sl_span<const astnode>(children.back().children());
+	return sl_span<const astnode>(children).subspan(1);
+}
+
+inline rtref<object_t> RTValue::object() const {
+	expect(OBJECT);
+	return rtref<object_t>(static_cast<object_t*>(payload_.counted));
+}
+
+inline rtref<function_t> RTValue::function() const {
+	expect(FUNCTION);
+	return rtref<function_t>(static_cast<function_t*>(payload_.counted));
+}
+
 struct EnvEvalProcess {
 	virtual RTValue eval(const astnode & node, rtenv& env) = 0;
 	virtual ~EnvEvalProcess() = default;
@@ -453,6 +1271,9 @@ caoco_def_env_eval_process(CVarDeclEval); // anon var decl <#var><alnumus><=><ex
 caoco_def_env_eval_process(CClassDeclEval); // class decl <#class><alnumus><{><...><}>
 caoco_def_env_eval_process(CFunctionDeclEval); // function decl <#function><alnumus><{><...><}>
 caoco_def_env_eval_process(CFunctionCallEval);
+caoco_def_env_eval_process(CMemberAccessEval); // member access <object><.><alnumus> or <object><.><function call>
+RTValue eval_function_body(function_t& function); // Runs the body of a function in its scope, the arguments bound.
+RTValue call_function(function_t& function, const astnode& call, rtenv& env); // Calls with the arguments of a call node.
 //----------------------------------------------------------------------------------------------------------------------------------------------------------//
 // Constant Evaluator Processes Implementations
 //----------------------------------------------------------------------------------------------------------------------------------------------------------//
@@ -526,7 +1347,7 @@ caoco_impl_env_eval_process(CStringEval) {
 	
 	}
 	// node is already a string, extract it and return
-	return RTValue(RTValue::STRING, literal);
+	return RTValue::interned(literal);
 }
 //
 caoco_impl_env_eval_process(CBitEval) {
@@ -618,6 +1439,8 @@ caoco_impl_env_eval_process(CNoneEval) {
 };
 
 caoco_impl_env_eval_process(CVariableEval) {
+	if (const auto* resolved = node.find_cache<name_slot>(); resolved && resolved->valid_in(env))
+		return env.at(resolved->slot);
 	auto var_name = node.literal_str();
 	auto resolved_var = env.resolve_variable(var_name);
 	if (resolved_var.valid()) {
@@ -652,285 +1475,383 @@ caoco_impl_env_eval_process(CLiteralEval) {
 	}
 }
 //----------------------------------------------------------------------------------------------------------------------------------------------------------//
-caoco_impl_env_eval_process(CAddOpEval) {
-	auto left = node.children().front();
-	auto right = node.children().back();
+// Binary operators with a row in the binop_table.
+enum class e_binop : sl_uint8 {
+	add_,
+	sub_,
+	mul_,
+	div_,
+	mod_,
+	eq_, // Comparisons yield a BIT.
+	ne_,
+	lt_,
+	gt_,
+	le_,
+	ge_,
+	count_
+};
 
-	RTValue left_val;
-	RTValue right_val;
-	// Left
-	if (syntax::get_node_operation(left.type()) == syntax::e_operation::binary_) {
-		left_val = CBinopEval{}(left, env);
-	}
-	else if (syntax::get_node_operation(left.type()) == syntax::e_operation::none_) {
-		left_val = CLiteralEval{}(left, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
+using binop_function = RTValue(*)(const RTValue&, const RTValue&);
 
-	// Right
-	if (syntax::get_node_operation(right.type()) == syntax::e_operation::binary_) {
-		right_val = CBinopEval{}(right, env);
-	}
-	else if (syntax::get_node_operation(right.type()) == syntax::e_operation::none_) {
-		right_val = CLiteralEval{}(right, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
+// Operands of a type pair the operator is not defined for.
+template<e_binop Op>
+RTValue invalid_binop(const RTValue&, const RTValue&) {
+	switch (Op) {
+	case e_binop::add_: throw std::runtime_error("CAddOpEval:Invalid types for addition, implicit conversion is disabled.");
+	case e_binop::sub_: throw std::runtime_error("CSubOpEval:Invalid types for subtraction, implicit conversion is disabled.");
+	case e_binop::mul_: throw std::runtime_error("CMultOpEval:Invalid types for multiplication, implicit conversion is disabled.");
+	case e_binop::div_: throw std::runtime_error("CDivOpEval:Invalid types for division, implicit conversion is disabled.");
+	case e_binop::mod_: throw std::runtime_error("CModOpEval:Invalid types for modulo, implicit conversion is disabled.");
+	default: throw std::runtime_error("CCompareOpEval:Invalid types for comparison, implicit conversion is disabled.");
 	}
+}
 
+// Op applied to two values of the arithmetic type stored as T, the result is converted back to the type.
+template<e_binop Op, RTValue::eType Type, typename T>
+RTValue arithmetic_binop(const RTValue& left_val, const RTValue& right_val) {
+	const T left = left_val.as<T>();
+	const T right = right_val.as<T>();
+	if constexpr ((Op == e_binop::div_ || Op == e_binop::mod_) && std::is_integral_v<T>) {
+		if (right == 0) throw std::runtime_error(Op == e_binop::div_ ? "CDivOpEval:Division by zero." : "CModOpEval:Modulo by zero.");
+	}
+	if constexpr (Op == e_binop::add_) return RTValue{ Type, left + right };
+	else if constexpr (Op == e_binop::sub_) return RTValue{ Type, left - right };
+	else if constexpr (Op == e_binop::mul_) return RTValue{ Type, left * right };
+	else if constexpr (Op == e_binop::div_) return RTValue{ Type, left / right };
+	else return RTValue{ Type, left % right };
+}
 
+template<e_binop Op, typename T>
+bool compare(const T& left, const T& right) {
+	if constexpr (Op == e_binop::eq_) return left == right;
+	else if constexpr (Op == e_binop::ne_) return left != right;
+	else if constexpr (Op == e_binop::lt_) return left < right;
+	else if constexpr (Op == e_binop::gt_) return left > right;
+	else if constexpr (Op == e_binop::le_) return left <= right;
+	else return left >= right;
+}
 
-	if (left_val.type == RTValue::NUMBER && right_val.type == RTValue::NUMBER) {
-		return RTValue{ RTValue::NUMBER, std::get<int>(left_val.value) + std::get<int>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::REAL && right_val.type == RTValue::REAL) {
-		return RTValue{ RTValue::REAL, std::get<double>(left_val.value) + std::get<double>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::STRING && right_val.type == RTValue::STRING) {
-		return RTValue{ RTValue::STRING, std::get<sl_string>(left_val.value) + std::get<sl_string>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::BIT && right_val.type == RTValue::BIT) {
-		return RTValue{ RTValue::BIT, std::get<bool>(left_val.value) + std::get<bool>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::BYTE && right_val.type == RTValue::BYTE) {
-		return RTValue{ RTValue::BYTE, static_cast<unsigned char>(std::get<unsigned char>(left_val.value) + std::get<unsigned char>(right_val.value)) };
-	}
-	else if (left_val.type == RTValue::UNSIGNED && right_val.type == RTValue::UNSIGNED) {
-		return RTValue{ RTValue::UNSIGNED, std::get<unsigned>(left_val.value) + std::get<unsigned>(right_val.value) };
-	}
-	else {
-		throw std::runtime_error("CAddOpEval:Invalid types for addition, implicit conversion is disabled.");
-	}
+// Comparison of two values of the type stored as T.
+template<e_binop Op, typename T>
+RTValue compare_binop(const RTValue& left_val, const RTValue& right_val) {
+	return RTValue{ RTValue::BIT, compare<Op>(left_val.as<T>(), right_val.as<T>()) };
 }
 
-caoco_impl_env_eval_process(CSubOpEval) {
-	auto left = node.children().front();
-	auto right = node.children().back();
+// Lexicographical comparison of two strings.
+template<e_binop Op>
+RTValue compare_strings(const RTValue& left_val, const RTValue& right_val) {
+	return RTValue{ RTValue::BIT, compare<Op>(left_val.string(), right_val.string()) };
+}
 
-	RTValue left_val;
-	RTValue right_val;
-	// Left
-	if (syntax::get_node_operation(left.type()) == syntax::e_operation::binary_) {
-		left_val = CBinopEval{}(left, env);
-	}
-	else if (syntax::get_node_operation(left.type()) == syntax::e_operation::none_) {
-		left_val = CLiteralEval{}(left, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
+inline RTValue concatenate_strings(const RTValue& left_val, const RTValue& right_val) {
+	sl_string_view left = left_val.string();
+	sl_string_view right = right_val.string();
+	sl_string sum;
+	sum.reserve(left.size() + right.size());
+	sum.append(left).append(right);
+	return RTValue{ RTValue::STRING, sum };
+}
 
-	// Right
-	if (syntax::get_node_operation(right.type()) == syntax::e_operation::binary_) {
-		right_val = CBinopEval{}(right, env);
-	}
-	else if (syntax::get_node_operation(right.type()) == syntax::e_operation::none_) {
-		right_val = CLiteralEval{}(right, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
+/// <binop_table>
+/// Implementation of every binary operator for every pair of operand types, indexed [op][left type][right type].
+/// Built at compile time, pairs without an implementation throw. Implicit conversion is disabled, so only
+/// pairs of the same type are filled in.
+/// </binop_table>
+struct binop_table {
+	SL_CXS sl_size op_count = static_cast<sl_size>(e_binop::count_);
+	SL_CXS sl_size type_count = RTValue::type_count;
+
+	binop_function functions[op_count][type_count][type_count];
+
+	SL_CX binop_table() : functions{} {
+		fill_invalid<e_binop::add_>();
+		fill_invalid<e_binop::sub_>();
+		fill_invalid<e_binop::mul_>();
+		fill_invalid<e_binop::div_>();
+		fill_invalid<e_binop::mod_>();
+		fill_invalid<e_binop::eq_>();
+		fill_invalid<e_binop::ne_>();
+		fill_invalid<e_binop::lt_>();
+		fill_invalid<e_binop::gt_>();
+		fill_invalid<e_binop::le_>();
+		fill_invalid<e_binop::ge_>();
+		fill_arithmetic<RTValue::NUMBER, int, true>();
+		fill_arithmetic<RTValue::REAL, double, false>();
+		fill_arithmetic<RTValue::BYTE, unsigned char, true>();
+		fill_arithmetic<RTValue::UNSIGNED, unsigned, true>();
+		at(e_binop::add_, RTValue::STRING, RTValue::STRING) = &concatenate_strings;
+		at(e_binop::add_, RTValue::BIT, RTValue::BIT) = &arithmetic_binop<e_binop::add_, RTValue::BIT, bool>;
+		fill_comparison<RTValue::NUMBER, int>();
+		fill_comparison<RTValue::REAL, double>();
+		fill_comparison<RTValue::BYTE, unsigned char>();
+		fill_comparison<RTValue::UNSIGNED, unsigned>();
+		at(e_binop::eq_, RTValue::BIT, RTValue::BIT) = &compare_binop<e_binop::eq_, bool>;
+		at(e_binop::ne_, RTValue::BIT, RTValue::BIT) = &compare_binop<e_binop::ne_, bool>;
+		at(e_binop::eq_, RTValue::STRING, RTValue::STRING) = &compare_strings<e_binop::eq_>;
+		at(e_binop::ne_, RTValue::STRING, RTValue::STRING) = &compare_strings<e_binop::ne_>;
+		at(e_binop::lt_, RTValue::STRING, RTValue::STRING) = &compare_strings<e_binop::lt_>;
+		at(e_binop::gt_, RTValue::STRING, RTValue::STRING) = &compare_strings<e_binop::gt_>;
+		at(e_binop::le_, RTValue::STRING, RTValue::STRING) = &compare_strings<e_binop::le_>;
+		at(e_binop::ge_, RTValue::STRING, RTValue::STRING) = &compare_strings<e_binop::ge_>;
+	}
+
+	SL_CX binop_function& at(e_binop op, RTValue::eType left, RTValue::eType right) {
+		return functions[static_cast<sl_size>(op)][left][right];
+	}
+
+	SL_CX binop_function at(e_binop op, RTValue::eType left, RTValue::eType right) const {
+		return functions[static_cast<sl_size>(op)][left][right];
+	}
+private:
+	template<e_binop Op>
+	SL_CX void fill_invalid() {
+		for (auto& left : functions[static_cast<sl_size>(Op)])
+			for (auto& function : left) function = &invalid_binop<Op>;
+	}
+
+	template<RTValue::eType Type, typename T, bool HasModulo>
+	SL_CX void fill_arithmetic() {
+		at(e_binop::add_, Type, Type) = &arithmetic_binop<e_binop::add_, Type, T>;
+		at(e_binop::sub_, Type, Type) = &arithmetic_binop<e_binop::sub_, Type, T>;
+		at(e_binop::mul_, Type, Type) = &arithmetic_binop<e_binop::mul_, Type, T>;
+		at(e_binop::div_, Type, Type) = &arithmetic_binop<e_binop::div_, Type, T>;
+		if constexpr (HasModulo) at(e_binop::mod_, Type, Type) = &arithmetic_binop<e_binop::mod_, Type, T>;
+	}
+
+	template<RTValue::eType Type, typename T>
+	SL_CX void fill_comparison() {
+		at(e_binop::eq_, Type, Type) = &compare_binop<e_binop::eq_, T>;
+		at(e_binop::ne_, Type, Type) = &compare_binop<e_binop::ne_, T>;
+		at(e_binop::lt_, Type, Type) = &compare_binop<e_binop::lt_, T>;
+		at(e_binop::gt_, Type, Type) = &compare_binop<e_binop::gt_, T>;
+		at(e_binop::le_, Type, Type) = &compare_binop<e_binop::le_, T>;
+		at(e_binop::ge_, Type, Type) = &compare_binop<e_binop::ge_, T>;
 	}
+};
 
-	if (left_val.type == RTValue::NUMBER && right_val.type == RTValue::NUMBER) {
-		return RTValue{ RTValue::NUMBER, std::get<int>(left_val.value) - std::get<int>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::REAL && right_val.type == RTValue::REAL) {
-		return RTValue{ RTValue::REAL, std::get<double>(left_val.value) - std::get<double>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::BYTE && right_val.type == RTValue::BYTE) {
-		return RTValue{ RTValue::BYTE, static_cast<unsigned char>(std::get<unsigned char>(left_val.value) - std::get<unsigned char>(right_val.value)) };
-	}
-	else if (left_val.type == RTValue::UNSIGNED && right_val.type == RTValue::UNSIGNED) {
-		return RTValue{ RTValue::UNSIGNED, std::get<unsigned>(left_val.value) - std::get<unsigned>(right_val.value) };
-	}
-	else {
-		throw std::runtime_error("CSubOpEval:Invalid types for subtraction, implicit conversion is disabled.");
-	}
+inline constexpr binop_table binop_dispatch{};
 
+// <@method:apply_binop> Value of op applied to left and right, one table lookup and one call.
+inline RTValue apply_binop(e_binop op, const RTValue& left, const RTValue& right) {
+	return binop_dispatch.at(op, left.type, right.type)(left, right);
 }
 
-caoco_impl_env_eval_process(CMultOpEval) {
-	auto left = node.children().front();
-	auto right = node.children().back();
-
-	RTValue left_val;
-	RTValue right_val;
-	// Left
-	if (syntax::get_node_operation(left.type()) == syntax::e_operation::binary_) {
-		left_val = CBinopEval{}(left, env);
-	}
-	else if (syntax::get_node_operation(left.type()) == syntax::e_operation::none_) {
-		left_val = CLiteralEval{}(left, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
+// <@method:binop_of> The e_binop of a binary operation node.
+inline e_binop binop_of(astnode_enum op) {
+	switch (op) {
+	case astnode_enum::addition_: return e_binop::add_;
+	case astnode_enum::subtraction_: return e_binop::sub_;
+	case astnode_enum::multiplication_: return e_binop::mul_;
+	case astnode_enum::division_: return e_binop::div_;
+	case astnode_enum::remainder_: return e_binop::mod_;
+	case astnode_enum::equal_: return e_binop::eq_;
+	case astnode_enum::not_equal_: return e_binop::ne_;
+	case astnode_enum::less_than_: return e_binop::lt_;
+	case astnode_enum::greater_than_: return e_binop::gt_;
+	case astnode_enum::less_than_or_equal_: return e_binop::le_;
+	case astnode_enum::greater_than_or_equal_: return e_binop::ge_;
+	default: throw std::runtime_error("CBinopEval:Invalid binary operator node type:" + std::to_string(static_cast<int>(op)));
 	}
+}
 
-	// Right
-	if (syntax::get_node_operation(right.type()) == syntax::e_operation::binary_) {
-		right_val = CBinopEval{}(right, env);
-	}
-	else if (syntax::get_node_operation(right.type()) == syntax::e_operation::none_) {
-		right_val = CLiteralEval{}(right, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
+// Value of the binary operation op applied to left and right.
+inline RTValue apply_binop(astnode_enum op, const RTValue& left, const RTValue& right) {
+	return apply_binop(binop_of(op), left, right);
+}
 
-	if (left_val.type == RTValue::NUMBER && right_val.type == RTValue::NUMBER) {
-		return RTValue{ RTValue::NUMBER, std::get<int>(left_val.value) * std::get<int>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::REAL && right_val.type == RTValue::REAL) {
-		return RTValue{ RTValue::REAL, std::get<double>(left_val.value) * std::get<double>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::BYTE && right_val.type == RTValue::BYTE) {
-		return RTValue{ RTValue::BYTE, static_cast<unsigned char>(std::get<unsigned char>(left_val.value) * std::get<unsigned char>(right_val.value)) };
-	}
-	else if (left_val.type == RTValue::UNSIGNED && right_val.type == RTValue::UNSIGNED) {
-		return RTValue{ RTValue::UNSIGNED, std::get<unsigned>(left_val.value) * std::get<unsigned>(right_val.value) };
-	}
-	else {
-		throw std::runtime_error("CMultOpEval:Invalid types for multiplication, implicit conversion is disabled.");
-	}
+// Value of left + right, both operands must have the same type.
+inline RTValue add_rtvalues(const RTValue& left_val, const RTValue& right_val) {
+	return apply_binop(e_binop::add_, left_val, right_val);
 }
 
-caoco_impl_env_eval_process(CDivOpEval) {
-	auto left = node.children().front();
-	auto right = node.children().back();
+// Value of left - right, both operands must have the same type.
+inline RTValue subtract_rtvalues(const RTValue& left_val, const RTValue& right_val) {
+	return apply_binop(e_binop::sub_, left_val, right_val);
+}
 
-	RTValue left_val;
-	RTValue right_val;
-	// Left
-	if (syntax::get_node_operation(left.type()) == syntax::e_operation::binary_) {
-		left_val = CBinopEval{}(left, env);
-	}
-	else if (syntax::get_node_operation(left.type()) == syntax::e_operation::none_) {
-		left_val = CLiteralEval{}(left, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
+// Value of left * right, both operands must have the same type.
+inline RTValue multiply_rtvalues(const RTValue& left_val, const RTValue& right_val) {
+	return apply_binop(e_binop::mul_, left_val, right_val);
+}
 
-	// Right
-	if (syntax::get_node_operation(right.type()) == syntax::e_operation::binary_) {
-		right_val = CBinopEval{}(right, env);
-	}
-	else if (syntax::get_node_operation(right.type()) == syntax::e_operation::none_) {
-		right_val = CLiteralEval{}(right, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
+// Value of left / right, both operands must have the same type.
+inline RTValue divide_rtvalues(const RTValue& left_val, const RTValue& right_val) {
+	return apply_binop(e_binop::div_, left_val, right_val);
+}
 
-	if (left_val.type == RTValue::NUMBER && right_val.type == RTValue::NUMBER) {
-		return RTValue{ RTValue::NUMBER, std::get<int>(left_val.value) / std::get<int>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::REAL && right_val.type == RTValue::REAL) {
-		return RTValue{ RTValue::REAL, std::get<double>(left_val.value) / std::get<double>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::BYTE && right_val.type == RTValue::BYTE) {
-		return RTValue{ RTValue::BYTE, static_cast<unsigned char>(std::get<unsigned char>(left_val.value) / std::get<unsigned char>(right_val.value)) };
-	}
-	else if (left_val.type == RTValue::UNSIGNED && right_val.type == RTValue::UNSIGNED) {
-		return RTValue{ RTValue::UNSIGNED, std::get<unsigned>(left_val.value) / std::get<unsigned>(right_val.value) };
-	}
-	else {
-		throw std::runtime_error("CDivOpEval:Invalid types for division, implicit conversion is disabled.");
-	}
+// Value of left % right, both operands must have the same type.
+inline RTValue modulo_rtvalues(const RTValue& left_val, const RTValue& right_val) {
+	return apply_binop(e_binop::mod_, left_val, right_val);
 }
 
-caoco_impl_env_eval_process(CModOpEval) {
-	auto left = node.children().front();
-	auto right = node.children().back();
+caoco_impl_env_eval_process(CAddOpEval) {
+	return CBinopEval{}(node, env);
+}
 
-	RTValue left_val;
-	RTValue right_val;
-	// Left
-	if (syntax::get_node_operation(left.type()) == syntax::e_operation::binary_) {
-		left_val = CBinopEval{}(left, env);
-	}
-	else if (syntax::get_node_operation(left.type()) == syntax::e_operation::none_) {
-		left_val = CLiteralEval{}(left, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
+caoco_impl_env_eval_process(CSubOpEval) {
+	return CBinopEval{}(node, env);
+}
 
-	// Right
-	if (syntax::get_node_operation(right.type()) == syntax::e_operation::binary_) {
-		right_val = CBinopEval{}(right, env);
-	}
-	else if (syntax::get_node_operation(right.type()) == syntax::e_operation::none_) {
-		right_val = CLiteralEval{}(right, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
+caoco_impl_env_eval_process(CMultOpEval) {
+	return CBinopEval{}(node, env);
+}
 
-	if (left_val.type == RTValue::NUMBER && right_val.type == RTValue::NUMBER) {
-		return RTValue{ RTValue::NUMBER, std::get<int>(left_val.value) % std::get<int>(right_val.value) };
-	}
-	else if (left_val.type == RTValue::BYTE && right_val.type == RTValue::BYTE) {
-		return RTValue{ RTValue::BYTE, static_cast<unsigned char>(std::get<unsigned char>(left_val.value) % std::get<unsigned char>(right_val.value)) };
-	}
-	else if (left_val.type == RTValue::UNSIGNED && right_val.type == RTValue::UNSIGNED) {
-		return RTValue{ RTValue::UNSIGNED, std::get<unsigned>(left_val.value) % std::get<unsigned>(right_val.value) };
-	}
-	else {
-		throw std::runtime_error("CModOpEval:Invalid types for modulo, implicit conversion is disabled.");
-	}
+caoco_impl_env_eval_process(CDivOpEval) {
+	return CBinopEval{}(node, env);
 }
 
+caoco_impl_env_eval_process(CModOpEval) {
+	return CBinopEval{}(node, env);
+}
+
+// binop_counters are kept in debug builds, test and profiling builds of release define CAOCO_EVAL_COUNTERS to 1.
+#ifndef CAOCO_EVAL_COUNTERS
+#ifdef NDEBUG
+#define CAOCO_EVAL_COUNTERS 0
+#else
+#define CAOCO_EVAL_COUNTERS 1
+#endif
+#endif
+
+/// <binop_counters>
+/// Work done by CBinopEval on the calling thread: operands are leaves evaluated by CLiteralEval, operations
+/// are applied operators. An expression of n leaves costs exactly n operands and n - 1 operations.
+/// Only counted if CAOCO_EVAL_COUNTERS is on.
+/// </binop_counters>
+struct binop_counters {
+	sl_size operands{ 0 };
+	sl_size operations{ 0 };
+
+	static binop_counters& local() {
+		thread_local binop_counters counters;
+		return counters;
+	}
+};
+
+// Nested operations are evaluated in post order with a work stack instead of recursion, so an expression of any
+// depth is evaluated in constant stack space. Each operand is evaluated once, left before right.
 caoco_impl_env_eval_process(CBinopEval) {
 	if(node.children().size()==0) { // If the node has no child, it is a literal
 		return CLiteralEval{}(node, env);
 	}
-	// If lhs node is binop,process it.
-	auto left = node.children().front();
-	auto right = node.children().back();
-	RTValue left_val;
-	RTValue right_val;
-	// Left
-	if(syntax::get_node_operation(left.type()) == syntax::e_operation::binary_) {
-		left_val = CBinopEval{}(left, env);
-	}
-	else if (syntax::get_node_operation(left.type()) == syntax::e_operation::none_) {
-		left_val = CLiteralEval{}(left, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
-	}
-
-	// Right
-	if (syntax::get_node_operation(right.type()) == syntax::e_operation::binary_) {
-		right_val = CBinopEval{}(right, env);
-	}
-	else if (syntax::get_node_operation(right.type()) == syntax::e_operation::none_) {
-		right_val = CLiteralEval{}(right, env);
-	}
-	else {
-		throw "NOT IMPLEMENTED";
+	struct pending_node {
+		const astnode* node;
+		bool expanded;
+	};
+	sl_vector<pending_node> work{ { &node, false } };
+	sl_vector<RTValue> values;
+#if CAOCO_EVAL_COUNTERS
+	binop_counters& counters = binop_counters::local();
+#endif
+	while (!work.empty()) {
+		pending_node& top = work.back();
+		const astnode& current = *top.node;
+		if (current.type() == astnode_enum::expression_ && current.children().size() == 1) {
+			top.node = &current.children().front();
+		}
+		else if (current.type() == astnode_enum::function_call_) {
+			values.push_back(CFunctionCallEval{}(current, env));
+			work.pop_back();
+		}
+		else if (current.type() == astnode_enum::period_) {
+			values.push_back(CMemberAccessEval{}(current, env));
+			work.pop_back();
+		}
+		else if (top.expanded) {
+			// Both operands are on the value stack, the right one on top.
+			RTValue right_val = std::move(values.back());
+			values.pop_back();
+			RTValue left_val = std::move(values.back());
+			values.pop_back();
+			values.push_back(apply_binop(current.type(), left_val, right_val));
+#if CAOCO_EVAL_COUNTERS
+			++counters.operations;
+#endif
+			work.pop_back();
+		}
+		else if (&current == &node || syntax::get_node_operation(current.type()) == syntax::e_operation::binary_) {
+			top.expanded = true;
+			// The left operand is pushed last so it is evaluated first.
+			work.push_back({ &current.children().back(), false });
+			work.push_back({ &current.children().front(), false });
+		}
+		else if (syntax::get_node_operation(current.type()) == syntax::e_operation::none_) {
+			values.push_back(CLiteralEval{}(current, env));
+#if CAOCO_EVAL_COUNTERS
+			++counters.operands;
+#endif
+			work.pop_back();
+		}
+		else {
+			throw std::runtime_error("CBinopEval:Invalid operand node type:" + std::to_string(static_cast<int>(current.type())));
+		}
 	}
+	return std::move(values.back());
+}
 
-	// Get the type of the operation
-	auto op = node.type();
-	switch (op) {
-	case astnode_enum::addition_:
-		return CAddOpEval{}(node, env);
-	case astnode_enum::subtraction_:
-		return CSubOpEval{}(node, env);
-	case astnode_enum::multiplication_:
-	return CMultOpEval{}(node, env);
-	case astnode_enum::division_:
-	return CDivOpEval{}(node, env);
-	case astnode_enum::remainder_:
-	return CModOpEval{}(node, env);
-	default:
-		throw "NOT IMPLEMENTED";
+// <@method:eval_image> Evaluates the expression rooted at node of a caoco::astnode image in place, as CBinopEval
+// evaluates the tree the image was written from. Operators are walked in the view, a leaf is made into a single
+// astnode to be evaluated. Calls and member accesses are built from the image, see ast_image::view::to_astnode.
+inline RTValue eval_image(const ast_image::view& image, ast_image::index_t node, rtenv& env) {
+	if (image.tree() != ast_image::e_tree::astnode_)
+		throw std::runtime_error("eval_image:Image holds another kind of tree.");
+	auto eval_leaf = [&image, &env](ast_image::index_t leaf) {
+		return CLiteralEval{}(astnode(image.astnode_type(leaf), sl_u8string(image.literal(leaf))), env);
+	};
+	if (image.leaf(node)) return eval_leaf(node);
+	struct pending_node {
+		ast_image::index_t node;
+		bool expanded;
+	};
+	sl_vector<pending_node> work{ { node, false } };
+	sl_vector<RTValue> values;
+#if CAOCO_EVAL_COUNTERS
+	binop_counters& counters = binop_counters::local();
+#endif
+	while (!work.empty()) {
+		pending_node& top = work.back();
+		const ast_image::index_t current = top.node;
+		const astnode_enum type = image.astnode_type(current);
+		if (type == astnode_enum::expression_ && image.size(current) == 1) {
+			top.node = image.child(current, 0);
+		}
+		else if (type == astnode_enum::function_call_) {
+			values.push_back(CFunctionCallEval{}(image.to_astnode(current), env));
+			work.pop_back();
+		}
+		else if (type == astnode_enum::period_) {
+			values.push_back(CMemberAccessEval{}(image.to_astnode(current), env));
+			work.pop_back();
+		}
+		else if (top.expanded) {
+			RTValue right_val = std::move(values.back());
+			values.pop_back();
+			RTValue left_val = std::move(values.back());
+			values.pop_back();
+			values.push_back(apply_binop(type, left_val, right_val));
+#if CAOCO_EVAL_COUNTERS
+			++counters.operations;
+#endif
+			work.pop_back();
+		}
+		else if (current == node || syntax::get_node_operation(type) == syntax::e_operation::binary_) {
+			top.expanded = true;
+			const ast_image::index_t left = image.child(current, 0);
+			work.push_back({ image.child(current, image.size(current) - 1), false });
+			work.push_back({ left, false });
+		}
+		else if (syntax::get_node_operation(type) == syntax::e_operation::none_) {
+			values.push_back(eval_leaf(current));
+#if CAOCO_EVAL_COUNTERS
+			++counters.operands;
+#endif
+			work.pop_back();
+		}
+		else {
+			throw std::runtime_error("eval_image:Invalid operand node type:" + std::to_string(static_cast<int>(type)));
+		}
 	}
-
+	return std::move(values.back());
 }
 
 caoco_impl_env_eval_process(CVarDeclEval) {
@@ -953,6 +1874,16 @@ caoco_impl_env_eval_process(CVarDeclEval) {
 	return created_var.value(); // return ref to the created variable
 }
 
+// <@method:make_function> The function of a <function_definition> node, its scope a sub environment of env.
+inline rtref<function_t> make_function(const astnode& node, rtenv& env) {
+	sl_vector<sl_string> arguments;
+	for (auto& arg : std::next(node.children().begin())->children()) {
+		arguments.push_back(arg.literal_str());
+	}
+	const sl_string function_name = node.children().front().literal_str();
+	return make_rtref<function_t>(function_name, env.add_subenv(function_name), arguments, node.children().back());
+}
+
 caoco_impl_env_eval_process(CClassDeclEval) {
 	/* Format of incoming node:
 		<class_definition>
@@ -961,13 +1892,23 @@ caoco_impl_env_eval_process(CClassDeclEval) {
 				-> ...statements...
 	*/
 	auto class_name = node.children().front().literal_str();
-	auto new_class = std::make_shared<object_t>(object_t(class_name, env.add_subenv(class_name)));
+	// Checked before adding the scope, so a failed declaration leaves no env behind.
+	if (env.resolve_variable(class_name).valid()) {
+		throw std::runtime_error("CClassDeclEval:Class already declared:" + class_name);
+	}
+	auto new_class = make_rtref<object_t>(class_name, env.add_subenv(class_name));
 	auto created_class = env.create_variable(class_name, RTValue(RTValue::OBJECT, new_class));
 
-	// Process the class body
+	// Process the class body, anon var decls and methods for now. Members are added in order, so classes
+	// declaring the same members share a shape.
 	for (auto& statement : node.children().back().children()) {
-		// only anonvardeclfor now
-		CVarDeclEval{}(statement, new_class->scope());
+		auto member_name = statement.children().front().literal_str();
+		if (statement.type() == astnode_enum::method_definition_) {
+			new_class->add_member(member_name, RTValue(RTValue::FUNCTION, make_function(statement, new_class->scope())));
+		}
+		else {
+			new_class->add_member(member_name, CBinopEval()(statement.children().back().children().back(), new_class->scope()));
+		}
 	}
 
 	return created_class.value(); // return ref to the created class
@@ -982,21 +1923,20 @@ caoco_impl_env_eval_process(CFunctionDeclEval) {
 				-> ...statements...
 	*/
 	auto function_name = node.children().front().literal_str();
-	auto arguments = [&node]() {
-		sl_vector<sl_string> args;
-		for (auto& arg : (*(node.children().begin()++)).children()) {
-			args.push_back(arg.literal_str());
-		}
-		return args;
-	}();
-	auto new_function = std::make_shared<function_t>(function_t(function_name, env.add_subenv(function_name), arguments, node.children().back()));
-	auto created_function = env.create_variable(function_name, RTValue(RTValue::FUNCTION, new_function));
+	if (env.resolve_variable(function_name).valid()) {
+		throw std::runtime_error("CFunctionDeclEval:Function already declared:" + function_name);
+	}
+	auto created_function = env.create_variable(function_name, RTValue(RTValue::FUNCTION, make_function(node, env)));
 
 	return created_function.value(); // return ref to the created function
 };
 
 caoco_impl_env_eval_process(CFunctionCallEval) {
-	// front will be the function name, back will be the arguments
+	// front is the function name, followed by the arguments, see call_arguments.
+	if (const auto* resolved = node.children().front().find_cache<name_slot>(); resolved && resolved->valid_in(env)) {
+		auto function = env.at(resolved->slot).function();
+		return call_function(*function, node, env);
+	}
 	auto function_name = node.children().front().literal_str();
 
 	// Get the function from the env
@@ -1007,19 +1947,307 @@ caoco_impl_env_eval_process(CFunctionCallEval) {
 		throw std::runtime_error("CFunctionCallEval:Function not found:" + function_name);
 	}
 
-	// Bind the arguments to the function
-	auto& function = std::get<std::shared_ptr<function_t>>(resolved_function.value().value);
-	function->scope().create_variable(function->args().front(),CBinopEval()(node.children().back(), env));
+	// Held by value, the call may change the env which owns the function.
+	auto function = resolved_function.value().function();
+	return call_function(*function, node, env);
+}
 
-	// Evaluate the function body(for now only 1 return statement)
-	auto result = CBinopEval()(function->children().children().front().children().back(), function->scope());
+RTValue call_function(function_t& function, const astnode& call, rtenv& env) {
+	// The arguments are evaluated in the caller's env, onto the call stack.
+	call_frame frame(function, call_frame::local_stack());
+	for (const auto& argument : call_arguments(call)) {
+		frame.push_argument(CBinopEval()(argument, env));
+	}
 
-	// destroy the variables created in the function scope
-	for (auto& arg : function->args()) {
-		function->scope().delete_variable(arg);
+	// A pure function called with the same arguments again returns the cached result.
+	const bool pure = function.memoised();
+	sl_size args_hash = 0;
+	if (pure) {
+		args_hash = call_memo::hash_args(frame.args());
+		if (const RTValue* cached = function.memo().find(frame.args(), args_hash)) return *cached;
 	}
 
+	frame.enter();
+	RTValue result = eval_function_body(function);
+	frame.leave();
+
+	if (pure) function.memo().insert(frame.args(), args_hash, result);
 	return result;
 }
 
+caoco_impl_env_eval_process(CMemberAccessEval) {
+	/* Format of incoming node:
+		<period_>
+			-> <expression> The object
+			-> <alnumus> The member, or
+			-> <function_call_> A method and its arguments, see call_arguments.
+	*/
+	// Held by value, the object owns the scope the member lives in.
+	auto object = CBinopEval()(node.children().front(), env).object();
+	const astnode& member = node.children().back();
+	const bool is_call = member.type() == astnode_enum::function_call_;
+	// The name is only read when the inline cache of the node misses.
+	const sl_uint32 slot = resolve_member(*object, node.cache<member_cache>(), [&member, is_call] {
+		return is_call ? member.children().front().literal_str() : member.literal_str();
+	});
+	if (!is_call) return object->member(slot);
+	// Arguments are evaluated in the caller's env, the method body sees the members through its scope.
+	auto method = object->member(slot).function();
+	return call_function(*method, member, env);
+}
+
+// Statements of a functional block: returns stop the function, conditionals run the block of the first clause
+// whose condition is 1b, variables declared in the block live until it ends. The first declaration opens a sub
+// environment of scope for the block, each activation and each run of a clause has its own.
+// Returns none if the block ends without a return.
+inline sl_opt<RTValue> eval_functional_block(const astnode& block, rtenv& scope) {
+	sl_opt<rtenv_scope> block_scope;
+	auto block_env = [&]() -> rtenv& { return block_scope ? block_scope->env() : scope; };
+	auto leave = [&block_scope](sl_opt<RTValue> result) {
+		if (block_scope) block_scope->close();
+		return result;
+	};
+	for (const auto& statement : block.children()) {
+		switch (statement.type()) {
+		case astnode_enum::return_:
+			if (statement.children().empty()) return leave(make_rtval_none());
+			return leave(CBinopEval()(statement.children().back(), block_env()));
+		case astnode_enum::conditional_statement_:
+			for (const auto& clause : statement.children()) {
+				if (clause.type() != astnode_enum::else_) {
+					RTValue condition = CBinopEval()(clause.children().front(), block_env());
+					if (!condition.get<bool>()) continue;
+				}
+				if (auto returned = eval_functional_block(clause.children().back(), block_env())) return leave(std::move(returned));
+				break;
+			}
+			break;
+		case astnode_enum::anon_variable_definition_assingment_:
+			if (!block_scope) block_scope.emplace(scope);
+			CVarDeclEval()(statement, block_scope->env());
+			break;
+		default:
+			throw std::runtime_error("CFunctionCallEval:Statement not supported in a function body:"
+				+ std::to_string(static_cast<int>(statement.type())));
+		}
+	}
+	return leave(sl::nullopt);
+}
+
+// <@method:is_pure_expression> True if evaluating the expression only reads the arguments of function: literals,
+// the argument names, arithmetic, comparisons and calls by name to pure functions. Any other name or operation
+// may read or write state outside the function.
+inline bool is_pure_expression(const astnode& expression, function_t& function, purity_analysis& analysis) {
+	const auto& args = function.args();
+	auto is_arg = [&args](const astnode& node) {
+		return std::find(args.begin(), args.end(), node.literal_str()) != args.end();
+	};
+	sl_vector<const astnode*> pending{ &expression };
+	while (!pending.empty()) {
+		const astnode& node = *pending.back();
+		pending.pop_back();
+		switch (node.type()) {
+		case astnode_enum::number_literal_:
+		case astnode_enum::real_literal_:
+		case astnode_enum::string_literal_:
+		case astnode_enum::bit_literal_:
+		case astnode_enum::unsigned_literal_:
+		case astnode_enum::byte_literal_:
+		case astnode_enum::none_literal_:
+			break;
+		case astnode_enum::alnumus_:
+			if (!is_arg(node)) return false;
+			break;
+		case astnode_enum::expression_:
+		case astnode_enum::arguments_:
+		case astnode_enum::addition_:
+		case astnode_enum::subtraction_:
+		case astnode_enum::multiplication_:
+		case astnode_enum::division_:
+		case astnode_enum::remainder_:
+		case astnode_enum::equal_:
+		case astnode_enum::not_equal_:
+		case astnode_enum::less_than_:
+		case astnode_enum::greater_than_:
+		case astnode_enum::less_than_or_equal_:
+		case astnode_enum::greater_than_or_equal_:
+			for (const auto& child : node.children()) pending.push_back(&child);
+			break;
+		case astnode_enum::function_call_: {
+			// The callee is resolved as the call resolves it, from the function scope, when the caller is first
+			// analysed. An argument may hold any function.
+			const astnode& callee = node.children().front();
+			if (callee.type() != astnode_enum::alnumus_ || is_arg(callee)) return false;
+			auto resolved = function.scope().resolve_variable(callee.literal_str());
+			if (!resolved.valid() || resolved.value().type != RTValue::FUNCTION) return false;
+			if (!resolved.value().function()->is_pure(analysis)) return false;
+			for (const auto& argument : call_arguments(node)) pending.push_back(&argument);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+// <@method:is_pure_body> True if evaluating the functional block only reads the arguments of function: return
+// statements and conditionals whose expressions are pure, see is_pure_expression.
+inline bool is_pure_body(const astnode& block, function_t& function, purity_analysis& analysis) {
+	if (block.type() != astnode_enum::functional_block_) return false;
+	for (const auto& statement : block.children()) {
+		switch (statement.type()) {
+		case astnode_enum::return_:
+			for (const auto& expression : statement.children())
+				if (!is_pure_expression(expression, function, analysis)) return false;
+			break;
+		case astnode_enum::conditional_statement_:
+			for (const auto& clause : statement.children()) {
+				if (clause.type() != astnode_enum::else_ && !is_pure_expression(clause.children().front(), function, analysis))
+					return false;
+				if (!is_pure_body(clause.children().back(), function, analysis)) return false;
+			}
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+inline bool function_t::is_pure(purity_analysis& analysis) {
+	if ((purity_ == e_purity::pure_ || purity_ == e_purity::impure_) && scope_.generation() != analysed_generation_) {
+		purity_ = e_purity::unknown_;
+		memo_.clear();
+	}
+	switch (purity_) {
+	case e_purity::pure_: return true;
+	case e_purity::impure_: return false;
+	case e_purity::analysing_:
+		analysis.lowest_assumed = std::min(analysis.lowest_assumed, analysis_depth_);
+		return true;
+	default: break;
+	}
+	const astnode& block = body();
+	purity_ = e_purity::analysing_;
+	analysis_depth_ = analysis.depth++;
+	const sl_size outer_assumed = std::exchange(analysis.lowest_assumed, sl_limits<sl_size>::max());
+	bool pure = false;
+	try {
+		pure = is_pure_body(block, *this, analysis);
+	}
+	catch (...) { // A callee body which fails to parse.
+		purity_ = e_purity::unknown_;
+		analysis.depth--;
+		throw;
+	}
+	analysis.depth--;
+	if (!pure) purity_ = e_purity::impure_;
+	else if (analysis.lowest_assumed < analysis_depth_) purity_ = e_purity::unknown_;
+	else purity_ = e_purity::pure_;
+	analysed_generation_ = scope_.generation();
+	analysis.lowest_assumed = std::min(outer_assumed, analysis.lowest_assumed);
+	return pure;
+}
+
+// Names read by an expression evaluated open_blocks envs below scope, see resolve_names.
+struct block_local {
+	sl_string name;
+	sl_uint32 level; // Of the block env which declared it, 0 for the outermost one.
+	sl_uint32 slot;
+};
+
+inline void resolve_name(const astnode& name, const rtenv& scope, sl_uint32 open_blocks, const sl_vector<block_local>& locals) {
+	name_slot& resolved = name.cache<name_slot>();
+	resolved.scope = nullptr;
+	const sl_string literal = name.literal_str();
+	for (auto it = locals.rbegin(); it != locals.rend(); ++it) {
+		if (it->name != literal) continue;
+		resolved.resolve(scope, open_blocks, rtslot{ open_blocks - 1 - it->level, it->slot });
+		return;
+	}
+	if (auto slot = scope.resolve_slot(literal))
+		resolved.resolve(scope, open_blocks, rtslot{ open_blocks + slot->depth, slot->slot });
+}
+
+inline void resolve_expression_names(const astnode& expression, const rtenv& scope, sl_uint32 open_blocks,
+	const sl_vector<block_local>& locals) {
+	sl_vector<const astnode*> pending{ &expression };
+	while (!pending.empty()) {
+		const astnode& node = *pending.back();
+		pending.pop_back();
+		if (node.type() == astnode_enum::alnumus_ && node.children().empty()) {
+			resolve_name(node, scope, open_blocks, locals);
+		}
+		else if (node.type() == astnode_enum::function_call_) {
+			const astnode& callee = node.children().front();
+			if (callee.type() == astnode_enum::alnumus_) resolve_name(callee, scope, open_blocks, locals);
+			for (const auto& argument : call_arguments(node)) pending.push_back(&argument);
+		}
+		else if (node.type() == astnode_enum::period_) {
+			// The member is looked up in the object, only the object and the arguments of a method are names.
+			pending.push_back(&node.children().front());
+			const astnode& member = node.children().back();
+			if (member.type() == astnode_enum::function_call_)
+				for (const auto& argument : call_arguments(member)) pending.push_back(&argument);
+		}
+		else {
+			for (const auto& child : node.children()) pending.push_back(&child);
+		}
+	}
+}
+
+inline void resolve_block_names(const astnode& block, const rtenv& scope, sl_uint32 open_blocks, sl_vector<block_local>& locals) {
+	const sl_size outer_locals = locals.size();
+	bool opened = false;
+	sl_uint32 next_slot = 0;
+	for (const auto& statement : block.children()) {
+		switch (statement.type()) {
+		case astnode_enum::return_:
+			if (!statement.children().empty())
+				resolve_expression_names(statement.children().back(), scope, open_blocks + opened, locals);
+			break;
+		case astnode_enum::conditional_statement_:
+			for (const auto& clause : statement.children()) {
+				if (clause.type() != astnode_enum::else_)
+					resolve_expression_names(clause.children().front(), scope, open_blocks + opened, locals);
+				resolve_block_names(clause.children().back(), scope, open_blocks + opened, locals);
+			}
+			break;
+		case astnode_enum::anon_variable_definition_assingment_:
+			opened = true;
+			resolve_expression_names(statement.children().back().children().back(), scope, open_blocks + 1, locals);
+			locals.push_back({ statement.children().front().literal_str(), open_blocks, next_slot++ });
+			break;
+		default: // The tree walker stops there.
+			locals.resize(outer_locals);
+			return;
+		}
+	}
+	locals.resize(outer_locals);
+}
+
+// <@method:resolve_names> Resolves the names read by a functional block run in scope, as eval_functional_block runs
+// it, so the evaluators read them with two array indexings instead of looking them up by name. Variables declared
+// in the block take the slots their block env gives them in declaration order. Names which don't resolve are
+// looked up by name when evaluated, as are all names once the generation of scope changed.
+inline void resolve_names(const astnode& block, const rtenv& scope) {
+	sl_vector<block_local> locals;
+	resolve_block_names(block, scope, 0, locals);
+}
+
+inline const astnode& function_t::resolved_body() {
+	const astnode& block = body();
+	if (resolved_generation_ != scope_.generation()) {
+		resolve_names(block, scope_);
+		resolved_generation_ = scope_.generation();
+	}
+	return block;
+}
+
+inline RTValue eval_function_body(function_t& function) {
+	auto returned = eval_functional_block(function.resolved_body(), function.scope());
+	return returned ? std::move(*returned) : make_rtval_none();
+}
+
 }; // namespace caoco
\ No newline at end of file
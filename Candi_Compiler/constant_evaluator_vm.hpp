@@ -0,0 +1,566 @@
+#pragma once
+#include "constant_evaluator.hpp"
+
+// Computed goto dispatch is a GCC and Clang extension, other compilers dispatch through a switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define CAOCO_VM_COMPUTED_GOTO 1
+#else
+#define CAOCO_VM_COMPUTED_GOTO 0
+#endif
+
+namespace caoco {
+
+enum class e_opcode : sl_uint8 {
+	push_const_ = 0, // Push constants[operand].
+	load_var_, // Push the variable names[operand], resolved by name in the current env.
+	load_slot_, // Push the variable in slot operand, count envs up from the current env.
+	add_, // Pop right and left, push left op right.
+	sub_,
+	mul_,
+	div_,
+	mod_,
+	binop_, // Pop right and left, push apply_binop(e_binop(operand), left, right).
+	call_, // Pop count arguments, call the function names[operand] and push its result.
+	call_slot_, // Pop count arguments and the function below them, call it and push its result. names[operand] is its name.
+	load_member_, // Pop an object, push its member members[operand].
+	call_member_, // Pop count arguments and the object below them, call its method members[operand] and push its result.
+	load_local_, // Push the local variable operand.
+	store_local_, // Pop a value into the local variable operand.
+	declare_, // Throw if names[operand] is declared in the current env or its parents, as a declaration does.
+	jump_, // Continue at instruction operand.
+	jump_if_false_, // Pop a condition, continue at instruction operand if it is 0b.
+	return_ // Pop the result and leave the chunk.
+};
+
+struct instruction {
+	e_opcode op;
+	sl_uint16 count{ 0 };
+	sl_uint32 operand{ 0 };
+};
+
+// A member access in a chunk, the inline cache is filled by the runs of the chunk.
+struct member_site {
+	sl_string name;
+	mutable member_cache cache;
+};
+
+/// <bytecode_chunk>
+/// A compiled expression or function body: stack machine code, the literal values it pushes and the names it resolves.
+/// Literals are evaluated once by the compiler instead of at every evaluation. The local variables of a body are
+/// the first values of its stack frame.
+/// </bytecode_chunk>
+struct bytecode_chunk {
+	sl_vector<instruction> code;
+	sl_vector<RTValue> constants;
+	sl_vector<sl_string> names;
+	sl_vector<member_site> members;
+	sl_size locals{ 0 };
+	sl_size max_stack{ 0 }; // Above the locals.
+	const rtenv* scope{ nullptr }; // The env slots were resolved against, the chunk may only run there.
+	sl_size generation{ 0 }; // Of the scope when compiled, the slots are stale once it changes.
+
+	// <@method:is_stale> True if a variable the chunk may have resolved to a slot was deleted or shadowed since it
+	// was compiled.
+	bool is_stale() const {
+		return scope != nullptr && scope->generation() != generation;
+	}
+};
+
+/// <bytecode_compiler>
+/// Compiles an expression accepted by CBinopEval or CFunctionCallEval into a bytecode_chunk.
+/// Operands are compiled in post order with a work stack, so the depth of the expression does not affect the call stack.
+/// A function call node holds the function name followed by the argument expressions, or by an arguments_ node
+/// listing them. Calls may be nested in expressions. Member accesses and method calls get a member_site each.
+/// Given a scope, names declared in it or in its parents are resolved to rtslots at compile time, other names
+/// are looked up by name when executed. A variable declared later in an env between the scope and the one a
+/// name was resolved to shadows it: the declaration changes the generation of the scope, the chunk is then stale.
+/// Function bodies compile return statements, conditionals and variable declarations, see compile_function_body.
+/// </bytecode_compiler>
+class bytecode_compiler {
+	bytecode_chunk chunk_;
+	const rtenv* scope_{ nullptr };
+	sl_size depth_{ 0 };
+	sl_vector<std::pair<sl_string, sl_uint32>> locals_; // Names of the locals in the enclosing blocks, innermost last.
+	rtenv literal_env_{ "literals" }; // Literal evaluators take an env but never read it.
+
+	sl_size emit(e_opcode op, sl_uint32 operand = 0, sl_uint16 count = 0) {
+		chunk_.code.push_back({ op, count, operand });
+		switch (op) {
+		case e_opcode::push_const_:
+		case e_opcode::load_var_:
+		case e_opcode::load_slot_:
+		case e_opcode::load_local_:
+			depth_++;
+			break;
+		case e_opcode::call_:
+			depth_ = depth_ - count + 1;
+			break;
+		case e_opcode::call_slot_:
+		case e_opcode::call_member_:
+			depth_ = depth_ - count;
+			break;
+		case e_opcode::load_member_:
+		case e_opcode::declare_:
+		case e_opcode::jump_:
+			break;
+		default: // binary operators, store_local_, jump_if_false_ and return_
+			depth_--;
+			break;
+		}
+		chunk_.max_stack = std::max(chunk_.max_stack, depth_);
+		return chunk_.code.size() - 1;
+	}
+
+	// <@method:patch_jump> Makes the jump at index continue at the next instruction emitted.
+	void patch_jump(sl_size index) {
+		chunk_.code[index].operand = static_cast<sl_uint32>(chunk_.code.size());
+	}
+
+	sl_uint32 add_name(const sl_string& name) {
+		auto found = std::find(chunk_.names.begin(), chunk_.names.end(), name);
+		if (found != chunk_.names.end()) return static_cast<sl_uint32>(found - chunk_.names.begin());
+		chunk_.names.push_back(name);
+		return static_cast<sl_uint32>(chunk_.names.size() - 1);
+	}
+
+	static e_opcode binary_opcode(astnode_enum type) {
+		switch (type) {
+		case astnode_enum::addition_: return e_opcode::add_;
+		case astnode_enum::subtraction_: return e_opcode::sub_;
+		case astnode_enum::multiplication_: return e_opcode::mul_;
+		case astnode_enum::division_: return e_opcode::div_;
+		case astnode_enum::remainder_: return e_opcode::mod_;
+		case astnode_enum::equal_:
+		case astnode_enum::not_equal_:
+		case astnode_enum::less_than_:
+		case astnode_enum::greater_than_:
+		case astnode_enum::less_than_or_equal_:
+		case astnode_enum::greater_than_or_equal_:
+			return e_opcode::binop_;
+		default:
+			throw std::runtime_error("bytecode_compiler:Operator not supported:" + std::to_string(static_cast<int>(type)));
+		}
+	}
+
+	sl_opt<sl_uint32> find_local(const sl_string& name) const {
+		for (auto it = locals_.rbegin(); it != locals_.rend(); ++it)
+			if (it->first == name) return it->second;
+		return sl::nullopt;
+	}
+
+	sl_opt<rtslot> resolve(const sl_string& name) const {
+		if (scope_ == nullptr) return sl::nullopt;
+		auto slot = scope_->resolve_slot(name);
+		if (slot && slot->depth > sl_limits<sl_uint16>::max()) return sl::nullopt;
+		return slot;
+	}
+
+	void compile_expression(const astnode& root) {
+		struct pending_node {
+			const astnode* node;
+			bool expanded;
+		};
+		sl_vector<pending_node> work{ { &root, false } };
+		while (!work.empty()) {
+			pending_node& top = work.back();
+			const astnode& current = *top.node;
+			if (current.type() == astnode_enum::expression_ && current.children().size() == 1) {
+				top.node = &current.children().front();
+			}
+			else if (current.type() == astnode_enum::function_call_) {
+				auto arguments = call_arguments(current);
+				const sl_string function_name = current.children().front().literal_str();
+				auto local = find_local(function_name);
+				auto slot = local ? sl::nullopt : resolve(function_name);
+				if (top.expanded) {
+					emit(local || slot ? e_opcode::call_slot_ : e_opcode::call_, add_name(function_name), static_cast<sl_uint16>(arguments.size()));
+					work.pop_back();
+					continue;
+				}
+				top.expanded = true;
+				if (local) emit(e_opcode::load_local_, *local);
+				else if (slot) emit(e_opcode::load_slot_, slot->slot, static_cast<sl_uint16>(slot->depth));
+				for (auto it = arguments.rbegin(); it != arguments.rend(); ++it)
+					work.push_back({ &*it, false });
+			}
+			else if (current.type() == astnode_enum::period_) {
+				const astnode& member = current.children().back();
+				const bool is_call = member.type() == astnode_enum::function_call_;
+				if (top.expanded) {
+					chunk_.members.push_back({ is_call ? member.children().front().literal_str() : member.literal_str(), {} });
+					const auto site = static_cast<sl_uint32>(chunk_.members.size() - 1);
+					if (is_call) emit(e_opcode::call_member_, site, static_cast<sl_uint16>(call_arguments(member).size()));
+					else emit(e_opcode::load_member_, site);
+					work.pop_back();
+					continue;
+				}
+				top.expanded = true;
+				// The object is compiled first, then the arguments of a method call.
+				if (is_call) {
+					auto arguments = call_arguments(member);
+					for (auto it = arguments.rbegin(); it != arguments.rend(); ++it)
+						work.push_back({ &*it, false });
+				}
+				work.push_back({ &current.children().front(), false });
+			}
+			else if (current.children().empty()) {
+				if (current.type() == astnode_enum::alnumus_) {
+					const sl_string name = current.literal_str();
+					if (auto local = find_local(name)) emit(e_opcode::load_local_, *local);
+					else if (auto slot = resolve(name)) emit(e_opcode::load_slot_, slot->slot, static_cast<sl_uint16>(slot->depth));
+					else emit(e_opcode::load_var_, add_name(name));
+				}
+				else {
+					chunk_.constants.push_back(CLiteralEval{}(current, literal_env_));
+					emit(e_opcode::push_const_, static_cast<sl_uint32>(chunk_.constants.size() - 1));
+				}
+				work.pop_back();
+			}
+			else if (top.expanded) {
+				const e_opcode op = binary_opcode(current.type());
+				emit(op, op == e_opcode::binop_ ? static_cast<sl_uint32>(binop_of(current.type())) : 0);
+				work.pop_back();
+			}
+			else {
+				top.expanded = true;
+				// The left operand is pushed last so it is compiled first.
+				work.push_back({ &current.children().back(), false });
+				work.push_back({ &current.children().front(), false });
+			}
+		}
+	}
+
+	// Compiles the statements of a functional block as eval_functional_block runs them. False on a statement it
+	// does not compile, or on a declaration which may fail: its name is visible from the scope or declared in an
+	// enclosing block. The tree walker then runs the body and reports the error as it happens.
+	bool compile_block(const astnode& block) {
+		if (block.type() != astnode_enum::functional_block_) return false;
+		const sl_size outer_locals = locals_.size();
+		for (const auto& statement : block.children()) {
+			switch (statement.type()) {
+			case astnode_enum::return_:
+				if (statement.children().empty()) {
+					chunk_.constants.push_back(make_rtval_none());
+					emit(e_opcode::push_const_, static_cast<sl_uint32>(chunk_.constants.size() - 1));
+				}
+				else {
+					compile_expression(statement.children().back());
+				}
+				emit(e_opcode::return_);
+				break;
+			case astnode_enum::conditional_statement_: {
+				// Each clause but the else jumps past the next ones once its block ran.
+				sl_vector<sl_size> exits;
+				for (const auto& clause : statement.children()) {
+					if (clause.type() == astnode_enum::else_) {
+						if (!compile_block(clause.children().back())) return false;
+						break;
+					}
+					compile_expression(clause.children().front());
+					const sl_size next_clause = emit(e_opcode::jump_if_false_);
+					if (!compile_block(clause.children().back())) return false;
+					exits.push_back(emit(e_opcode::jump_));
+					patch_jump(next_clause);
+				}
+				for (sl_size exit : exits) patch_jump(exit);
+				break;
+			}
+			case astnode_enum::anon_variable_definition_assingment_: {
+				const sl_string name = statement.children().front().literal_str();
+				if (find_local(name) || scope_ == nullptr || scope_->resolve_variable(name).valid()) return false;
+				// Checked again when run, the name may have been declared in the scope since.
+				emit(e_opcode::declare_, add_name(name));
+				compile_expression(statement.children().back().children().back());
+				const auto local = static_cast<sl_uint32>(chunk_.locals++);
+				emit(e_opcode::store_local_, local);
+				locals_.emplace_back(name, local);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		locals_.resize(outer_locals);
+		return true;
+	}
+public:
+	// <@method:compile> Compiles an expression, throws std::runtime_error on nodes the evaluator does not support.
+	// Without a scope every name is looked up when executed and the chunk may run in any env.
+	static bytecode_chunk compile(const astnode& expression, const rtenv* scope = nullptr) {
+		bytecode_compiler compiler;
+		compiler.scope_ = scope;
+		compiler.chunk_.scope = scope;
+		if (scope != nullptr) compiler.chunk_.generation = scope->generation();
+		compiler.compile_expression(expression);
+		compiler.emit(e_opcode::return_);
+		return std::move(compiler.chunk_);
+	}
+
+	// <@method:compile_function_body> Compiles a functional block run in scope, the body of a function. Local
+	// variables live in the stack frame of the chunk, a block which ends without a return returns none.
+	// None if the body has statements the compiler does not support, see compile_block. Throws std::runtime_error
+	// on expressions the evaluator does not support.
+	static sl_opt<bytecode_chunk> compile_function_body(const astnode& block, const rtenv& scope) {
+		bytecode_compiler compiler;
+		compiler.scope_ = &scope;
+		compiler.chunk_.scope = &scope;
+		compiler.chunk_.generation = scope.generation();
+		if (!compiler.compile_block(block)) return sl::nullopt;
+		compiler.chunk_.constants.push_back(make_rtval_none());
+		compiler.emit(e_opcode::push_const_, static_cast<sl_uint32>(compiler.chunk_.constants.size() - 1));
+		compiler.emit(e_opcode::return_);
+		return std::move(compiler.chunk_);
+	}
+};
+
+/// <bytecode_vm>
+/// Stack machine executing bytecode_chunks against an rtenv. Results and errors match the tree walking evaluators.
+/// Function bodies are compiled against the function scope on their first call and kept in the function_t. A body
+/// the compiler does not support is kept as a chunk without code and runs in the tree walker, until the scope changes.
+/// Calls bind their arguments through a call_frame over the VM stack, so recursive calls nest as in CFunctionCallEval.
+/// </bytecode_vm>
+class bytecode_vm {
+	sl_vector<RTValue> stack_;
+
+	// <@method:function_body> The compiled body of a function, nullptr if it runs in the tree walker.
+	// A body compiled before a deletion or a shadowing declaration in the function scope or its parents is compiled again.
+	static const bytecode_chunk* function_body(function_t& function) {
+		if (!function.compiled_body() || function.compiled_body()->is_stale()) {
+			auto compiled = bytecode_compiler::compile_function_body(function.body(), function.scope());
+			if (!compiled) {
+				compiled.emplace();
+				compiled->scope = &function.scope();
+				compiled->generation = function.scope().generation();
+			}
+			function.set_compiled_body(std::make_shared<const bytecode_chunk>(std::move(*compiled)));
+		}
+		const bytecode_chunk* body = function.compiled_body().get();
+		return body->code.empty() ? nullptr : body;
+	}
+
+	template<class OpT>
+	void binary(OpT&& op) {
+		RTValue right = std::move(stack_.back());
+		stack_.pop_back();
+		stack_.back() = op(stack_.back(), right);
+	}
+
+	// Binds the top argc values to the arguments of function, runs its body and replaces the arguments by the result.
+	// Calls to a pure function share its call_memo with CFunctionCallEval.
+	void call(function_t& function, sl_size argc) {
+		RTValue result;
+		{
+			call_frame frame(function, stack_, stack_.size() - argc);
+			const bool pure = function.memoised();
+			sl_size args_hash = 0;
+			const RTValue* cached = nullptr;
+			if (pure) {
+				args_hash = call_memo::hash_args(frame.args());
+				cached = function.memo().find(frame.args(), args_hash);
+			}
+			if (cached) {
+				result = *cached;
+			}
+			else {
+				frame.enter();
+				const bytecode_chunk* body = function_body(function);
+				result = body ? execute(*body, function.scope()) : eval_function_body(function);
+				frame.leave();
+				if (pure) function.memo().insert(frame.args(), args_hash, result);
+			}
+		} // The frame pops the arguments.
+		stack_.push_back(std::move(result));
+	}
+
+	// Handlers with locals which have destructors live out of line: a computed goto leaving a block does not run the
+	// destructors of its locals, an rtref held there would never be released.
+
+	// <@method:load_var> Pushes the variable named name, resolved in env.
+	void load_var(const sl_string& name, rtenv& env) {
+		auto resolved_var = env.resolve_variable(name);
+		if (!resolved_var.valid())
+			throw std::runtime_error("CVariableEval:Variable not found:" + name);
+		stack_.push_back(resolved_var.value());
+	}
+
+	// <@method:call_named> Calls the function named function_name with the top argc values.
+	void call_named(const sl_string& function_name, sl_size argc, rtenv& env) {
+		auto resolved_function = env.resolve_variable(function_name);
+		if (!resolved_function.valid())
+			throw std::runtime_error("CFunctionCallEval:Function not found:" + function_name);
+		// Held by value, the call may change the env which owns the function.
+		auto function = resolved_function.value().function();
+		call(*function, argc);
+	}
+
+	// <@method:call_below> Calls the function below the top argc values with them, the result replaces the function.
+	void call_below(sl_size argc) {
+		const sl_size callee = stack_.size() - argc - 1;
+		auto function = stack_[callee].function();
+		call(*function, argc);
+		// Move the result over the callee.
+		stack_[callee] = std::move(stack_.back());
+		stack_.pop_back();
+	}
+
+	// <@method:load_member> Replaces the object on top by its member at site.
+	void load_member(const member_site& site) {
+		// Held by value, the object owns the scope the member lives in.
+		auto object = stack_.back().object();
+		stack_.back() = object->member(resolve_member(*object, site.cache, [&site] { return site.name; }));
+	}
+
+	// <@method:load_local> Pushes the local variable at index of the frame at base.
+	void load_local(sl_size base, sl_size index) {
+		RTValue value = stack_[base + index];
+		stack_.push_back(std::move(value));
+	}
+
+	// <@method:declare> Throws if name is visible from env, as CVarDeclEval does.
+	static void declare(const sl_string& name, rtenv& env) {
+		if (env.resolve_variable(name).valid())
+			throw std::runtime_error("CAssignOpEval:Variable already declared:" + name);
+	}
+
+	// <@method:call_member> Calls the method at site of the object below the top argc values, the result replaces it.
+	void call_member(const member_site& site, sl_size argc) {
+		const sl_size receiver = stack_.size() - argc - 1;
+		auto object = stack_[receiver].object();
+		auto method = object->member(resolve_member(*object, site.cache, [&site] { return site.name; })).function();
+		call(*method, argc);
+		// Move the result over the object.
+		stack_[receiver] = std::move(stack_.back());
+		stack_.pop_back();
+	}
+
+	RTValue execute(const bytecode_chunk& chunk, rtenv& env) {
+		const sl_size base = stack_.size();
+		stack_.reserve(base + chunk.locals + chunk.max_stack);
+		stack_.resize(base + chunk.locals);
+		const instruction* ip = chunk.code.data();
+
+#if CAOCO_VM_COMPUTED_GOTO
+		static void* const dispatch_table[] = {
+			&&op_push_const_, &&op_load_var_, &&op_load_slot_, &&op_add_, &&op_sub_, &&op_mul_, &&op_div_, &&op_mod_,
+			&&op_binop_, &&op_call_, &&op_call_slot_, &&op_load_member_, &&op_call_member_, &&op_load_local_,
+			&&op_store_local_, &&op_declare_, &&op_jump_, &&op_jump_if_false_, &&op_return_
+		};
+#define CAOCO_VM_OP(name) op_##name:
+#define CAOCO_VM_NEXT() goto *dispatch_table[static_cast<sl_size>((++ip)->op)]
+#define CAOCO_VM_JUMP(target) ip = chunk.code.data() + (target); goto *dispatch_table[static_cast<sl_size>(ip->op)]
+		goto *dispatch_table[static_cast<sl_size>(ip->op)];
+#else
+#define CAOCO_VM_OP(name) case e_opcode::name:
+#define CAOCO_VM_NEXT() ++ip; continue
+#define CAOCO_VM_JUMP(target) ip = chunk.code.data() + (target); continue
+		while (true) {
+			switch (ip->op) {
+#endif
+		CAOCO_VM_OP(push_const_) {
+			stack_.push_back(chunk.constants[ip->operand]);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(load_var_) {
+			load_var(chunk.names[ip->operand], env);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(load_slot_) {
+			stack_.push_back(env.at(rtslot{ ip->count, ip->operand }));
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(add_) {
+			binary(add_rtvalues);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(sub_) {
+			binary(subtract_rtvalues);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(mul_) {
+			binary(multiply_rtvalues);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(div_) {
+			binary(divide_rtvalues);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(mod_) {
+			binary(modulo_rtvalues);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(binop_) {
+			const e_binop op = static_cast<e_binop>(ip->operand);
+			binary([op](const RTValue& left, const RTValue& right) { return apply_binop(op, left, right); });
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(call_) {
+			call_named(chunk.names[ip->operand], ip->count, env);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(call_slot_) {
+			call_below(ip->count);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(load_member_) {
+			load_member(chunk.members[ip->operand]);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(call_member_) {
+			call_member(chunk.members[ip->operand], ip->count);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(load_local_) {
+			load_local(base, ip->operand);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(store_local_) {
+			stack_[base + ip->operand] = std::move(stack_.back());
+			stack_.pop_back();
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(declare_) {
+			declare(chunk.names[ip->operand], env);
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(jump_) {
+			CAOCO_VM_JUMP(ip->operand);
+		}
+		CAOCO_VM_OP(jump_if_false_) {
+			const bool condition = stack_.back().get<bool>();
+			stack_.pop_back();
+			if (!condition) {
+				CAOCO_VM_JUMP(ip->operand);
+			}
+			CAOCO_VM_NEXT();
+		}
+		CAOCO_VM_OP(return_) {
+			RTValue result = std::move(stack_.back());
+			stack_.resize(base);
+			return result;
+		}
+#if !CAOCO_VM_COMPUTED_GOTO
+			}
+		}
+#endif
+#undef CAOCO_VM_OP
+#undef CAOCO_VM_NEXT
+#undef CAOCO_VM_JUMP
+	}
+public:
+	// <@method:run> Evaluates a compiled expression in env.
+	RTValue run(const bytecode_chunk& chunk, rtenv& env) {
+		if (chunk.scope != nullptr && chunk.scope != &env)
+			throw std::runtime_error("bytecode_vm:Chunk was compiled for another environment.");
+		if (chunk.is_stale())
+			throw std::runtime_error("bytecode_vm:A variable the chunk resolved was deleted or shadowed, compile it again.");
+		stack_.clear(); // Values left behind by a run which threw.
+		return execute(chunk, env);
+	}
+
+	// <@method:run> Compiles and evaluates an expression in env.
+	RTValue run(const astnode& expression, rtenv& env) {
+		return run(bytecode_compiler::compile(expression, &env), env);
+	}
+};
+
+}; // namespace caoco
@@ -0,0 +1,186 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include "constant_evaluator.hpp"
+
+// Constant folding runs after parsing in release builds, define CAOCO_CONSTANT_FOLDING to 0 or 1 to override.
+#ifndef CAOCO_CONSTANT_FOLDING
+#ifdef NDEBUG
+#define CAOCO_CONSTANT_FOLDING 1
+#else
+#define CAOCO_CONSTANT_FOLDING 0
+#endif
+#endif
+
+namespace caoco {
+
+// What folding did to the tree of one file.
+struct fold_report {
+	sl_string file;
+	sl_size folded_operations{ 0 };
+	sl_size eliminated_nodes{ 0 };
+
+	sl_string to_string() const {
+		return file + ": folded " + std::to_string(folded_operations) + " operations, eliminated "
+			+ std::to_string(eliminated_nodes) + " nodes";
+	}
+};
+
+/// <constant_folder>
+/// Replaces binary operations whose operands are literals by the literal of their value, bottom up, so
+/// 1 + 2 * 3 becomes 7 and 'a' + 'b' becomes 'ab'. Values are computed by apply_binop, the folded tree
+/// evaluates to exactly what the original did. Operations which fail, a type mismatch or a division by zero,
+/// are left in the tree to fail at evaluation. The tree is walked with a work stack, so any depth is folded.
+/// </constant_folder>
+class constant_folder {
+	static bool is_constant(const astnode& node) {
+		switch (node.type()) {
+		case astnode_enum::number_literal_:
+		case astnode_enum::real_literal_:
+		case astnode_enum::string_literal_:
+		case astnode_enum::bit_literal_:
+		case astnode_enum::unsigned_literal_:
+		case astnode_enum::byte_literal_:
+		case astnode_enum::none_literal_:
+			return node.children().empty();
+		default:
+			return false;
+		}
+	}
+
+	static bool is_foldable_operation(const astnode& node) {
+		switch (node.type()) {
+		case astnode_enum::addition_:
+		case astnode_enum::subtraction_:
+		case astnode_enum::multiplication_:
+		case astnode_enum::division_:
+		case astnode_enum::remainder_:
+		case astnode_enum::equal_:
+		case astnode_enum::not_equal_:
+		case astnode_enum::less_than_:
+		case astnode_enum::greater_than_:
+		case astnode_enum::less_than_or_equal_:
+		case astnode_enum::greater_than_or_equal_:
+			return node.children().size() == 2;
+		default:
+			return false;
+		}
+	}
+
+	static sl_u8string to_u8(const sl_string& text) {
+		return sl_u8string(text.begin(), text.end());
+	}
+
+	// <@method:literal_of> A literal node which evaluates to value, none if the value has no literal form.
+	static sl_opt<astnode> literal_of(const RTValue& value) {
+		switch (value.type) {
+		case RTValue::NUMBER:
+			return astnode(astnode_enum::number_literal_, to_u8(std::to_string(value.get<int>())));
+		case RTValue::REAL: {
+			const double real = value.get<double>();
+			if (!std::isfinite(real)) return sl::nullopt;
+			// The shortest form which reads back as the same double.
+			char text[32];
+			auto written = std::to_chars(text, text + sizeof(text), real);
+			return astnode(astnode_enum::real_literal_, to_u8(sl_string(text, written.ptr)));
+		}
+		case RTValue::STRING: {
+			sl_string literal = "'";
+			for (char c : value.string()) {
+				switch (c) {
+				case '\0': return sl::nullopt; // CStringEval can't read back an escaped null.
+				case '\n': literal += "\\n"; break;
+				case '\t': literal += "\\t"; break;
+				case '\r': literal += "\\r"; break;
+				case '\\': literal += "\\\\"; break;
+				case '\'': literal += "\\'"; break;
+				default: literal += c;
+				}
+			}
+			literal += "'";
+			return astnode(astnode_enum::string_literal_, to_u8(literal));
+		}
+		case RTValue::BIT:
+			return astnode(astnode_enum::bit_literal_, value.get<bool>() ? u8"1b" : u8"0b");
+		case RTValue::BYTE:
+			return astnode(astnode_enum::byte_literal_, to_u8(std::to_string(value.get<unsigned char>()) + "c"));
+		case RTValue::UNSIGNED:
+			return astnode(astnode_enum::unsigned_literal_, to_u8(std::to_string(value.get<unsigned>()) + "u"));
+		case RTValue::NONE:
+			return astnode(astnode_enum::none_literal_, u8"#none");
+		default:
+			return sl::nullopt;
+		}
+	}
+
+	// <@method:fold_operation> Value of an operation on two literals, none if evaluating it fails.
+	static sl_opt<RTValue> fold_operation(const astnode& operation) {
+		rtenv no_variables;
+		try {
+			return apply_binop(operation.type(),
+				CLiteralEval{}(operation.children().front(), no_variables),
+				CLiteralEval{}(operation.children().back(), no_variables));
+		}
+		catch (const std::exception&) {
+			return sl::nullopt;
+		}
+	}
+public:
+	// <@method:fold> Folds the constant operations of the tree rooted at root in place.
+	static fold_report fold(astnode& root, sl_string_view file = {}) {
+		fold_report report{ sl_string(file) };
+		struct pending_node {
+			astnode* node;
+			bool expanded;
+		};
+		sl_vector<pending_node> work{ { &root, false } };
+		while (!work.empty()) {
+			pending_node& top = work.back();
+			astnode& current = *top.node;
+			if (!top.expanded) {
+				top.expanded = true;
+				for (auto& child : current.children_unsafe()) work.push_back({ &child, false });
+				continue;
+			}
+			work.pop_back();
+			// Children are folded first, so an operation over folded operations is folded too.
+			if (!is_foldable_operation(current) || !is_constant(current.children().front())
+				|| !is_constant(current.children().back()))
+				continue;
+			auto value = fold_operation(current);
+			if (!value) continue;
+			auto literal = literal_of(*value);
+			if (!literal) continue;
+			current = std::move(*literal);
+			report.folded_operations++;
+			report.eliminated_nodes += 2;
+		}
+		return report;
+	}
+};
+
+// <@method:optimize_program> Runs the AST optimisation passes on the tree of a parsed file, call it while the
+// tokens of the file are alive. Constant folding runs if CAOCO_CONSTANT_FOLDING is on.
+inline fold_report optimize_program([[maybe_unused]] astnode& program, sl_string_view file) {
+#if CAOCO_CONSTANT_FOLDING
+	return constant_folder::fold(program, file);
+#else
+	return fold_report{ sl_string(file) };
+#endif
+}
+
+// A file through the front end: its tree and what the optimisation passes did to it.
+struct parsed_program {
+	astnode tree;
+	fold_report folding;
+};
+
+// <@method:load_program> The front end of a file: parse_program, then optimize_program on the tree.
+// Throws as parse_program does. The tokens must outlive the tree.
+inline parsed_program load_program(tk_vector_cit begin, tk_vector_cit end, sl_string_view file, sl_size enter_thread_count = 1) {
+	parsed_program program{ parse_program(begin, end, enter_thread_count), fold_report{ sl_string(file) } };
+	program.folding = optimize_program(program.tree, file);
+	return program;
+}
+
+}; // namespace caoco
@@ -5,103 +5,286 @@
 	#define LAMBDA_STRING(str) []() consteval { return #str; }
 	#define LAMBDA_U8STRING(str) []() consteval { return u8#str; }
 
+	// Diagnostic
+	// Error record which is formatted into text only when the error is reported.
+	// Holds a code, a location and up to 4 argument slots, their meaning is up to the formatter which made the record.
+	// The detail must be a string which outlives the record, ex. a literal. Making one never allocates.
+	struct sl_diagnostic {
+		using formatter = sl_string(*)(const sl_diagnostic&);
+		formatter format_with{ nullptr };
+		sl_uint32 code{ 0 };
+		const void* location{ nullptr };
+		sl_size args[4]{};
+		const char* detail{ "" };
+
+		SL_CX bool empty() const { return format_with == nullptr; }
+		sl_string format() const { return format_with ? format_with(*this) : sl_string(); }
+	};
+	static_assert(std::is_trivially_copyable_v<sl_diagnostic>, "sl_diagnostic must stay a plain record.");
+
+	// Error
+	// Error handle of the result types: a diagnostic, plus a message only for errors built from other messages.
+	// Move-only, copy() duplicates the message explicitly.
+	class sl_error {
+		sl_diagnostic diagnostic_{};
+		sl_string* message_{ nullptr };
+
+		SL_CX void release() { delete message_; message_ = nullptr; }
+	public:
+		SL_CX sl_error() = default;
+		SL_CX sl_error(const sl_diagnostic& diagnostic) : diagnostic_(diagnostic) {}
+		SL_CX sl_error(sl_string message) : message_(message.empty() ? nullptr : new sl_string(std::move(message))) {}
+		SL_CX sl_error(const sl_diagnostic& diagnostic, sl_string message) : sl_error(std::move(message)) { diagnostic_ = diagnostic; }
+		SL_CX sl_error(sl_error&& other) noexcept : diagnostic_(other.diagnostic_), message_(std::exchange(other.message_, nullptr)) {}
+		SL_CX sl_error& operator=(sl_error&& other) noexcept {
+			if (this != &other) {
+				release();
+				diagnostic_ = other.diagnostic_;
+				message_ = std::exchange(other.message_, nullptr);
+			}
+			return *this;
+		}
+		sl_error(const sl_error&) = delete;
+		sl_error& operator=(const sl_error&) = delete;
+		SL_CX ~sl_error() { release(); }
+
+		SL_CX sl_error copy() const {
+			return message_ ? sl_error(diagnostic_, *message_) : sl_error(diagnostic_);
+		}
+
+		SL_CX const sl_diagnostic& diagnostic() const { return diagnostic_; }
+
+		// <@method:message> Formats the error.
+		sl_string message() const {
+			if (diagnostic_.empty()) return message_ ? *message_ : sl_string();
+			return message_ ? diagnostic_.format() + *message_ : diagnostic_.format();
+		}
+	};
+
+	// Value Or Error
+	// Storage of the result types, holds either the value or the error handle, never both.
+	// A result whose value was extracted holds an empty error.
+	template <typename ValueT>
+	class sl_value_or_error {
+		union {
+			ValueT value_;
+			sl_error error_;
+		};
+		bool valid_;
+
+		SL_CX void destroy() {
+			if (valid_) std::destroy_at(&value_);
+			else std::destroy_at(&error_);
+		}
+	public:
+		SL_CX explicit sl_value_or_error(ValueT&& value) : value_(std::move(value)), valid_(true) {}
+		SL_CX explicit sl_value_or_error(sl_error&& error) : error_(std::move(error)), valid_(false) {}
+		SL_CX sl_value_or_error(sl_value_or_error&& other) noexcept(std::is_nothrow_move_constructible_v<ValueT>) : valid_(other.valid_) {
+			if (valid_) std::construct_at(&value_, std::move(other.value_));
+			else std::construct_at(&error_, std::move(other.error_));
+		}
+		SL_CX sl_value_or_error& operator=(sl_value_or_error&& other) noexcept(std::is_nothrow_move_constructible_v<ValueT>) {
+			if (this != &other) {
+				destroy();
+				valid_ = other.valid_;
+				if (valid_) std::construct_at(&value_, std::move(other.value_));
+				else std::construct_at(&error_, std::move(other.error_));
+			}
+			return *this;
+		}
+		sl_value_or_error(const sl_value_or_error&) = delete;
+		sl_value_or_error& operator=(const sl_value_or_error&) = delete;
+		SL_CX ~sl_value_or_error() { destroy(); }
+
+		SL_CX bool valid() const { return valid_; }
+		SL_CX ValueT& value() { assert(valid_); return value_; }
+		SL_CX const ValueT& value() const { assert(valid_); return value_; }
+		SL_CX sl_error& error() { assert(!valid_); return error_; }
+		SL_CX const sl_error& error() const { assert(!valid_); return error_; }
+
+		// <@method:take> Moves the value out, leaving an empty error behind.
+		SL_CX ValueT take() {
+			assert(valid_);
+			ValueT value = std::move(value_);
+			std::destroy_at(&value_);
+			std::construct_at(&error_);
+			valid_ = false;
+			return value;
+		}
+
+		SL_CX sl_value_or_error copy() const {
+			return valid_ ? sl_value_or_error(ValueT(value_)) : sl_value_or_error(error_.copy());
+		}
+	};
+
 	// Partial Expected
+	// Result which always carries a position, ex. where parsing stopped, and either a value or an error.
+	// Move-only: extract() or and_then/transform consume the value, copy() is explicit.
 	template <typename ExpectedT, typename AlwaysT>
 	class sl_partial_expected {
 		AlwaysT always_;
-		sl_opt<ExpectedT> expected_{ sl::nullopt };
-		sl_string error_message_{ "" };
-
-		template <typename ExpectedT, typename AlwaysT>
-		constexpr sl_partial_expected(AlwaysT always, ExpectedT expected) : always_(always), expected_(expected) {}
-
-		template <typename AlwaysT>
-		constexpr sl_partial_expected(AlwaysT always) : always_(always) {}
+		sl_value_or_error<ExpectedT> result_;
 
+		SL_CX sl_partial_expected(AlwaysT always, sl_value_or_error<ExpectedT>&& result) : always_(always), result_(std::move(result)) {}
 	public:
+		using value_type = ExpectedT;
+		using always_type = AlwaysT;
 
 		SL_CXS auto make_success(AlwaysT always, ExpectedT expected) {
-			return sl_partial_expected(always, expected);
+			return sl_partial_expected(always, sl_value_or_error<ExpectedT>(std::move(expected)));
+		}
+
+		SL_CXS auto make_failure(AlwaysT always, sl_error&& error) {
+			return sl_partial_expected(always, sl_value_or_error<ExpectedT>(std::move(error)));
 		}
 
 		SL_CXS auto make_failure(AlwaysT always, const sl_string& error_message) {
-			auto ret = sl_partial_expected(always);
-			ret.error_message_ = error_message;
-			return ret;
+			return make_failure(always, sl_error(error_message));
+		}
+
+		SL_CXS auto make_failure(AlwaysT always, const sl_diagnostic& diagnostic) {
+			return make_failure(always, sl_error(diagnostic));
+		}
+
+		SL_CXS auto make_failure_chain(const sl_partial_expected& other, AlwaysT always, const sl_string& error_message) {
+			return make_failure(other.always(), other.error_message() + error_message);
 		}
 
-		SL_CXS auto make_failure_chain(sl_partial_expected other, AlwaysT always, const sl_string& error_message) {
-			auto ret = sl_partial_expected(other.always());
-			ret.error_message_ = other.error_message_ + error_message;
-			return ret;
+		SL_CXS auto make_failure_chain(const sl_partial_expected& other, AlwaysT always, const sl_diagnostic& diagnostic) {
+			return make_failure_chain(other, always, diagnostic.format());
 		}
 
+		SL_CX bool valid() const {
+			return result_.valid();
+		}
 
-		constexpr bool valid() const {
-			return expected_.has_value();
+		SL_CX const auto& expected() const {
+			return result_.value();
 		}
 
-		constexpr const auto& expected() const {
-			return expected_.value();
+		// <@method:extract> Moves the expected value out of the result, it may only be consumed once.
+		SL_CX ExpectedT extract() {
+			return result_.take();
 		}
 
-		constexpr const auto& always()  const {
+		SL_CX const auto& always() const {
 			return always_;
 		}
 
-		constexpr const auto& error_message() const {
-			return error_message_;
+		// <@method:error_message> Formats the error, empty on success.
+		sl_string error_message() const {
+			return result_.valid() ? sl_string() : result_.error().message();
 		}
 
-		constexpr auto chain_failure(AlwaysT always, sl_string error_message) {
+		SL_CX sl_diagnostic diagnostic() const {
+			return result_.valid() ? sl_diagnostic{} : result_.error().diagnostic();
+		}
+
+		// <@method:error> The error of a failure.
+		SL_CX const sl_error& error() const {
+			return result_.error();
+		}
+
+		SL_CX auto chain_failure(AlwaysT always, sl_string error_message) const {
 			return sl_partial_expected::make_failure_chain(*this, always, error_message);
 		}
+
+		SL_CX auto chain_failure(AlwaysT always, const sl_diagnostic& diagnostic) const {
+			return sl_partial_expected::make_failure_chain(*this, always, diagnostic);
+		}
+
+		// <@method:and_then> On success returns f(always, value), which must return an sl_partial_expected
+		// with the same AlwaysT. A failure is passed on as is.
+		template <typename FnT>
+		SL_CX auto and_then(FnT&& f) && {
+			using result_t = std::invoke_result_t<FnT, AlwaysT, ExpectedT&&>;
+			if (!result_.valid()) return result_t::make_failure(always_, std::move(result_.error()));
+			return std::invoke(std::forward<FnT>(f), always_, result_.take());
+		}
+
+		// <@method:transform> On success replaces the value by f(value), keeping always.
+		template <typename FnT>
+		SL_CX auto transform(FnT&& f) && {
+			using result_t = sl_partial_expected<std::invoke_result_t<FnT, ExpectedT&&>, AlwaysT>;
+			if (!result_.valid()) return result_t::make_failure(always_, std::move(result_.error()));
+			return result_t::make_success(always_, std::invoke(std::forward<FnT>(f), result_.take()));
+		}
+
+		SL_CX sl_partial_expected copy() const {
+			return sl_partial_expected(always_, result_.copy());
+		}
 	};
 
 	// Expected
+	// Move-only value or error, see sl_partial_expected.
 	template <typename ExpectedT>
 	class sl_expected {
-		sl_opt<ExpectedT> expected_{ sl::nullopt };
-		sl_string error_message_{ "" };
-
-		constexpr sl_expected(ExpectedT expected) : expected_(expected) {}
-		template <typename ExpectedT>
-		constexpr sl_expected(ExpectedT&& expected) : expected_(expected) {}
-		template <typename ExpectedT>
-		constexpr sl_expected(const ExpectedT& expected) : expected_(expected) {}
-
-		constexpr sl_expected(const sl_nullopt& none,sl_string error_message) : expected_(sl::nullopt) , error_message_(error_message) {}
+		sl_value_or_error<ExpectedT> result_;
 
-		public:
+		SL_CX explicit sl_expected(sl_value_or_error<ExpectedT>&& result) : result_(std::move(result)) {}
+	public:
+		using value_type = ExpectedT;
 
 		SL_CX bool valid() const {
-			return expected_.has_value();
+			return result_.valid();
 		}
 
+		// <@method:extract> Moves the expected value out of the result, it may only be consumed once.
 		SL_CX ExpectedT extract() {
-			ExpectedT val = std::move(expected_.value());
-			expected_.reset();
-			return val;
+			return result_.take();
 		}
 
-		SL_CX auto & expected() {
-			return expected_.value();
+		SL_CX auto& expected() {
+			return result_.value();
 		}
 
 		SL_CX const auto& expected() const {
-			return expected_.value();
+			return result_.value();
 		}
 
-		SL_CX const auto & error_message() const {
-			return error_message_;
+		// <@method:error_message> Formats the error, empty on success.
+		sl_string error_message() const {
+			return result_.valid() ? sl_string() : result_.error().message();
+		}
+
+		SL_CX sl_diagnostic diagnostic() const {
+			return result_.valid() ? sl_diagnostic{} : result_.error().diagnostic();
 		}
 
 		SL_CXSA make_success(ExpectedT expected) {
-			return sl_expected(expected);
+			return sl_expected(sl_value_or_error<ExpectedT>(std::move(expected)));
+		}
+
+		SL_CXSA make_failure(sl_error&& error) {
+			return sl_expected(sl_value_or_error<ExpectedT>(std::move(error)));
 		}
 
 		SL_CXSA make_failure(sl_string error_message) {
-			return sl_expected(sl::nullopt, error_message);
+			return make_failure(sl_error(std::move(error_message)));
+		}
+
+		SL_CXSA make_failure(const sl_diagnostic& diagnostic) {
+			return make_failure(sl_error(diagnostic));
+		}
+
+		// <@method:and_then> On success returns f(value), which must return an sl_expected. A failure is passed on as is.
+		template <typename FnT>
+		SL_CX auto and_then(FnT&& f) && {
+			using result_t = std::invoke_result_t<FnT, ExpectedT&&>;
+			if (!result_.valid()) return result_t::make_failure(std::move(result_.error()));
+			return std::invoke(std::forward<FnT>(f), result_.take());
+		}
+
+		// <@method:transform> On success replaces the value by f(value).
+		template <typename FnT>
+		SL_CX auto transform(FnT&& f) && {
+			using result_t = sl_expected<std::invoke_result_t<FnT, ExpectedT&&>>;
+			if (!result_.valid()) return result_t::make_failure(std::move(result_.error()));
+			return result_t::make_success(std::invoke(std::forward<FnT>(f), result_.take()));
+		}
+
+		SL_CX sl_expected copy() const {
+			return sl_expected(result_.copy());
 		}
 	};
 
@@ -123,6 +306,97 @@
 		}
 	};
 
+	// Tree Traversal
+	// Non-recursive walks over a tree whose nodes expose a random access children() container.
+	// The walk keeps its own heap allocated stack so the depth of the tree does not affect the call stack.
+	template <typename NodeT>
+	class sl_preorder_view {
+		const NodeT* root_;
+	public:
+		class iterator {
+			sl_vector<const NodeT*> stack_;
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = NodeT;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const NodeT*;
+			using reference = const NodeT&;
+
+			iterator() = default;
+			explicit iterator(const NodeT* root) { if (root != nullptr) stack_.push_back(root); }
+
+			reference operator*() const { return *stack_.back(); }
+			pointer operator->() const { return stack_.back(); }
+			iterator& operator++() {
+				const NodeT* node = stack_.back();
+				stack_.pop_back();
+				const auto& children = node->children();
+				for (auto it = children.rbegin(); it != children.rend(); ++it)
+					stack_.push_back(&*it);
+				return *this;
+			}
+			iterator operator++(int) { iterator prev = *this; ++(*this); return prev; }
+			bool operator==(const iterator& other) const {
+				return stack_.empty() ? other.stack_.empty() : (!other.stack_.empty() && stack_.back() == other.stack_.back());
+			}
+		};
+
+		explicit sl_preorder_view(const NodeT& root) : root_(&root) {}
+		iterator begin() const { return iterator(root_); }
+		iterator end() const { return iterator(); }
+	};
+
+	template <typename NodeT>
+	class sl_postorder_view {
+		const NodeT* root_;
+	public:
+		class iterator {
+			// Each entry is a node and the index of the next child to visit.
+			sl_vector<std::pair<const NodeT*, sl_size>> stack_;
+
+			void descend() {
+				while (!stack_.empty()) {
+					auto& top = stack_.back();
+					const auto& children = top.first->children();
+					if (top.second >= children.size()) return;
+					const NodeT* next = &children[top.second];
+					++top.second;
+					stack_.emplace_back(next, 0);
+				}
+			}
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = NodeT;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const NodeT*;
+			using reference = const NodeT&;
+
+			iterator() = default;
+			explicit iterator(const NodeT* root) {
+				if (root != nullptr) {
+					stack_.emplace_back(root, 0);
+					descend();
+				}
+			}
+
+			reference operator*() const { return *stack_.back().first; }
+			pointer operator->() const { return stack_.back().first; }
+			iterator& operator++() {
+				stack_.pop_back();
+				descend();
+				return *this;
+			}
+			iterator operator++(int) { iterator prev = *this; ++(*this); return prev; }
+			bool operator==(const iterator& other) const {
+				return stack_.empty() ? other.stack_.empty() : (!other.stack_.empty() && stack_.back().first == other.stack_.back().first);
+			}
+		};
+
+		explicit sl_postorder_view(const NodeT& root) : root_(&root) {}
+		iterator begin() const { return iterator(root_); }
+		iterator end() const { return iterator(); }
+	};
+
 	namespace sl {
 		// Converts a string_t utf 8 string to a std::string char string
 		SL_CXIN sl_string to_str(const sl_u8string& str) 
@@ -142,7 +416,7 @@
 		}
 
 		// Convert u8 string to a vector of char_8t
-		sl_vector<char8_t> to_u8vec(const char8_t* str) {
+		inline sl_vector<char8_t> to_u8vec(const char8_t* str) {
 			sl_vector<char8_t> vec;
 			for (int i = 0; str[i] != '\0'; i++) {
 				vec.push_back(str[i]);
@@ -150,7 +424,7 @@
 			return vec;
 		}
 
-		sl_vector<char8_t> to_u8vec(const char* str) {
+		inline sl_vector<char8_t> to_u8vec(const char* str) {
 			sl_vector<char8_t> vec;
 			for (int i = 0; str[i] != '\0'; i++) {
 				vec.push_back(static_cast<char8_t>(str[i]));
@@ -159,7 +433,7 @@
 		}
 
 		// Loads a file into a vector of chars
-		sl_char8_vector load_file_to_char8_vector(sl_string name) {
+		inline sl_char8_vector load_file_to_char8_vector(sl_string name) {
 
 
 			std::ifstream ifs(name, std::ios::binary | std::ios::ate);
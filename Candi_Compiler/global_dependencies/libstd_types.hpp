@@ -68,7 +68,9 @@ While using these names for your own purposes right now might not cause a proble
 #pragma once
 // Basic Types
 #include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t
 #include <string> // std::string
+#include <string_view> // std::string_view
 
 // Containers
 #include <array> // std::array
@@ -93,6 +95,7 @@ While using these names for your own purposes right now might not cause a proble
 
 // Algorithms
 #include <algorithm> // std::move, std::forward, std::get, std::ref, std::cref, std::any_of
+#include <utility> // std::exchange
 
 // Type
 #include <typeinfo>
@@ -105,6 +108,10 @@ While using these names for your own purposes right now might not cause a proble
 #include <iostream>
 #include <fstream>
 
+// Concurrency
+#include <thread>
+#include <exception> // std::exception_ptr
+
 #define SL_S static
 #define SL_IN inline
 #define SL_CX constexpr
@@ -137,7 +144,13 @@ While using these names for your own purposes right now might not cause a proble
 
 	/// <@section:Basic Types>
 	using sl_size = std::size_t;
+	using sl_uint8 = std::uint8_t;
+	using sl_int16 = std::int16_t;
+	using sl_uint16 = std::uint16_t;
+	using sl_uint32 = std::uint32_t;
+	using sl_uint64 = std::uint64_t;
 	using sl_string = std::string;
+	using sl_string_view = std::string_view;
 	
 	/// <@section:Utils>
 	template<class T,class Deleter = std::default_delete<T>> 
@@ -194,6 +207,10 @@ While using these names for your own purposes right now might not cause a proble
 	//using sl_exception = std::exception;
 	using sl_runtime_error = std::runtime_error;
 	using sl_out_of_range = std::out_of_range;
+	using sl_exception_ptr = std::exception_ptr;
+
+	// Concurrency
+	using sl_thread = std::thread;
 
 
 
@@ -203,6 +220,7 @@ While using these names for your own purposes right now might not cause a proble
 
 	// Specific typedefs which will be used often.
 	using sl_u8string = std::basic_string<char8_t>;
+	using sl_u8string_view = std::basic_string_view<char8_t>;
 	using sl_char8_vector = std::vector<char8_t>;
 	using sl_char8_vector_it = sl_char8_vector::iterator;
 	using sl_char8_vector_cit = sl_char8_vector::const_iterator;
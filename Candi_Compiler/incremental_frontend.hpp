@@ -0,0 +1,340 @@
+#pragma once
+#include "cand_syntax.hpp"
+#include "tokenizer.hpp"
+#include "pratt_parser.hpp"
+
+/// <incremental_frontend>
+/// Keeps the source, tokens and statement trees of one buffer alive across edits.
+/// The buffer is split into top level statements, each ending at a semicolon outside of any scope or at the
+/// brace closing an #enter or #start block or a function body. Every statement owns its bytes and its tokens, token offsets and
+/// lines are relative to the start of the statement, so an edit never touches the statements it doesn't damage.
+/// The statements are kept in a gap buffer: statements before the gap know their position from the start of the
+/// buffer, statements after it from the end. An edit moves the gap to the damaged window, relexes and reparses
+/// the enclosing top level statements and splices them in at the gap. Its cost is the size of the window plus
+/// the number of statements the gap moves over, not the size of the buffer.
+/// A window which no longer ends with a statement takes in the statements after it until it does. When the
+/// window can't be relexed on its own (an unterminated string or comment, a keyword syntax switch) the whole
+/// buffer is rebuilt, so the result is always the same as a fresh tokenize and parse of the edited buffer.
+/// </incremental_frontend>
+class incremental_frontend {
+public:
+	// Replaces the bytes [begin, end) of the source with text.
+	struct text_edit {
+		sl_size begin{ 0 };
+		sl_size end{ 0 };
+		sl_u8string text{};
+	};
+
+	// Parses the tokens of one top level statement, without its closing semicolon.
+	using statement_parser = pratt_parser::result_type(*)(tk_vector_cit begin, tk_vector_cit end);
+
+	// Bytes, lines and tokens of a run of statements.
+	struct extent {
+		sl_size bytes{ 0 };
+		sl_size lines{ 0 };
+		sl_size tokens{ 0 };
+
+		extent operator+(const extent& other) const { return { bytes + other.bytes, lines + other.lines, tokens + other.tokens }; }
+		extent operator-(const extent& other) const { return { bytes - other.bytes, lines - other.lines, tokens - other.tokens }; }
+	};
+
+	// A top level statement and the whitespace before it, the last statement also owns the rest of the buffer.
+	// Token offsets are relative to source, token lines count from 1 on the line the statement starts on.
+	struct statement {
+		sl_char8_vector source{};
+		tk_vector tokens{};
+		pratt_parser::result_type tree{ pratt_parser::result_type::make_failure("Statement not parsed.") };
+
+		// Lines from the line the statement starts on to the line its last token is on.
+		extent size() const { return { source.size(), tokens.empty() ? 0 : tokens.back().line() - 1, tokens.size() }; }
+	};
+
+	struct edit_stats {
+		sl_size relexed_tokens{ 0 };
+		sl_size reparsed_statements{ 0 };
+		bool rebuilt{ false };
+	};
+private:
+	enum class e_keyword_syntax { none_, directive_, keyword_ };
+
+	// A statement in the gap buffer. Before the gap, start is the extent of the statements before it.
+	// After the gap, start is the extent of the statement and every statement after it.
+	struct placed_statement {
+		statement value;
+		extent start;
+	};
+
+	// Statements before the gap in order, statements after the gap in reverse order.
+	sl_vector<placed_statement> before_;
+	sl_vector<placed_statement> after_;
+	// The buffer while it has no statements, it is empty, blank or failed to tokenize.
+	sl_char8_vector unsplit_;
+	statement_parser parser_;
+	e_keyword_syntax keyword_syntax_{ e_keyword_syntax::none_ };
+	sl_string error_;
+
+	static e_keyword_syntax keyword_syntax_of(const tk& t) {
+		if (!t.is_keyword()) return e_keyword_syntax::none_;
+		return t.literal()[0] == u8'#' ? e_keyword_syntax::directive_ : e_keyword_syntax::keyword_;
+	}
+
+	static pratt_parser::result_type parse_expression_statement(tk_vector_cit begin, tk_vector_cit end) {
+		return parse_expression_pratt(begin, end);
+	}
+
+	// Statements which end at the brace closing their body, a function definition needs no semicolon.
+	static bool opens_block_statement(const tk& head) {
+		return head.type_is(e_tk::enter_) || head.type_is(e_tk::start_) || head.type_is(e_tk::function_);
+	}
+
+	// <@method:statement_ends> Index one past the last token of each top level statement of tokens.
+	// If the last statement is not closed the last index is tokens.size() and closed is false.
+	static sl_vector<sl_size> statement_ends(const tk_vector& tokens, bool& closed) {
+		sl_vector<sl_size> ends;
+		sl_size depth = 0;
+		sl_size first = 0;
+		for (sl_size i = 0; i < tokens.size(); i++) {
+			const tk& t = tokens[i];
+			if (t.is_opening_scope()) depth++;
+			else if (t.is_closing_scope() && depth > 0) {
+				if (--depth == 0 && t.type_is(e_tk::close_brace_) && opens_block_statement(tokens[first])) {
+					// A semicolon right after the body still belongs to the statement.
+					if (i + 1 < tokens.size() && tokens[i + 1].type_is(e_tk::semicolon_)) i++;
+					ends.push_back(i + 1);
+					first = i + 1;
+				}
+			}
+			else if (t.type_is(e_tk::semicolon_) && depth == 0) {
+				ends.push_back(i + 1);
+				first = i + 1;
+			}
+		}
+		closed = first == tokens.size();
+		if (!closed) ends.push_back(tokens.size());
+		return ends;
+	}
+
+	void parse_statement(statement& s) const {
+		auto last = s.tokens.cend();
+		if (s.tokens.back().type_is(e_tk::semicolon_)) --last;
+		s.tree = parser_(s.tokens.cbegin(), last);
+		// A diagnostic refers to its token, statements are copied apart from their tokens.
+		if (!s.tree.valid()) s.tree = pratt_parser::result_type::make_failure(s.tree.error_message());
+	}
+
+	extent before_extent() const { return before_.empty() ? extent{} : before_.back().start + before_.back().value.size(); }
+	extent after_extent() const { return after_.empty() ? extent{} : after_.back().start; }
+
+	const placed_statement& placed_at(sl_size index) const {
+		return index < before_.size() ? before_[index] : after_[after_.size() - 1 - (index - before_.size())];
+	}
+	// Extent of the statements before the statement at index.
+	extent start_of(sl_size index) const {
+		if (index < before_.size()) return before_[index].start;
+		return before_extent() + after_extent() - placed_at(index).start;
+	}
+	sl_size span_end(sl_size index) const { return start_of(index).bytes + placed_at(index).value.source.size(); }
+
+	void push_before(statement&& s) {
+		const extent start = before_extent();
+		before_.push_back(placed_statement{ std::move(s), start });
+	}
+	// <@method:move_gap> Moves the gap in front of the statement at index.
+	void move_gap(sl_size index) {
+		while (before_.size() > index) {
+			statement s = std::move(before_.back().value);
+			before_.pop_back();
+			const extent start = after_extent() + s.size();
+			after_.push_back(placed_statement{ std::move(s), start });
+		}
+		while (before_.size() < index) {
+			push_before(std::move(after_.back().value));
+			after_.pop_back();
+		}
+	}
+
+	// <@method:take_next> Appends the source of the statement after the gap to window and drops the statement.
+	void take_next(sl_char8_vector& window) {
+		const auto& next = after_.back().value.source;
+		window.insert(window.end(), next.cbegin(), next.cend());
+		after_.pop_back();
+	}
+
+	// <@method:split> Splits tokens lexed from text into statements and pushes them at the gap.
+	// Tokens are relative to the start of text, the last statement owns the rest of text.
+	sl_size split(const sl_char8_vector& text, tk_vector&& tokens) {
+		bool closed = false;
+		const auto ends = statement_ends(tokens, closed);
+		sl_size first = 0;
+		sl_size byte = 0;
+		sl_size line = 1;
+		for (sl_size i = 0; i < ends.size(); i++) {
+			const sl_size last = ends[i];
+			const tk& last_token = tokens[last - 1];
+			const sl_size end_byte = i + 1 == ends.size() ? text.size() : last_token.offset() + last_token.size();
+			const sl_size end_line = last_token.line();
+			statement s;
+			s.source.assign(text.cbegin() + byte, text.cbegin() + end_byte);
+			s.tokens.reserve(last - first);
+			for (sl_size t = first; t < last; t++) {
+				tk& moved = s.tokens.emplace_back(std::move(tokens[t]));
+				moved.set_offset(moved.offset() - byte);
+				moved.set_line(moved.line() - line + 1);
+			}
+			parse_statement(s);
+			push_before(std::move(s));
+			first = last;
+			byte = end_byte;
+			line = end_line;
+		}
+		return ends.size();
+	}
+
+	// <@method:rebuild> Tokenizes and parses the whole buffer.
+	edit_stats rebuild(sl_char8_vector source) {
+		before_.clear();
+		after_.clear();
+		unsplit_.clear();
+		keyword_syntax_ = e_keyword_syntax::none_;
+		error_.clear();
+
+		tk_vector tokens;
+		if (!source.empty()) {
+			auto lexed = tokenizer(source.cbegin(), source.cend())();
+			if (lexed.valid()) tokens = lexed.extract();
+			else error_ = lexed.error_message();
+		}
+		if (tokens.empty()) {
+			unsplit_ = std::move(source);
+			return edit_stats{ 0, 0, true };
+		}
+		for (const auto& t : tokens) {
+			if (t.is_keyword()) { keyword_syntax_ = keyword_syntax_of(t); break; }
+		}
+		const sl_size token_count = tokens.size();
+		const sl_size statement_count = split(source, std::move(tokens));
+		return edit_stats{ token_count, statement_count, true };
+	}
+
+	// <@method:rebuild_with_window> Rebuilds the buffer from the statements around the gap and window between them.
+	edit_stats rebuild_with_window(const sl_char8_vector& window) {
+		sl_char8_vector source;
+		source.reserve(before_extent().bytes + window.size() + after_extent().bytes);
+		for (const auto& s : before_) source.insert(source.end(), s.value.source.cbegin(), s.value.source.cend());
+		source.insert(source.end(), window.cbegin(), window.cend());
+		for (auto it = after_.crbegin(); it != after_.crend(); ++it)
+			source.insert(source.end(), it->value.source.cbegin(), it->value.source.cend());
+		return rebuild(std::move(source));
+	}
+public:
+	incremental_frontend(statement_parser parser = &parse_expression_statement) : parser_(parser) {}
+	incremental_frontend(sl_char8_vector source, statement_parser parser = &parse_expression_statement) : parser_(parser) {
+		rebuild(std::move(source));
+	}
+
+	// <@method:apply> Applies an edit to the source and brings tokens and statements up to date.
+	edit_stats apply(const text_edit& edit) {
+		if (edit.begin > edit.end || edit.end > size())
+			throw sl_out_of_range("incremental_frontend::apply edit range out of range.");
+
+		// Without a valid token stream there is nothing to reuse.
+		if (statement_count() == 0) {
+			sl_char8_vector source = std::move(unsplit_);
+			source.erase(source.begin() + edit.begin, source.begin() + edit.end);
+			source.insert(source.begin() + edit.begin, edit.text.begin(), edit.text.end());
+			return rebuild(std::move(source));
+		}
+
+		// Damaged window: every statement whose span the edit touches. An insertion between two statements
+		// belongs to the one after it.
+		auto first_ending_after = [this](sl_size offset, bool inclusive) {
+			sl_size lo = 0, hi = statement_count();
+			while (lo < hi) {
+				sl_size mid = lo + (hi - lo) / 2;
+				sl_size end = span_end(mid);
+				if (inclusive ? end >= offset : end > offset) hi = mid; else lo = mid + 1;
+			}
+			return std::min(lo, statement_count() - 1);
+		};
+		const sl_size first_statement = first_ending_after(edit.begin, false);
+		const sl_size last_statement = std::max(first_statement, first_ending_after(edit.end, true));
+
+		// Take the window out of the buffer and edit it.
+		move_gap(first_statement);
+		const sl_size window_begin = before_extent().bytes;
+		sl_char8_vector window;
+		for (sl_size i = first_statement; i <= last_statement; i++) take_next(window);
+		window.erase(window.begin() + (edit.begin - window_begin), window.begin() + (edit.end - window_begin));
+		window.insert(window.begin() + (edit.begin - window_begin), edit.text.begin(), edit.text.end());
+
+		// Relex the window on its own. It starts right after a statement, where the lexer holds no state.
+		// The window must end with a closed statement unless it runs to the end of the buffer, else it
+		// takes in the statements after it, twice as many each time so a long run is relexed a bounded
+		// number of times. A comment after the last statement would run on past the window.
+		tk_vector relexed;
+		for (sl_size taken = 1;; taken *= 2) {
+			relexed.clear();
+			if (!window.empty()) {
+				auto lexed = tokenizer(window.cbegin(), window.cend())();
+				if (!lexed.valid()) return rebuild_with_window(window);
+				relexed = lexed.extract();
+			}
+			if (after_.empty()) break;
+			if (!relexed.empty()) {
+				bool closed = false;
+				statement_ends(relexed, closed);
+				if (closed && relexed.back().offset() + relexed.back().size() == window.size()) break;
+			}
+			for (sl_size i = 0; i < taken && !after_.empty(); i++) take_next(window);
+		}
+		for (const auto& t : relexed) {
+			const e_keyword_syntax syntax = keyword_syntax_of(t);
+			if (syntax != e_keyword_syntax::none_ && syntax != keyword_syntax_) return rebuild_with_window(window);
+		}
+
+		// A blank window at the end of the buffer is the tail of the statement before it.
+		if (relexed.empty()) {
+			if (before_.empty()) return rebuild_with_window(window);
+			auto& tail = before_.back().value.source;
+			tail.insert(tail.end(), window.cbegin(), window.cend());
+			return edit_stats{ 0, 0, false };
+		}
+
+		const sl_size relexed_count = relexed.size();
+		const sl_size reparsed_count = split(window, std::move(relexed));
+		return edit_stats{ relexed_count, reparsed_count, false };
+	}
+
+	// Size of the buffer in bytes.
+	sl_size size() const { return statement_count() == 0 ? unsplit_.size() : (before_extent() + after_extent()).bytes; }
+	sl_size statement_count() const { return before_.size() + after_.size(); }
+	const statement& statement_at(sl_size index) const { return placed_at(index).value; }
+	// Position of the statement at index: its first byte, the line it starts on less one and its first token.
+	extent statement_start(sl_size index) const { return start_of(index); }
+
+	// <@method:source> Copies the buffer out of its statements.
+	sl_char8_vector source() const {
+		if (statement_count() == 0) return unsplit_;
+		sl_char8_vector source;
+		source.reserve(size());
+		for (sl_size i = 0; i < statement_count(); i++)
+			source.insert(source.end(), statement_at(i).source.cbegin(), statement_at(i).source.cend());
+		return source;
+	}
+	// <@method:tokens> Copies the tokens of the buffer out of its statements, with offsets and lines in the buffer.
+	tk_vector tokens() const {
+		tk_vector tokens;
+		for (sl_size i = 0; i < statement_count(); i++) {
+			const extent start = start_of(i);
+			for (tk t : statement_at(i).tokens) {
+				t.set_offset(t.offset() + start.bytes);
+				t.set_line(t.line() + start.lines);
+				tokens.push_back(std::move(t));
+			}
+		}
+		return tokens;
+	}
+	// False if the buffer failed to tokenize, statements which failed to parse hold their own error.
+	bool valid() const { return error_.empty(); }
+	const sl_string& error_message() const { return error_; }
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "cand_syntax.hpp"
 #include "token_iterator.hpp"
+#include "pratt_parser.hpp"
 
 /// <Expression Rules>
 /// 1. Access Operators . :: may only be followed by an identifier. Not a prefix!
@@ -548,234 +549,16 @@ public:
 
 };
 
+// Parses the fully parenthesized output of the parenthesizer. The pratt parser reads the explicit
+// parentheses as given, and keeps them on its work stack instead of recursing once per level.
 ast parse_expression_impl(tk_vector_cit begin, tk_vector_cit end) {
-	tk_iterator it(begin, end);
-	ast node;
-	enum class e_expected { operand_, operator_, any_ } expected = e_expected::any_;
-
-	// Open Paren -> Subexpr or Redundant Parentheses.
-	if (it.type_is(e_tk::open_paren_)) {
-		auto scope = tk_scope::find_paren(it.it(), it.end());
-		if (!scope.valid()) {
-			throw "Mismatched parentheses in operand.";
-		}
-		else {
-			// Check for redundant parentheses.
-			if (scope.end() == it.end()) {
-				// Parse the inside of the parentheses.
-				return parse_expression_impl(scope.contained_begin(), scope.contained_end());
-			}
-			else {
-				// Scope is an operand contained in a subexpression.
-				ast operand = parse_expression_impl(scope.contained_begin(), scope.contained_end());
-				it.advance(scope.end());
-
-				// Operand may be followed by a postfix, or a binary operator.
-				if (it.operation() == e_operation::postfix_) {
-					// Postfix () -> Function Call
-					if (it.type_is(e_tk::open_paren_)) {
-						auto scope = tk_scope::find_paren(it.it(), it.end());
-						if (!scope.valid()) {
-							throw "Mismatched parentheses in function call.";
-						}
-						else {
-							// Parse the inside of the parentheses.
-							node = ast{ e_ast::function_call_ };
-							node.push_back(operand);
-							node.push_back(ast{ e_ast::arguments_ }); // TODO: parse_args
-							it.advance(scope.end());
-						}
-					}
-					// Postfix {} -> Index Operator
-					else if (it.type_is(e_tk::open_brace_)) {
-						auto scope = tk_scope::find_brace(it.it(), it.end());
-						if (!scope.valid()) {
-							throw "Mismatched braces in index operator.";
-						}
-						else {
-							// Parse the inside of the parentheses.
-							node = ast{ e_ast::index_operator_ };
-							node.push_back(operand);
-							node.push_back(e_ast::index_arguments_); // TODO: parse_index_args
-							it.advance(scope.end());
-						}
-					}
-					// Postfix [] -> Type Call
-					else if (it.type_is(e_tk::open_bracket_)) {
-						auto scope = tk_scope::find_bracket(it.it(), it.end());
-						if (!scope.valid()) {
-							throw "Mismatched brackets in type call.";
-						}
-						else {
-							// Parse the inside of the parentheses.
-							node = ast{ e_ast::type_call_ };
-							node.push_back(operand);
-							node.push_back(e_ast::type_arguments_); // TODO: parse_type_args
-							it.advance(scope.end());
-						}
-					}
-					// Postfix Single Token Operator.
-					else {
-						node = ast{ it.get() };
-						node.push_back(operand);
-						it.advance();
-					}
-				}
-				else if (it.operation() == e_operation::binary_) {
-					node = ast{ it.get() };
-					node.push_back(operand);
-					it.advance();
-
-					// Expecting an operand after a binary operator.
-					// Open Paren -> Subexpr
-					if (it.type_is(e_tk::open_paren_)) {
-						auto scope = tk_scope::find_paren(it.it(), it.end());
-						if (!scope.valid()) {
-							throw "Mismatched parentheses in operand.";
-						}
-						else {
-							// Parse the inside of the parentheses.
-							node.push_back(parse_expression_impl(scope.contained_begin(), scope.contained_end()));
-							it.advance(scope.end());
-						}
-					}
-					else if (it.operation() == e_operation::none_) {
-						node.push_back(ast{ it.get() });
-						it.advance();
-					}
-					else
-						throw "Invalid token following operand in subexpression.";
-				}
-				else {
-					throw "Invalid token following operand in subexpression.";
-				}
-
-			}
-		}
-
-	}
-	else if (it.operation() == e_operation::none_) {
-		// Single Operand
-		ast operand = ast{ it.get() };
-		it.advance();
-
-		if (it.at_end()) {
-			// Single operand expression.
-			node = operand;
-			return node;
-		}
-
-		// Operand may be followed by a postfix, or a binary operator.
-		if (it.operation() == e_operation::postfix_) {
-			if (it.type_is(e_tk::open_paren_)) {
-				auto scope = tk_scope::find_paren(it.it(), it.end());
-				if (!scope.valid()) {
-					throw "Mismatched parentheses in function call.";
-				}
-				else {
-					// Parse the inside of the parentheses.
-					node = ast{ e_ast::function_call_ };
-					node.push_back(operand);
-					node.push_back(ast{ e_ast::arguments_ });
-					it.advance(scope.end());
-				}
-			}
-			// Postfix {} -> Index Operator
-			else if (it.type_is(e_tk::open_brace_)) {
-				auto scope = tk_scope::find_brace(it.it(), it.end());
-				if (!scope.valid()) {
-					throw "Mismatched braces in index operator.";
-				}
-				else {
-					// Parse the inside of the parentheses.
-					node = ast{ e_ast::index_operator_ };
-					node.push_back(operand);
-					node.push_back(e_ast::index_arguments_); // TODO: parse_index_args
-					it.advance(scope.end());
-				}
-			}
-			// Postfix [] -> Type Call
-			else if (it.type_is(e_tk::open_bracket_)) {
-				auto scope = tk_scope::find_bracket(it.it(), it.end());
-				if (!scope.valid()) {
-					throw "Mismatched brackets in type call.";
-				}
-				else {
-					// Parse the inside of the parentheses.
-					node = ast{ e_ast::type_call_ };
-					node.push_back(operand);
-					node.push_back(e_ast::type_arguments_); // TODO: parse_type_args
-					it.advance(scope.end());
-				}
-			}
-			else {
-				node = ast{ it.get() };
-				node.push_back(operand);
-				it.advance();
-			}
-		}
-		else if (it.operation() == e_operation::binary_) {
-			node = ast{ it.get() };
-			node.push_back(operand);
-			it.advance();
-
-			// Expecting an operand after a binary operator.
-			// Open Paren -> Subexpr
-			if (it.type_is(e_tk::open_paren_)) {
-				auto scope = tk_scope::find_paren(it.it(), it.end());
-				if (!scope.valid()) {
-					throw "Mismatched parentheses in operand.";
-				}
-				else {
-					// Parse the inside of the parentheses.
-					node.push_back(parse_expression_impl(scope.contained_begin(), scope.contained_end()));
-					it.advance(scope.end());
-				}
-			}
-			else if (it.operation() == e_operation::none_) {
-				node.push_back(ast{ it.get() });
-				it.advance();
-			}
-			else
-				throw "Invalid token following operand in subexpression.";
-		}
-		else {
-			throw "Invalid token following operand in subexpression.";
-		}
-
-	}
-	else if (it.operation() == e_operation::prefix_) {
-		// Prefix Operator, must be followed by an operand.
-		node = ast{ it.get() };
-		it.advance();
-		// Open Paren -> Subexpr
-		if (it.type_is(e_tk::open_paren_)) {
-			auto scope = tk_scope::find_paren(it.it(), it.end());
-			if (!scope.valid()) {
-				throw "Mismatched parentheses in operand.";
-			}
-			else {
-				// Parse the inside of the parentheses.
-				node.push_back(parse_expression_impl(scope.contained_begin(), scope.contained_end()));
-				it.advance(scope.end());
-			}
-		}
-		else if (it.operation() == e_operation::none_) {
-			node.push_back(ast{ it.get() });
-			it.advance();
-		}
-		else
-			throw "Invalid token following operand in subexpression.";
-	}
-	else
-		throw "Invalid token at start of expression.";
-
-	return node;
+	return parse_expression(begin, end);
 }
 
+// Expressions are parsed in a single pass by the pratt_parser. The parenthesizer
+// is kept to print the resolved operator order of an expression.
 ast parse_expression(tk_vector_cit begin, tk_vector_cit end) {
-	parenthesizer p(begin, end);
-	auto parenthesized = p.parenthesize_expression();
-	auto node = parse_expression_impl(parenthesized.begin(), parenthesized.end());
-	return node;
+	auto result = parse_expression_pratt(begin, end);
+	if (!result.valid()) throw sl_runtime_error(result.error_message());
+	return result.extract();
 }
\ No newline at end of file
@@ -21,6 +21,161 @@ namespace caoco {
 // expected() is the node, always() is one token iterator past the parsed tokens.
 using expected_parse_result = sl_partial_expected<astnode, tk_vector_cit>;
 
+// Parser settings of the calling thread.
+// lazy_function_bodies: function and method definitions keep only their signature and the token range of their body
+//	in a deferred_functional_block_, the body is parsed on first call. See parse_deferred_block.
+// full_check: every body is parsed at load time even in lazy mode, so errors in bodies are reported up front.
+// memo: packrat memo the backtracking rules store their results in, none by default. See parse_memo.
+// max_depth: deepest nesting of blocks the recursive block parsers accept, deeper blocks fail with a diagnostic
+//	instead of overflowing the stack. llk_parser keeps its own parse stack and has no such limit.
+class parse_memo;
+struct parser_settings {
+	bool lazy_function_bodies{ false };
+	bool full_check{ false };
+	parse_memo* memo{ nullptr };
+	sl_size max_depth{ 256 };
+};
+
+inline parser_settings& current_parser_settings() {
+	thread_local parser_settings settings;
+	return settings;
+}
+
+// Counts the blocks the calling thread is parsing until the end of the scope.
+// The count is per thread, a parallel worker inherits the depth of the thread which started it.
+class parse_depth_guard {
+	sl_size previous_;
+	static sl_size& depth() {
+		thread_local sl_size depth{ 0 };
+		return depth;
+	}
+public:
+	parse_depth_guard() : previous_(depth()++) {}
+	// Continues counting from the depth of another thread.
+	explicit parse_depth_guard(sl_size caller_depth) : previous_(depth()) { depth() = caller_depth; }
+	~parse_depth_guard() { depth() = previous_; }
+	parse_depth_guard(const parse_depth_guard&) = delete;
+	parse_depth_guard& operator=(const parse_depth_guard&) = delete;
+	// <@method:exceeded> True if the block is nested deeper than parser_settings::max_depth.
+	bool exceeded() const { return depth() > current_parser_settings().max_depth; }
+	// <@method:current> The depth of the calling thread.
+	static sl_size current() { return depth(); }
+};
+
+// Applies parser settings to the calling thread until the end of the scope.
+class parser_settings_scope {
+	parser_settings previous_;
+public:
+	parser_settings_scope(parser_settings settings) : previous_(current_parser_settings()) {
+		current_parser_settings() = settings;
+	}
+	~parser_settings_scope() { current_parser_settings() = previous_; }
+	parser_settings_scope(const parser_settings_scope&) = delete;
+	parser_settings_scope& operator=(const parser_settings_scope&) = delete;
+};
+
+// Rules which try several interpretations of the same token range and are kept in a parse_memo.
+enum class e_memo_rule : int {
+	operand_,
+	primary_expression_,
+	value_statement_
+};
+
+/// <parse_memo>
+/// Packrat memo table of one token vector: a rule over [begin, end) is parsed once, every later attempt at the same
+/// rule and token range returns the stored end position and error, or the stored tree. Backtracking rules which
+/// retry a sub-range under another interpretation stop re-parsing it.
+/// A stored tree is shared (see astnode::share) with every result it is handed out in, a hit copies its root only.
+/// Ranges are keyed by token index, the memo is only valid while the token vector is left unchanged.
+/// Not thread safe, each thread parses with its own memo.
+/// </parse_memo>
+class parse_memo {
+	struct key {
+		e_memo_rule rule;
+		sl_size begin;
+		sl_size end;
+		bool operator==(const key&) const = default;
+	};
+	struct key_hash {
+		sl_size operator()(const key& k) const noexcept {
+			sl_size h = std::hash<sl_size>{}(k.begin);
+			h ^= std::hash<sl_size>{}(k.end) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+			return h ^ static_cast<sl_size>(k.rule);
+		}
+	};
+
+	struct failure {
+		tk_vector_cit always;
+		sl_error error;
+	};
+	struct success {
+		tk_vector_cit always;
+		astnode node; // Children shared with the results.
+	};
+
+	tk_vector_cit base_;
+	sl_unordered_map<key, failure, key_hash> failures_;
+	sl_unordered_map<key, success, key_hash> successes_;
+	sl_size hits_{ 0 };
+	sl_size misses_{ 0 };
+public:
+	parse_memo(const tk_vector& tokens) : base_(tokens.cbegin()) {}
+	// Token indices are counted from base, the first token of the vector.
+	parse_memo(tk_vector_cit base) : base_(base) {}
+
+	// <@method:memoize> Returns the stored result of rule over [begin, end), or calls parse(begin, end) and stores
+	// its result.
+	template<class ParseT>
+	expected_parse_result memoize(e_memo_rule rule, tk_vector_cit begin, tk_vector_cit end, ParseT&& parse) {
+		const key k{ rule, static_cast<sl_size>(begin - base_), static_cast<sl_size>(end - base_) };
+		if (auto found = successes_.find(k); found != successes_.end()) {
+			hits_++;
+			return expected_parse_result::make_success(found->second.always, found->second.node);
+		}
+		if (auto found = failures_.find(k); found != failures_.end()) {
+			hits_++;
+			return expected_parse_result::make_failure(found->second.always, found->second.error.copy());
+		}
+		misses_++;
+		// The maps may rehash while parse recurses, the result is inserted after.
+		auto result = parse(begin, end);
+		if (!result.valid()) {
+			failures_.emplace(k, failure{ result.always(), result.error().copy() });
+			return result;
+		}
+		const auto always = result.always();
+		astnode node = result.extract();
+		node.share();
+		successes_.emplace(k, success{ always, node });
+		return expected_parse_result::make_success(always, std::move(node));
+	}
+
+	// <@method:add_stats> Adds the lookups of another memo, ex. one used by a worker thread.
+	void add_stats(const parse_memo& other) {
+		hits_ += other.hits_;
+		misses_ += other.misses_;
+	}
+
+	const tk_vector_cit& base() const { return base_; }
+	sl_size hits() const { return hits_; }
+	sl_size misses() const { return misses_; }
+	sl_size size() const { return failures_.size() + successes_.size(); }
+	double hit_rate() const { return hits_ + misses_ == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(hits_ + misses_); }
+	void clear() {
+		failures_.clear();
+		successes_.clear();
+		hits_ = 0;
+		misses_ = 0;
+	}
+};
+
+// Parses through the memo of the calling thread's settings, if there is one.
+template<class ParseT>
+expected_parse_result memoized_parse(e_memo_rule rule, tk_vector_cit begin, tk_vector_cit end, ParseT&& parse) {
+	parse_memo* memo = current_parser_settings().memo;
+	return memo ? memo->memoize(rule, begin, end, std::forward<ParseT>(parse)) : parse(begin, end);
+}
+
 // Helper functions for parsing a singular-token astnode.
 template<tk_enum TOKEN_TYPE, astnode_enum NODE_TYPE, auto error_lambda>
 constexpr inline expected_parse_result generic_parse_single_token(tk_vector_cit begin, tk_vector_cit end) {
@@ -63,7 +218,7 @@ expected_parse_result parse_cso(tk_vector_cit begin, tk_vector_cit end);
 // NOTE: currently arguments containing scopes are not supported.
 expected_parse_result parse_arguments(tk_vector_cit begin, tk_vector_cit end); // This is not the same as function definition arguments. This is for function calls.
 expected_parse_result expression_split_parse(tk_cursor cursor, astnode* last_pass = nullptr);
-astnode expression_simplify(astnode node);
+astnode expression_simplify(astnode&& node);
 expected_parse_result expression_split_and_simplify(tk_vector_cit begin, tk_vector_cit end);
 ///
 expected_parse_result expression_split_parse2(tk_cursor cursor, astnode* last_pass = nullptr);
@@ -97,8 +252,13 @@ expected_parse_result parse_directive_include(tk_vector_cit begin, tk_vector_cit
 expected_parse_result parse_conditional_block(tk_vector_cit begin, tk_vector_cit end); // allows use of break,continue,default.
 // allows use of return. All except the above, and include is forbidden.
 expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit end); 
+// Parses the body recorded by a deferred_functional_block_ into a functional_block_.
+expected_parse_result parse_deferred_block(const astnode& deferred);
 // allows use of all except return/break/continue/default.Value expr is forbidden?allowed for now.
 expected_parse_result parse_pragmatic_block(tk_vector_cit begin, tk_vector_cit end); 
+// Same as parse_pragmatic_block, the top level statements are parsed on up to thread_count threads.
+expected_parse_result parse_pragmatic_block_parallel(tk_vector_cit begin, tk_vector_cit end, sl_size thread_count);
+expected_parse_result parse_pragmatic_statement(tk_vector_cit begin, tk_vector_cit end);
 
 expected_parse_result parse_string_literal(tk_vector_cit begin, tk_vector_cit end) {
 	return generic_parse_single_token<
@@ -164,7 +324,7 @@ expected_parse_result parse_directive_none(tk_vector_cit begin, tk_vector_cit en
 	>(begin, end);
 }
 
-expected_parse_result parse_operand(tk_vector_cit begin, tk_vector_cit end) {
+expected_parse_result parse_operand_unmemoized(tk_vector_cit begin, tk_vector_cit end) {
 	switch (begin->type())
 	{
 	case tk_enum::string_literal_:
@@ -198,7 +358,7 @@ expected_parse_result parse_operand(tk_vector_cit begin, tk_vector_cit end) {
 				return expected_parse_result::make_failure(begin, ca_error::parser::invalid_expression(begin, "Invalid expression in operand."));
 
 			auto nd = astnode(astnode_enum::expression_, scope.scope_begin(), scope.scope_end());
-			nd.push_back(expr.expected());
+			nd.push_back(expr.extract());
 			return expected_parse_result::make_success(scope.scope_end(),nd);
 		}
 	}
@@ -225,9 +385,9 @@ expected_parse_result parse_operand(tk_vector_cit begin, tk_vector_cit end) {
 					if (!expr.valid())
 						return expected_parse_result::make_failure(begin, ca_error::parser::invalid_expression(begin, "Invalid expression in list operand."));
 
-					list.push_back(expr.expected());
+					list.push_back(expr.extract());
 				}
-				return expected_parse_result::make_success(seperated_list.back().scope_end(), list);
+				return expected_parse_result::make_success(seperated_list.back().scope_end(), std::move(list));
 			}
 		}
 	}
@@ -240,6 +400,10 @@ expected_parse_result parse_operand(tk_vector_cit begin, tk_vector_cit end) {
 	}
 }
 
+expected_parse_result parse_operand(tk_vector_cit begin, tk_vector_cit end) {
+	return memoized_parse(e_memo_rule::operand_, begin, end, parse_operand_unmemoized);
+}
+
 expected_parse_result parse_cso_type(tk_vector_cit begin, tk_vector_cit end) {
 	return generic_parse_single_token<tk_enum::atype_, astnode_enum::atype_, LAMBDA_STRING(cso_type : begin is not atype_ token.)>(begin, end);
 }
@@ -270,39 +434,39 @@ expected_parse_result parse_cso_int(tk_vector_cit begin, tk_vector_cit end) {
 		if (cursor.type_is(tk_enum::subtraction_)) { // negative lower bound
 			cursor.advance();
 			auto& unary_op = atype_node.push_back({ astnode_enum::unary_minus_ });
-			unary_op.push_back(parse_number_literal(cursor.get_it(), end).expected());
+			unary_op.push_back(parse_number_literal(cursor.get_it(), end).extract());
 			cursor.advance(2); // past number and ellipsis.
 
 			// get the upper bound
 			if (cursor.type_is(tk_enum::subtraction_)) { // negative upper bound
 				cursor.advance();
 				auto& unary_op2 = atype_node.push_back({ astnode_enum::unary_minus_ });
-				unary_op2.push_back(parse_number_literal(cursor.get_it(), end).expected());
+				unary_op2.push_back(parse_number_literal(cursor.get_it(), end).extract());
 				cursor.advance(2); // past number and close frame
-				return expected_parse_result::make_success(cursor.get_it(), atype_node);
+				return expected_parse_result::make_success(cursor.get_it(), std::move(atype_node));
 			}
 			else {
-				atype_node.push_back(parse_number_literal(cursor.get_it(), end).expected());
+				atype_node.push_back(parse_number_literal(cursor.get_it(), end).extract());
 				cursor.advance(2); // past number and close frame
-				return expected_parse_result::make_success(cursor.get_it(), atype_node);
+				return expected_parse_result::make_success(cursor.get_it(), std::move(atype_node));
 			}
 		}
 		else { // positive lower bound
-			atype_node.push_back(parse_number_literal(cursor.get_it(), end).expected());
+			atype_node.push_back(parse_number_literal(cursor.get_it(), end).extract());
 			cursor.advance(2); // past number and ellipsis.
 
 			// get the upper bound
 			if (cursor.type_is(tk_enum::subtraction_)) { // negative upper bound
 				cursor.advance();
 				auto& unary_op = atype_node.push_back({ astnode_enum::unary_minus_ });
-				unary_op.push_back(parse_number_literal(cursor.get_it(), end).expected());
+				unary_op.push_back(parse_number_literal(cursor.get_it(), end).extract());
 				cursor.advance(2); // past number and close frame
-				return expected_parse_result::make_success(cursor.get_it(), atype_node);
+				return expected_parse_result::make_success(cursor.get_it(), std::move(atype_node));
 			}
 			else {
-				atype_node.push_back(parse_number_literal(cursor.get_it(), end).expected());
+				atype_node.push_back(parse_number_literal(cursor.get_it(), end).extract());
 				cursor.advance(2); // past number and close frame
-				return expected_parse_result::make_success(cursor.get_it(), atype_node);
+				return expected_parse_result::make_success(cursor.get_it(), std::move(atype_node));
 			}
 
 		}
@@ -325,11 +489,11 @@ expected_parse_result parse_cso_uint(tk_vector_cit begin, tk_vector_cit end) {
 	if (scan_tokens_pack<constrained_uint_type_mask>(begin, end)) {
 		astnode atype_node(astnode_enum::auint_constrained_);
 		cursor.advance(2); // Skip the 'auint' and the open frame.
-		atype_node.push_back(parse_number_literal(cursor.get_it(), end).expected());
+		atype_node.push_back(parse_number_literal(cursor.get_it(), end).extract());
 		cursor.advance(2); // past number and ellipsis.
-		atype_node.push_back(parse_number_literal(cursor.get_it(), end).expected());
+		atype_node.push_back(parse_number_literal(cursor.get_it(), end).extract());
 		cursor.advance(2); // past number and close frame
-		return expected_parse_result::make_success(cursor.get_it(), atype_node);
+		return expected_parse_result::make_success(cursor.get_it(), std::move(atype_node));
 	}
 	else {
 		return generic_parse_single_token<tk_enum::auint_, astnode_enum::auint_, LAMBDA_STRING(cso_uint : begin is not auint_ token.)>(begin, end);
@@ -374,46 +538,38 @@ expected_parse_result parse_cso(tk_vector_cit begin, tk_vector_cit end) {
 	}
 }
 
-astnode expression_simplify(astnode node) {
-	if(node.type() == astnode_enum::expression_){
-		auto expr = node.front();
-		return expression_simplify(expr);
-	}
-	else{
-		if (node.children().empty()) return node;
-
-		if (node.front().type() == astnode_enum::expression_) {
-			auto expr = node.front().front();
-			node.front() = expr;
-		}
-
-		if (node.back().type() == astnode_enum::expression_) {
-			auto expr = node.back().front();
-			node.back() = expr;
+// Consumes the node, subtrees are moved into the simplified tree.
+// expression_ wrappers are replaced by their operand. The tree is walked with a work stack, so any depth is simplified.
+astnode expression_simplify(astnode&& node) {
+	astnode root = std::move(node);
+	sl_vector<astnode*> pending{ &root };
+	while (!pending.empty()) {
+		astnode& current = *pending.back();
+		pending.pop_back();
+		while (current.type() == astnode_enum::expression_) {
+			auto expr = std::move(current.front());
+			current = std::move(expr);
 		}
-
-		auto new_front = expression_simplify(node.front());
-		auto new_back = expression_simplify(node.back());
-
-		node.front() = new_front;
-		node.back() = new_back;
+		if (current.children().empty()) continue;
+		pending.push_back(&current.front());
+		if (current.children().size() > 1) pending.push_back(&current.back());
 	}
-	return node;
+	return root;
 }
 
 expected_parse_result expression_split_and_simplify(tk_vector_cit begin, tk_vector_cit end) {
 	auto result = expression_split_parse(tk_cursor(begin, end));
 	if (!result.valid()) return expected_parse_result::make_failure(result.always(), ca_error::parser::invalid_expression(
 		result.always(), "expression_split_and_simplify : Invalid expression."));
-	auto simplified = expression_simplify(result.expected());
-	return expected_parse_result::make_success(result.always(), simplified);
+	auto simplified = expression_simplify(result.extract());
+	return expected_parse_result::make_success(result.always(), std::move(simplified));
 }
 expected_parse_result expression_split_and_simplify2(tk_vector_cit begin, tk_vector_cit end) {
 	auto result = expression_split_parse2(tk_cursor(begin, end));
 	if (!result.valid()) return expected_parse_result::make_failure(result.always(), ca_error::parser::invalid_expression(
 		result.always(), "expression_split_and_simplify : Invalid expression."));
-	auto simplified = expression_simplify(result.expected());
-	return expected_parse_result::make_success(result.always(), simplified);
+	auto simplified = expression_simplify(result.extract());
+	return expected_parse_result::make_success(result.always(), std::move(simplified));
 }
 
 auto inline is_operational_operand(tk_cursor& tkcrsr){
@@ -430,25 +586,25 @@ auto make_partial_binop_after_unary(tk_cursor& crsr, sl_vector<astnode>& prefix_
 		auto rest_of_expr_result = expression_split_parse(last_operand_start);
 		if (!rest_of_expr_result.valid()) return rest_of_expr_result; // Error parsing rest of expression.
 
-		auto rest_of_expr = rest_of_expr_result.expected();
+		auto rest_of_expr = rest_of_expr_result.extract();
 		// Apply the unary operators to the rest of the expression.
 		astnode* last_unary_op = &rest_of_expr;
 		for (auto& op : prefix_ops) {
-			op.push_back(*last_unary_op);
+			op.push_back(std::move(*last_unary_op));
 			last_unary_op = &op;
 		}
 
-		return expected_parse_result::make_success(rest_of_expr_result.always(), *last_unary_op);
+		return expected_parse_result::make_success(rest_of_expr_result.always(), std::move(*last_unary_op));
 	}
 	else {
 		// Apply the unary operators to the operand
 		astnode* last_unary_op = &operandnode;
 		for (auto& op : prefix_ops) {
-			op.push_back(*last_unary_op);
+			op.push_back(std::move(*last_unary_op));
 			last_unary_op = &op;
 		}
 		astnode subexpr = astnode(astnode_enum::expression_);
-		subexpr.push_back(*last_unary_op);
+		subexpr.push_back(std::move(*last_unary_op));
 		return expression_split_parse2(crsr.advance_to(*next_operator_start), &subexpr);
 	}
 };
@@ -1256,7 +1412,7 @@ expected_parse_result expression_split_parse(tk_cursor cursor, astnode* last_pas
 	//}
 }
 
-expected_parse_result parse_primary_expression(tk_vector_cit begin, tk_vector_cit end) {
+expected_parse_result parse_primary_expression_unmemoized(tk_vector_cit begin, tk_vector_cit end) {
 	tk_cursor cursor(begin, end);
 	// check if the scope is redundant
 	if (cursor.type_is(tk_enum::open_scope_)) {
@@ -1280,7 +1436,11 @@ expected_parse_result parse_primary_expression(tk_vector_cit begin, tk_vector_ci
 	return expression_split_and_simplify2(begin, end);
 }
 
-expected_parse_result parse_value_statement(tk_vector_cit begin, tk_vector_cit end) {
+expected_parse_result parse_primary_expression(tk_vector_cit begin, tk_vector_cit end) {
+	return memoized_parse(e_memo_rule::primary_expression_, begin, end, parse_primary_expression_unmemoized);
+}
+
+expected_parse_result parse_value_statement_unmemoized(tk_vector_cit begin, tk_vector_cit end) {
 	parser_scope_result expr_scope;
 	try {
 		expr_scope = caoco::find_open_statement(begin->type(), caoco::tk_enum::eos_, begin, end);
@@ -1296,7 +1456,11 @@ expected_parse_result parse_value_statement(tk_vector_cit begin, tk_vector_cit e
 	auto result = parse_primary_expression(expr_scope.scope_begin(), expr_scope.contained_end());
 	if (!result.valid()) return result;
 
-	return expected_parse_result::make_success(expr_scope.scope_end(), result.expected());
+	return expected_parse_result::make_success(expr_scope.scope_end(), result.extract());
+}
+
+expected_parse_result parse_value_statement(tk_vector_cit begin, tk_vector_cit end) {
+	return memoized_parse(e_memo_rule::value_statement_, begin, end, parse_value_statement_unmemoized);
 }
 
 expected_parse_result parse_arguments(tk_vector_cit begin, tk_vector_cit end) {
@@ -1314,7 +1478,7 @@ expected_parse_result parse_arguments(tk_vector_cit begin, tk_vector_cit end) {
 
 	// Get each argument out of the scope.
 	auto scope_cursor = tk_cursor(scope.contained_begin(), scope.scope_end());
-	sl_vector<astnode> arguments;
+	scratch_vector<astnode> arguments;
 	while(!scope_cursor.at_end()) {
 		auto arg_expr_scope = find_open_statement(scope_cursor.get_it()->type(), tk_enum::comma_, scope_cursor.get_it(), scope_cursor.end());
 			
@@ -1329,22 +1493,22 @@ expected_parse_result parse_arguments(tk_vector_cit begin, tk_vector_cit end) {
 			// Get the last argument.
 			auto arg = parse_primary_expression(scope_cursor.get_it(), scope.contained_end());
 			if (!arg.valid()) return arg;
-			arguments.push_back(arg.expected());
+			arguments.push_back(arg.extract());
 			break;
 		}
 
 		auto arg = parse_primary_expression(arg_expr_scope.scope_begin(), arg_expr_scope.contained_end());
 		if (!arg.valid()) return arg;
-		arguments.push_back(arg.expected());
+		arguments.push_back(arg.extract());
 		scope_cursor.advance_to(arg.always()+1);
 	}
 
 	astnode args_node(astnode_enum::arguments_, scope.scope_begin(), scope.scope_end());
 	for (auto& arg : arguments) {
-		args_node.push_back(arg);
+		args_node.push_back(std::move(arg));
 	}
 
-	return expected_parse_result::make_success(scope.scope_end(), args_node);
+	return expected_parse_result::make_success(scope.scope_end(), std::move(args_node));
 }
 
 expected_parse_result parse_directive_type(tk_vector_cit begin, tk_vector_cit end) {
@@ -1384,10 +1548,10 @@ expected_parse_result parse_directive_type(tk_vector_cit begin, tk_vector_cit en
 	cursor.advance_to(statement.always());
 
 	astnode node(astnode_enum::type_alias_, cursor.begin(), cursor.get_it(),
-		alnumus_literal_type_name.expected(), statement.expected()
+		alnumus_literal_type_name.extract(), statement.extract()
 	);
 
-	return expected_parse_result::make_success(cursor.get_it(), node);
+	return expected_parse_result::make_success(cursor.get_it(), std::move(node));
 };
 
 expected_parse_result parse_directive_var(tk_vector_cit begin, tk_vector_cit end) {
@@ -1405,8 +1569,8 @@ expected_parse_result parse_directive_var(tk_vector_cit begin, tk_vector_cit end
 	cursor.advance();
 
 	if(cursor.type_is(tk_enum::eos_)) { // Anon Var Decl
-		astnode node{ astnode_enum::anon_variable_definition_, begin, cursor.get_it() ,variable_name.expected()};
-		return expected_parse_result::make_success(cursor.next().get_it(), node);
+		astnode node{ astnode_enum::anon_variable_definition_, begin, cursor.get_it() ,variable_name.extract()};
+		return expected_parse_result::make_success(cursor.next().get_it(), std::move(node));
 	}
 	else if (cursor.type_is(tk_enum::simple_assignment_)) { // Anon Var Decl Assignment
 		cursor.advance();
@@ -1416,9 +1580,9 @@ expected_parse_result parse_directive_var(tk_vector_cit begin, tk_vector_cit end
 				"parse_directive_var: Invalid var statement format. Assingment expression is invalid:" + expr.error_message()));
 		}
 		astnode node{ astnode_enum::anon_variable_definition_assingment_, begin, expr.always() ,
-			variable_name.expected(),
-			expr.expected() };
-		return expected_parse_result::make_success(expr.always(), node);
+			variable_name.extract(),
+			expr.extract() };
+		return expected_parse_result::make_success(expr.always(), std::move(node));
 	}
 	else if (cursor.type_is(tk_enum::alnumus_) or cursor.is_keyword_type()) { // Single Type Contrained Var Decl
 		auto type_operand = parse_operand(cursor.get_it(), end);
@@ -1430,9 +1594,9 @@ expected_parse_result parse_directive_var(tk_vector_cit begin, tk_vector_cit end
 
 		if(cursor.type_is(tk_enum::eos_)) {
 			astnode node{ astnode_enum::constrained_variable_definition_, begin, cursor.get_it() ,
-				variable_name.expected(),
-				type_operand.expected() };
-			return expected_parse_result::make_success(cursor.next().get_it(), node);
+				variable_name.extract(),
+				type_operand.extract() };
+			return expected_parse_result::make_success(cursor.next().get_it(), std::move(node));
 		}
 		else if (cursor.type_is(tk_enum::simple_assignment_)) {
 			cursor.advance();
@@ -1442,10 +1606,10 @@ expected_parse_result parse_directive_var(tk_vector_cit begin, tk_vector_cit end
 					"parse_directive_var: Invalid var statement format. Assingment expression is invalid:" + expr.error_message()));
 			}
 			astnode node{ astnode_enum::constrained_variable_definition_assingment_, begin, expr.always() ,
-				variable_name.expected(),
-				type_operand.expected(),
-				expr.expected() };
-			return expected_parse_result::make_success(expr.always(), node);
+				variable_name.extract(),
+				type_operand.extract(),
+				expr.extract() };
+			return expected_parse_result::make_success(expr.always(), std::move(node));
 		}
 		else {
 			return expected_parse_result::make_failure(cursor.get_it(), ca_error::parser::invalid_expression(cursor.get_it(),
@@ -1465,9 +1629,9 @@ expected_parse_result parse_directive_var(tk_vector_cit begin, tk_vector_cit end
 		// Expecting and eos or an assingment token.
 		if(cursor.type_is(tk_enum::eos_)) {
 			astnode node( astnode_enum::constrained_variable_definition_, begin, cursor.get_it() ,
-				variable_name.expected(),
+				variable_name.extract(),
 				astnode( astnode_enum::type_constraints_, frame_scope.scope_begin(), frame_scope.scope_end() ) );
-			return expected_parse_result::make_success(cursor.next().get_it(), node);
+			return expected_parse_result::make_success(cursor.next().get_it(), std::move(node));
 		}
 		else if (cursor.type_is(tk_enum::simple_assignment_)) {
 			cursor.advance();
@@ -1477,10 +1641,10 @@ expected_parse_result parse_directive_var(tk_vector_cit begin, tk_vector_cit end
 					"parse_directive_var: Invalid var statement format. Assingment expression is invalid:" + expr.error_message()));
 			}
 			astnode node( astnode_enum::constrained_variable_definition_assingment_, begin, expr.always() ,
-				variable_name.expected(),
+				variable_name.extract(),
 				astnode( astnode_enum::type_constraints_, frame_scope.contained_begin(), frame_scope.contained_end() ),
-				expr.expected() );
-			return expected_parse_result::make_success(expr.always(), node);
+				expr.extract() );
+			return expected_parse_result::make_success(expr.always(), std::move(node));
 		}
 		else {
 			return expected_parse_result::make_failure(cursor.get_it(), ca_error::parser::invalid_expression(cursor.get_it(),
@@ -1534,9 +1698,9 @@ expected_parse_result parse_directive_if(tk_vector_cit begin, tk_vector_cit end)
 				node = astnode{ astnode_enum::elif_, cursor.get_it(), if_block_scope.scope_end() };
 
 
-			node.push_back(expr.expected());
-			node.push_back(if_block.expected());
-			return expected_parse_result::make_success(if_block_scope.scope_end(), node);
+			node.push_back(expr.extract());
+			node.push_back(if_block.extract());
+			return expected_parse_result::make_success(if_block_scope.scope_end(), std::move(node));
 		}
 		else { // parsing an else block.
 			// Next is a functional block
@@ -1556,8 +1720,8 @@ expected_parse_result parse_directive_if(tk_vector_cit begin, tk_vector_cit end)
 			}
 
 			astnode node{ astnode_enum::else_, cursor.get_it(), if_block_scope.scope_end() };
-			node.push_back(if_block.expected());
-			return expected_parse_result::make_success( if_block_scope.scope_end(), node);
+			node.push_back(if_block.extract());
+			return expected_parse_result::make_success( if_block_scope.scope_end(), std::move(node));
 		}
 	};
 
@@ -1574,7 +1738,7 @@ expected_parse_result parse_directive_if(tk_vector_cit begin, tk_vector_cit end)
 	if (!if_block.valid()) {
 		return if_block; // error
 	}
-	node.push_back(if_block.expected());
+	node.push_back(if_block.extract());
 	cursor.advance_to(if_block.always());
 
 	// if no elif, or else, return the if block
@@ -1589,7 +1753,7 @@ expected_parse_result parse_directive_if(tk_vector_cit begin, tk_vector_cit end)
 		if (!elif_block.valid()) {
 			return elif_block; // error
 		}
-		node.push_back(elif_block.expected());
+		node.push_back(elif_block.extract());
 		cursor.advance_to(elif_block.always());
 	}
 
@@ -1599,7 +1763,7 @@ expected_parse_result parse_directive_if(tk_vector_cit begin, tk_vector_cit end)
 		if (!else_block.valid()) {
 			return else_block; // error
 		}
-		node.push_back(else_block.expected());
+		node.push_back(else_block.extract());
 		cursor.advance_to(else_block.always());
 
 		// expecting an eos
@@ -1615,7 +1779,7 @@ expected_parse_result parse_directive_if(tk_vector_cit begin, tk_vector_cit end)
 			"ParseDirectiveIf: Expected an else directive.");
 	}
 
-	return expected_parse_result::make_success(cursor.get_it(), node);
+	return expected_parse_result::make_success(cursor.get_it(), std::move(node));
 }
 
 expected_parse_result parse_directive_func(tk_vector_cit begin, tk_vector_cit end) {
@@ -1647,7 +1811,7 @@ expected_parse_result parse_directive_func(tk_vector_cit begin, tk_vector_cit en
 			}
 
 			auto arguments = astnode(astnode_enum::arguments_, arguments_scope.scope_begin(), arguments_scope.scope_end());
-			argscope = arguments;
+			argscope = std::move(arguments);
 			cursor.advance_to(arguments_scope.scope_end());
 		}
 
@@ -1658,7 +1822,7 @@ expected_parse_result parse_directive_func(tk_vector_cit begin, tk_vector_cit en
 				return expected_parse_result::make_failure(cursor.get_it(), ca_error::parser::invalid_expression(
 					cursor.get_it(), "parse_directive_func: Invalid type constraints."));
 			}
-			type_constraint = type_constraints.expected();
+			type_constraint = type_constraints.extract();
 			cursor.advance_to(type_constraints.always());
 		}
 		else if(cursor.type_is(tk_enum::open_frame_)) {
@@ -1669,25 +1833,36 @@ expected_parse_result parse_directive_func(tk_vector_cit begin, tk_vector_cit en
 			}
 
 			auto type_constraints = astnode(astnode_enum::type_constraints_, type_constraints_scope.scope_begin(), type_constraints_scope.scope_end());
-			type_constraint = type_constraints;
+			type_constraint = std::move(type_constraints);
 			cursor.advance_to(type_constraints_scope.scope_end());
 		}
 
-		auto functional_block = parse_functional_block(cursor.get_it(), cursor.end());
+		const parser_settings& settings = current_parser_settings();
+		auto functional_block = [&cursor, &settings]() {
+			if (!settings.lazy_function_bodies || settings.full_check)
+				return parse_functional_block(cursor.get_it(), cursor.end());
+			// Lazy mode: only find the end of the body, it is parsed on first call.
+			parser_scope_result body_scope = find_list_scope(cursor.get_it(), cursor.end());
+			if (!body_scope.valid)
+				return expected_parse_result::make_failure(cursor.get_it(), "parse_directive_func: Invalid functional block scope.");
+			return expected_parse_result::make_success(body_scope.scope_end(),
+				astnode{ astnode_enum::deferred_functional_block_, cursor.get_it(), body_scope.scope_end() });
+		}();
 		if (!functional_block.valid()) {
 			return expected_parse_result::make_failure(cursor.get_it(), ca_error::parser::invalid_expression(
 				cursor.get_it(), "parse_directive_func: Invalid functional block."));
 		}
 
 		astnode node{ astnode_enum::func_, begin, functional_block.always() };
-		node.push_back(capture_list);
-		node.push_back(func_name.expected());
+		node.children_unsafe().reserve(3 + (argscope.type() != astnode_enum::none_) + (type_constraint.type() != astnode_enum::none_));
+		node.push_back(std::move(capture_list));
+		node.push_back(func_name.extract());
 		if(argscope.type() != astnode_enum::none_)
-			node.push_back(argscope);
+			node.push_back(std::move(argscope));
 		if(type_constraint.type() != astnode_enum::none_)
-			node.push_back(type_constraint);
-		node.push_back(functional_block.expected());
-		return expected_parse_result::make_success(functional_block.always(), node);
+			node.push_back(std::move(type_constraint));
+		node.push_back(functional_block.extract());
+		return expected_parse_result::make_success(functional_block.always(), std::move(node));
 	}
 	else {
 		return expected_parse_result::make_failure(cursor.get_it(), ca_error::parser::invalid_expression(
@@ -1895,9 +2070,8 @@ expected_parse_result parse_directive_class(tk_vector_cit begin, tk_vector_cit e
 	// Everything within the list is a pragmatic block.
 	parser_scope_result class_scope = find_list_scope(*cursor, end);
 	if (class_scope.is_empty()) {
-		astnode node{ astnode_enum::class_definition_, begin, class_scope.scope_end() };
-		node.push_back(class_name.expected());
-		node.push_back({ astnode_enum::pragmatic_block_, class_scope.scope_begin(), class_scope.scope_end() });
+		astnode node{ astnode_enum::class_definition_, begin, class_scope.scope_end(), class_name.extract(),
+			astnode{ astnode_enum::pragmatic_block_, class_scope.scope_begin(), class_scope.scope_end() } };
 
 		// next should be an eos
 		if (class_scope.scope_end()->type() != tk_enum::eos_) {
@@ -1905,12 +2079,13 @@ expected_parse_result parse_directive_class(tk_vector_cit begin, tk_vector_cit e
 				"ParseDirectiveClass: Expected an eos."));
 		}
 
-		return expected_parse_result::make_success(class_scope.scope_end() + 1, node);
+		return expected_parse_result::make_success(class_scope.scope_end() + 1, std::move(node));
 	}
 
 	auto class_definition = parse_pragmatic_block(class_scope.scope_begin(), class_scope.scope_end());
 	if (!class_definition.valid()) {
-		return expected_parse_result::make_failure(class_definition.always(), ca_error::parser::invalid_expression(class_definition.always(),
+		// Chained so the cause in the body, ex. a depth limit, is reported too.
+		return class_definition.chain_failure(class_definition.always(), ca_error::parser::invalid_expression(class_definition.always(),
 			"ParseDirectiveClass: Invalid class definition."));
 	}
 
@@ -1920,17 +2095,201 @@ expected_parse_result parse_directive_class(tk_vector_cit begin, tk_vector_cit e
 			"ParseDirectiveClass: Expected an eos."));
 	}
 
-	astnode node{ astnode_enum::class_definition_, begin, class_scope.scope_end() };
-	node.push_back(class_name.expected());
-	node.push_back(class_definition.expected());
-	return expected_parse_result::make_success(class_scope.scope_end()+ 1, node);
+	astnode node{ astnode_enum::class_definition_, begin, class_scope.scope_end(), class_name.extract(), class_definition.extract() };
+	return expected_parse_result::make_success(class_scope.scope_end()+ 1, std::move(node));
 };
 
+expected_parse_result parse_pragmatic_statement(tk_vector_cit begin, tk_vector_cit end) {
+	// <statement> ::= <type> | <var> | <func> | <class>
+	if (begin->type_is(tk_enum::alnumus_)) { // Var Declaration
+		auto var_def = parse_directive_var(begin, end);
+		if (!var_def.valid()) {
+			return expected_parse_result::make_failure(var_def.always(), ca_error::parser::invalid_expression(
+				var_def.always(), "ParsePragmaticBlock: Invalid var definition." + var_def.error_message()));
+		}
+		return var_def;
+	}
+	else if (begin->type_is(tk_enum::open_frame_)) { // Function declaration.
+		auto func_def = parse_directive_func(begin, end);
+		if (!func_def.valid()) {
+			return expected_parse_result::make_failure(func_def.always(), ca_error::parser::invalid_expression(
+				func_def.always(), "ParsePragmaticBlock: Invalid function definition." + func_def.error_message()));
+		}
+		return func_def;
+	}
+	else if (begin->type_is(tk_enum::use_)) {
+		auto type_alias = parse_directive_type(begin, end);
+		if (!type_alias.valid()) {
+			return expected_parse_result::make_failure(type_alias.always(), ca_error::parser::invalid_expression(
+				type_alias.always(), "ParsePragmaticBlock: Invalid type alias." + type_alias.error_message()));
+		}
+		return type_alias;
+	}
+	else if (begin->type_is(tk_enum::class_)) { // Class declaration
+		auto class_decl = parse_directive_class(begin, end);
+		if (!class_decl.valid()) {
+			return expected_parse_result::make_failure(class_decl.always(), ca_error::parser::invalid_expression(
+				class_decl.always(), "ParsePragmaticBlock: Invalid class declaration." + class_decl.error_message()));
+		}
+		return class_decl;
+	}
+	else {
+		return expected_parse_result::make_failure(begin, ca_error::parser::invalid_expression(begin, "ParsePragmaticBlock: Invalid statement."));
+	}
+}
+
+// <@method:closes_function_body> True if it is the brace closing the body of the function definition starting at
+// statement_begin, scope_depth is the depth after it. A function definition, [captures] name (args) { body },
+// is the only statement which ends without an eos.
+bool closes_function_body(tk_vector_cit statement_begin, tk_vector_cit it, int scope_depth) {
+	return scope_depth == 0 && it->type_is(tk_enum::close_list_) && statement_begin->type_is(tk_enum::open_frame_);
+}
+
+// <@method:split_pragmatic_statements> Splits the contents of a pragmatic block into statement ranges.
+// A statement ends at the first eos which is not inside a (), [] or {} scope, a function definition at the
+// brace closing its body. Trailing tokens which are not closed are returned as an invalid range.
+scratch_vector<parser_scope_result> split_pragmatic_statements(tk_vector_cit begin, tk_vector_cit end) {
+	scratch_vector<parser_scope_result> statements;
+	int scope_depth = 0;
+	auto statement_begin = begin;
+	auto it = begin;
+	for (; it < end && it->type() != tk_enum::eof_; it++) {
+		switch (it->type()) {
+		case tk_enum::open_scope_: case tk_enum::open_frame_: case tk_enum::open_list_:
+			scope_depth++;
+			break;
+		case tk_enum::close_scope_: case tk_enum::close_frame_: case tk_enum::close_list_:
+			scope_depth--;
+			if (closes_function_body(statement_begin, it, scope_depth)) {
+				statements.push_back(parser_scope_result{ true, statement_begin, it + 1 });
+				statement_begin = it + 1;
+			}
+			break;
+		case tk_enum::eos_:
+			if (scope_depth == 0) {
+				statements.push_back(parser_scope_result{ true, statement_begin, it + 1 });
+				statement_begin = it + 1;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	if (statement_begin != it)
+		statements.push_back(parser_scope_result{ false, statement_begin, it });
+	return statements;
+}
+
+// <@method:count_block_statements> Number of statements in the contents of a block, see split_pragmatic_statements.
+// Block parsers reserve the children of the block with it, so the node is allocated once.
+sl_size count_block_statements(tk_vector_cit begin, tk_vector_cit end) {
+	sl_size count = 0;
+	int scope_depth = 0;
+	auto statement_begin = begin;
+	auto it = begin;
+	for (; it < end && it->type() != tk_enum::eof_; it++) {
+		switch (it->type()) {
+		case tk_enum::open_scope_: case tk_enum::open_frame_: case tk_enum::open_list_:
+			scope_depth++;
+			break;
+		case tk_enum::close_scope_: case tk_enum::close_frame_: case tk_enum::close_list_:
+			scope_depth--;
+			if (closes_function_body(statement_begin, it, scope_depth)) {
+				count++;
+				statement_begin = it + 1;
+			}
+			break;
+		case tk_enum::eos_:
+			if (scope_depth == 0) {
+				count++;
+				statement_begin = it + 1;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return statement_begin != it ? count + 1 : count;
+}
+
+// <@method:parse_pragmatic_statements_parallel> Parses each statement range on its own, on up to thread_count threads.
+// Every worker parses a contiguous run of statements into its own node buffer, the buffers are then moved
+// into the block in source order. Returns false if the block must be parsed serially instead: when a statement
+// fails or does not end where the split predicted, so that errors are reported exactly as by the serial parse.
+bool parse_pragmatic_statements_parallel(astnode& block, const scratch_vector<parser_scope_result>& statements, sl_size thread_count) {
+	// Below this many statements per thread the cost of starting a thread outweighs the parse.
+	SL_CXA min_statements_per_thread = 16;
+	for (const auto& statement : statements)
+		if (!statement.valid) return false;
+	const sl_size worker_count = std::min(thread_count, statements.size() / min_statements_per_thread);
+	if (worker_count < 2) return false;
+
+	struct chunk_result {
+		sl_vector<astnode> nodes;
+		bool complete{ false };
+		sl_exception_ptr exception;
+	};
+	sl_vector<chunk_result> chunks(worker_count);
+	const parser_settings settings = current_parser_settings();
+	// A memo is not shared between threads, each worker keeps its own over the same tokens.
+	sl_vector<sl_opt<parse_memo>> worker_memos(worker_count);
+	const sl_size caller_depth = parse_depth_guard::current();
+	auto parse_chunk = [&statements, &chunks, &settings, &worker_memos, worker_count, caller_depth](sl_size chunk_index) {
+		parse_depth_guard worker_depth(caller_depth);
+		parser_settings worker = settings;
+		if (settings.memo) worker.memo = &worker_memos[chunk_index].emplace(settings.memo->base());
+		parser_settings_scope worker_settings(worker);
+		chunk_result& chunk = chunks[chunk_index];
+		const sl_size first = statements.size() * chunk_index / worker_count;
+		const sl_size last = statements.size() * (chunk_index + 1) / worker_count;
+		try {
+			chunk.nodes.reserve(last - first);
+			for (sl_size i = first; i < last; i++) {
+				scratch_scope scratch;
+				auto statement = parse_pragmatic_statement(statements[i].scope_begin(), statements[i].scope_end());
+				if (!statement.valid() || statement.always() != statements[i].scope_end()) return;
+				chunk.nodes.push_back(statement.extract());
+			}
+			chunk.complete = true;
+		}
+		catch (...) {
+			chunk.exception = std::current_exception();
+		}
+	};
+
+	sl_vector<sl_thread> workers;
+	workers.reserve(worker_count - 1);
+	for (sl_size i = 1; i < worker_count; i++)
+		workers.emplace_back(parse_chunk, i);
+	parse_chunk(0);
+	for (auto& worker : workers)
+		worker.join();
+	if (settings.memo)
+		for (auto& memo : worker_memos)
+			settings.memo->add_stats(*memo);
+
+	for (auto& chunk : chunks)
+		if (!chunk.complete) return false;
+	block.children_unsafe().reserve(block.children().size() + statements.size());
+	for (auto& chunk : chunks)
+		for (auto& nd : chunk.nodes)
+			block.push_back(std::move(nd));
+	return true;
+}
+
 expected_parse_result parse_pragmatic_block(tk_vector_cit begin, tk_vector_cit end) {
+	return parse_pragmatic_block_parallel(begin, end, 1);
+}
+
+expected_parse_result parse_pragmatic_block_parallel(tk_vector_cit begin, tk_vector_cit end, sl_size thread_count) {
 	// Pragmatic blocks may contain statements starting with a directive or alnumus, ending in a semicolon.
 	// <pragmatic_block> ::= (<directive>|<alnumus>) <statement> <eos> ?
 	// <statement> ::= <type> | <var> | <func> | <class> | <identifier_statement>
 	auto it = begin;
+	parse_depth_guard depth;
+	if (depth.exceeded()) {
+		return expected_parse_result::make_failure(it, ca_error::parser::invalid_expression(it, "ParsePragmaticBlock: Blocks are nested deeper than the depth limit."));
+	}
 	// Find the list scope of the block.
 	std::next(it);
 	if(it->type() != tk_enum::open_list_) {
@@ -1944,7 +2303,7 @@ expected_parse_result parse_pragmatic_block(tk_vector_cit begin, tk_vector_cit e
 
 	if(block_scope.is_empty()) {
 		astnode node(astnode_enum::pragmatic_block_, block_scope.scope_begin(), block_scope.scope_end());
-		return expected_parse_result::make_success(block_scope.scope_end(), node);
+		return expected_parse_result::make_success(block_scope.scope_end(), std::move(node));
 		//return expected_parse_result::make_failure(it, ca_error::parser::invalid_expression(it, "ParsePragmaticBlock: Empty block."));
 	}
 		
@@ -1953,54 +2312,26 @@ expected_parse_result parse_pragmatic_block(tk_vector_cit begin, tk_vector_cit e
 	it = begin;
 	astnode node(astnode_enum::pragmatic_block_, begin, end);
 
-	// Find and parse all statements in the block.
-	while (it < end && it->type() != tk_enum::eof_) {
-		// Get the scope of the statement stating from the first token to the last matching semicolon.
-		parser_scope_result statement_scope;
+	// Statement extents only depend on the bracket structure, so they can be found up front and parsed independently.
+	if (thread_count > 1) {
+		auto statements = split_pragmatic_statements(begin, end);
+		if (parse_pragmatic_statements_parallel(node, statements, thread_count))
+			return expected_parse_result::make_success(statements.back().scope_end(), std::move(node));
+	}
 
-		if (it->type_is(tk_enum::alnumus_)) { // Var Declaration
-			auto var_def = parse_directive_var(it, end);
-			if (!var_def.valid()) {
-				return expected_parse_result::make_failure(var_def.always(), ca_error::parser::invalid_expression(
-					var_def.always(), "ParsePragmaticBlock: Invalid var definition." + var_def.error_message()));
-			}
-			node.push_back(var_def.expected());
-			it = var_def.always();
-		}
-		else if (it->type_is(tk_enum::open_frame_)) { // Function declaration.
-			auto func_def = parse_directive_func(it, end);
-			if (!func_def.valid()) {
-				return expected_parse_result::make_failure(func_def.always(), ca_error::parser::invalid_expression(
-					func_def.always(), "ParsePragmaticBlock: Invalid function definition." + func_def.error_message()));
-			}
-			node.push_back(func_def.expected());
-			it = func_def.always();
-		}
-		else if (it->type_is(tk_enum::use_)) {
-			auto type_alias = parse_directive_type(it, end);
-			if (!type_alias.valid()) {
-				return expected_parse_result::make_failure(type_alias.always(), ca_error::parser::invalid_expression(
-					type_alias.always(), "ParsePragmaticBlock: Invalid type alias." + type_alias.error_message()));
-			}
-			node.push_back(type_alias.expected());
-			it = type_alias.always();
-		
-		}
-		else if (it->type_is(tk_enum::class_)) { // Class declaration
-			auto class_decl = parse_directive_class(it, end);
-			if (!class_decl.valid()) {
-				return expected_parse_result::make_failure(class_decl.always(), ca_error::parser::invalid_expression(
-					class_decl.always(), "ParsePragmaticBlock: Invalid class declaration." + class_decl.error_message()));
-			}
-			node.push_back(class_decl.expected());
-			it = class_decl.always();
-		}
-		else {
-			return expected_parse_result::make_failure(it, ca_error::parser::invalid_expression(it, "ParsePragmaticBlock: Invalid statement."));
+	// Find and parse all statements in the block. Temporaries of a top level statement are freed at its end.
+	node.children_unsafe().reserve(count_block_statements(begin, end));
+	while (it < end && it->type() != tk_enum::eof_) {
+		scratch_scope scratch;
+		auto statement = parse_pragmatic_statement(it, end);
+		if (!statement.valid()) {
+			return statement;
 		}
+		it = statement.always();
+		node.push_back(statement.extract());
 	}
 
-	return expected_parse_result::make_success(it,node);
+	return expected_parse_result::make_success(it, std::move(node));
 }
 
 expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit end) {
@@ -2008,6 +2339,10 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 	// <pragmatic_block> ::= (<directive>|<alnumus>) <statement> <eos> ?
 	// <statement> ::= <type> | <var> | <func> | <class> | <identifier_statement>
 	auto it = begin;
+	parse_depth_guard depth;
+	if (depth.exceeded()) {
+		return expected_parse_result::make_failure(it, ca_error::parser::invalid_expression(it, "ParseFunctionalBlock: Blocks are nested deeper than the depth limit."));
+	}
 	// Find the list scope of the block.
 	std::next(it);
 	if (it->type() != tk_enum::open_list_) {
@@ -2028,8 +2363,10 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 	it = begin;
 	astnode node(astnode_enum::functional_block_, begin, end);
 
-	// Find and parse all statements in the block.
+	// Find and parse all statements in the block. Temporaries of a top level statement are freed at its end.
+	node.children_unsafe().reserve(count_block_statements(begin, end));
 	while (it < end && it->type() != tk_enum::eof_) {
+		scratch_scope scratch;
 		// Get the scope of the statement stating from the first token to the last matching semicolon.
 		parser_scope_result statement_scope;
 
@@ -2046,7 +2383,7 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 			if (!parse_result.valid()) {
 				throw std::runtime_error("ParsePragmaticBlock: Invalid statement." + parse_result.error_message());
 			}
-			node.push_back(parse_result.expected());
+			node.push_back(parse_result.extract());
 			it = parse_result.always();
 		};
 		auto parse_open_statement = [&it, &statement_scope, &end, &node](auto&& parsing_process, tk_enum open, tk_enum close)->void {
@@ -2062,7 +2399,7 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 			if (!parse_result.valid()) {
 				throw std::runtime_error("ParsePragmaticBlock: Invalid statement.");
 			}
-			node.push_back(parse_result.expected());
+			node.push_back(parse_result.extract());
 			it = parse_result.always();
 		};
 
@@ -2072,7 +2409,7 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 				return expected_parse_result::make_failure(var_def.always(), ca_error::parser::invalid_expression(
 					var_def.always(), "ParsePragmaticBlock: Invalid var definition." + var_def.error_message()));
 			}
-			node.push_back(var_def.expected());
+			node.push_back(var_def.extract());
 			it = var_def.always();
 		}
 		else if (it->type_is(tk_enum::open_frame_)) { // Function declaration.
@@ -2081,7 +2418,7 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 				return expected_parse_result::make_failure(func_def.always(), ca_error::parser::invalid_expression(
 					func_def.always(), "ParsePragmaticBlock: Invalid function definition." + func_def.error_message()));
 			}
-			node.push_back(func_def.expected());
+			node.push_back(func_def.extract());
 			it = func_def.always();
 		}
 		else if (it->type_is(tk_enum::use_)) {
@@ -2090,7 +2427,7 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 				return expected_parse_result::make_failure(type_alias.always(), ca_error::parser::invalid_expression(
 					type_alias.always(), "ParsePragmaticBlock: Invalid type alias." + type_alias.error_message()));
 			}
-			node.push_back(type_alias.expected());
+			node.push_back(type_alias.extract());
 			it = type_alias.always();
 
 		}
@@ -2100,7 +2437,7 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 				return expected_parse_result::make_failure(class_decl.always(), ca_error::parser::invalid_expression(
 					class_decl.always(), "ParsePragmaticBlock: Invalid class declaration." + class_decl.error_message()));
 			}
-			node.push_back(class_decl.expected());
+			node.push_back(class_decl.extract());
 			it = class_decl.always();
 		}
 		else {
@@ -2125,9 +2462,16 @@ expected_parse_result parse_functional_block(tk_vector_cit begin, tk_vector_cit
 		}
 	}
 
-	return expected_parse_result::make_success(block_scope.scope_end(), node);
+	return expected_parse_result::make_success(block_scope.scope_end(), std::move(node));
 }
 	
+expected_parse_result parse_deferred_block(const astnode& deferred) {
+	if (deferred.type() != astnode_enum::deferred_functional_block_ || !deferred.has_source()) {
+		return expected_parse_result::make_failure(deferred.source_begin(), "parse_deferred_block: Expected a deferred functional block.");
+	}
+	return parse_functional_block(deferred.source_begin(), deferred.source_end());
+}
+
 expected_parse_result parse_directive_on(tk_vector_cit begin, tk_vector_cit end) {
 	tk_cursor cursor(begin, end);
 
@@ -2161,7 +2505,7 @@ expected_parse_result parse_directive_on(tk_vector_cit begin, tk_vector_cit end)
 
 	// inside the on block , expecting #if directives.
 	auto conditional_it = on_block_scope.contained_begin();
-	sl_vector<astnode> conditionals;
+	scratch_vector<astnode> conditionals;
 	while(conditional_it < on_block_scope.contained_end()) {
 		if (conditional_it->type_is(tk_enum::if_)) {
 			auto cond = parse_directive_if(conditional_it, on_block_scope.contained_end());
@@ -2169,7 +2513,7 @@ expected_parse_result parse_directive_on(tk_vector_cit begin, tk_vector_cit end)
 				return cond; // error
 			}
 			conditional_it = cond.always();
-			conditionals.push_back(cond.expected());
+			conditionals.push_back(cond.extract());
 		}
 		else {
 			return expected_parse_result::make_failure(conditional_it,
@@ -2184,13 +2528,13 @@ expected_parse_result parse_directive_on(tk_vector_cit begin, tk_vector_cit end)
 	}
 
 	astnode node{ astnode_enum::on_, begin, on_block_scope.scope_end() };
-	node.push_back(expr.expected());
+	node.push_back(expr.extract());
 	node.push_back({astnode_enum::on_block_, on_block_scope.scope_begin(), on_block_scope.scope_end()});
 	for (auto& c : conditionals) {
-		node.push_back(c);
+		node.push_back(std::move(c));
 	}
 
-	return expected_parse_result::make_success(on_block_scope.scope_end() + 1, node);
+	return expected_parse_result::make_success(on_block_scope.scope_end() + 1, std::move(node));
 };
 
 expected_parse_result parse_directive_while(tk_vector_cit begin, tk_vector_cit end) {
@@ -2240,10 +2584,10 @@ expected_parse_result parse_directive_while(tk_vector_cit begin, tk_vector_cit e
 	}
 
 	astnode node{ astnode_enum::while_, begin, while_block_scope.scope_end() };
-	node.push_back(expr.expected());
-	node.push_back(while_block.expected());
+	node.push_back(expr.extract());
+	node.push_back(while_block.extract());
 
-	return expected_parse_result::make_success(while_block_scope.scope_end()+1, node);
+	return expected_parse_result::make_success(while_block_scope.scope_end()+1, std::move(node));
 }
 
 expected_parse_result parse_directive_for(tk_vector_cit begin, tk_vector_cit end) {
@@ -2264,14 +2608,14 @@ expected_parse_result parse_directive_for(tk_vector_cit begin, tk_vector_cit end
 	}
 
 	auto conditional_scope_statements = find_seperated_paren_scopes(conditional_scope,tk_enum::eos_);
-	sl_vector<astnode> conditions;
+	scratch_vector<astnode> conditions;
 	for (auto& s : conditional_scope_statements) {
 		auto expr = parse_primary_expression(s.contained_begin(), s.contained_end());
 		if (!expr.valid()) {
 		return expected_parse_result::make_failure(s.scope_begin()
 				, "Invalid #for conditional statement format. Expected an expression." + expr.error_message());
 		}
-		conditions.push_back(expr.expected());
+		conditions.push_back(expr.extract());
 	}
 
 	parser_scope_result for_block_scope = find_list_scope(conditional_scope.scope_end(), cursor.end());
@@ -2295,11 +2639,11 @@ expected_parse_result parse_directive_for(tk_vector_cit begin, tk_vector_cit end
 
 	astnode node{ astnode_enum::for_, begin, for_block_scope.scope_end()};
 	for (auto& c : conditions) {
-		node.push_back(c);
+		node.push_back(std::move(c));
 	}
-	node.push_back(for_block.expected());
+	node.push_back(for_block.extract());
 
-	return expected_parse_result::make_success(for_block_scope.scope_end() + 1, node);
+	return expected_parse_result::make_success(for_block_scope.scope_end() + 1, std::move(node));
 };
 
 expected_parse_result parse_directive_return(tk_vector_cit begin, tk_vector_cit end) {
@@ -2320,11 +2664,12 @@ expected_parse_result parse_directive_return(tk_vector_cit begin, tk_vector_cit
 	}
 
 	astnode node{ astnode_enum::return_, begin, value_statement.always() };
-	node.push_back(value_statement.expected());
-	return expected_parse_result::make_success(value_statement.always(), node);
+	node.push_back(value_statement.extract());
+	return expected_parse_result::make_success(value_statement.always(), std::move(node));
 }
  //Main paring method.
-astnode parse_program(tk_vector_cit begin, tk_vector_cit end) {
+// enter_thread_count: number of threads used to parse the top level statements of the #enter block.
+astnode parse_program(tk_vector_cit begin, tk_vector_cit end, sl_size enter_thread_count = 1) {
 	tk_cursor cursor(begin, end);
 	// Program will be in the form:
 	// #enter{}#start{}
@@ -2335,11 +2680,12 @@ astnode parse_program(tk_vector_cit begin, tk_vector_cit end) {
 
 	if (cursor.type_is(tk_enum::enter_)) {
 		auto program = astnode(astnode_enum::program_);
+		program.children_unsafe().reserve(2);
 		cursor.advance();
 		auto enter_scope = find_list(*cursor, end);
-		auto enter_block = parse_pragmatic_block(enter_scope.scope_begin(), enter_scope.scope_end());
+		auto enter_block = parse_pragmatic_block_parallel(enter_scope.scope_begin(), enter_scope.scope_end(), enter_thread_count);
 		if (enter_block.valid()) {
-			program.push_back(enter_block.expected());
+			program.push_back(enter_block.extract());
 		}
 		else {
 			throw std::runtime_error("parse_program: Invalid pragmatic block. Attempting to parse #enter block. Error:" + enter_block.error_message());
@@ -2352,7 +2698,7 @@ astnode parse_program(tk_vector_cit begin, tk_vector_cit end) {
 			auto start_scope = find_list(*cursor, end);
 			auto start_block = parse_functional_block(start_scope.scope_begin(), start_scope.scope_end());
 			if (start_block.valid()) {
-				program.push_back(start_block.expected());
+				program.push_back(start_block.extract());
 			}
 			else {
 				throw std::runtime_error("parse_program: Invalid functional block. Attempting to parse #start block. Error:" + enter_block.error_message());
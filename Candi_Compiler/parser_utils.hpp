@@ -13,6 +13,7 @@
 #include "tokenizer.hpp"
 #include "ast_node.hpp"
 #include "syntax_traits.hpp"
+#include "scratch_arena.hpp"
 
 namespace caoco {
 
@@ -111,11 +112,12 @@ namespace caoco {
 
 		// <@method:next> returns the current token on the cursor, if at end or before begin, returns eof token.
 		const tk& get() const {
+			static const tk eof_token{ tk_enum::eof_ };
 			if (it_ >= end_) {
-				return tk{ tk_enum::eof_ };
+				return eof_token;
 			}
 			else if (it_ < beg_) {
-				return tk{ tk_enum::eof_ };
+				return eof_token;
 			}
 			else
 				return *it_;
@@ -318,7 +320,7 @@ namespace caoco {
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		std::stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		auto last_open = begin;
 		auto last_closed = begin;
 
@@ -421,7 +423,7 @@ namespace caoco {
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		sl_stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		tk_cursor last_open = { begin, end };
 		tk_vector_cit last_closed = begin;
 		tk_vector_cit error_last_closed = begin;
@@ -544,7 +546,7 @@ namespace caoco {
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		sl_stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		tk_cursor last_open = { begin, end };
 		tk_vector_cit last_closed = begin;
 		tk_vector_cit error_last_closed = begin;
@@ -667,7 +669,7 @@ namespace caoco {
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		sl_stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		tk_cursor last_open = { begin, end };
 		tk_vector_cit last_closed = begin;
 		tk_vector_cit error_last_closed = begin;
@@ -789,13 +791,13 @@ namespace caoco {
 	}
 
 	// Method for extracting a seperated parentheses scope. (<separator>)
-	sl_vector<parser_scope_result> find_seperated_paren_scopes(tk_vector_cit begin, tk_vector_cit end, tk_enum separator) {
-		sl_vector< parser_scope_result> scopes;
+	scratch_vector<parser_scope_result> find_seperated_paren_scopes(tk_vector_cit begin, tk_vector_cit end, tk_enum separator) {
+		scratch_vector<parser_scope_result> scopes;
 		if (begin->type() != tk_enum::open_scope_) {
 			scopes.push_back(parser_scope_result{ false, begin, end });
 			return scopes;
 		}
-		sl_stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		tk_vector_cit last_closed = begin;
 		begin++; // Skip the open list token
 		for (auto i = begin; i < end;) {
@@ -827,18 +829,18 @@ namespace caoco {
 			sl::advance(i, 1);
 		}
 	}
-	sl_vector<parser_scope_result> find_seperated_paren_scopes(parser_scope_result ls, tk_enum separator) {
+	scratch_vector<parser_scope_result> find_seperated_paren_scopes(parser_scope_result ls, tk_enum separator) {
 		return find_seperated_paren_scopes(ls.scope_begin(), ls.scope_end(), separator);
 	}
 
 	// Method for extracting a seperated list scope. {<separator>}
-	sl_vector<parser_scope_result> find_seperated_list_scopes(tk_vector_cit begin, tk_vector_cit end, tk_enum separator) {
-		sl_vector< parser_scope_result> scopes;
+	scratch_vector<parser_scope_result> find_seperated_list_scopes(tk_vector_cit begin, tk_vector_cit end, tk_enum separator) {
+		scratch_vector<parser_scope_result> scopes;
 		if (begin->type() != tk_enum::open_list_) {
 			scopes.push_back(parser_scope_result{ false, begin, end });
 			return scopes;
 		}
-		sl_stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		tk_vector_cit last_closed = begin;
 		begin++; // Skip the open list token
 		for (auto i = begin; i < end;) {
@@ -870,18 +872,18 @@ namespace caoco {
 			sl::advance(i,1);
 		}
 	}
-	sl_vector<parser_scope_result> find_seperated_list_scopes(parser_scope_result ls, tk_enum separator) {
+	scratch_vector<parser_scope_result> find_seperated_list_scopes(parser_scope_result ls, tk_enum separator) {
 		return find_seperated_list_scopes(ls.scope_begin(), ls.scope_end(), separator);
 	}
 
 	// Method for extracting a seperated frame scope. [<separator>]
-	sl_vector<parser_scope_result> find_seperated_frame_scopes(tk_vector_cit begin, tk_vector_cit end, tk_enum separator) {
-		sl_vector< parser_scope_result> scopes;
+	scratch_vector<parser_scope_result> find_seperated_frame_scopes(tk_vector_cit begin, tk_vector_cit end, tk_enum separator) {
+		scratch_vector<parser_scope_result> scopes;
 		if (begin->type() != tk_enum::open_frame_) {
 			scopes.push_back(parser_scope_result{ false, begin, end });
 			return scopes;
 		}
-		sl_stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		tk_vector_cit last_closed = begin;
 		begin++; // Skip the open list token
 		for (auto i = begin; i < end;) {
@@ -913,7 +915,7 @@ namespace caoco {
 			sl::advance(i, 1);
 		}
 	}
-	sl_vector<parser_scope_result> find_seperated_frame_scopes(parser_scope_result ls, tk_enum separator) {
+	scratch_vector<parser_scope_result> find_seperated_frame_scopes(parser_scope_result ls, tk_enum separator) {
 		return find_seperated_frame_scopes(ls.scope_begin(), ls.scope_end(), separator);
 	}
 
@@ -925,7 +927,7 @@ namespace caoco {
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
 		//tk_enum currrent_scope_type = tk_enum::none_;
-		std::stack<tk_enum> scope_type_history;
+		scratch_stack<tk_enum> scope_type_history;
 		auto last_open = begin;
 		auto last_closed = begin;
 
@@ -0,0 +1,313 @@
+#pragma once
+#include "cand_syntax.hpp"
+#include "token_iterator.hpp"
+#include "compiler_error.hpp"
+#include "ast_arena.hpp"
+
+/// <pratt_tree_builders>
+/// Where a pratt parser puts the nodes it builds. heap_ast_builder builds a heap allocated ast, each node owns
+/// its children. arena_ast_builder builds into an ast_arena: a node is an index into the arena and linking a
+/// child writes an index, no node is allocated or moved on its own.
+/// </pratt_tree_builders>
+struct heap_ast_builder {
+	using node_type = ast;
+	ast make(const tk& t) { return ast{ t }; }
+	ast make(e_ast type) { return ast{ type }; }
+	void push_back(ast& parent, ast&& child) { parent.push_back(std::move(child)); }
+};
+
+struct arena_ast_builder {
+	using node_type = ast_arena::index_t;
+	ast_arena* arena{ nullptr };
+	node_type make(const tk& t) { return arena->make(t); }
+	node_type make(e_ast type) { return arena->make(type); }
+	void push_back(node_type parent, node_type child) { arena->push_back(parent, child); }
+};
+
+/// <pratt_parser>
+/// Single pass expression parser driven by the token tables in cand_syntax.hpp:
+/// binding power is read from tk_type_priority, associativity from tk_type_assoc and the
+/// position of an operator (prefix, binary or postfix) from tk_type_operation.
+/// Each token is visited once and subtrees are moved into their parent, parsing is linear in
+/// the length of the expression. The parser does not recurse: scopes, prefix operands and operators
+/// of higher priority are kept on a heap allocated work stack. An expression nested deeper than
+/// max_depth fails with a diagnostic, so machine generated input can't exhaust the memory or the
+/// stack of whoever walks the tree next.
+/// The tree is built by BuilderT, see pratt_tree_builders.
+/// </pratt_parser>
+template<typename BuilderT>
+class basic_pratt_parser {
+public:
+	using node_type = typename BuilderT::node_type;
+	using result_type = sl_expected<node_type>;
+	SL_CXS sl_size default_max_depth = 100000;
+private:
+	// Entries of the work stack.
+	// expr_: parses operators binding tighter than min_priority, node is its left operand.
+	// subexpression_: the expression above it must be followed by ')'.
+	// operator_: node takes the expression above it as its last operand.
+	// list_: node takes the expression above it as its next element, the list ends at close.
+	enum class e_frame { expr_, subexpression_, operator_, list_ };
+	struct frame {
+		e_frame kind;
+		int min_priority{ priority::e_priority::none_ };
+		node_type node{};
+		e_tk close{ e_tk::none_ };
+	};
+	// What the parse loop does next: parse an operand for the expr_ frame on top, apply the operators
+	// following its left operand, or hand a finished value to the frame on top.
+	enum class e_step { operand_, operators_, complete_ };
+	// Thrown by fail and caught by parse. Carries the unformatted diagnostic, a failed speculative parse
+	// neither allocates nor formats its message.
+	struct failure { sl_diagnostic diagnostic; };
+
+	tk_vector_cit begin_;
+	tk_vector_cit it_;
+	tk_vector_cit end_;
+	sl_size max_depth_;
+	sl_size depth_{ 0 };
+	sl_vector<frame> stack_;
+	BuilderT builder_;
+
+	// Tokens which end the expression or the current scope. Closing scopes are postfix operators
+	// in the token tables, so they must be checked before the operation.
+	static bool is_terminator(const tk& t) {
+		switch (t.type()) {
+		case e_tk::close_paren_: case e_tk::close_brace_: case e_tk::close_bracket_:
+		case e_tk::comma_: case e_tk::semicolon_: case e_tk::colon_:
+		case e_tk::eof_: case e_tk::none_:
+			return true;
+		default:
+			return false;
+		}
+	}
+	static bool is_scope_open(const tk& t) {
+		return t.type_is(e_tk::open_paren_) || t.type_is(e_tk::open_brace_) || t.type_is(e_tk::open_bracket_);
+	}
+
+	bool at_end() const { return it_ == end_ || is_terminator(*it_); }
+	// Location reported by errors, the last token when the range is exhausted.
+	tk_vector_cit error_location() const { return it_ != end_ ? it_ : std::prev(end_); }
+	[[noreturn]] void fail(const char* message) const {
+		throw failure{ compiler_error::parser::invalid_expression(error_location(), message) };
+	}
+	void expect(e_tk type, const char* message) {
+		if (it_ == end_ || !it_->type_is(type)) fail(message);
+		++it_;
+	}
+
+	// <@method:push_expr> Starts an expression of operators binding tighter than min_priority.
+	void push_expr(int min_priority) {
+		if (++depth_ > max_depth_) fail("Expression is nested deeper than the depth limit.");
+		stack_.push_back(frame{ e_frame::expr_, min_priority });
+	}
+
+	// <@method:open_list> Starts comma separated expressions up to the close token, the open token must
+	// already be consumed. An empty list is complete at once and returned in value.
+	e_step open_list(e_ast list_type, e_tk close, node_type& value) {
+		if (it_ != end_ && it_->type_is(close)) {
+			++it_;
+			value = builder_.make(list_type);
+			return e_step::complete_;
+		}
+		stack_.push_back(frame{ e_frame::list_, priority::e_priority::none_, builder_.make(list_type), close });
+		push_expr(priority::e_priority::none_);
+		return e_step::operand_;
+	}
+
+	// <@method:parse_operand> Parses the operand at the head- a literal, a prefix operation,
+	// a parenthesized subexpression or a generic list.
+	e_step parse_operand(node_type& value) {
+		if (at_end()) fail("Expected an operand.");
+		const tk& head = *it_;
+		if (head.type_is(e_tk::open_paren_)) {
+			++it_;
+			if (it_ != end_ && it_->type_is(e_tk::close_paren_)) fail("Empty subexpression.");
+			stack_.push_back(frame{ e_frame::subexpression_ });
+			push_expr(priority::e_priority::none_);
+			return e_step::operand_;
+		}
+		if (head.type_is(e_tk::open_brace_)) {
+			++it_;
+			return open_list(e_ast::generic_list_, e_tk::close_brace_, value);
+		}
+		switch (head.operation()) {
+		case e_operation::none_:
+			++it_;
+			value = builder_.make(head);
+			return e_step::complete_;
+		case e_operation::prefix_:
+			stack_.push_back(frame{ e_frame::operator_, priority::e_priority::none_, builder_.make(head) });
+			++it_;
+			push_expr(head.priority());
+			return e_step::operand_;
+		default:
+			fail("Operator is missing its left operand.");
+		}
+	}
+
+	// <@method:open_call> Moves the left operand into a call node and starts its argument list.
+	e_step open_call(e_ast call_type, e_ast list_type, e_tk close, node_type& value) {
+		node_type node = builder_.make(call_type);
+		builder_.push_back(node, std::move(stack_.back().node));
+		stack_.push_back(frame{ e_frame::operator_, priority::e_priority::none_, std::move(node) });
+		return open_list(list_type, close, value);
+	}
+
+	// <@method:parse_postfix> Applies the postfix operator at the head to the left operand.
+	// () is a function call, {} is an index operator and [] is a type call.
+	e_step parse_postfix(node_type& value) {
+		const tk& head = *it_;
+		++it_;
+		if (head.type_is(e_tk::open_paren_))
+			return open_call(e_ast::function_call_, e_ast::arguments_, e_tk::close_paren_, value);
+		if (head.type_is(e_tk::open_brace_))
+			return open_call(e_ast::index_operator_, e_ast::index_arguments_, e_tk::close_brace_, value);
+		if (head.type_is(e_tk::open_bracket_))
+			return open_call(e_ast::type_call_, e_ast::type_arguments_, e_tk::close_bracket_, value);
+		frame& top = stack_.back();
+		node_type node = builder_.make(head);
+		builder_.push_back(node, std::move(top.node));
+		top.node = std::move(node);
+		return e_step::operators_;
+	}
+
+	// <@method:parse_operators> Applies the operators following the left operand of the expr_ frame on top
+	// which bind tighter than its min_priority. The expression ends at the first one which doesn't.
+	e_step parse_operators(node_type& value) {
+		frame& top = stack_.back();
+		if (!at_end()) {
+			const tk& head = *it_;
+			const int binding = head.priority();
+			if (head.operation() == e_operation::binary_) {
+				if (binding > top.min_priority) {
+					node_type node = builder_.make(head);
+					++it_;
+					builder_.push_back(node, std::move(top.node));
+					stack_.push_back(frame{ e_frame::operator_, priority::e_priority::none_, std::move(node) });
+					// A right associative operator lets an operator of the same priority bind on its right.
+					push_expr(head.assoc() == e_assoc::right_ ? binding - 1 : binding);
+					return e_step::operand_;
+				}
+			}
+			else if (head.operation() == e_operation::postfix_ || is_scope_open(head)) {
+				if (binding > top.min_priority) return parse_postfix(value);
+			}
+			else if (head.operation() == e_operation::prefix_) {
+				fail("Prefix operator following an operand.");
+			}
+			else {
+				fail("Operand following an operand.");
+			}
+		}
+		value = std::move(top.node);
+		stack_.pop_back();
+		--depth_;
+		return e_step::complete_;
+	}
+
+	// <@method:complete> Hands the value of a finished operand or expression to the frame on top.
+	e_step complete(node_type& value) {
+		frame& top = stack_.back();
+		switch (top.kind) {
+		case e_frame::expr_:
+			top.node = std::move(value);
+			return e_step::operators_;
+		case e_frame::subexpression_:
+			expect(e_tk::close_paren_, "Expected ')' to close subexpression.");
+			stack_.pop_back();
+			return e_step::complete_;
+		case e_frame::operator_:
+			builder_.push_back(top.node, std::move(value));
+			value = std::move(top.node);
+			stack_.pop_back();
+			return e_step::complete_;
+		case e_frame::list_:
+			builder_.push_back(top.node, std::move(value));
+			if (it_ != end_ && it_->type_is(e_tk::comma_)) {
+				++it_;
+				push_expr(priority::e_priority::none_);
+				return e_step::operand_;
+			}
+			expect(top.close, "Expected ',' or end of scope in list.");
+			value = std::move(top.node);
+			stack_.pop_back();
+			return e_step::complete_;
+		}
+		fail("pratt_parser: Invalid work stack.");
+	}
+
+	// <@method:parse_expr> Parses one expression from it_ with the work stack.
+	node_type parse_expr() {
+		stack_.clear();
+		depth_ = 0;
+		push_expr(priority::e_priority::none_);
+		node_type value{};
+		e_step step = e_step::operand_;
+		while (true) {
+			switch (step) {
+			case e_step::operand_:
+				step = parse_operand(value);
+				break;
+			case e_step::operators_:
+				step = parse_operators(value);
+				break;
+			case e_step::complete_:
+				if (stack_.empty()) return value;
+				step = complete(value);
+				break;
+			}
+		}
+	}
+public:
+	basic_pratt_parser(tk_vector_cit begin, tk_vector_cit end, sl_size max_depth = default_max_depth, BuilderT builder = {})
+		: begin_(begin), it_(begin), end_(end), max_depth_(max_depth), builder_(builder) {}
+
+	// <@method:parse> Parses one expression from the start of the range. The expression ends at the
+	// end of the range or at a token which can't continue it, see position().
+	result_type parse() {
+		it_ = begin_;
+		if (begin_ == end_) return result_type::make_failure("pratt_parser: Empty expression.");
+		try {
+			return result_type::make_success(parse_expr());
+		}
+		catch (const failure& f) {
+			stack_.clear();
+			return result_type::make_failure(f.diagnostic);
+		}
+	}
+
+	// <@method:position> First token after the last parsed expression.
+	tk_vector_cit position() const { return it_; }
+	// <@method:max_depth> Deepest nesting of subexpressions, operands and lists the parser accepts.
+	sl_size max_depth() const { return max_depth_; }
+};
+
+using pratt_parser = basic_pratt_parser<heap_ast_builder>;
+using arena_pratt_parser = basic_pratt_parser<arena_ast_builder>;
+
+// <@method:parse_whole_range> Runs parser over its whole range, tokens left after the expression are an error.
+template<typename ParserT>
+typename ParserT::result_type parse_whole_range(ParserT& parser, tk_vector_cit end) {
+	auto result = parser.parse();
+	if (result.valid() && parser.position() != end && !parser.position()->type_is(e_tk::eof_))
+		return ParserT::result_type::make_failure(compiler_error::parser::invalid_expression(parser.position(),
+			"pratt_parser: Unexpected token after expression."));
+	return result;
+}
+
+// <@method:parse_expression_pratt> Parses the whole range as a single expression.
+// Nesting deeper than max_depth fails, see pratt_parser.
+pratt_parser::result_type parse_expression_pratt(tk_vector_cit begin, tk_vector_cit end,
+	sl_size max_depth = pratt_parser::default_max_depth) {
+	pratt_parser parser(begin, end, max_depth);
+	return parse_whole_range(parser, end);
+}
+
+// <@method:parse_expression_arena> Parses the whole range as a single expression into arena, returns the index
+// of its root. Nodes made before a parse fails stay in the arena unlinked until it is released.
+arena_pratt_parser::result_type parse_expression_arena(tk_vector_cit begin, tk_vector_cit end, ast_arena& arena,
+	sl_size max_depth = arena_pratt_parser::default_max_depth) {
+	arena_pratt_parser parser(begin, end, max_depth, arena_ast_builder{ &arena });
+	return parse_whole_range(parser, end);
+}
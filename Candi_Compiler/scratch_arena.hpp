@@ -0,0 +1,152 @@
+#pragma once
+#include <new>
+#include "global_dependencies.hpp"
+
+/// <scratch_arena>
+/// Per-thread bump allocator for parser temporaries: scope stacks, separated scope lists, argument lists.
+/// Memory is handed out from chunks which live as long as the thread. Freeing only gives the memory back when it
+/// is the last block handed out, so stack-like temporaries reuse the same bytes. Everything else is reclaimed at
+/// once when the outermost scratch_scope ends, the parser opens one per statement.
+/// Outside any scratch_scope allocations go to the heap, so scratch containers work anywhere.
+/// A scratch container must be destroyed on its thread, before the end of the scope it was created in, and must
+/// not grow inside a scope opened after it was created.
+/// </scratch_arena>
+class scratch_arena {
+	SL_CXS sl_size chunk_size = 64 * 1024;
+	struct chunk {
+		std::unique_ptr<std::byte[]> data;
+		sl_size size;
+	};
+	sl_vector<chunk> chunks_;
+	sl_size chunk_index_{ 0 };
+	sl_size offset_{ 0 };
+	sl_size depth_{ 0 };
+	sl_size in_use_{ 0 };
+	sl_size peak_{ 0 };
+	sl_size heap_allocations_{ 0 };
+
+	bool owns(const void* p) const {
+		const auto* byte = static_cast<const std::byte*>(p);
+		for (const auto& c : chunks_)
+			if (byte >= c.data.get() && byte < c.data.get() + c.size) return true;
+		return false;
+	}
+public:
+	scratch_arena() = default;
+	scratch_arena(const scratch_arena&) = delete;
+	scratch_arena& operator=(const scratch_arena&) = delete;
+
+	// <@method:local> The arena of the calling thread.
+	static scratch_arena& local() {
+		thread_local scratch_arena arena;
+		return arena;
+	}
+
+	// <@method:allocate> Returns bytes aligned to align, from the arena inside a scope and from the heap outside.
+	void* allocate(sl_size bytes, sl_size align) {
+		if (depth_ == 0) {
+			++heap_allocations_;
+			return ::operator new(bytes, std::align_val_t(align));
+		}
+		while (true) {
+			if (chunk_index_ < chunks_.size()) {
+				chunk& c = chunks_[chunk_index_];
+				const sl_size start = (offset_ + align - 1) / align * align;
+				if (start + bytes <= c.size) {
+					in_use_ += start + bytes - offset_;
+					peak_ = std::max(peak_, in_use_);
+					offset_ = start + bytes;
+					return c.data.get() + start;
+				}
+				// The rest of a chunk too small for the request stays unused until the arena is rewound.
+				in_use_ += c.size - offset_;
+				++chunk_index_;
+				offset_ = 0;
+				continue;
+			}
+			const sl_size size = std::max(chunk_size, bytes + align);
+			chunks_.push_back(chunk{ std::make_unique<std::byte[]>(size), size });
+		}
+	}
+
+	// <@method:deallocate> Gives back a block. Arena memory is reused at once only if it is the last block.
+	void deallocate(void* p, sl_size bytes, sl_size align) noexcept {
+		if (!owns(p)) {
+			::operator delete(p, std::align_val_t(align));
+			return;
+		}
+		chunk& c = chunks_[chunk_index_];
+		auto* byte = static_cast<std::byte*>(p);
+		if (byte + bytes == c.data.get() + offset_) {
+			const sl_size start = static_cast<sl_size>(byte - c.data.get());
+			in_use_ -= offset_ - start;
+			offset_ = start;
+		}
+	}
+
+	// <@method:enter> Opens a scope, see scratch_scope.
+	void enter() { ++depth_; }
+	// <@method:leave> Closes a scope. Closing the outermost one rewinds the arena, keeping its chunks.
+	void leave() {
+		if (--depth_ == 0) {
+			chunk_index_ = 0;
+			offset_ = 0;
+			in_use_ = 0;
+		}
+	}
+
+	bool in_scope() const { return depth_ > 0; }
+	// <@method:bytes_in_use> Bytes handed out since the outermost scope was opened.
+	sl_size bytes_in_use() const { return in_use_; }
+	// <@method:peak_bytes> Most bytes in use at once since the thread started.
+	sl_size peak_bytes() const { return peak_; }
+	// <@method:reserved_bytes> Bytes held in chunks.
+	sl_size reserved_bytes() const {
+		sl_size total = 0;
+		for (const auto& c : chunks_) total += c.size;
+		return total;
+	}
+	// <@method:heap_allocations> Allocations made outside any scope.
+	sl_size heap_allocations() const { return heap_allocations_; }
+};
+
+/// <scratch_scope>
+/// Routes scratch allocations of the calling thread to its scratch_arena until the end of the scope.
+/// Scopes nest, the arena is rewound when the outermost one ends.
+/// </scratch_scope>
+class scratch_scope {
+public:
+	scratch_scope() { scratch_arena::local().enter(); }
+	~scratch_scope() { scratch_arena::local().leave(); }
+	scratch_scope(const scratch_scope&) = delete;
+	scratch_scope& operator=(const scratch_scope&) = delete;
+};
+
+/// <scratch_allocator>
+/// Standard allocator over the scratch_arena of the calling thread.
+/// </scratch_allocator>
+template<class T>
+struct scratch_allocator {
+	using value_type = T;
+	scratch_allocator() noexcept = default;
+	template<class U>
+	scratch_allocator(const scratch_allocator<U>&) noexcept {}
+
+	T* allocate(sl_size n) {
+		return static_cast<T*>(scratch_arena::local().allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* p, sl_size n) noexcept {
+		scratch_arena::local().deallocate(p, n * sizeof(T), alignof(T));
+	}
+	template<class U>
+	bool operator==(const scratch_allocator<U>&) const noexcept { return true; }
+};
+
+template<class T>
+using scratch_vector = sl_vector<T, scratch_allocator<T>>;
+
+template<class T>
+using scratch_stack = sl_stack<T, scratch_vector<T>>;
+
+template<class T>
+using scratch_list = sl_list<T, scratch_allocator<T>>;
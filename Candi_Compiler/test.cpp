@@ -1,9 +1,19 @@
 #include "pch.h"
+#define CAOCO_EVAL_COUNTERS 1 // The evaluator tests check the work counters in every build.
+#include <filesystem>
 #include "global_dependencies.hpp"
 #include "cand_syntax.hpp"
 #include "tokenizer.hpp"
 #include "parenthesizer.hpp"
+#include "ast_arena.hpp"
+#include "ast_image.hpp"
+#include "incremental_frontend.hpp"
+#include "ast_node.hpp"
+#include "parser.hpp"
 #include "LLK_parser.hpp"
+#include "constant_evaluator.hpp"
+#include "constant_evaluator_vm.hpp"
+#include "constant_folder.hpp"
 
 // Google Test will not do check on caoco::sl_u8string, so we need to define the << operator for char8_t
 std::ostream& operator<<(std::ostream& os, char8_t u8) {
@@ -17,16 +27,72 @@ std::ostream& operator<<(std::ostream& os, const char8_t* u8_cstr) {
 	return os;
 }
 
+// Heap memory of the current thread, kept by the replacement operator new and delete below.
+// Each block carries its size in front of it so live bytes can be tracked.
+struct heap_usage {
+	SL_CXS sl_size header_size = alignof(std::max_align_t);
+	sl_size allocations{ 0 };
+	sl_size live_bytes{ 0 };
+
+	static heap_usage& local() {
+		thread_local heap_usage usage;
+		return usage;
+	}
+	// Allocations made since the snapshot, and the change in live bytes.
+	heap_usage since(const heap_usage& snapshot) const { return { allocations - snapshot.allocations, live_bytes - snapshot.live_bytes }; }
+};
+
+void* operator new(std::size_t size) {
+	auto* block = static_cast<std::byte*>(std::malloc(size + heap_usage::header_size));
+	if (!block) throw std::bad_alloc();
+	std::memcpy(block, &size, sizeof(size));
+	auto& usage = heap_usage::local();
+	usage.allocations++;
+	usage.live_bytes += size;
+	return block + heap_usage::header_size;
+}
+
+void operator delete(void* memory) noexcept {
+	if (!memory) return;
+	auto* block = static_cast<std::byte*>(memory) - heap_usage::header_size;
+	std::size_t size;
+	std::memcpy(&size, block, sizeof(size));
+	heap_usage::local().live_bytes -= size;
+	std::free(block);
+}
+
+void operator delete(void* memory, std::size_t) noexcept { operator delete(memory); }
+
 #define CAOCO_TEST_ALL 1
 #define CAOCO_TEST_NONE 0
 #define CAOCO_TEST_TOKENIZER 1
 #define CAOCO_TEST_PARENTHESIZER 1
+#define CAOCO_TEST_PRATT_PARSER 1
+#define CAOCO_TEST_INCREMENTAL_FRONTEND 1
 #define CAOCO_TEST_PARSER_BASIC 0
 #define CAOCO_TEST_PARSER_UTILS 1
+#define CAOCO_TEST_AST 1
 #define CAOCO_TEST_PARSER_STATEMENTS 0
+#define CAOCO_TEST_PARSER_PARALLEL 1
+#define CAOCO_TEST_PARSER_LAZY 1
+#define CAOCO_TEST_PARSER_PACKRAT 1
+#define CAOCO_TEST_PARSER_LLK 1
+#define CAOCO_TEST_PARSER_NESTING 1
+#define CAOCO_TEST_PARSER_SCRATCH 1
+#define CAOCO_TEST_PARSER_DIAGNOSTICS 1
+#define CAOCO_TEST_RESULT_TYPES 1
 #define CAOCO_TEST_PARSER_PROGRAM 0
 #define CAOCO_TEST_PREPROCESSOR 0
 #define CAOCO_TEST_CONST_EVALUATOR 0
+#define CAOCO_TEST_RTVALUE 1
+#define CAOCO_TEST_CONST_EVALUATOR_VM 1
+#define CAOCO_TEST_CONST_EVALUATOR_BINOP 1
+#define CAOCO_TEST_CONSTANT_FOLDING 1
+#define CAOCO_TEST_CONST_EVALUATOR_MEMO 1
+#define CAOCO_TEST_CONST_EVALUATOR_CALLS 1
+#define CAOCO_TEST_CONST_EVALUATOR_ENV 1
+#define CAOCO_TEST_CONST_EVALUATOR_SHAPES 1
+#define CAOCO_TEST_BENCHMARK 1
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Tokenizer Tests
@@ -806,6 +872,706 @@ TEST(ExtensiveUnaryBinaryPostifxCombinedClosures, LARPARSER) {
 	}
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pratt Parser Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_PRATT_PARSER
+#define CAOCO_TEST_PRATT_PARSER_SingleOperand 1
+#define CAOCO_TEST_PRATT_PARSER_SingleOperation 1
+#define CAOCO_TEST_PRATT_PARSER_ChainOperation 1
+#define CAOCO_TEST_PRATT_PARSER_ComplexOperation 1
+#define CAOCO_TEST_PRATT_PARSER_DeepNesting 1
+#endif
+
+// Tokenizes the source and parses all of it as one expression.
+pratt_parser::result_type pratt_parse_u8(const char8_t* source, sl_size max_depth = pratt_parser::default_max_depth) {
+	auto input_vec = sl::to_u8vec(source);
+	auto tokens = tokenizer(input_vec.cbegin(), input_vec.cend())();
+	if (!tokens.valid()) return pratt_parser::result_type::make_failure(tokens.error_message());
+	const auto& tk_vec = tokens.expected();
+	auto result = parse_expression_pratt(tk_vec.cbegin(), tk_vec.cend(), max_depth);
+	// Formatted while the tokens its diagnostic refers to are alive.
+	if (!result.valid()) return pratt_parser::result_type::make_failure(result.error_message());
+	return result;
+}
+
+bool ast_equal(const ast& a, const ast& b) {
+	if (a.type() != b.type() || a.literal() != b.literal() || a.size() != b.size()) return false;
+	for (sl_size i = 0; i < a.size(); i++)
+		if (!ast_equal(a[i], b[i])) return false;
+	return true;
+}
+
+bool test_pratt_parse(const char8_t* source, const ast& expected) {
+	auto result = pratt_parse_u8(source);
+	if (!result.valid()) {
+		std::cout << result.error_message() << std::endl;
+		return false;
+	}
+	if (!ast_equal(result.expected(), expected)) {
+		std::cout << "Expected:" << std::endl;
+		print_ast(expected);
+		std::cout << "Got:" << std::endl;
+		print_ast(result.expected());
+		return false;
+	}
+	return true;
+}
+
+ast alnumus(const char8_t* name) { return ast{ e_ast::alnumus_, name }; }
+ast number(const char8_t* value) { return ast{ e_ast::number_literal_, value }; }
+ast call(ast callee) { return ast{ e_ast::function_call_, u8"", std::move(callee), ast{ e_ast::arguments_ } }; }
+
+#if CAOCO_TEST_PRATT_PARSER_SingleOperand
+TEST(ut_Pratt_Expression_SingleOperand, Literals) {
+	EXPECT_TRUE(test_pratt_parse(u8"1", number(u8"1")));
+	EXPECT_TRUE(test_pratt_parse(u8"1.1", ast(e_ast::real_literal_, u8"1.1")));
+	EXPECT_TRUE(test_pratt_parse(u8"1u", ast(e_ast::unsigned_literal_, u8"1u")));
+	EXPECT_TRUE(test_pratt_parse(u8"1b", ast(e_ast::bit_literal_, u8"1b")));
+	EXPECT_TRUE(test_pratt_parse(u8"1c", ast(e_ast::byte_literal_, u8"1c")));
+	EXPECT_TRUE(test_pratt_parse(u8"'hello'", ast(e_ast::string_literal_, u8"'hello'")));
+	EXPECT_TRUE(test_pratt_parse(u8"foo", alnumus(u8"foo")));
+}
+
+TEST(ut_Pratt_Expression_SingleOperand, ValueInBrackets) {
+	EXPECT_TRUE(test_pratt_parse(u8"(1)", number(u8"1")));
+	EXPECT_TRUE(test_pratt_parse(u8"((1))", number(u8"1")));
+}
+#endif
+
+#if CAOCO_TEST_PRATT_PARSER_SingleOperation
+TEST(ut_Pratt_Expression_SingleOperation, Binary) {
+	EXPECT_TRUE(test_pratt_parse(u8"1 + 1", ast(e_ast::addition_, u8"+", number(u8"1"), number(u8"1"))));
+}
+
+TEST(ut_Pratt_Expression_SingleOperation, EmptyScopeIsAnError) {
+	EXPECT_FALSE(pratt_parse_u8(u8"()").valid());
+}
+
+TEST(ut_Pratt_Expression_SingleOperation, FunctionCall) {
+	EXPECT_TRUE(test_pratt_parse(u8"foo()", call(alnumus(u8"foo"))));
+	EXPECT_TRUE(test_pratt_parse(u8"foo(1, a + 1)", ast(e_ast::function_call_, u8"", alnumus(u8"foo"),
+		ast(e_ast::arguments_, u8"", number(u8"1"), ast(e_ast::addition_, u8"+", alnumus(u8"a"), number(u8"1"))))));
+}
+
+TEST(ut_Pratt_Expression_SingleOperation, IndexAndTypeCall) {
+	EXPECT_TRUE(test_pratt_parse(u8"a{1}", ast(e_ast::index_operator_, u8"", alnumus(u8"a"),
+		ast(e_ast::index_arguments_, u8"", number(u8"1")))));
+	EXPECT_TRUE(test_pratt_parse(u8"a[b]", ast(e_ast::type_call_, u8"", alnumus(u8"a"),
+		ast(e_ast::type_arguments_, u8"", alnumus(u8"b")))));
+}
+
+TEST(ut_Pratt_Expression_SingleOperation, Unary) {
+	EXPECT_TRUE(test_pratt_parse(u8"!1", ast(e_ast::negation_, u8"!", number(u8"1"))));
+}
+
+TEST(ut_Pratt_Expression_SingleOperation, Postfix) {
+	EXPECT_TRUE(test_pratt_parse(u8"a++", ast(e_ast::increment_, u8"++", alnumus(u8"a"))));
+}
+#endif
+
+#if CAOCO_TEST_PRATT_PARSER_ChainOperation
+TEST(ut_Pratt_Expression_ChainOperation, BinaryDiffPriority) {
+	EXPECT_TRUE(test_pratt_parse(u8"1 + 1 * 1", ast(e_ast::addition_, u8"+", number(u8"1"),
+		ast(e_ast::multiplication_, u8"*", number(u8"1"), number(u8"1")))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, LogicalOperators) {
+	EXPECT_TRUE(test_pratt_parse(u8"a || b && c", ast(e_ast::logical_and_, u8"&&",
+		ast(e_ast::logical_or_, u8"||", alnumus(u8"a"), alnumus(u8"b")), alnumus(u8"c"))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, Scopes) {
+	EXPECT_TRUE(test_pratt_parse(u8"(1 + 1) * 1", ast(e_ast::multiplication_, u8"*",
+		ast(e_ast::addition_, u8"+", number(u8"1"), number(u8"1")), number(u8"1"))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, AssingmentIsRightAssoc) {
+	EXPECT_TRUE(test_pratt_parse(u8"a = b = c", ast(e_ast::simple_assignment_, u8"=", alnumus(u8"a"),
+		ast(e_ast::simple_assignment_, u8"=", alnumus(u8"b"), alnumus(u8"c")))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, SumIsLeftAssoc) {
+	EXPECT_TRUE(test_pratt_parse(u8"a + b - c", ast(e_ast::subtraction_, u8"-",
+		ast(e_ast::addition_, u8"+", alnumus(u8"a"), alnumus(u8"b")), alnumus(u8"c"))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, MemberAccessIsLeftAssoc) {
+	EXPECT_TRUE(test_pratt_parse(u8"a.b.c", ast(e_ast::period_, u8".",
+		ast(e_ast::period_, u8".", alnumus(u8"a"), alnumus(u8"b")), alnumus(u8"c"))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, BinaryAfterUnaryIsAnError) {
+	EXPECT_FALSE(pratt_parse_u8(u8"!+1").valid());
+	EXPECT_FALSE(pratt_parse_u8(u8"1 +").valid());
+	EXPECT_FALSE(pratt_parse_u8(u8"a b").valid());
+	EXPECT_FALSE(pratt_parse_u8(u8"(a + b").valid());
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, UnaryRepeated) {
+	EXPECT_TRUE(test_pratt_parse(u8"!!1", ast(e_ast::negation_, u8"!", ast(e_ast::negation_, u8"!", number(u8"1")))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, UnaryThenBinary) {
+	EXPECT_TRUE(test_pratt_parse(u8"!1 + 1", ast(e_ast::addition_, u8"+",
+		ast(e_ast::negation_, u8"!", number(u8"1")), number(u8"1"))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, UnaryThenHigherPriority) {
+	EXPECT_TRUE(test_pratt_parse(u8"!1 * 1", ast(e_ast::multiplication_, u8"*",
+		ast(e_ast::negation_, u8"!", number(u8"1")), number(u8"1"))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, UnaryAfterBinary) {
+	EXPECT_TRUE(test_pratt_parse(u8"1 + !1", ast(e_ast::addition_, u8"+", number(u8"1"),
+		ast(e_ast::negation_, u8"!", number(u8"1")))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, UnaryThenFunctionCall) {
+	EXPECT_TRUE(test_pratt_parse(u8"!foo()", ast(e_ast::negation_, u8"!", call(alnumus(u8"foo")))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, FunctionCallThenBinary) {
+	EXPECT_TRUE(test_pratt_parse(u8"foo() + 1", ast(e_ast::addition_, u8"+", call(alnumus(u8"foo")), number(u8"1"))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, BinaryDotOperatorThenFunctionCall) {
+	EXPECT_TRUE(test_pratt_parse(u8"foo.bar()", call(ast(e_ast::period_, u8".", alnumus(u8"foo"), alnumus(u8"bar")))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, BinaryThenFunctionCall) {
+	EXPECT_TRUE(test_pratt_parse(u8"1 + foo()", ast(e_ast::addition_, u8"+", number(u8"1"), call(alnumus(u8"foo")))));
+}
+
+TEST(ut_Pratt_Expression_ChainOperation, MemberAccessWithFunctionCall) {
+	// a.b().c is parsed as (a.b()).c
+	EXPECT_TRUE(test_pratt_parse(u8"a.b().c", ast(e_ast::period_, u8".",
+		call(ast(e_ast::period_, u8".", alnumus(u8"a"), alnumus(u8"b"))), alnumus(u8"c"))));
+}
+#endif
+
+#if CAOCO_TEST_PRATT_PARSER_ComplexOperation
+TEST(ut_Pratt_Expression_ComplexOperation, Operation) {
+	EXPECT_TRUE(test_pratt_parse(u8"foo.bar() + 1 * 1", ast(e_ast::addition_, u8"+",
+		call(ast(e_ast::period_, u8".", alnumus(u8"foo"), alnumus(u8"bar"))),
+		ast(e_ast::multiplication_, u8"*", number(u8"1"), number(u8"1")))));
+}
+
+TEST(ut_Pratt_Expression_ComplexOperation, OperationWithScopes) {
+	EXPECT_TRUE(test_pratt_parse(u8"(foo.bar() + 1) * 1", ast(e_ast::multiplication_, u8"*",
+		ast(e_ast::addition_, u8"+", call(ast(e_ast::period_, u8".", alnumus(u8"foo"), alnumus(u8"bar"))), number(u8"1")),
+		number(u8"1"))));
+}
+
+TEST(ut_Pratt_Expression_ComplexOperation, MatchesParenthesizerOrder) {
+	// !!!!!!(foo).bar[aa] + 1 * a.google{1}++++++++
+	auto bar = ast(e_ast::type_call_, u8"", ast(e_ast::period_, u8".", alnumus(u8"foo"), alnumus(u8"bar")),
+		ast(e_ast::type_arguments_, u8"", alnumus(u8"aa")));
+	ast lhs = std::move(bar);
+	for (int i = 0; i < 6; i++) lhs = ast(e_ast::negation_, u8"!", std::move(lhs));
+	ast rhs = ast(e_ast::index_operator_, u8"", ast(e_ast::period_, u8".", alnumus(u8"a"), alnumus(u8"google")),
+		ast(e_ast::index_arguments_, u8"", number(u8"1")));
+	for (int i = 0; i < 4; i++) rhs = ast(e_ast::increment_, u8"++", std::move(rhs));
+	EXPECT_TRUE(test_pratt_parse(u8"!!!!!!(foo).bar[aa] + 1 * a.google{1}++++++++",
+		ast(e_ast::addition_, u8"+", std::move(lhs), ast(e_ast::multiplication_, u8"*", number(u8"1"), std::move(rhs)))));
+}
+#endif
+
+#if CAOCO_TEST_PRATT_PARSER_DeepNesting
+TEST(ut_Pratt_Expression_DeepNesting, Parentheses) {
+	const sl_size depth = 50000;
+	sl_u8string source(depth, u8'(');
+	source += u8"1";
+	source.append(depth, u8')');
+	source += u8" + 1";
+	auto result = pratt_parse_u8(source.c_str());
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	EXPECT_TRUE(ast_equal(result.expected(), ast(e_ast::addition_, u8"+", number(u8"1"), number(u8"1"))));
+}
+TEST(ut_Pratt_Expression_DeepNesting, PrefixOperators) {
+	const sl_size depth = 50000;
+	sl_u8string source(depth, u8'!');
+	source += u8"1";
+	auto result = pratt_parse_u8(source.c_str());
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	sl_size levels = 0;
+	const ast* node = &result.expected();
+	for (; !node->leaf(); node = &(*node)[0]) levels++;
+	EXPECT_EQ(levels, depth);
+	EXPECT_TRUE(node->literal() == u8"1");
+}
+TEST(ut_Pratt_Expression_DeepNesting, DepthLimit) {
+	sl_u8string nested(20, u8'(');
+	nested += u8"1";
+	nested.append(20, u8')');
+	EXPECT_TRUE(pratt_parse_u8(nested.c_str(), 21).valid());
+	auto result = pratt_parse_u8(nested.c_str(), 20);
+	ASSERT_FALSE(result.valid());
+	EXPECT_NE(result.error_message().find("depth limit"), sl_string::npos);
+	// Arguments and prefix operands count as nesting too.
+	EXPECT_FALSE(pratt_parse_u8(u8"f(g(h(1)))", 3).valid());
+	EXPECT_FALSE(pratt_parse_u8(u8"!!!1", 3).valid());
+	EXPECT_TRUE(pratt_parse_u8(u8"!!!1", 4).valid());
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Incremental Frontend Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_INCREMENTAL_FRONTEND
+#define CAOCO_TEST_INCREMENTAL_FRONTEND_MatchesRebuild 1
+#define CAOCO_TEST_INCREMENTAL_FRONTEND_TopLevelBlocks 1
+#endif
+
+#if CAOCO_TEST_INCREMENTAL_FRONTEND_MatchesRebuild || CAOCO_TEST_INCREMENTAL_FRONTEND_TopLevelBlocks
+// Compares an edited buffer against a fresh tokenize and parse of the same source.
+void expect_same_as_rebuild(const incremental_frontend& edited) {
+	incremental_frontend fresh(edited.source());
+	ASSERT_EQ(edited.valid(), fresh.valid());
+	ASSERT_EQ(edited.size(), fresh.size());
+	const tk_vector edited_tokens = edited.tokens();
+	const tk_vector fresh_tokens = fresh.tokens();
+	ASSERT_EQ(edited_tokens.size(), fresh_tokens.size());
+	for (sl_size i = 0; i < fresh_tokens.size(); i++) {
+		const tk& a = edited_tokens[i];
+		const tk& b = fresh_tokens[i];
+		EXPECT_TRUE(a == b) << "token " << i;
+		EXPECT_EQ(a.offset(), b.offset()) << "token " << i;
+		EXPECT_EQ(a.line(), b.line()) << "token " << i;
+	}
+	ASSERT_EQ(edited.statement_count(), fresh.statement_count());
+	for (sl_size i = 0; i < fresh.statement_count(); i++) {
+		const auto& a = edited.statement_at(i);
+		const auto& b = fresh.statement_at(i);
+		EXPECT_EQ(edited.statement_start(i).bytes, fresh.statement_start(i).bytes) << "statement " << i;
+		EXPECT_EQ(edited.statement_start(i).tokens, fresh.statement_start(i).tokens) << "statement " << i;
+		EXPECT_EQ(a.tokens.size(), b.tokens.size()) << "statement " << i;
+		ASSERT_EQ(a.tree.valid(), b.tree.valid()) << "statement " << i;
+		if (b.tree.valid()) {
+			EXPECT_TRUE(ast_equal(a.tree.expected(), b.tree.expected())) << "statement " << i;
+		}
+	}
+}
+#endif
+
+#if CAOCO_TEST_INCREMENTAL_FRONTEND_MatchesRebuild
+TEST(ut_Incremental_Frontend, MatchesRebuild) {
+	sl_u8string source;
+	for (int i = 0; i < 1000; i++) source += u8"a = b + 1;\nfoo(x, y) * 2;\n";
+	incremental_frontend buffer(sl_char8_vector(source.begin(), source.end()));
+	ASSERT_TRUE(buffer.valid()) << buffer.error_message();
+	ASSERT_EQ(buffer.statement_count(), 2000);
+
+	// Edit an operand in the middle of the buffer: b -> bar
+	sl_size middle = source.size() / 2 + 4;
+	ASSERT_EQ(buffer.source()[middle], u8'b');
+	const tk* untouched = buffer.statement_at(1500).tokens.data();
+	auto stats = buffer.apply({ middle, middle + 1, u8"bar" });
+	EXPECT_FALSE(stats.rebuilt);
+	EXPECT_EQ(stats.reparsed_statements, 1);
+	EXPECT_LE(stats.relexed_tokens, 6);
+	expect_same_as_rebuild(buffer);
+	// Statements the edit doesn't touch keep their tokens, in place.
+	EXPECT_EQ(buffer.statement_at(1500).tokens.data(), untouched);
+
+	// Insert a new statement spanning lines.
+	stats = buffer.apply({ 11, 11, u8"c = (d\n - e);\n" });
+	EXPECT_FALSE(stats.rebuilt);
+	EXPECT_EQ(stats.reparsed_statements, 2);
+	expect_same_as_rebuild(buffer);
+
+	// Remove a statement and its newline.
+	stats = buffer.apply({ 0, 11, u8"" });
+	EXPECT_FALSE(stats.rebuilt);
+	expect_same_as_rebuild(buffer);
+
+	// Break a statement in two, then join them again.
+	stats = buffer.apply({ 3, 3, u8"1; " });
+	EXPECT_FALSE(stats.rebuilt);
+	expect_same_as_rebuild(buffer);
+	buffer.apply({ 3, 6, u8"" });
+	expect_same_as_rebuild(buffer);
+
+	// Removing a semicolon joins the statement with the next one, only those two are relexed.
+	const sl_size semicolon = buffer.statement_start(1).bytes - 1;
+	const sl_size joined_tokens = buffer.statement_start(2).tokens - 1;
+	ASSERT_EQ(buffer.source()[semicolon], u8';');
+	stats = buffer.apply({ semicolon, semicolon + 1, u8"" });
+	EXPECT_FALSE(stats.rebuilt);
+	EXPECT_EQ(stats.reparsed_statements, 1);
+	EXPECT_EQ(stats.relexed_tokens, joined_tokens);
+	expect_same_as_rebuild(buffer);
+	buffer.apply({ semicolon, semicolon, u8";" });
+	expect_same_as_rebuild(buffer);
+
+	// Invalid statements keep their own error.
+	buffer.apply({ 0, 1, u8"+" });
+	expect_same_as_rebuild(buffer);
+	EXPECT_FALSE(buffer.statement_at(0).tree.valid());
+
+	// Append at the end of the buffer.
+	stats = buffer.apply({ buffer.size(), buffer.size(), u8"z = 3;" });
+	EXPECT_FALSE(stats.rebuilt);
+	expect_same_as_rebuild(buffer);
+	stats = buffer.apply({ buffer.size(), buffer.size(), u8"\n\n" });
+	EXPECT_EQ(stats.reparsed_statements, 1);
+	expect_same_as_rebuild(buffer);
+	// Removing the last statement leaves its whitespace to the statement before it.
+	stats = buffer.apply({ buffer.size() - 8, buffer.size() - 2, u8"" });
+	EXPECT_FALSE(stats.rebuilt);
+	EXPECT_EQ(stats.relexed_tokens, 0);
+	expect_same_as_rebuild(buffer);
+
+	// An unclosed scope runs past the end of its statement, every statement after it joins the window.
+	const sl_size statement_count = buffer.statement_count();
+	stats = buffer.apply({ middle, middle, u8"(" });
+	expect_same_as_rebuild(buffer);
+	EXPECT_LT(buffer.statement_count(), statement_count);
+	stats = buffer.apply({ middle, middle + 1, u8"" });
+	expect_same_as_rebuild(buffer);
+	EXPECT_EQ(buffer.statement_count(), statement_count);
+
+	// Edits to an empty buffer.
+	incremental_frontend empty;
+	empty.apply({ 0, 0, u8"  " });
+	EXPECT_EQ(empty.statement_count(), 0);
+	empty.apply({ 1, 1, u8"a;" });
+	expect_same_as_rebuild(empty);
+	EXPECT_EQ(empty.statement_count(), 1);
+}
+#endif
+
+#if CAOCO_TEST_INCREMENTAL_FRONTEND_TopLevelBlocks
+TEST(ut_Incremental_Frontend, TopLevelBlocks) {
+	// #enter and #start blocks are top level statements, an edit inside one reparses only that block.
+	sl_u8string source = u8"#enter { a = 1; b = 2; }\n#start { c; }\n";
+	incremental_frontend buffer(sl_char8_vector(source.begin(), source.end()));
+	ASSERT_TRUE(buffer.valid()) << buffer.error_message();
+	ASSERT_EQ(buffer.statement_count(), 2);
+	EXPECT_EQ(buffer.statement_at(0).tokens.size(), 11);
+	EXPECT_EQ(buffer.statement_start(1).tokens, 11);
+
+	auto stats = buffer.apply({ 12, 13, u8"10" });
+	EXPECT_FALSE(stats.rebuilt);
+	EXPECT_EQ(stats.reparsed_statements, 1);
+	EXPECT_EQ(stats.relexed_tokens, 11);
+	expect_same_as_rebuild(buffer);
+	stats = buffer.apply({ buffer.size() - 4, buffer.size() - 4, u8" d;" });
+	EXPECT_EQ(stats.reparsed_statements, 1);
+	expect_same_as_rebuild(buffer);
+
+	// A function definition ends at its closing brace, a semicolon right after it belongs to it.
+	sl_u8string functions = u8"#function f(a) { a; }\nb = 1;\n#function g() { c; };\nd = 2;\n";
+	incremental_frontend defined(sl_char8_vector(functions.begin(), functions.end()));
+	ASSERT_EQ(defined.statement_count(), 4);
+	EXPECT_EQ(defined.statement_at(0).tokens.size(), 9);
+	EXPECT_EQ(defined.statement_at(2).tokens.size(), 9);
+	const sl_size b = functions.find(u8'b');
+	stats = defined.apply({ b, b + 1, u8"bar" });
+	EXPECT_FALSE(stats.rebuilt);
+	EXPECT_EQ(stats.reparsed_statements, 1);
+	EXPECT_EQ(stats.relexed_tokens, 4);
+	expect_same_as_rebuild(defined);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AST Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_AST
+#define CAOCO_TEST_AST_ArenaBuild 1
+#define CAOCO_TEST_AST_ArenaConversion 1
+#define CAOCO_TEST_AST_ArenaParse 1
+#define CAOCO_TEST_AST_ChildAccessAndTraversal 1
+#define CAOCO_TEST_AST_SourceRangeLiterals 1
+#define CAOCO_TEST_AST_ImageRoundTrip 1
+#define CAOCO_TEST_AST_ImageAstnode 1
+#endif
+
+#if CAOCO_TEST_AST_ArenaBuild
+TEST(ut_AST_Arena, ArenaBuild) {
+	// a = b + 1;
+	ast_arena arena;
+	auto assign = arena.make(e_ast::simple_assignment_, u8"=");
+	auto add = arena.make(e_ast::addition_, u8"+");
+	arena.push_back(add, arena.make(e_ast::alnumus_, u8"b"));
+	arena.push_back(add, arena.make(e_ast::number_literal_, u8"1"));
+	arena.push_back(assign, add);
+	arena.push_front(assign, arena.make(e_ast::alnumus_, u8"a"));
+
+	EXPECT_EQ(arena.node_count(), 5);
+	EXPECT_TRUE(arena.root(assign));
+	EXPECT_EQ(arena.size(assign), 2);
+	EXPECT_TRUE(arena.literal(arena.child(assign, 0)) == u8"a");
+	EXPECT_EQ(arena.child(assign, 1), add);
+	EXPECT_EQ(arena.parent(add), assign);
+	EXPECT_EQ(arena.type(arena.last_child(add)), e_ast::number_literal_);
+	EXPECT_TRUE(arena.literal(arena.child(add, 0)) == u8"b");
+
+	// A node may only be linked once.
+	EXPECT_ANY_THROW(arena.push_back(assign, add));
+
+	arena.release();
+	EXPECT_EQ(arena.node_count(), 0);
+	EXPECT_EQ(arena.literal_bytes(), 0);
+}
+#endif
+
+#if CAOCO_TEST_AST_ArenaConversion
+TEST(ut_AST_Arena, ArenaConversion) {
+	auto input_vec = sl::to_u8vec(u8"a + b * c - foo.bar;");
+	auto result = tokenizer(input_vec.cbegin(), input_vec.cend())();
+	ASSERT_TRUE(result.valid());
+	auto tokens = result.expected();
+	tk_scope stmt_scope = tk_scope::find_program_statement(tokens.cbegin(), tokens.cend());
+	ASSERT_TRUE(stmt_scope.valid());
+	ast tree = parse_expression(stmt_scope.begin(), stmt_scope.contained_end());
+
+	ast_arena arena;
+	auto root = arena.adopt(tree);
+	ast round_trip = arena.to_ast(root);
+
+	std::function<void(const ast&, const ast&)> compare = [&compare](const ast& a, const ast& b) {
+		EXPECT_EQ(a.type(), b.type());
+		EXPECT_TRUE(a.literal() == b.literal());
+		ASSERT_EQ(a.size(), b.size());
+		for (sl_size i = 0; i < a.size(); i++)
+			compare(a[i], b[i]);
+	};
+	compare(tree, round_trip);
+}
+#endif
+
+#if CAOCO_TEST_AST_ArenaParse
+TEST(ut_AST_Arena, ArenaParse) {
+	auto input_vec = sl::to_u8vec(u8"call(a, b + 1, c * d, e, 'str') - foo.bar{x}[y];");
+	auto result = tokenizer(input_vec.cbegin(), input_vec.cend())();
+	ASSERT_TRUE(result.valid());
+	auto tokens = result.expected();
+	tk_scope stmt_scope = tk_scope::find_program_statement(tokens.cbegin(), tokens.cend());
+	ASSERT_TRUE(stmt_scope.valid());
+
+	// The parser builds straight into the arena, the tree is the one it builds on the heap.
+	ast_arena arena;
+	auto parsed = parse_expression_arena(stmt_scope.begin(), stmt_scope.contained_end(), arena);
+	ASSERT_TRUE(parsed.valid()) << parsed.error_message();
+	ast tree = parse_expression(stmt_scope.begin(), stmt_scope.contained_end());
+	EXPECT_TRUE(arena.root(parsed.expected()));
+	EXPECT_TRUE(ast_equal(arena.to_ast(parsed.expected()), tree));
+	sl_size heap_nodes = 0;
+	for ([[maybe_unused]] const ast& node : tree.preorder()) heap_nodes++;
+	EXPECT_EQ(arena.node_count(), heap_nodes);
+
+	// Errors are reported as by the heap parser.
+	auto bad = sl::to_u8vec(u8"a + * b");
+	auto bad_tokens = tokenizer(bad.cbegin(), bad.cend())().expected();
+	auto failed = parse_expression_arena(bad_tokens.cbegin(), bad_tokens.cend(), arena);
+	ASSERT_FALSE(failed.valid());
+	EXPECT_EQ(failed.error_message(), parse_expression_pratt(bad_tokens.cbegin(), bad_tokens.cend()).error_message());
+}
+#endif
+
+#if CAOCO_TEST_AST_ImageRoundTrip
+TEST(ut_AST_Image, ImageRoundTrip) {
+	auto input_vec = sl::to_u8vec(u8"call(a, b + 1, c * d, e, 'str') - foo.bar;");
+	auto result = tokenizer(input_vec.cbegin(), input_vec.cend())();
+	ASSERT_TRUE(result.valid());
+	auto tokens = result.expected();
+	tk_scope stmt_scope = tk_scope::find_program_statement(tokens.cbegin(), tokens.cend());
+	ASSERT_TRUE(stmt_scope.valid());
+	ast tree = parse_expression(stmt_scope.begin(), stmt_scope.contained_end());
+	auto image = ast_image::write(tree);
+
+	// The image holds no addresses, a copy at any (aligned) address reads the same.
+	sl_vector<sl_uint32> moved((image.size() + 3) / 4);
+	std::memcpy(moved.data(), image.data(), image.size());
+	ast_image::view view(sl_span<const std::byte>(reinterpret_cast<const std::byte*>(moved.data()), image.size()));
+	EXPECT_TRUE(ast_equal(view.to_ast(view.root()), tree));
+
+	// Children are consecutive records and point back at their parent.
+	const auto root = view.root();
+	EXPECT_EQ(view.type(root), tree.type());
+	EXPECT_EQ(view.parent(root), ast_image::npos);
+	for (ast_image::index_t i = 0; i < view.size(root); i++) {
+		EXPECT_EQ(view.child(root, i), view.child(root, 0) + i);
+		EXPECT_EQ(view.parent(view.child(root, i)), root);
+	}
+	EXPECT_THROW(view.child(root, view.size(root)), sl_out_of_range);
+	EXPECT_THROW(view.type(static_cast<ast_image::index_t>(view.node_count())), sl_out_of_range);
+
+	// Corrupt or truncated images are rejected when the view is opened.
+	auto bytes = sl_span<const std::byte>(reinterpret_cast<const std::byte*>(moved.data()), image.size());
+	EXPECT_THROW(ast_image::view(bytes.first(image.size() - 1)), sl_runtime_error);
+	moved[0] = 0;
+	EXPECT_THROW(ast_image::view{ bytes }, sl_runtime_error);
+}
+#endif
+
+#if CAOCO_TEST_AST_ImageAstnode
+TEST(ut_AST_Image, ImageAstnode) {
+	// (2 + 3) * a, as the constant evaluator walks it.
+	using astnode_enum = caoco::astnode_enum;
+	caoco::astnode tree(astnode_enum::multiplication_, u8"*",
+		caoco::astnode(astnode_enum::addition_, u8"+",
+			caoco::astnode(astnode_enum::number_literal_, u8"2"), caoco::astnode(astnode_enum::number_literal_, u8"3")),
+		caoco::astnode(astnode_enum::alnumus_, u8"a"));
+
+	// Saved to disk, then mapped and evaluated in place.
+	const sl_string path = (std::filesystem::temp_directory_path() / "caoco_ut_ast_image.cast").string();
+	ast_image::file::save(path, ast_image::write(tree));
+	caoco::rtenv env("global");
+	env.create_variable("a", caoco::RTValue(caoco::RTValue::eType::NUMBER, 4));
+	{
+		auto mapped = ast_image::file::map(path);
+		EXPECT_TRUE(mapped.mapped());
+		auto mapped_view = mapped.view();
+		EXPECT_EQ(caoco::eval_image(mapped_view, mapped_view.root(), env), caoco::CBinopEval{}(tree, env));
+		EXPECT_EQ(caoco::eval_image(mapped_view, mapped_view.child(mapped_view.root(), 1), env).as<int>(), 4);
+		// The mapping moves with the file.
+		ast_image::file moved = std::move(mapped);
+		EXPECT_FALSE(mapped.mapped());
+		EXPECT_EQ(caoco::eval_image(moved.view(), 0, env).as<int>(), 20);
+	}
+	auto loaded = ast_image::file::load(path);
+	std::filesystem::remove(path);
+	EXPECT_FALSE(loaded.mapped());
+	auto view = loaded.view();
+	EXPECT_EQ(view.tree(), ast_image::e_tree::astnode_);
+	EXPECT_EQ(view.node_count(), 5);
+	EXPECT_EQ(view.astnode_type(view.child(view.root(), 1)), astnode_enum::alnumus_);
+	EXPECT_EQ(caoco::eval_image(view, view.root(), env).as<int>(), 20);
+	caoco::astnode read = view.to_astnode(view.root());
+	EXPECT_FALSE(read.has_source());
+	EXPECT_TRUE(read[0][1].literal() == u8"3");
+	EXPECT_EQ(caoco::CBinopEval{}(read, env), caoco::CBinopEval{}(tree, env));
+	EXPECT_THROW(ast_image::file::map(path), sl_runtime_error);
+
+	// An image holds one kind of tree.
+	EXPECT_THROW(view.to_ast(view.root()), sl_runtime_error);
+	EXPECT_THROW(ast_image::file::load(path), sl_runtime_error);
+
+	// Images are read back without recursion, however deep the tree.
+	caoco::astnode chain(astnode_enum::number_literal_, u8"1");
+	for (int i = 0; i < 100000; i++)
+		chain = caoco::astnode(astnode_enum::addition_, u8"+", std::move(chain), caoco::astnode(astnode_enum::number_literal_, u8"1"));
+	auto image = ast_image::write(chain);
+	sl_vector<sl_uint32> aligned((image.size() + 3) / 4);
+	std::memcpy(aligned.data(), image.data(), image.size());
+	ast_image::view deep(sl_span<const std::byte>(reinterpret_cast<const std::byte*>(aligned.data()), image.size()));
+	caoco::astnode deep_read = deep.to_astnode(deep.root());
+	sl_size depth = 0;
+	for (const caoco::astnode* node = &deep_read; !node->children().empty(); node = &node->children().front()) depth++;
+	EXPECT_EQ(depth, 100000);
+	EXPECT_EQ(caoco::eval_image(deep, deep.root(), env).as<int>(), 100001);
+
+	// Records which point at a child before them, past the last node or past the literal pool are rejected when
+	// the view is opened.
+	auto corrupt = [&aligned, &image](auto&& change) {
+		sl_vector<sl_uint32> copy = aligned;
+		auto* records = reinterpret_cast<ast_image::record*>(reinterpret_cast<std::byte*>(copy.data()) + sizeof(ast_image::header));
+		change(records);
+		return ast_image::view(sl_span<const std::byte>(reinterpret_cast<const std::byte*>(copy.data()), image.size()));
+	};
+	EXPECT_NO_THROW(corrupt([](ast_image::record*) {}));
+	EXPECT_THROW(corrupt([](ast_image::record* records) { records[1].first_child = 1; }), sl_runtime_error);
+	EXPECT_THROW(corrupt([](ast_image::record* records) { records[1].first_child = 0; }), sl_runtime_error);
+	EXPECT_THROW(corrupt([&deep](ast_image::record* records) {
+		records[1].first_child = static_cast<ast_image::index_t>(deep.node_count() - 1); }), sl_runtime_error);
+	EXPECT_THROW(corrupt([](ast_image::record* records) { records[2].literal_size = 1000000; }), sl_runtime_error);
+	EXPECT_THROW(corrupt([](ast_image::record* records) { records[2].literal_offset = ast_image::npos; }), sl_runtime_error);
+}
+#endif
+
+#if CAOCO_TEST_AST_ChildAccessAndTraversal
+TEST(ut_AST, ChildAccessAndTraversal) {
+	// call(a, b, c, d, e) - more children than the arena stores inline.
+	ast tree{ e_ast::function_call_, u8"call" };
+	ast_arena arena;
+	auto root = arena.make(e_ast::function_call_, u8"call");
+	const sl_vector<sl_u8string> args = { u8"a", u8"b", u8"c", u8"d", u8"e" };
+	for (const auto& arg : args) {
+		ast& pushed = tree.push_back(ast{ e_ast::alnumus_, arg });
+		pushed.push_back(ast{ e_ast::number_literal_, u8"1" });
+		auto arena_arg = arena.push_back(root, arena.make(e_ast::alnumus_, arg));
+		arena.push_back(arena_arg, arena.make(e_ast::number_literal_, u8"1"));
+	}
+	arena.push_front(root, arena.make(e_ast::alnumus_, u8"self"));
+	tree.push_front(ast{ e_ast::alnumus_, u8"self" });
+
+	ASSERT_EQ(tree.size(), 6);
+	ASSERT_EQ(arena.size(root), 6);
+	EXPECT_TRUE(tree[0].literal() == u8"self");
+	EXPECT_TRUE(arena.literal(arena.child(root, 0)) == u8"self");
+	for (sl_size i = 0; i < args.size(); i++) {
+		EXPECT_TRUE(tree[i + 1].literal() == args[i]);
+		EXPECT_TRUE(tree.at(i + 1)[0].literal() == u8"1");
+		EXPECT_TRUE(arena.literal(arena.child(root, i + 1)) == args[i]);
+		// Parents follow the children when the contiguous storage grows.
+		EXPECT_EQ(&tree.at(i + 1).at(0).parent(), &tree.at(i + 1));
+		EXPECT_EQ(&tree.at(i + 1).parent(), &tree);
+	}
+
+	sl_u8string pre, post, arena_pre, arena_post;
+	for (const auto& node : tree.preorder()) pre += node.literal();
+	for (const auto& node : tree.postorder()) post += node.literal();
+	for (auto node : arena.preorder(root)) arena_pre += arena.literal(node);
+	for (auto node : arena.postorder(root)) arena_post += arena.literal(node);
+	EXPECT_TRUE(pre == u8"callselfa1b1c1d1e1");
+	EXPECT_TRUE(post == u8"self1a1b1c1d1ecall");
+	EXPECT_TRUE(arena_pre == pre);
+	EXPECT_TRUE(arena_post == post);
+
+	// A deep chain is walked without recursion.
+	ast deep{ e_ast::negation_, u8"!" };
+	ast* tail = &deep;
+	for (int i = 0; i < 10000; i++)
+		tail = &tail->push_back(ast{ e_ast::negation_, u8"!" });
+	sl_size count = 0;
+	for (const auto& node : deep.postorder()) { (void)node; count++; }
+	EXPECT_EQ(count, 10001);
+}
+#endif
+
+#if CAOCO_TEST_AST_SourceRangeLiterals
+TEST(ut_AST, SourceRangeLiterals) {
+	// a = b + 1 ;
+	auto src = sl::to_u8vec(u8"a=b+1;");
+	using caoco::astnode;
+	using tk_enum = caoco::tk::e_type;
+	caoco::tk_vector tokens = {
+		caoco::tk(tk_enum::alnumus_, src.cbegin(), src.cbegin() + 1),
+		caoco::tk(tk_enum::simple_assignment_, src.cbegin() + 1, src.cbegin() + 2),
+		caoco::tk(tk_enum::alnumus_, src.cbegin() + 2, src.cbegin() + 3),
+		caoco::tk(tk_enum::addition_, src.cbegin() + 3, src.cbegin() + 4),
+		caoco::tk(tk_enum::number_literal_, src.cbegin() + 4, src.cbegin() + 5),
+		caoco::tk(tk_enum::eos_, src.cbegin() + 5, src.cbegin() + 6)
+	};
+	auto beg = tokens.cbegin();
+
+	// Nodes keep a reference to their tokens, the text is only rebuilt when asked for.
+	astnode add{ astnode::e_type::addition_, beg + 3, beg + 4,
+		astnode{ astnode::e_type::alnumus_, beg + 2, beg + 3 },
+		astnode{ astnode::e_type::number_literal_, beg + 4, beg + 5 } };
+	astnode statement{ astnode::e_type::statement_, beg, tokens.cend(),
+		astnode{ astnode::e_type::simple_assignment_, beg + 1, beg + 2,
+			astnode{ astnode::e_type::alnumus_, beg, beg + 1 }, std::move(add) } };
+
+	EXPECT_TRUE(statement.has_source());
+	EXPECT_TRUE(statement.literal() == u8"a=b+1;");
+	EXPECT_TRUE(statement.source_begin() == tokens.cbegin());
+	EXPECT_TRUE(statement.source_end() == tokens.cend());
+	EXPECT_TRUE(statement[0].literal() == u8"=");
+	EXPECT_TRUE(statement[0][1].literal() == u8"+");
+	EXPECT_TRUE(statement[0][1][1].literal() == u8"1");
+	EXPECT_EQ(statement.literal_str(), "a=b+1;");
+
+	// Nodes made from an explicit literal still own their text.
+	astnode owned{ astnode::e_type::alnumus_, u8"c" };
+	EXPECT_FALSE(owned.has_source());
+	EXPECT_TRUE(owned.literal() == u8"c");
+}
+#endif
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Parser Basic Tests
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1847,126 +2613,964 @@ TEST(CaocoParser_BasicNode_FunctionalBlock, CaocoParser_Test) {
 #endif
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Parser Program Tests
+// Parser Parallel Tests
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
-#if CAOCO_TEST_PARSER_PROGRAM
-#define CAOCO_TEST_PARSER_PROGRAM_MinimumProgram 1
-#define CAOCO_TEST_PARSER_PROGRAM_BasicProgram 1
+#if CAOCO_TEST_PARSER_PARALLEL
+#define CAOCO_TEST_PARSER_PARALLEL_PragmaticBlock 1
 #endif
 
-#if CAOCO_TEST_PARSER_PROGRAM_MinimumProgram 
-TEST(CaocoParser_MinimumProgram, CaocoParser_Test) {
-	auto source_file = caoco::sl::load_file_to_char8_vector("ut_parser_minimum_program.candi");
-	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
-	EXPECT_TRUE(exp_result.valid());
-	if (exp_result.valid()) {
-		auto result = exp_result.expected();
-
-		try {
-			auto parse_result = caoco::parse_program(result.cbegin(), result.cend());
-			print_ast(parse_result);
-		}
-		catch (std::exception e) {
-			std::cout << e.what() << std::endl;
-		}
+#if CAOCO_TEST_PARSER_PARALLEL || CAOCO_TEST_PARSER_LAZY || CAOCO_TEST_PARSER_PACKRAT || CAOCO_TEST_PARSER_LLK || CAOCO_TEST_PARSER_NESTING \
+	|| CAOCO_TEST_PARSER_SCRATCH || CAOCO_TEST_PARSER_DIAGNOSTICS || CAOCO_TEST_CONSTANT_FOLDING || CAOCO_TEST_BENCHMARK
+// Builds caoco tokens over a single source buffer, the buffer must not reallocate once tokens refer to it.
+struct caoco_token_builder {
+	sl_char8_vector source;
+	sl_vector<std::tuple<caoco::tk_enum, sl_size, sl_size>> spans;
+	void add(caoco::tk_enum type, const char* text) {
+		sl_size offset = source.size();
+		for (sl_size i = 0; text[i] != '\0'; i++) source.push_back(static_cast<char8_t>(text[i]));
+		spans.emplace_back(type, offset, source.size());
 	}
-	else {
-		std::cout << exp_result.error_message() << std::endl;
+	caoco::tk_vector build() const {
+		caoco::tk_vector tokens;
+		tokens.reserve(spans.size());
+		for (const auto& [type, first, last] : spans)
+			tokens.emplace_back(type, source.cbegin() + first, source.cbegin() + last);
+		return tokens;
 	}
+};
+
+bool caoco_ast_equal(const caoco::astnode& a, const caoco::astnode& b) {
+	if (a.type() != b.type() || a.literal() != b.literal() || a.children().size() != b.children().size()) return false;
+	for (sl_size i = 0; i < a.children().size(); i++)
+		if (!caoco_ast_equal(a.children()[i], b.children()[i])) return false;
+	return true;
 }
 #endif
 
+#if CAOCO_TEST_PARSER_PARALLEL_PragmaticBlock
+TEST(ut_Parser_Parallel, PragmaticBlock) {
+	// { a; #class B { c; d; }; [] f(x) { x; } ... }
+	using tk_enum = caoco::tk_enum;
+	caoco_token_builder builder;
+	builder.add(tk_enum::open_list_, "{");
+	for (int i = 0; i < 2000; i++) {
+		builder.add(tk_enum::alnumus_, "a");
+		builder.add(tk_enum::eos_, ";");
+		builder.add(tk_enum::class_, "#class");
+		builder.add(tk_enum::alnumus_, "B");
+		builder.add(tk_enum::open_list_, "{");
+		builder.add(tk_enum::alnumus_, "c");
+		builder.add(tk_enum::eos_, ";");
+		builder.add(tk_enum::alnumus_, "d");
+		builder.add(tk_enum::eos_, ";");
+		builder.add(tk_enum::close_list_, "}");
+		builder.add(tk_enum::eos_, ";");
+		// A function definition ends at its body, without an eos.
+		builder.add(tk_enum::open_frame_, "[");
+		builder.add(tk_enum::close_frame_, "]");
+		builder.add(tk_enum::alnumus_, "f");
+		builder.add(tk_enum::open_scope_, "(");
+		builder.add(tk_enum::alnumus_, "x");
+		builder.add(tk_enum::close_scope_, ")");
+		builder.add(tk_enum::open_list_, "{");
+		builder.add(tk_enum::alnumus_, "x");
+		builder.add(tk_enum::eos_, ";");
+		builder.add(tk_enum::close_list_, "}");
+	}
+	builder.add(tk_enum::close_list_, "}");
+	auto tokens = builder.build();
+
+	auto serial = caoco::parse_pragmatic_block(tokens.cbegin(), tokens.cend());
+	auto parallel = caoco::parse_pragmatic_block_parallel(tokens.cbegin(), tokens.cend(), 4);
+	ASSERT_TRUE(serial.valid()) << serial.error_message();
+	ASSERT_TRUE(parallel.valid()) << parallel.error_message();
+	EXPECT_EQ(serial.expected().children().size(), 6000);
+	EXPECT_TRUE(serial.always() == parallel.always());
+	EXPECT_TRUE(caoco_ast_equal(serial.expected(), parallel.expected()));
+
+	// Every statement is split where the serial parse ends it, so the block is parsed in parallel
+	// instead of falling back to the serial parse.
+	{
+		scratch_scope scratch;
+		auto statements = caoco::split_pragmatic_statements(tokens.cbegin() + 1, tokens.cend() - 1);
+		EXPECT_EQ(statements.size(), 6000);
+		EXPECT_EQ(caoco::count_block_statements(tokens.cbegin() + 1, tokens.cend() - 1), 6000);
+		caoco::astnode block(caoco::astnode_enum::pragmatic_block_, tokens.cbegin() + 1, tokens.cend() - 1);
+		EXPECT_TRUE(caoco::parse_pragmatic_statements_parallel(block, statements, 4));
+		EXPECT_TRUE(caoco_ast_equal(serial.expected(), block));
+	}
+
+	// Errors are reported exactly as by the serial parse.
+	builder.spans.insert(builder.spans.begin() + 3000, { tk_enum::close_list_, 0, 1 });
+	auto broken = builder.build();
+	auto serial_error = caoco::parse_pragmatic_block(broken.cbegin(), broken.cend());
+	auto parallel_error = caoco::parse_pragmatic_block_parallel(broken.cbegin(), broken.cend(), 4);
+	EXPECT_EQ(serial_error.valid(), parallel_error.valid());
+	EXPECT_EQ(serial_error.error_message(), parallel_error.error_message());
+}
+#endif
 
-#if CAOCO_TEST_PARSER_PROGRAM_BasicProgram
-TEST(CaocoParser_BasicProgram, CaocoParser_Test) {
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parser Lazy Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_PARSER_LAZY
+#define CAOCO_TEST_PARSER_LAZY_FunctionBody 1
+#endif
 
-	auto source_file = caoco::sl::load_file_to_char8_vector("ut_program_basic.candi");
-	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
-	EXPECT_TRUE(exp_result.valid());
-	if (exp_result.valid()) {
-		auto result = exp_result.expected();
+#if CAOCO_TEST_PARSER_LAZY_FunctionBody
+TEST(ut_Parser_Lazy, FunctionBody) {
+	// [] f { a; }
+	using tk_enum = caoco::tk_enum;
+	caoco_token_builder builder;
+	builder.add(tk_enum::open_frame_, "[");
+	builder.add(tk_enum::close_frame_, "]");
+	builder.add(tk_enum::alnumus_, "f");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "a");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	auto tokens = builder.build();
+
+	auto eager = caoco::parse_directive_func(tokens.cbegin(), tokens.cend());
+	ASSERT_TRUE(eager.valid()) << eager.error_message();
+	EXPECT_EQ(eager.expected().children().back().type(), caoco::astnode_enum::functional_block_);
+
+	caoco::parser_settings_scope lazy_settings({ .lazy_function_bodies = true });
+	auto lazy = caoco::parse_directive_func(tokens.cbegin(), tokens.cend());
+	ASSERT_TRUE(lazy.valid()) << lazy.error_message();
+	EXPECT_TRUE(lazy.always() == eager.always());
+	const auto& deferred = lazy.expected().children().back();
+	EXPECT_EQ(deferred.type(), caoco::astnode_enum::deferred_functional_block_);
+	EXPECT_TRUE(deferred.children().empty());
+	EXPECT_TRUE(deferred.source_begin() == tokens.cbegin() + 3);
+
+	// The body is parsed on first use into the same tree as the eager parse.
+	auto body = caoco::parse_deferred_block(deferred);
+	ASSERT_TRUE(body.valid()) << body.error_message();
+	EXPECT_TRUE(caoco_ast_equal(body.expected(), eager.expected().children().back()));
+}
 
-		try {
-			auto parse_result = caoco::parse_program(result.cbegin(), result.cend());
-			print_ast(parse_result);
-		}
-		catch (std::exception e) {
-			std::cout << e.what() << std::endl;
-		}
+TEST(ut_Parser_Lazy, FunctionBodyErrorsAreDeferred) {
+	// [] f { }
+	using tk_enum = caoco::tk_enum;
+	caoco_token_builder builder;
+	builder.add(tk_enum::open_frame_, "[");
+	builder.add(tk_enum::close_frame_, "]");
+	builder.add(tk_enum::alnumus_, "f");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::close_list_, "}");
+	auto tokens = builder.build();
+
+	EXPECT_FALSE(caoco::parse_directive_func(tokens.cbegin(), tokens.cend()).valid());
+	{
+		caoco::parser_settings_scope lazy_settings({ .lazy_function_bodies = true });
+		auto lazy = caoco::parse_directive_func(tokens.cbegin(), tokens.cend());
+		ASSERT_TRUE(lazy.valid()) << lazy.error_message();
+		EXPECT_FALSE(caoco::parse_deferred_block(lazy.expected().children().back()).valid());
 	}
-	else {
-		std::cout << exp_result.error_message() << std::endl;
+	{
+		caoco::parser_settings_scope full_check_settings({ .lazy_function_bodies = true, .full_check = true });
+		EXPECT_FALSE(caoco::parse_directive_func(tokens.cbegin(), tokens.cend()).valid());
 	}
+	EXPECT_FALSE(caoco::current_parser_settings().lazy_function_bodies);
 }
 #endif
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parser Packrat Tests
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_PARSER_PACKRAT
+#define CAOCO_TEST_PARSER_PACKRAT_MemoizedRules 1
+#endif
 
+#if CAOCO_TEST_PARSER_PACKRAT_MemoizedRules
+TEST(ut_Parser_Packrat, MemoizedRules) {
+	// {a,b}
+	using tk_enum = caoco::tk_enum;
+	caoco_token_builder builder;
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "a");
+	builder.add(tk_enum::comma_, ",");
+	builder.add(tk_enum::alnumus_, "b");
+	builder.add(tk_enum::close_list_, "}");
+	auto tokens = builder.build();
+	const auto a = tokens.cbegin() + 1;
+
+	// Expressions in a list are not supported by the legacy parser yet, the list operand fails in its first element.
+	auto unmemoized_list = caoco::parse_operand(tokens.cbegin(), tokens.cend());
+	auto unmemoized_a = caoco::parse_operand(a, a + 1);
+	EXPECT_FALSE(unmemoized_list.valid());
+	ASSERT_TRUE(unmemoized_a.valid()) << unmemoized_a.error_message();
+
+	caoco::parse_memo memo(tokens);
+	caoco::parser_settings_scope packrat_settings({ .memo = &memo });
+	auto list = caoco::parse_operand(tokens.cbegin(), tokens.cend());
+	EXPECT_EQ(memo.hits(), 0);
+	EXPECT_EQ(memo.misses(), 2); // The list operand and its first element.
+
+	// Failures are answered from the memo with their end position and error.
+	auto list_again = caoco::parse_operand(tokens.cbegin(), tokens.cend());
+	EXPECT_EQ(memo.hits(), 1);
+	EXPECT_FALSE(list.valid() || list_again.valid());
+	EXPECT_TRUE(list.always() == unmemoized_list.always() && list_again.always() == unmemoized_list.always());
+	EXPECT_EQ(list.error_message(), unmemoized_list.error_message());
+	EXPECT_EQ(list_again.error_message(), unmemoized_list.error_message());
+
+	// So is a sub-range retried by another rule.
+	EXPECT_FALSE(caoco::parse_primary_expression(a, a + 1).valid());
+	EXPECT_EQ(memo.hits(), 2);
+
+	// Successes are stored too, a retried one is answered from the memo and shares the stored tree.
+	const sl_size copies = caoco::astnode::copy_count();
+	auto operand_a = caoco::parse_operand(a, a + 1);
+	EXPECT_EQ(memo.misses(), 3);
+	auto operand_a_again = caoco::parse_operand(a, a + 1);
+	EXPECT_EQ(caoco::astnode::copy_count(), copies);
+	EXPECT_EQ(memo.hits(), 3);
+	EXPECT_EQ(memo.misses(), 3);
+	EXPECT_EQ(memo.size(), 3);
+	ASSERT_TRUE(operand_a.valid() && operand_a_again.valid());
+	EXPECT_TRUE(operand_a_again.always() == unmemoized_a.always());
+	EXPECT_TRUE(caoco_ast_equal(operand_a.expected(), unmemoized_a.expected()));
+	EXPECT_TRUE(caoco_ast_equal(operand_a_again.expected(), unmemoized_a.expected()));
+	EXPECT_TRUE(operand_a.expected().is_shared() && operand_a_again.expected().is_shared());
+	EXPECT_EQ(&operand_a.expected().children(), &operand_a_again.expected().children());
+	EXPECT_DOUBLE_EQ(memo.hit_rate(), 3.0 / 6.0);
+
+	// Changing a handed out tree copies its children first, the stored one is left as it was.
+	caoco::astnode changed = operand_a_again.extract();
+	changed.push_back(caoco::astnode(caoco::astnode_enum::alnumus_, u8"c"));
+	EXPECT_FALSE(changed.is_shared());
+	auto operand_a_third = caoco::parse_operand(a, a + 1);
+	EXPECT_EQ(memo.hits(), 4);
+	EXPECT_TRUE(caoco_ast_equal(operand_a_third.expected(), unmemoized_a.expected()));
+
+	memo.clear();
+	EXPECT_EQ(memo.size(), 0);
+	EXPECT_EQ(memo.hits() + memo.misses(), 0);
+}
+#endif
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Preprocessor Tests
+// Parser LL(k) Tests
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-#if CAOCO_TEST_PREPROCESSOR
-#define CAOCO_TEST_PREPROCESSOR_Include  1
-#define CAOCO_TEST_PREPROCESSOR_Macro 1
+#if CAOCO_TEST_PARSER_LLK
+#define CAOCO_TEST_PARSER_LLK_MatchesParseProgram 1
+#define CAOCO_TEST_PARSER_LLK_ExpressionNodes 1
+#define CAOCO_TEST_PARSER_LLK_ControlFlow 1
+#define CAOCO_TEST_PARSER_LLK_SyntaxErrors 1
 #endif
 
-#if CAOCO_TEST_PREPROCESSOR_Include 
-TEST(CaocoPreprocessor_Include, CaocoPreprocessor_Test) {
-	auto source_file = caoco::sl::load_file_to_char8_vector("ut_preprocessor_include.candi");
-	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
-	EXPECT_TRUE(exp_result.valid());
-	if (exp_result.valid()) {
-		auto result = exp_result.expected();
-		auto preprocessed = caoco::preprocess(result, "ut_preprocessor_include.candi");
+#if CAOCO_TEST_PARSER_LLK || CAOCO_TEST_PARSER_SCRATCH || CAOCO_TEST_BENCHMARK
+// #enter { a; b c; d [e]; #class F { g; [] h { i; } }; #class J { }; [] k (l) m { n; o p; } } #start { q; }
+void add_llk_program_body(caoco_token_builder& builder) {
+	using tk_enum = caoco::tk_enum;
+	builder.add(tk_enum::alnumus_, "a");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "b");
+	builder.add(tk_enum::alnumus_, "c");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "d");
+	builder.add(tk_enum::open_frame_, "[");
+	builder.add(tk_enum::alnumus_, "e");
+	builder.add(tk_enum::close_frame_, "]");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::class_, "#class");
+	builder.add(tk_enum::alnumus_, "F");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "g");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::open_frame_, "[");
+	builder.add(tk_enum::close_frame_, "]");
+	builder.add(tk_enum::alnumus_, "h");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "i");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	builder.add(tk_enum::close_list_, "}");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::class_, "#class");
+	builder.add(tk_enum::alnumus_, "J");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::close_list_, "}");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::open_frame_, "[");
+	builder.add(tk_enum::close_frame_, "]");
+	builder.add(tk_enum::alnumus_, "k");
+	builder.add(tk_enum::open_scope_, "(");
+	builder.add(tk_enum::alnumus_, "l");
+	builder.add(tk_enum::close_scope_, ")");
+	builder.add(tk_enum::alnumus_, "m");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "n");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "o");
+	builder.add(tk_enum::alnumus_, "p");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+}
 
-		if (!std::get<1>(preprocessed)) {
-			std::cout << "Preprocessing Error: " << std::get<2>(preprocessed) << std::endl;
-		}
-		else {
-			for (auto& token : std::get<0>(preprocessed)) {
-				std::cout << token.literal_str();
-			}
-		}
-	}
-	else {
-		std::cout << exp_result.error_message() << std::endl;
+// r = s + t * 2; u = s * t - 1;
+// parse_program can not parse these, the split expression parser is not implemented yet.
+void add_llk_expression_statements(caoco_token_builder& builder) {
+	using tk_enum = caoco::tk_enum;
+	builder.add(tk_enum::alnumus_, "r");
+	builder.add(tk_enum::simple_assignment_, "=");
+	builder.add(tk_enum::alnumus_, "s");
+	builder.add(tk_enum::addition_, "+");
+	builder.add(tk_enum::alnumus_, "t");
+	builder.add(tk_enum::multiplication_, "*");
+	builder.add(tk_enum::number_literal_, "2");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "u");
+	builder.add(tk_enum::simple_assignment_, "=");
+	builder.add(tk_enum::alnumus_, "s");
+	builder.add(tk_enum::multiplication_, "*");
+	builder.add(tk_enum::alnumus_, "t");
+	builder.add(tk_enum::subtraction_, "-");
+	builder.add(tk_enum::number_literal_, "1");
+	builder.add(tk_enum::eos_, ";");
+}
+
+caoco_token_builder make_llk_program(sl_size body_repeats, bool with_expressions = false) {
+	using tk_enum = caoco::tk_enum;
+	caoco_token_builder builder;
+	builder.add(tk_enum::enter_, "#enter");
+	builder.add(tk_enum::open_list_, "{");
+	for (sl_size i = 0; i < body_repeats; i++) {
+		add_llk_program_body(builder);
+		if (with_expressions) add_llk_expression_statements(builder);
 	}
+	builder.add(tk_enum::close_list_, "}");
+	builder.add(tk_enum::start_, "#start");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "q");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	return builder;
+}
+
+// Number of expression_ nodes, expressions the llk_parser kept over their tokens.
+sl_size count_expression_nodes(const caoco::astnode& node) {
+	sl_size count = node.type() == caoco::astnode_enum::expression_ ? 1 : 0;
+	for (const auto& child : node.children())
+		count += count_expression_nodes(child);
+	return count;
 }
 #endif
 
-#if CAOCO_TEST_PREPROCESSOR_Macro
-TEST(CaocoPreprocessor_Macro, CaocoPreprocessor_Test) {
-	auto source_file = caoco::sl::load_file_to_char8_vector("ut_preprocessor_macros.candi");
-	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
-	EXPECT_TRUE(exp_result.valid());
-	if (exp_result.valid()) {
-		auto result = exp_result.expected();
-		auto expanded = caoco::macro_expand(result, "ut_preprocessor_macros.candi");
+#if CAOCO_TEST_PARSER_LLK_MatchesParseProgram
+TEST(ut_Parser_LLK, MatchesParseProgram) {
+	auto tokens = make_llk_program(1).build();
+	auto expected = caoco::parse_program(tokens.cbegin(), tokens.cend());
+	auto result = caoco::llk_parser::parse(tokens.cbegin(), tokens.cend());
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	EXPECT_TRUE(result.always() == tokens.cend());
+	EXPECT_TRUE(caoco_ast_equal(result.expected(), expected));
+	EXPECT_EQ(count_expression_nodes(result.expected()), 0);
+	ASSERT_EQ(result.expected().children().size(), 2);
+	EXPECT_EQ(result.expected()[0].children().size(), 6);
+}
+#endif
 
-		if(!std::get<1>(expanded)) {
-			std::cout << "Macro Expansion Error: " << std::get<2>(expanded) << std::endl;
-		}
-		else {
-			for (auto& token : std::get<0>(expanded)) {
-				std::cout << token.literal_str();
-			}
-		}
+#if CAOCO_TEST_PARSER_LLK_ExpressionNodes
+TEST(ut_Parser_LLK, ExpressionNodes) {
+	// The llk_parser keeps an operator expression as an expression_ node over its tokens, the ; is not in it.
+	using astnode_enum = caoco::astnode_enum;
+	auto tokens = make_llk_program(1, true).build();
+	auto result = caoco::llk_parser::parse(tokens.cbegin(), tokens.cend());
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	const auto& program = result.expected();
+	EXPECT_EQ(count_expression_nodes(program), 2);
+	ASSERT_EQ(program[0].children().size(), 8);
+	const auto& r = program[0][6];
+	ASSERT_EQ(r.children().size(), 2);
+	EXPECT_EQ(r[1].type(), astnode_enum::expression_);
+	EXPECT_EQ(r[1].literal_str(), "s+t*2");
+	const auto& u = program[0][7];
+	ASSERT_EQ(u.children().size(), 2);
+	EXPECT_EQ(u[1].type(), astnode_enum::expression_);
+	EXPECT_EQ(u[1].literal_str(), "s*t-1");
+}
+#endif
 
-	}
-	else {
-		std::cout << exp_result.error_message() << std::endl;
-	}
+#if CAOCO_TEST_PARSER_LLK_ControlFlow
+TEST(ut_Parser_LLK, ControlFlow) {
+	// { #if (x) { a; } #elif (y) { b; } #else { c; }; #while (x) { a; }; #for (a; b; c) { d; };
+	//   #on (x) { #if (1) { a; }; }; #return x + 1; v = (w; z); }
+	using tk_enum = caoco::tk_enum;
+	caoco_token_builder builder;
+	auto block = [&builder](const char* name) {
+		builder.add(tk_enum::open_list_, "{");
+		builder.add(tk_enum::alnumus_, name);
+		builder.add(tk_enum::eos_, ";");
+		builder.add(tk_enum::close_list_, "}");
+	};
+	auto condition = [&builder](tk_enum type, const char* text) {
+		builder.add(tk_enum::open_scope_, "(");
+		builder.add(type, text);
+		builder.add(tk_enum::close_scope_, ")");
+	};
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::if_, "#if");
+	condition(tk_enum::alnumus_, "x");
+	block("a");
+	builder.add(tk_enum::elif_, "#elif");
+	condition(tk_enum::alnumus_, "y");
+	block("b");
+	builder.add(tk_enum::else_, "#else");
+	block("c");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::while_, "#while");
+	condition(tk_enum::alnumus_, "x");
+	block("a");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::for_, "#for");
+	builder.add(tk_enum::open_scope_, "(");
+	builder.add(tk_enum::alnumus_, "a");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "b");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "c");
+	builder.add(tk_enum::close_scope_, ")");
+	block("d");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::on_, "#on");
+	condition(tk_enum::alnumus_, "x");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::if_, "#if");
+	condition(tk_enum::number_literal_, "1");
+	block("a");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::return_, "#return");
+	builder.add(tk_enum::alnumus_, "x");
+	builder.add(tk_enum::addition_, "+");
+	builder.add(tk_enum::number_literal_, "1");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "v");
+	builder.add(tk_enum::simple_assignment_, "=");
+	builder.add(tk_enum::open_scope_, "(");
+	builder.add(tk_enum::alnumus_, "w");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::alnumus_, "z");
+	builder.add(tk_enum::close_scope_, ")");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	auto tokens = builder.build();
+
+	auto result = caoco::llk_parser::parse(tokens.cbegin(), tokens.cend(), caoco::llk_parser::e_rule::functional_block_);
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	EXPECT_TRUE(result.always() == tokens.cend());
+	using astnode_enum = caoco::astnode_enum;
+	const auto& body = result.expected();
+	ASSERT_EQ(body.children().size(), 6);
+
+	const auto& conditional = body[0];
+	EXPECT_EQ(conditional.type(), astnode_enum::conditional_statement_);
+	ASSERT_EQ(conditional.children().size(), 3);
+	EXPECT_EQ(conditional[0].type(), astnode_enum::if_);
+	EXPECT_EQ(conditional[0][0].type(), astnode_enum::expression_);
+	EXPECT_TRUE(conditional[0][0].literal() == u8"x");
+	EXPECT_EQ(conditional[0][1].type(), astnode_enum::functional_block_);
+	EXPECT_EQ(conditional[1].type(), astnode_enum::elif_);
+	EXPECT_EQ(conditional[2].type(), astnode_enum::else_);
+
+	EXPECT_EQ(body[1].type(), astnode_enum::while_);
+	const auto& for_node = body[2];
+	EXPECT_EQ(for_node.type(), astnode_enum::for_);
+	ASSERT_EQ(for_node.children().size(), 4);
+	EXPECT_TRUE(for_node[1].literal() == u8"b");
+	EXPECT_EQ(for_node[3].type(), astnode_enum::functional_block_);
+
+	const auto& on_node = body[3];
+	EXPECT_EQ(on_node.type(), astnode_enum::on_);
+	ASSERT_EQ(on_node.children().size(), 2);
+	EXPECT_EQ(on_node[1].type(), astnode_enum::on_block_);
+	ASSERT_EQ(on_node[1].children().size(), 1);
+	EXPECT_EQ(on_node[1][0].type(), astnode_enum::conditional_statement_);
+
+	EXPECT_EQ(body[4].type(), astnode_enum::return_);
+	EXPECT_TRUE(body[4][0].literal() == u8"x+1");
+
+	// An eos inside a scope does not end the value.
+	EXPECT_EQ(body[5].type(), astnode_enum::anon_variable_definition_assingment_);
+	EXPECT_TRUE(body[5][1].literal() == u8"(w;z)");
+}
+#endif
+
+#if CAOCO_TEST_PARSER_LLK_SyntaxErrors
+TEST(ut_Parser_LLK, SyntaxErrors) {
+	using tk_enum = caoco::tk_enum;
+	// { a b c; }
+	caoco_token_builder builder;
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "a");
+	builder.add(tk_enum::alnumus_, "b");
+	builder.add(tk_enum::alnumus_, "c");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	auto tokens = builder.build();
+	auto result = caoco::llk_parser::parse(tokens.cbegin(), tokens.cend(), caoco::llk_parser::e_rule::pragmatic_block_);
+	EXPECT_FALSE(result.valid());
+	EXPECT_TRUE(result.always() == tokens.cbegin() + 3);
+	EXPECT_NE(result.error_message().find("var statement"), sl_string::npos);
+
+	// A functional block may not be empty.
+	caoco_token_builder empty;
+	empty.add(tk_enum::open_list_, "{");
+	empty.add(tk_enum::close_list_, "}");
+	auto empty_tokens = empty.build();
+	EXPECT_FALSE(caoco::llk_parser::parse(empty_tokens.cbegin(), empty_tokens.cend(), caoco::llk_parser::e_rule::functional_block_).valid());
+
+	// Unterminated statement.
+	builder.spans.pop_back();
+	builder.spans.pop_back();
+	auto unterminated = builder.build();
+	result = caoco::llk_parser::parse(unterminated.cbegin(), unterminated.cbegin() + 3, caoco::llk_parser::e_rule::pragmatic_block_);
+	EXPECT_FALSE(result.valid());
+	EXPECT_NE(result.error_message().find("end of input"), sl_string::npos);
 }
 #endif
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Const Evaluator Tests
+// Parser Nesting Tests
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_PARSER_NESTING
+#define CAOCO_TEST_PARSER_NESTING_BlockDepthLimit 1
+#define CAOCO_TEST_PARSER_NESTING_DeepArithmetic 1
+
+// #class C { #class C { ... { x; } ... }; };
+void add_nested_class(caoco_token_builder& builder, sl_size depth) {
+	using tk_enum = caoco::tk_enum;
+	for (sl_size i = 0; i < depth; i++) {
+		builder.add(tk_enum::class_, "#class");
+		builder.add(tk_enum::alnumus_, "C");
+		builder.add(tk_enum::open_list_, "{");
+	}
+	builder.add(tk_enum::alnumus_, "x");
+	builder.add(tk_enum::eos_, ";");
+	for (sl_size i = 0; i < depth; i++) {
+		builder.add(tk_enum::close_list_, "}");
+		builder.add(tk_enum::eos_, ";");
+	}
+}
 
-#if CAOCO_TEST_CONST_EVALUATOR
+// { #class C { #class C { ... { x; } ... }; }; }
+caoco_token_builder make_nested_classes(sl_size depth) {
+	caoco_token_builder builder;
+	builder.add(caoco::tk_enum::open_list_, "{");
+	add_nested_class(builder, depth);
+	builder.add(caoco::tk_enum::close_list_, "}");
+	return builder;
+}
+#endif
+
+#if CAOCO_TEST_PARSER_NESTING_BlockDepthLimit
+TEST(ut_Parser_Nesting, BlockDepthLimit) {
+	// The outer block and each class body are one level.
+	auto tokens = make_nested_classes(20).build();
+	caoco::parser_settings settings;
+	settings.max_depth = 21;
+	{
+		caoco::parser_settings_scope scope(settings);
+		auto result = caoco::parse_pragmatic_block(tokens.cbegin(), tokens.cend());
+		EXPECT_TRUE(result.valid()) << result.error_message();
+	}
+	settings.max_depth = 20;
+	{
+		caoco::parser_settings_scope scope(settings);
+		auto result = caoco::parse_pragmatic_block(tokens.cbegin(), tokens.cend());
+		ASSERT_FALSE(result.valid());
+		EXPECT_NE(result.error_message().find("depth limit"), sl_string::npos);
+	}
+
+	// Parallel workers continue from the depth of the block which started them. The first chunk is parsed
+	// by the calling thread, only the statements after it are nested too deep.
+	caoco_token_builder wide_builder;
+	wide_builder.add(caoco::tk_enum::open_list_, "{");
+	for (sl_size i = 0; i < 64; i++)
+		add_nested_class(wide_builder, i < 16 ? 1 : 20);
+	wide_builder.add(caoco::tk_enum::close_list_, "}");
+	auto wide = wide_builder.build();
+	settings.max_depth = 21;
+	{
+		caoco::parser_settings_scope scope(settings);
+		auto result = caoco::parse_pragmatic_block_parallel(wide.cbegin(), wide.cend(), 4);
+		EXPECT_TRUE(result.valid()) << result.error_message();
+	}
+	settings.max_depth = 20;
+	{
+		caoco::parser_settings_scope scope(settings);
+		auto result = caoco::parse_pragmatic_block_parallel(wide.cbegin(), wide.cend(), 4);
+		ASSERT_FALSE(result.valid());
+		EXPECT_NE(result.error_message().find("depth limit"), sl_string::npos);
+	}
+
+	// The table driven parser keeps its parse stack on the heap, far deeper input is fine.
+	auto deep = make_nested_classes(20000).build();
+	auto result = caoco::llk_parser::parse(deep.cbegin(), deep.cend(), caoco::llk_parser::e_rule::pragmatic_block_);
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	EXPECT_TRUE(result.always() == deep.cend());
+}
+#endif
+
+#if CAOCO_TEST_PARSER_NESTING_DeepArithmetic
+TEST(ut_Parser_Nesting, DeepArithmetic) {
+	using astnode_enum = caoco::astnode_enum;
+	// ((((1) + 1) + 1) ... + 1), each operation wrapped in an expression_ node.
+	const int depth = 100000;
+	caoco::astnode tree(astnode_enum::number_literal_, u8"1");
+	for (int i = 0; i < depth; i++) {
+		caoco::astnode sum(astnode_enum::addition_, u8"+", std::move(tree), caoco::astnode(astnode_enum::number_literal_, u8"1"));
+		tree = caoco::astnode(astnode_enum::expression_, u8"", std::move(sum));
+	}
+	tree = caoco::expression_simplify(std::move(tree));
+	sl_size levels = 0;
+	for (auto& node : tree.preorder()) {
+		EXPECT_NE(node.type(), astnode_enum::expression_);
+		if (node.type() == astnode_enum::addition_) levels++;
+	}
+	EXPECT_EQ(levels, depth);
+
+	caoco::rtenv env("global");
+	auto value = caoco::CBinopEval{}(tree, env);
+	ASSERT_EQ(value.type, caoco::RTValue::NUMBER);
+	EXPECT_EQ(value.get<int>(), depth + 1);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parser Scratch Arena Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_PARSER_SCRATCH
+#define CAOCO_TEST_PARSER_SCRATCH_Scopes 1
+#define CAOCO_TEST_PARSER_SCRATCH_ParserTemporaries 1
+#define CAOCO_TEST_PARSER_SCRATCH_NoSubtreeCopies 1
+#endif
+
+#if CAOCO_TEST_PARSER_SCRATCH_Scopes
+TEST(ut_Parser_Scratch, Scopes) {
+	auto& arena = scratch_arena::local();
+	ASSERT_FALSE(arena.in_scope());
+	// Outside a scope scratch containers use the heap.
+	const sl_size heap_before = arena.heap_allocations();
+	{
+		scratch_vector<int> outside(16);
+		EXPECT_EQ(arena.heap_allocations(), heap_before + 1);
+	}
+	{
+		scratch_scope outer;
+		scratch_vector<int> kept(16);
+		const sl_size kept_bytes = arena.bytes_in_use();
+		EXPECT_GE(kept_bytes, 16 * sizeof(int));
+		{
+			// The last block handed out is reused as soon as it is freed.
+			scratch_stack<int> temporary;
+			for (int i = 0; i < 100; i++) temporary.push(i);
+			EXPECT_GT(arena.bytes_in_use(), kept_bytes);
+		}
+		{
+			scratch_scope inner;
+			scratch_vector<int> temporary(8);
+		}
+		// Closing a nested scope keeps the memory of the outer one.
+		EXPECT_TRUE(arena.in_scope());
+		EXPECT_EQ(kept.size(), 16);
+		kept[15] = 1;
+	}
+	EXPECT_EQ(arena.bytes_in_use(), 0);
+	EXPECT_EQ(arena.heap_allocations(), heap_before + 1);
+}
+#endif
+
+#if CAOCO_TEST_PARSER_SCRATCH_ParserTemporaries
+TEST(ut_Parser_Scratch, ParserTemporaries) {
+	auto tokens = make_llk_program(50).build();
+	auto& arena = scratch_arena::local();
+	const sl_size scratch_before = arena.heap_allocations();
+	const heap_usage before_parse = heap_usage::local();
+	auto program = caoco::parse_program(tokens.cbegin(), tokens.cend());
+	const heap_usage parse = heap_usage::local().since(before_parse);
+	EXPECT_EQ(program.children().size(), 2);
+	// A copy allocates only the nodes of the tree, what the parse allocated beyond it were temporaries.
+	const heap_usage before_copy = heap_usage::local();
+	auto program_copy = program;
+	const heap_usage tree = heap_usage::local().since(before_copy);
+	// Scope stacks and statement lists come from the arena and block children are reserved up front, the few left
+	// are the arena's own chunks.
+	EXPECT_LT(parse.allocations - tree.allocations, 5);
+	EXPECT_LT(arena.heap_allocations() - scratch_before, 10);
+	EXPECT_EQ(arena.bytes_in_use(), 0);
+}
+#endif
+
+#if CAOCO_TEST_PARSER_SCRATCH_NoSubtreeCopies
+// Parse results are moved into their parents, parsing a whole program must not copy any subtree.
+TEST(ut_Parser_Scratch, NoSubtreeCopies) {
+	auto tokens = make_llk_program(50).build();
+	const auto copies_before = caoco::astnode::copy_count();
+	auto program = caoco::parse_program(tokens.cbegin(), tokens.cend());
+	EXPECT_EQ(caoco::astnode::copy_count() - copies_before, 0);
+	ASSERT_EQ(program.children().size(), 2);
+	EXPECT_EQ(program[0].children().size(), 50 * 6);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parser Diagnostics Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_PARSER_DIAGNOSTICS
+#define CAOCO_TEST_PARSER_DIAGNOSTICS_SpeculativeFailure 1
+#define CAOCO_TEST_PARSER_DIAGNOSTICS_PrattFailure 1
+#define CAOCO_TEST_PARSER_DIAGNOSTICS_Tokenizer 1
+#endif
+
+#if CAOCO_TEST_PARSER_DIAGNOSTICS_SpeculativeFailure
+TEST(ut_Parser_Diagnostics, SpeculativeFailure) {
+	caoco_token_builder builder;
+	builder.add(caoco::tk_enum::comma_, ",");
+	builder.add(caoco::tk_enum::eos_, ";");
+	auto tokens = builder.build();
+	auto result = caoco::parse_operand(tokens.cbegin(), tokens.cend());
+	ASSERT_FALSE(result.valid());
+	// The failure is kept as a record until its message is asked for.
+	const auto& diagnostic = result.diagnostic();
+	EXPECT_EQ(diagnostic.code, static_cast<sl_uint32>(caoco::ca_error::e_code::parser_logic_error_));
+	EXPECT_EQ(diagnostic.location, &tokens.front());
+	EXPECT_EQ(result.error_message(), caoco::ca_error::parser::programmer_logic_error(caoco::astnode_enum::operand_,
+		tokens.cbegin(), sl_string("parse_operand : Invalid operand, not a literal or an identifier.")));
+
+	// Chaining formats the cause into the new message.
+	auto chained = result.chain_failure(tokens.cbegin(), caoco::ca_error::parser::invalid_expression(tokens.cbegin(), "outer"));
+	EXPECT_TRUE(chained.diagnostic().empty());
+	EXPECT_EQ(chained.error_message().find(result.error_message()), 0);
+	EXPECT_NE(chained.error_message().find("error detail: outer"), sl_string::npos);
+}
+#endif
+
+#if CAOCO_TEST_PARSER_DIAGNOSTICS_PrattFailure
+TEST(ut_Parser_Diagnostics, PrattFailure) {
+	auto input_vec = sl::to_u8vec(u8"(a b)");
+	auto tokens = tokenizer(input_vec.cbegin(), input_vec.cend())();
+	ASSERT_TRUE(tokens.valid());
+	const auto& tk_vec = tokens.expected();
+	pratt_parser parser(tk_vec.cbegin(), tk_vec.cend());
+	ASSERT_FALSE(parser.parse().valid()); // Sizes the work stack.
+
+	// Once the work stack is sized a failed parse allocates nothing, the message is formatted on demand.
+	const heap_usage before = heap_usage::local();
+	auto result = parser.parse();
+	EXPECT_EQ(heap_usage::local().since(before).allocations, 0);
+	ASSERT_FALSE(result.valid());
+	EXPECT_EQ(result.diagnostic().code, static_cast<sl_uint32>(compiler_error::e_code::invalid_expression_));
+	EXPECT_EQ(result.diagnostic().location, &tk_vec[2]);
+	EXPECT_NE(result.error_message().find("Operand following an operand."), sl_string::npos);
+}
+#endif
+
+#if CAOCO_TEST_PARSER_DIAGNOSTICS_Tokenizer
+TEST(ut_Parser_Diagnostics, Tokenizer) {
+	auto input_vec = sl::to_u8vec(u8"$");
+	auto result = tokenizer(input_vec.cbegin(), input_vec.cend())();
+	ASSERT_FALSE(result.valid());
+	EXPECT_EQ(result.diagnostic().code, static_cast<sl_uint32>(compiler_error::e_code::invalid_char_));
+	EXPECT_EQ(result.error_message(), compiler_error::tokenizer::invalid_char(1, 1, u8'$', sl_string()));
+
+	// Errors built from another message are formatted at once.
+	auto misspelled = sl::to_u8vec(u8"#inclde");
+	result = tokenizer(misspelled.cbegin(), misspelled.cend())();
+	ASSERT_FALSE(result.valid());
+	EXPECT_TRUE(result.diagnostic().empty());
+	EXPECT_NE(result.error_message().find("Lexer syntax error"), sl_string::npos);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Result Types Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_RESULT_TYPES
+#define CAOCO_TEST_RESULT_TYPES_MoveOnly 1
+#define CAOCO_TEST_RESULT_TYPES_Monadic 1
+#endif
+
+#if CAOCO_TEST_RESULT_TYPES_MoveOnly
+TEST(ut_Result_Types, MoveOnly) {
+	using result_t = sl_partial_expected<sl_vector<int>, int>;
+	static_assert(!std::is_copy_constructible_v<result_t> && std::is_nothrow_move_constructible_v<result_t>);
+	static_assert(!std::is_copy_constructible_v<sl_expected<sl_string>>);
+	// The value and the error share storage, there is no message on the success path.
+	static_assert(sizeof(sl_expected<sl_vector<int>>) <= sizeof(sl_error) + sizeof(void*));
+
+	auto success = result_t::make_success(3, sl_vector<int>{ 1, 2, 3 });
+	const int* data = success.expected().data();
+	auto moved = std::move(success);
+	EXPECT_EQ(moved.expected().data(), data);
+	EXPECT_TRUE(moved.error_message().empty());
+
+	auto copy = moved.copy();
+	sl_vector<int> value = moved.extract();
+	EXPECT_EQ(value.data(), data);
+	// An extracted result is no longer valid, its copy is untouched.
+	EXPECT_FALSE(moved.valid());
+	EXPECT_EQ(copy.expected().size(), 3);
+
+	auto failure = result_t::make_failure(7, "first.");
+	auto chained = failure.chain_failure(8, "second.");
+	EXPECT_EQ(chained.always(), 7);
+	EXPECT_EQ(chained.error_message(), "first.second.");
+	EXPECT_EQ(failure.copy().error_message(), "first.");
+}
+#endif
+
+#if CAOCO_TEST_RESULT_TYPES_Monadic
+TEST(ut_Result_Types, Monadic) {
+	auto halve = [](int x) {
+		return x % 2 == 0 ? sl_expected<int>::make_success(x / 2) : sl_expected<int>::make_failure("odd.");
+	};
+	auto quarter = sl_expected<int>::make_success(12).and_then(halve).and_then(halve);
+	ASSERT_TRUE(quarter.valid());
+	EXPECT_EQ(quarter.expected(), 3);
+	auto odd = sl_expected<int>::make_success(6).and_then(halve).and_then(halve).transform([](int x) { return x * 10; });
+	EXPECT_FALSE(odd.valid());
+	EXPECT_EQ(odd.error_message(), "odd.");
+
+	using result_t = sl_partial_expected<sl_string, int>;
+	auto next = [](int position, sl_string&& text) {
+		return text.empty() ? result_t::make_failure(position, "empty.") : result_t::make_success(position + 1, text + "!");
+	};
+	auto parsed = result_t::make_success(1, "a").and_then(next).transform([](sl_string&& text) { return text.size(); });
+	ASSERT_TRUE(parsed.valid());
+	EXPECT_EQ(parsed.always(), 2);
+	EXPECT_EQ(parsed.expected(), 2);
+	auto empty = result_t::make_success(4, "").and_then(next).and_then(next);
+	EXPECT_EQ(empty.always(), 4);
+	EXPECT_EQ(empty.error_message(), "empty.");
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parser Program Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_PARSER_PROGRAM
+#define CAOCO_TEST_PARSER_PROGRAM_MinimumProgram 1
+#define CAOCO_TEST_PARSER_PROGRAM_BasicProgram 1
+#endif
+
+#if CAOCO_TEST_PARSER_PROGRAM_MinimumProgram 
+TEST(CaocoParser_MinimumProgram, CaocoParser_Test) {
+	auto source_file = caoco::sl::load_file_to_char8_vector("ut_parser_minimum_program.candi");
+	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
+	EXPECT_TRUE(exp_result.valid());
+	if (exp_result.valid()) {
+		auto result = exp_result.expected();
+
+		try {
+			auto parse_result = caoco::parse_program(result.cbegin(), result.cend());
+			print_ast(parse_result);
+		}
+		catch (std::exception e) {
+			std::cout << e.what() << std::endl;
+		}
+	}
+	else {
+		std::cout << exp_result.error_message() << std::endl;
+	}
+}
+#endif
+
+
+#if CAOCO_TEST_PARSER_PROGRAM_BasicProgram
+TEST(CaocoParser_BasicProgram, CaocoParser_Test) {
+
+	auto source_file = caoco::sl::load_file_to_char8_vector("ut_program_basic.candi");
+	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
+	EXPECT_TRUE(exp_result.valid());
+	if (exp_result.valid()) {
+		auto result = exp_result.expected();
+
+		try {
+			auto parse_result = caoco::parse_program(result.cbegin(), result.cend());
+			print_ast(parse_result);
+		}
+		catch (std::exception e) {
+			std::cout << e.what() << std::endl;
+		}
+	}
+	else {
+		std::cout << exp_result.error_message() << std::endl;
+	}
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Preprocessor Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if CAOCO_TEST_PREPROCESSOR
+#define CAOCO_TEST_PREPROCESSOR_Include  1
+#define CAOCO_TEST_PREPROCESSOR_Macro 1
+#endif
+
+#if CAOCO_TEST_PREPROCESSOR_Include 
+TEST(CaocoPreprocessor_Include, CaocoPreprocessor_Test) {
+	auto source_file = caoco::sl::load_file_to_char8_vector("ut_preprocessor_include.candi");
+	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
+	EXPECT_TRUE(exp_result.valid());
+	if (exp_result.valid()) {
+		auto result = exp_result.expected();
+		auto preprocessed = caoco::preprocess(result, "ut_preprocessor_include.candi");
+
+		if (!std::get<1>(preprocessed)) {
+			std::cout << "Preprocessing Error: " << std::get<2>(preprocessed) << std::endl;
+		}
+		else {
+			for (auto& token : std::get<0>(preprocessed)) {
+				std::cout << token.literal_str();
+			}
+		}
+	}
+	else {
+		std::cout << exp_result.error_message() << std::endl;
+	}
+}
+#endif
+
+#if CAOCO_TEST_PREPROCESSOR_Macro
+TEST(CaocoPreprocessor_Macro, CaocoPreprocessor_Test) {
+	auto source_file = caoco::sl::load_file_to_char8_vector("ut_preprocessor_macros.candi");
+	auto exp_result = caoco::tokenizer(source_file.cbegin(), source_file.cend())();
+	EXPECT_TRUE(exp_result.valid());
+	if (exp_result.valid()) {
+		auto result = exp_result.expected();
+		auto expanded = caoco::macro_expand(result, "ut_preprocessor_macros.candi");
+
+		if(!std::get<1>(expanded)) {
+			std::cout << "Macro Expansion Error: " << std::get<2>(expanded) << std::endl;
+		}
+		else {
+			for (auto& token : std::get<0>(expanded)) {
+				std::cout << token.literal_str();
+			}
+		}
+
+	}
+	else {
+		std::cout << exp_result.error_message() << std::endl;
+	}
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Const Evaluator Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if CAOCO_TEST_CONST_EVALUATOR
 #define CAOCO_TEST_CONST_EVALUATOR_Literals 1
 #define CAOCO_TEST_CONST_EVALUATOR_MathOperators 1
 #define CAOCO_TEST_CONST_EVALUATOR_VariableDeclaration 0
@@ -1993,49 +3597,49 @@ TEST(CaocoConstantEvaluator_Literals, CaocoConstantEvaluator_Test) {
 		auto int_literal = caoco::parse_operand(result.cbegin(), result.cend());
 		auto eval_result = caoco::CNumberEval()(int_literal.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NUMBER);
-		EXPECT_EQ(std::get<int>(eval_result.value), 42);
+		EXPECT_EQ(eval_result.get<int>(), 42);
 
 		// real literal
 		auto real_literal = caoco::parse_operand(int_literal.always(), result.cend());
 		eval_result = caoco::CRealEval()(real_literal.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::REAL);
-		EXPECT_EQ(std::get<double>(eval_result.value), 42.42);
+		EXPECT_EQ(eval_result.get<double>(), 42.42);
 
 		// string literal
 		auto string_literal = caoco::parse_operand(real_literal.always(), result.cend());
 		eval_result = caoco::CStringEval()(string_literal.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::STRING);
-		EXPECT_EQ(std::get<caoco::sl_string>(eval_result.value), "Hello'World");
+		EXPECT_EQ(eval_result.get<caoco::sl_string>(), "Hello'World");
 
 		// bit literal
 		auto bit_literal = caoco::parse_operand(string_literal.always(), result.cend());
 		eval_result = caoco::CBitEval()(bit_literal.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::BIT);
-		EXPECT_EQ(std::get<bool>(eval_result.value), true);
+		EXPECT_EQ(eval_result.get<bool>(), true);
 
 		// unsigned int literal
 		auto uint_literal = parse_operand(bit_literal.always(), result.cend());
 		eval_result = caoco::CUnsignedEval()(uint_literal.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::UNSIGNED);
-		EXPECT_EQ(std::get<unsigned int>(eval_result.value), 42u);
+		EXPECT_EQ(eval_result.get<unsigned int>(), 42u);
 
 		// octet literal
 		auto octet_literal = parse_operand(uint_literal.always(), result.cend());
 		eval_result = caoco::COctetEval()(octet_literal.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::BYTE);
-		EXPECT_EQ(std::get<unsigned char>(eval_result.value), (unsigned char)42);
+		EXPECT_EQ(eval_result.get<unsigned char>(), (unsigned char)42);
 
 		// octet  from char
 		auto octet_from_char = parse_operand(octet_literal.always(), result.cend());
 		eval_result = caoco::COctetEval()(octet_from_char.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::BYTE);
-		EXPECT_EQ(std::get<unsigned char>(eval_result.value), (unsigned char)'a');
+		EXPECT_EQ(eval_result.get<unsigned char>(), (unsigned char)'a');
 
 		// none
 		auto none_literal = parse_operand(octet_from_char.always(), result.cend());
 		eval_result = caoco::CNoneEval()(none_literal.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NONE);
-		EXPECT_EQ(std::get<caoco::none_t>(eval_result.value), caoco::none_t{});
+		EXPECT_EQ(eval_result.get<caoco::none_t>(), caoco::none_t{});
 
 	}
 	else
@@ -2058,27 +3662,27 @@ TEST(CaocoConstantEvaluator_Operators, CaocoConstantEvaluator_Operators) {
 		auto expr = caoco::parse_value_statement(result.cbegin(), result.cend());
 		auto eval_result = caoco::CAddOpEval()(expr.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NUMBER);
-		EXPECT_EQ(std::get<int>(eval_result.value), 2);
+		EXPECT_EQ(eval_result.get<int>(), 2);
 
 		// multiple operators <numlit><+><numlit><+><numlit> 1+1+1
 		expr = caoco::parse_value_statement(expr.always(), result.cend());
 		eval_result = caoco::CBinopEval()(expr.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NUMBER);
-		EXPECT_EQ(std::get<int>(eval_result.value), 5);
+		EXPECT_EQ(eval_result.get<int>(), 5);
 
 
 		// operator -        1 + 1 - 1
 		expr = caoco::parse_value_statement(expr.always(), result.cend());
 		eval_result = caoco::CBinopEval()(expr.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NUMBER);
-		EXPECT_EQ(std::get<int>(eval_result.value), 1);
+		EXPECT_EQ(eval_result.get<int>(), 1);
 
 		//// operators + - * / %
 		//// 1 + 1 - 1 * 1 / 1 % 1 (== 2)
 		//expr = caoco::parse_value_statement(expr.always(), result.cend());
 		//eval_result = caoco::CBinopEval()(expr.expected(), runtime_env);
 		//EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NUMBER);
-		//EXPECT_EQ(std::get<int>(eval_result.value), 2);
+		//EXPECT_EQ(eval_result.get<int>(), 2);
 
 		// variable in expression
 		//1 + a;
@@ -2086,7 +3690,7 @@ TEST(CaocoConstantEvaluator_Operators, CaocoConstantEvaluator_Operators) {
 		expr = caoco::parse_value_statement(expr.always(), result.cend());
 		eval_result = caoco::CBinopEval()(expr.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NUMBER);
-		EXPECT_EQ(std::get<int>(eval_result.value), 43);
+		EXPECT_EQ(eval_result.get<int>(), 43);
 
 	}
 	else
@@ -2111,9 +3715,9 @@ TEST(CaocoConstantEvaluator_VariableDeclaration, CaocoConstantEvaluator_Variable
 		EXPECT_TRUE(var_decl.valid());
 		auto eval_result = caoco::CVarDeclEval()(var_decl.expected(), runtime_env);
 		EXPECT_EQ(eval_result.type, caoco::RTValue::eType::NUMBER);
-		EXPECT_EQ(std::get<int>(eval_result.value), 1);
-		//std::cout << "Variable a = " << std::get<int>(runtime_env.resolve_variable("a").value().value) << std::endl;
-		EXPECT_EQ(std::get<int>(runtime_env.resolve_variable("a").value().value), 1);
+		EXPECT_EQ(eval_result.get<int>(), 1);
+		//std::cout << "Variable a = " << runtime_env.resolve_variable("a").value().get<int>() << std::endl;
+		EXPECT_EQ(runtime_env.resolve_variable("a").value().get<int>(), 1);
 	}
 	else {
 		std::cout << exp_result.error_message() << std::endl;
@@ -2140,10 +3744,10 @@ TEST(CaocoConstantEvaluator_Structs, CaocoConstantEvaluator_Test) {
 	print_ast(class_decl.node());
 	auto eval_result = caoco::CClassDeclEval()(class_decl.node(), runtime_env);
 
-	auto class_obj = std::get<std::shared_ptr<caoco::object_t>>(eval_result.value).get();
-	EXPECT_EQ(std::get<int>(class_obj->get_member("a").value), 1);
-	EXPECT_EQ(std::get<int>(class_obj->get_member("b").value), 2);
-	EXPECT_EQ(std::get<int>(class_obj->get_member("c").value), 3);
+	auto class_obj = eval_result.object();
+	EXPECT_EQ(class_obj->get_member("a").get<int>(), 1);
+	EXPECT_EQ(class_obj->get_member("b").get<int>(), 2);
+	EXPECT_EQ(class_obj->get_member("c").get<int>(), 3);
 }
 #endif
 #if CAOCO_UT_ConstantEvaluator_FreeFunctions
@@ -2178,7 +3782,1561 @@ TEST(CaocoConstantEvaluator_FreeFunctions, CaocoConstantEvaluator_Test) {
 
 	//// Check the result of the function call.
 	//EXPECT_EQ(eval_result2.type, caoco::RTValue::eType::NUMBER);
-	//EXPECT_EQ(std::get<int>(eval_result2.value), 42);
+	//EXPECT_EQ(eval_result2.get<int>(), 42);
+
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runtime Value Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_RTVALUE
+#define CAOCO_TEST_RTVALUE_Strings 1
+#define CAOCO_TEST_RTVALUE_Handles 1
+#endif
+
+#if CAOCO_TEST_RTVALUE_Strings
+TEST(ut_RTValue, Strings) {
+	using caoco::RTValue;
+	static_assert(sizeof(RTValue) == 16);
+
+	// Short strings are stored inside the value.
+	RTValue small(RTValue::STRING, sl_string("12345678"));
+	EXPECT_EQ(small.string(), "12345678");
+	EXPECT_TRUE(small.string().data() >= reinterpret_cast<const char*>(&small)
+		&& small.string().data() < reinterpret_cast<const char*>(&small + 1));
+
+	// Longer strings are shared by copies.
+	RTValue heap(RTValue::STRING, sl_string("a longer string"));
+	RTValue copy = heap;
+	EXPECT_EQ(copy.string().data(), heap.string().data());
+	EXPECT_EQ(copy, heap);
+
+	// Interned strings share storage without being copies of each other.
+	RTValue first = RTValue::interned("an interned string");
+	RTValue second = RTValue::interned("an interned string");
+	EXPECT_EQ(first.string().data(), second.string().data());
+	EXPECT_NE(first.string().data(), RTValue(RTValue::STRING, "an interned string").string().data());
+
+	// String literals are interned, concatenation makes a new string.
+	caoco::rtenv env("global");
+	auto literal = caoco::astnode(caoco::astnode_enum::string_literal_, u8"'Hello World!'");
+	EXPECT_EQ(caoco::CStringEval{}(literal, env).string().data(), caoco::CStringEval{}(literal, env).string().data());
+	auto sum = caoco::add_rtvalues(RTValue(RTValue::STRING, "Hello"), RTValue(RTValue::STRING, " World!"));
+	EXPECT_EQ(sum.get<sl_string>(), "Hello World!");
+	EXPECT_THROW(sum.get<int>(), std::runtime_error);
+
+	// Scalars are converted to the type of the value.
+	EXPECT_EQ(caoco::add_rtvalues(RTValue(RTValue::BIT, true), RTValue(RTValue::BIT, true)).get<bool>(), true);
+}
+#endif
+
+#if CAOCO_TEST_RTVALUE_Handles
+TEST(ut_RTValue, Handles) {
+	using caoco::RTValue;
+	caoco::rtenv env("global");
+	auto object = caoco::make_rtref<caoco::object_t>("obj", env.add_subenv("obj"));
+	EXPECT_EQ(object->ref_count(), 1);
+	{
+		RTValue value(RTValue::OBJECT, object);
+		RTValue copy = value;
+		EXPECT_EQ(object->ref_count(), 3);
+		RTValue moved = std::move(copy);
+		EXPECT_EQ(object->ref_count(), 3);
+		EXPECT_EQ(moved.object(), object);
+		EXPECT_THROW(moved.function(), std::runtime_error);
+	}
+	EXPECT_EQ(object->ref_count(), 1);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constant Evaluator Bytecode VM Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_CONST_EVALUATOR_VM
+#define CAOCO_TEST_CONST_EVALUATOR_VM_MatchesTreeWalker 1
+#define CAOCO_TEST_CONST_EVALUATOR_VM_FunctionCalls 1
+#define CAOCO_TEST_CONST_EVALUATOR_VM_ResolvedSlots 1
+#define CAOCO_TEST_CONST_EVALUATOR_VM_ReleasesReferences 1
+#define CAOCO_TEST_CONST_EVALUATOR_VM_Statements 1
+#define CAOCO_TEST_CONST_EVALUATOR_VM_Shadowing 1
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_VM || CAOCO_TEST_CONST_EVALUATOR_BINOP || CAOCO_TEST_CONSTANT_FOLDING \
+	|| CAOCO_TEST_CONST_EVALUATOR_MEMO || CAOCO_TEST_CONST_EVALUATOR_CALLS || CAOCO_TEST_CONST_EVALUATOR_ENV \
+	|| CAOCO_TEST_CONST_EVALUATOR_SHAPES || CAOCO_TEST_BENCHMARK
+bool ceval_equal(const caoco::RTValue& a, const caoco::RTValue& b) {
+	return a == b;
+}
+
+caoco::astnode ceval_binop(caoco::astnode_enum op, caoco::astnode left, caoco::astnode right) {
+	return caoco::astnode(op, u8"", std::move(left), std::move(right));
+}
+
+caoco::astnode ceval_leaf(caoco::astnode_enum type, const char8_t* literal) {
+	return caoco::astnode(type, literal);
+}
+
+// #func name(arg) { #return body; };
+caoco::astnode ceval_function(const char8_t* name, const char8_t* arg, caoco::astnode body) {
+	using astnode_enum = caoco::astnode_enum;
+	return caoco::astnode(astnode_enum::method_definition_, u8"",
+		ceval_leaf(astnode_enum::alnumus_, name),
+		caoco::astnode(astnode_enum::arguments_, u8"", ceval_leaf(astnode_enum::alnumus_, arg)),
+		caoco::astnode(astnode_enum::functional_block_, u8"", caoco::astnode(astnode_enum::return_, u8"", std::move(body))));
+}
+
+caoco::astnode ceval_call(const char8_t* name, caoco::astnode argument) {
+	return caoco::astnode(caoco::astnode_enum::function_call_, u8"", ceval_leaf(caoco::astnode_enum::alnumus_, name), std::move(argument));
+}
+
+// #func name(args...) { statements... };
+caoco::astnode ceval_function_block(const char8_t* name, std::initializer_list<const char8_t*> args, caoco::astnode block) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::astnode arguments(astnode_enum::arguments_);
+	for (auto arg : args) arguments.push_back(ceval_leaf(astnode_enum::alnumus_, arg));
+	return caoco::astnode(astnode_enum::method_definition_, u8"", ceval_leaf(astnode_enum::alnumus_, name),
+		std::move(arguments), std::move(block));
+}
+
+// #if (condition) { #return then; }; #return otherwise;
+caoco::astnode ceval_if_return(caoco::astnode condition, caoco::astnode then, caoco::astnode otherwise) {
+	using astnode_enum = caoco::astnode_enum;
+	return caoco::astnode(astnode_enum::functional_block_, u8"",
+		caoco::astnode(astnode_enum::conditional_statement_, u8"",
+			caoco::astnode(astnode_enum::if_, u8"", caoco::astnode(astnode_enum::expression_, u8"", std::move(condition)),
+				caoco::astnode(astnode_enum::functional_block_, u8"", caoco::astnode(astnode_enum::return_, u8"", std::move(then))))),
+		caoco::astnode(astnode_enum::return_, u8"", std::move(otherwise)));
+}
+
+// #var name = value;
+caoco::astnode ceval_var(const char8_t* name, caoco::astnode value) {
+	using astnode_enum = caoco::astnode_enum;
+	return caoco::astnode(astnode_enum::anon_variable_definition_assingment_, u8"", ceval_leaf(astnode_enum::alnumus_, name),
+		caoco::astnode(astnode_enum::simple_assignment_, u8"", ceval_leaf(astnode_enum::alnumus_, name), std::move(value)));
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_VM_MatchesTreeWalker
+TEST(ut_ConstEvaluator_Vm, MatchesTreeWalker) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	caoco::bytecode_vm vm;
+	// ut_ceval_literals.candi
+	const std::pair<astnode_enum, const char8_t*> literals[] = {
+		{ astnode_enum::number_literal_, u8"42" }, { astnode_enum::real_literal_, u8"42.42" },
+		{ astnode_enum::string_literal_, u8"'Hello\\'World'" }, { astnode_enum::bit_literal_, u8"1b" },
+		{ astnode_enum::unsigned_literal_, u8"42u" }, { astnode_enum::byte_literal_, u8"42c" },
+		{ astnode_enum::byte_literal_, u8"'a'c" }, { astnode_enum::none_literal_, u8"#none" }
+	};
+	for (const auto& [type, literal] : literals) {
+		auto node = ceval_leaf(type, literal);
+		EXPECT_TRUE(ceval_equal(vm.run(node, env), caoco::CLiteralEval{}(node, env)));
+	}
+
+	// ut_ceval_operators.candi: 1 + 1; 1 + 1 + 1 + 1 + 1; 1 + 1 - 1; 1 + a; and 1 + 1 - 1 * 1 / 1 % 1;
+	auto one = [] { return ceval_leaf(astnode_enum::number_literal_, u8"1"); };
+	env.create_variable("a", caoco::RTValue(caoco::RTValue::eType::NUMBER, 42));
+	sl_vector<caoco::astnode> expressions;
+	expressions.push_back(ceval_binop(astnode_enum::addition_, one(), one()));
+	caoco::astnode chain = one();
+	for (int i = 0; i < 4; i++) chain = ceval_binop(astnode_enum::addition_, std::move(chain), one());
+	expressions.push_back(std::move(chain));
+	expressions.push_back(ceval_binop(astnode_enum::subtraction_, ceval_binop(astnode_enum::addition_, one(), one()), one()));
+	expressions.push_back(ceval_binop(astnode_enum::addition_, one(), ceval_leaf(astnode_enum::alnumus_, u8"a")));
+	expressions.push_back(ceval_binop(astnode_enum::subtraction_, ceval_binop(astnode_enum::addition_, one(), one()),
+		ceval_binop(astnode_enum::remainder_, ceval_binop(astnode_enum::division_,
+			ceval_binop(astnode_enum::multiplication_, one(), one()), one()), one())));
+	const int expected[] = { 2, 5, 1, 43, 2 };
+	for (sl_size i = 0; i < expressions.size(); i++) {
+		auto walked = caoco::CBinopEval{}(expressions[i], env);
+		auto executed = vm.run(expressions[i], env);
+		EXPECT_TRUE(ceval_equal(executed, walked));
+		EXPECT_EQ(executed.get<int>(), expected[i]);
+	}
+
+	// Errors are the same as well.
+	auto mixed = ceval_binop(astnode_enum::addition_, one(), ceval_leaf(astnode_enum::real_literal_, u8"1.5"));
+	EXPECT_THROW(vm.run(mixed, env), std::runtime_error);
+	auto unknown = ceval_binop(astnode_enum::addition_, one(), ceval_leaf(astnode_enum::alnumus_, u8"b"));
+	try {
+		vm.run(unknown, env);
+		ADD_FAILURE();
+	}
+	catch (const std::runtime_error& e) {
+		EXPECT_EQ(sl_string(e.what()), "CVariableEval:Variable not found:b");
+	}
+	// The stack is reset after a run which threw.
+	EXPECT_TRUE(ceval_equal(vm.run(expressions[3], env), caoco::RTValue(caoco::RTValue::eType::NUMBER, 43)));
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_VM_FunctionCalls
+TEST(ut_ConstEvaluator_Vm, FunctionCalls) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	caoco::bytecode_vm vm;
+	// ut_ceval_free_functions.candi: #func add(x) { #return x + 40; }; add(2);
+	caoco::CFunctionDeclEval{}(ceval_function(u8"add", u8"x",
+		ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"x"),
+			ceval_leaf(astnode_enum::number_literal_, u8"40"))), env);
+	auto call = [](caoco::astnode argument) {
+		return caoco::astnode(astnode_enum::function_call_, u8"", ceval_leaf(astnode_enum::alnumus_, u8"add"), std::move(argument));
+	};
+	auto add_two = call(ceval_leaf(astnode_enum::number_literal_, u8"2"));
+	auto walked = caoco::CFunctionCallEval{}(add_two, env);
+	auto executed = vm.run(add_two, env);
+	EXPECT_TRUE(ceval_equal(executed, walked));
+	EXPECT_EQ(executed.get<int>(), 42);
+	// The argument is unbound after the call.
+	EXPECT_FALSE(env.resolve_variable("x").valid());
+
+	// Calls nested in expressions and arguments: add(add(2) * 2) - 1
+	auto nested = ceval_binop(astnode_enum::subtraction_,
+		call(ceval_binop(astnode_enum::multiplication_, std::move(add_two), ceval_leaf(astnode_enum::number_literal_, u8"2"))),
+		ceval_leaf(astnode_enum::number_literal_, u8"1"));
+	EXPECT_EQ(vm.run(nested, env).get<int>(), 123);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_VM_ReleasesReferences
+TEST(ut_ConstEvaluator_Vm, ReleasesReferences) {
+	using astnode_enum = caoco::astnode_enum;
+	const sl_size live = caoco::rtenv::live_count();
+	{
+		caoco::rtenv env("global");
+		caoco::bytecode_vm vm;
+		caoco::CFunctionDeclEval{}(ceval_function(u8"add", u8"x",
+			ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"x"),
+				ceval_leaf(astnode_enum::number_literal_, u8"40"))), env);
+		auto add_two = ceval_call(u8"add", ceval_leaf(astnode_enum::number_literal_, u8"2"));
+		auto add = env.resolve_variable("add").value().function();
+		const auto held = add->ref_count();
+		// Calls by name and by resolved slot hold the function only while they run.
+		const auto by_name = caoco::bytecode_compiler::compile(add_two);
+		const auto by_slot = caoco::bytecode_compiler::compile(add_two, &env);
+		for (int i = 0; i < 3; i++) {
+			EXPECT_EQ(vm.run(by_name, env).get<int>(), 42);
+			EXPECT_EQ(vm.run(by_slot, env).get<int>(), 42);
+		}
+		EXPECT_EQ(add->ref_count(), held);
+	}
+	// The function was released with the env, and its scope with it.
+	EXPECT_EQ(caoco::rtenv::live_count(), live);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_VM_Statements
+TEST(ut_ConstEvaluator_Vm, Statements) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv global("global");
+	global.create_variable("limit", caoco::RTValue(caoco::RTValue::NUMBER, 10));
+	auto name = [](const char8_t* n) { return ceval_leaf(astnode_enum::alnumus_, n); };
+	auto number = [](const char8_t* literal) { return ceval_leaf(astnode_enum::number_literal_, literal); };
+	auto block = [](auto&&... statements) { return caoco::astnode(astnode_enum::functional_block_, u8"", std::move(statements)...); };
+	auto ret = [](caoco::astnode value) { return caoco::astnode(astnode_enum::return_, u8"", std::move(value)); };
+	auto condition = [](caoco::astnode value) { return caoco::astnode(astnode_enum::expression_, u8"", std::move(value)); };
+	// #func f(n) { #var y = n * 2; #if (y < limit) { #var z = y + 1; #return z; } #elif (y == limit) { #var z = 0;
+	//   #if (n == 5) { #return z; }; } #else { #return y - limit; }; #return n; };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"f", { u8"n" }, block(
+		ceval_var(u8"y", ceval_binop(astnode_enum::multiplication_, name(u8"n"), number(u8"2"))),
+		caoco::astnode(astnode_enum::conditional_statement_, u8"",
+			caoco::astnode(astnode_enum::if_, u8"", condition(ceval_binop(astnode_enum::less_than_, name(u8"y"), name(u8"limit"))),
+				block(ceval_var(u8"z", ceval_binop(astnode_enum::addition_, name(u8"y"), number(u8"1"))), ret(name(u8"z")))),
+			caoco::astnode(astnode_enum::elif_, u8"", condition(ceval_binop(astnode_enum::equal_, name(u8"y"), name(u8"limit"))),
+				block(ceval_var(u8"z", number(u8"0")),
+					caoco::astnode(astnode_enum::conditional_statement_, u8"",
+						caoco::astnode(astnode_enum::if_, u8"", condition(ceval_binop(astnode_enum::equal_, name(u8"n"), number(u8"5"))),
+							block(ret(name(u8"z"))))))),
+			caoco::astnode(astnode_enum::else_, u8"", block(ret(ceval_binop(astnode_enum::subtraction_, name(u8"y"), name(u8"limit")))))),
+		ret(name(u8"n")))), global);
+	auto f = global.resolve_variable("f").value().function();
+	caoco::bytecode_vm vm;
+	for (const char8_t* argument : { u8"1", u8"4", u8"5", u8"7" }) {
+		auto call = ceval_call(u8"f", number(argument));
+		auto walked = caoco::CFunctionCallEval{}(call, global);
+		EXPECT_TRUE(ceval_equal(vm.run(call, global), walked)) << sl::to_str(sl_u8string(argument));
+	}
+	EXPECT_EQ(vm.run(ceval_call(u8"f", number(u8"4")), global).get<int>(), 9);
+	EXPECT_EQ(vm.run(ceval_call(u8"f", number(u8"5")), global).get<int>(), 0);
+	EXPECT_EQ(vm.run(ceval_call(u8"f", number(u8"7")), global).get<int>(), 4);
+	// The body was compiled, its locals live on the VM stack instead of in block environments.
+	ASSERT_TRUE(f->compiled_body());
+	EXPECT_FALSE(f->compiled_body()->code.empty());
+	EXPECT_EQ(f->compiled_body()->locals, 3);
+	EXPECT_EQ(f->scope().subenv_count(), 0);
+	EXPECT_EQ(f->scope().subenv_capacity(), 0);
+
+	// A block which ends without a return returns none.
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"g", { u8"n" }, block(ceval_var(u8"y", name(u8"n")))), global);
+	EXPECT_EQ(vm.run(ceval_call(u8"g", number(u8"1")), global).type, caoco::RTValue::NONE);
+
+	// A declaration of a visible name runs in the tree walker, which reports it.
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"h", { u8"n" }, block(ceval_var(u8"limit", name(u8"n")), ret(name(u8"n")))), global);
+	EXPECT_THROW(vm.run(ceval_call(u8"h", number(u8"1")), global), std::runtime_error);
+	EXPECT_TRUE(global.resolve_variable("h").value().function()->compiled_body()->code.empty());
+	// A name declared in the scope after compiling is checked when the declaration runs.
+	global.create_variable("y", caoco::RTValue(caoco::RTValue::NUMBER, 0));
+	try {
+		vm.run(ceval_call(u8"f", number(u8"1")), global);
+		ADD_FAILURE();
+	}
+	catch (const std::runtime_error& e) {
+		EXPECT_EQ(sl_string(e.what()), "CAssignOpEval:Variable already declared:y");
+	}
+	EXPECT_THROW(caoco::CFunctionCallEval{}(ceval_call(u8"f", number(u8"1")), global), std::runtime_error);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_VM_Shadowing
+TEST(ut_ConstEvaluator_Vm, Shadowing) {
+	using astnode_enum = caoco::astnode_enum;
+	using caoco::RTValue;
+	// #var x = 10; { #func f(n) { #return n + x; }; f(1); #var x = 20; f(1); }
+	caoco::rtenv global("global");
+	global.create_variable("x", RTValue(RTValue::NUMBER, 10));
+	caoco::rtenv& inner = global.add_subenv("inner");
+	caoco::CFunctionDeclEval{}(ceval_function(u8"f", u8"n",
+		ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"n"), ceval_leaf(astnode_enum::alnumus_, u8"x"))), inner);
+	auto f_of_1 = ceval_call(u8"f", ceval_leaf(astnode_enum::number_literal_, u8"1"));
+	auto x_chunk = caoco::bytecode_compiler::compile(ceval_leaf(astnode_enum::alnumus_, u8"x"), &inner);
+	caoco::bytecode_vm vm;
+	EXPECT_EQ(vm.run(f_of_1, inner).get<int>(), 11);
+	EXPECT_EQ(vm.run(x_chunk, inner).get<int>(), 10);
+
+	// The declaration in inner shadows the x the chunks resolved in global, they are stale.
+	const auto generation = inner.generation();
+	inner.create_variable("x", RTValue(RTValue::NUMBER, 20));
+	EXPECT_NE(inner.generation(), generation);
+	EXPECT_TRUE(x_chunk.is_stale());
+	EXPECT_THROW(vm.run(x_chunk, inner), std::runtime_error);
+	EXPECT_EQ(vm.run(f_of_1, inner).get<int>(), 21);
+	EXPECT_EQ(caoco::CFunctionCallEval{}(f_of_1, inner).get<int>(), 21);
+	// A declaration which shadows nothing leaves resolved slots valid.
+	const auto shadowed = inner.generation();
+	inner.create_variable("w", RTValue(RTValue::NUMBER, 0));
+	EXPECT_EQ(inner.generation(), shadowed);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_VM_ResolvedSlots
+TEST(ut_ConstEvaluator_Vm, ResolvedSlots) {
+	using astnode_enum = caoco::astnode_enum;
+	using caoco::RTValue;
+	caoco::rtenv global("global");
+	global.create_variable("a", RTValue(RTValue::NUMBER, 1));
+	global.create_variable("b", RTValue(RTValue::NUMBER, 2));
+	caoco::rtenv& inner = global.add_subenv("inner");
+	inner.create_variable("c", RTValue(RTValue::NUMBER, 3));
+
+	auto a = inner.resolve_slot("a");
+	ASSERT_TRUE(a.has_value());
+	EXPECT_EQ(a->depth, 1);
+	EXPECT_EQ(a->slot, 0);
+	EXPECT_EQ(inner.at(*a).get<int>(), 1);
+	EXPECT_EQ(inner.resolve_slot("c")->depth, 0);
+	EXPECT_FALSE(inner.resolve_slot("z").has_value());
+	// A deleted variable's slot is reused.
+	EXPECT_TRUE(global.delete_variable("b"));
+	global.create_variable("d", RTValue(RTValue::NUMBER, 4));
+	EXPECT_EQ(global.resolve_slot("d")->slot, 1);
+	EXPECT_EQ(global.frame_size(), 2);
+
+	// a + c + z: a and c are resolved when compiling, z is looked up by name as it is declared later.
+	auto expression = ceval_binop(astnode_enum::addition_,
+		ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"a"), ceval_leaf(astnode_enum::alnumus_, u8"c")),
+		ceval_leaf(astnode_enum::alnumus_, u8"z"));
+	auto chunk = caoco::bytecode_compiler::compile(expression, &inner);
+	ASSERT_EQ(chunk.code.size(), 6);
+	EXPECT_EQ(chunk.code[0].op, caoco::e_opcode::load_slot_);
+	EXPECT_EQ(chunk.code[0].count, 1);
+	EXPECT_EQ(chunk.code[1].op, caoco::e_opcode::load_slot_);
+	EXPECT_EQ(chunk.code[1].count, 0);
+	EXPECT_EQ(chunk.code[3].op, caoco::e_opcode::load_var_);
+	global.create_variable("z", RTValue(RTValue::NUMBER, 10));
+	caoco::bytecode_vm vm;
+	EXPECT_EQ(vm.run(chunk, inner).get<int>(), 14);
+	EXPECT_THROW(vm.run(chunk, global), std::runtime_error);
+
+	// Function arguments are declared in the function scope when the function is.
+	caoco::CFunctionDeclEval{}(ceval_function(u8"twice", u8"x",
+		ceval_binop(astnode_enum::multiplication_, ceval_leaf(astnode_enum::alnumus_, u8"x"),
+			ceval_leaf(astnode_enum::number_literal_, u8"2"))), global);
+	auto twice = global.resolve_variable("twice").value().function();
+	auto x = twice->scope().resolve_slot("x");
+	ASSERT_TRUE(x.has_value());
+	EXPECT_EQ(x->depth, 0);
+	caoco::astnode call(astnode_enum::function_call_, u8"", ceval_leaf(astnode_enum::alnumus_, u8"twice"),
+		ceval_leaf(astnode_enum::alnumus_, u8"a"));
+	auto call_chunk = caoco::bytecode_compiler::compile(call, &inner);
+	EXPECT_EQ(call_chunk.code.front().op, caoco::e_opcode::load_slot_);
+	EXPECT_EQ(vm.run(call_chunk, inner).get<int>(), 2);
+	EXPECT_EQ(twice->scope().at(*x).type, RTValue::NONE);
+
+	// A deletion makes slots resolved before it stale: a chunk throws instead of reading the slot's new variable,
+	// a compiled function body is compiled again.
+	caoco::rtenv env("global");
+	env.create_variable("x", RTValue(RTValue::NUMBER, 10));
+	caoco::CFunctionDeclEval{}(ceval_function(u8"f", u8"n",
+		ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"n"), ceval_leaf(astnode_enum::alnumus_, u8"x"))), env);
+	auto f_of_10 = ceval_call(u8"f", ceval_leaf(astnode_enum::number_literal_, u8"10"));
+	auto x_chunk = caoco::bytecode_compiler::compile(ceval_leaf(astnode_enum::alnumus_, u8"x"), &env);
+	EXPECT_EQ(vm.run(f_of_10, env).get<int>(), 20);
+	EXPECT_EQ(vm.run(x_chunk, env).get<int>(), 10);
+	EXPECT_TRUE(env.delete_variable("x"));
+	env.create_variable("y", RTValue(RTValue::NUMBER, 1000));
+	EXPECT_TRUE(x_chunk.is_stale());
+	EXPECT_THROW(vm.run(x_chunk, env), std::runtime_error);
+	EXPECT_THROW(caoco::CFunctionCallEval{}(f_of_10, env), std::runtime_error);
+	EXPECT_THROW(vm.run(f_of_10, env), std::runtime_error);
+	env.create_variable("x", RTValue(RTValue::NUMBER, 5));
+	EXPECT_EQ(vm.run(f_of_10, env).get<int>(), 15);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constant Evaluator Binary Operator Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_CONST_EVALUATOR_BINOP
+#define CAOCO_TEST_CONST_EVALUATOR_BINOP_SingleEvaluation 1
+#define CAOCO_TEST_CONST_EVALUATOR_BINOP_DispatchTable 1
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_BINOP_SingleEvaluation
+// Every leaf is evaluated once and every operator applied once, whatever the shape and depth of the expression.
+TEST(ut_ConstEvaluator_Binop, SingleEvaluation) {
+	using caoco::astnode_enum;
+	using caoco::RTValue;
+	caoco::rtenv env("global");
+	for (int i = 0; i < 8; i++) {
+		env.create_variable("v" + std::to_string(i), RTValue(RTValue::NUMBER, i + 1));
+	}
+	auto leaf = [](int i) {
+		sl_string name = "v" + std::to_string(i);
+		return caoco::astnode(astnode_enum::alnumus_, sl_u8string(name.begin(), name.end()));
+	};
+
+	// Balanced: ((v0 + v1) * (v2 - v3)) + ((v4 * v5) - (v6 % v7)), with 8 leaves and 7 operators.
+	caoco::astnode balanced = ceval_binop(astnode_enum::addition_,
+		ceval_binop(astnode_enum::multiplication_,
+			ceval_binop(astnode_enum::addition_, leaf(0), leaf(1)),
+			ceval_binop(astnode_enum::subtraction_, leaf(2), leaf(3))),
+		ceval_binop(astnode_enum::subtraction_,
+			ceval_binop(astnode_enum::multiplication_, leaf(4), leaf(5)),
+			ceval_binop(astnode_enum::remainder_, leaf(6), leaf(7))));
+
+	// Left leaning chain of 1000 additions.
+	caoco::astnode chain = leaf(0);
+	for (int i = 1; i <= 1000; i++) chain = ceval_binop(astnode_enum::addition_, std::move(chain), leaf(i % 8));
+
+	struct expression_case {
+		const caoco::astnode* node;
+		sl_size leaves;
+		int expected;
+	};
+	const expression_case cases[] = {
+		{ &balanced, 8, (1 + 2) * (3 - 4) + (5 * 6 - 7 % 8) },
+		{ &chain, 1001, 1 + 125 * 36 },
+	};
+	for (const auto& expression : cases) {
+		auto& counters = caoco::binop_counters::local();
+		counters = {};
+		const sl_size copies = caoco::astnode::copy_count();
+		RTValue result = caoco::CBinopEval{}(*expression.node, env);
+		EXPECT_EQ(result.get<int>(), expression.expected);
+		EXPECT_EQ(counters.operands, expression.leaves);
+		EXPECT_EQ(counters.operations, expression.leaves - 1);
+		EXPECT_EQ(caoco::astnode::copy_count(), copies);
+	}
+
+	// The single operator evaluators share the engine.
+	caoco::binop_counters::local() = {};
+	EXPECT_EQ(caoco::CAddOpEval{}(balanced, env).get<int>(), 20);
+	EXPECT_EQ(caoco::binop_counters::local().operands, 8);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_BINOP_DispatchTable
+TEST(ut_ConstEvaluator_Binop, DispatchTable) {
+	using caoco::RTValue;
+	using caoco::e_binop;
+	const auto& table = caoco::binop_dispatch;
+	ASSERT_NE(caoco::binop_dispatch.at(e_binop::add_, RTValue::NUMBER, RTValue::NUMBER), nullptr);
+
+	const RTValue samples[] = {
+		RTValue(RTValue::NUMBER, 7), RTValue(RTValue::REAL, 7.5), RTValue(RTValue::STRING, "seven"),
+		RTValue(RTValue::BIT, true), RTValue(RTValue::BYTE, 7), RTValue(), RTValue(RTValue::UNSIGNED, 7u),
+	};
+	for (sl_size op = 0; op < caoco::binop_table::op_count; op++) {
+		for (const auto& left : samples) {
+			for (const auto& right : samples) {
+				auto function = table.at(static_cast<e_binop>(op), left.type, right.type);
+				ASSERT_NE(function, nullptr);
+				if (left.type != right.type) {
+					EXPECT_THROW(function(left, right), std::runtime_error);
+				}
+			}
+		}
+	}
+
+	EXPECT_EQ(caoco::apply_binop(e_binop::mod_, RTValue(RTValue::NUMBER, 7), RTValue(RTValue::NUMBER, 4)).get<int>(), 3);
+	EXPECT_EQ(caoco::apply_binop(e_binop::div_, RTValue(RTValue::REAL, 7.5), RTValue(RTValue::REAL, 2.5)).get<double>(), 3.0);
+	EXPECT_EQ(caoco::apply_binop(e_binop::sub_, RTValue(RTValue::BYTE, 1), RTValue(RTValue::BYTE, 2)).get<unsigned char>(), 255);
+	EXPECT_EQ(caoco::apply_binop(e_binop::mul_, RTValue(RTValue::UNSIGNED, 6u), RTValue(RTValue::UNSIGNED, 7u)).get<unsigned>(), 42u);
+	EXPECT_THROW(caoco::apply_binop(e_binop::mod_, RTValue(RTValue::REAL, 1.0), RTValue(RTValue::REAL, 1.0)), std::runtime_error);
+	EXPECT_THROW(caoco::apply_binop(e_binop::sub_, RTValue(RTValue::STRING, "a"), RTValue(RTValue::STRING, "b")), std::runtime_error);
+	EXPECT_THROW(caoco::apply_binop(e_binop::div_, RTValue(RTValue::NUMBER, 1), RTValue(RTValue::NUMBER, 0)), std::runtime_error);
+	// Nodes which are not binary operators are reported like any other evaluation error.
+	EXPECT_THROW(caoco::apply_binop(caoco::astnode_enum::alnumus_, RTValue(RTValue::NUMBER, 1), RTValue(RTValue::NUMBER, 1)), std::runtime_error);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constant Folding Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_CONSTANT_FOLDING
+#define CAOCO_TEST_CONSTANT_FOLDING_LiteralSubtrees 1
+#define CAOCO_TEST_CONSTANT_FOLDING_MatchesEvaluator 1
+#define CAOCO_TEST_CONSTANT_FOLDING_LoadProgram 1
+#endif
+
+#if CAOCO_TEST_CONSTANT_FOLDING_LiteralSubtrees
+TEST(ut_ConstantFolding, LiteralSubtrees) {
+	using caoco::astnode_enum;
+	// 1 + 2 * 3
+	auto sum = ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::number_literal_, u8"1"),
+		ceval_binop(astnode_enum::multiplication_, ceval_leaf(astnode_enum::number_literal_, u8"2"),
+			ceval_leaf(astnode_enum::number_literal_, u8"3")));
+	auto report = caoco::constant_folder::fold(sum, "sum.candi");
+	EXPECT_EQ(sum.type(), astnode_enum::number_literal_);
+	EXPECT_EQ(sum.literal_str(), "7");
+	EXPECT_EQ(report.folded_operations, 2);
+	EXPECT_EQ(report.eliminated_nodes, 4);
+	EXPECT_EQ(report.to_string(), "sum.candi: folded 2 operations, eliminated 4 nodes");
+
+	// 'a' + 'b'
+	auto text = ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::string_literal_, u8"'a\\n'"),
+		ceval_leaf(astnode_enum::string_literal_, u8"'b\\''"));
+	caoco::constant_folder::fold(text);
+	EXPECT_EQ(text.type(), astnode_enum::string_literal_);
+	caoco::rtenv env("global");
+	EXPECT_EQ(caoco::CLiteralEval{}(text, env).get<sl_string>(), "a\nb'");
+
+	// a + 2 * 3: only the literal operand is folded.
+	auto partial = ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"a"),
+		ceval_binop(astnode_enum::multiplication_, ceval_leaf(astnode_enum::number_literal_, u8"2"),
+			ceval_leaf(astnode_enum::number_literal_, u8"3")));
+	report = caoco::constant_folder::fold(partial);
+	EXPECT_EQ(partial.type(), astnode_enum::addition_);
+	EXPECT_EQ(partial.children().back().literal_str(), "6");
+	EXPECT_EQ(report.eliminated_nodes, 2);
+
+	// Operations which fail are left to fail at evaluation.
+	auto by_zero = ceval_binop(astnode_enum::division_, ceval_leaf(astnode_enum::number_literal_, u8"1"),
+		ceval_leaf(astnode_enum::number_literal_, u8"0"));
+	auto mismatch = ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::number_literal_, u8"1"),
+		ceval_leaf(astnode_enum::real_literal_, u8"1.0"));
+	EXPECT_EQ(caoco::constant_folder::fold(by_zero).folded_operations, 0);
+	EXPECT_EQ(caoco::constant_folder::fold(mismatch).folded_operations, 0);
+	EXPECT_THROW(caoco::CBinopEval{}(by_zero, env), std::runtime_error);
+
+	// The pass only runs on parsed files when folding is enabled, by default in release builds.
+	auto disabled = ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::number_literal_, u8"1"),
+		ceval_leaf(astnode_enum::number_literal_, u8"1"));
+	EXPECT_EQ(caoco::optimize_program(disabled, "program.candi").eliminated_nodes, CAOCO_CONSTANT_FOLDING ? 2 : 0);
+}
+#endif
+
+#if CAOCO_TEST_CONSTANT_FOLDING_LoadProgram
+TEST(ut_ConstantFolding, LoadProgram) {
+	// #enter { a; } #start { q; }
+	using tk_enum = caoco::tk_enum;
+	caoco_token_builder builder;
+	builder.add(tk_enum::enter_, "#enter");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "a");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	builder.add(tk_enum::start_, "#start");
+	builder.add(tk_enum::open_list_, "{");
+	builder.add(tk_enum::alnumus_, "q");
+	builder.add(tk_enum::eos_, ";");
+	builder.add(tk_enum::close_list_, "}");
+	auto tokens = builder.build();
+
+	// The front end returns the tree parse_program builds after the optimisation passes, and what they did.
+	auto program = caoco::load_program(tokens.cbegin(), tokens.cend(), "program.candi");
+	auto parsed = caoco::parse_program(tokens.cbegin(), tokens.cend());
+	EXPECT_TRUE(caoco_ast_equal(program.tree, parsed));
+	EXPECT_EQ(program.folding.file, "program.candi");
+	EXPECT_EQ(program.folding.folded_operations, 0);
+	EXPECT_EQ(program.folding.to_string(), "program.candi: folded 0 operations, eliminated 0 nodes");
+
+	// Parse errors are thrown as by parse_program.
+	EXPECT_THROW(caoco::load_program(tokens.cbegin() + 5, tokens.cend(), "program.candi"), std::runtime_error);
+}
+#endif
+
+#if CAOCO_TEST_CONSTANT_FOLDING_MatchesEvaluator
+// A folded literal evaluates to the value of the operation it replaced, for every foldable type.
+TEST(ut_ConstantFolding, MatchesEvaluator) {
+	using caoco::astnode_enum;
+	struct operand_pair {
+		astnode_enum type;
+		const char8_t* left;
+		const char8_t* right;
+	};
+	const operand_pair pairs[] = {
+		{ astnode_enum::number_literal_, u8"-7", u8"3" },
+		{ astnode_enum::real_literal_, u8"0.1", u8"0.2" },
+		{ astnode_enum::string_literal_, u8"'hello '", u8"'world\\t!'" },
+		{ astnode_enum::bit_literal_, u8"1b", u8"0b" },
+		{ astnode_enum::unsigned_literal_, u8"7u", u8"3u" },
+		{ astnode_enum::byte_literal_, u8"200c", u8"100c" },
+	};
+	const astnode_enum operations[] = { astnode_enum::addition_, astnode_enum::subtraction_,
+		astnode_enum::multiplication_, astnode_enum::division_, astnode_enum::remainder_ };
+	caoco::rtenv env("global");
+	for (const auto& pair : pairs) {
+		for (auto op : operations) {
+			auto tree = ceval_binop(op, ceval_leaf(pair.type, pair.left), ceval_leaf(pair.type, pair.right));
+			caoco::RTValue expected;
+			try {
+				expected = caoco::CBinopEval{}(tree, env);
+			}
+			catch (const std::exception&) {
+				EXPECT_EQ(caoco::constant_folder::fold(tree).folded_operations, 0);
+				continue;
+			}
+			EXPECT_EQ(caoco::constant_folder::fold(tree).folded_operations, 1);
+			EXPECT_TRUE(tree.children().empty());
+			EXPECT_TRUE(ceval_equal(caoco::CLiteralEval{}(tree, env), expected)) << tree.literal_str();
+		}
+	}
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constant Evaluator Memoisation Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_CONST_EVALUATOR_MEMO
+#define CAOCO_TEST_CONST_EVALUATOR_MEMO_Purity 1
+#define CAOCO_TEST_CONST_EVALUATOR_MEMO_PureCalls 1
+#define CAOCO_TEST_CONST_EVALUATOR_MEMO_Redeclared 1
+#define CAOCO_TEST_CONST_EVALUATOR_MEMO_LruEviction 1
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_MEMO_Purity
+TEST(ut_ConstEvaluator_Memo, Purity) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	env.create_variable("outer", caoco::RTValue(caoco::RTValue::NUMBER, 1));
+	auto declare = [&env](const char8_t* name, caoco::astnode body) {
+		caoco::CFunctionDeclEval{}(ceval_function(name, u8"x", std::move(body)), env);
+		return env.resolve_variable(sl::to_str(sl_u8string(name))).value().function();
+	};
+	auto x = [] { return ceval_leaf(astnode_enum::alnumus_, u8"x"); };
+	auto two = [] { return ceval_leaf(astnode_enum::number_literal_, u8"2"); };
+
+	// Literals, arguments and arithmetic only.
+	EXPECT_TRUE(declare(u8"square", ceval_binop(astnode_enum::multiplication_, x(), x()))->is_pure());
+	EXPECT_TRUE(declare(u8"constant", two())->is_pure());
+	// Reads a variable outside the function, its value may change between calls.
+	EXPECT_FALSE(declare(u8"shift", ceval_binop(astnode_enum::addition_, x(), ceval_leaf(astnode_enum::alnumus_, u8"outer")))->is_pure());
+	// Calls are as pure as the function they call.
+	EXPECT_TRUE(declare(u8"calls", ceval_call(u8"square", x()))->is_pure());
+	EXPECT_FALSE(declare(u8"calls_shift", ceval_call(u8"shift", x()))->is_pure());
+	// The callee is resolved when the caller is analysed, an unknown name is impure.
+	EXPECT_FALSE(declare(u8"calls_unknown", ceval_call(u8"unknown", x()))->is_pure());
+	// An argument may hold any function.
+	EXPECT_FALSE(declare(u8"calls_x", ceval_call(u8"x", two()))->is_pure());
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_MEMO_PureCalls
+TEST(ut_ConstEvaluator_Memo, PureCalls) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	env.create_variable("outer", caoco::RTValue(caoco::RTValue::NUMBER, 1));
+	// #func square(x) { #return x * x; }; #func shift(x) { #return x + outer; };
+	caoco::CFunctionDeclEval{}(ceval_function(u8"square", u8"x",
+		ceval_binop(astnode_enum::multiplication_, ceval_leaf(astnode_enum::alnumus_, u8"x"), ceval_leaf(astnode_enum::alnumus_, u8"x"))), env);
+	caoco::CFunctionDeclEval{}(ceval_function(u8"shift", u8"x",
+		ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"x"), ceval_leaf(astnode_enum::alnumus_, u8"outer"))), env);
+	auto square = env.resolve_variable("square").value().function();
+	auto shift = env.resolve_variable("shift").value().function();
+	auto call = [](const char8_t* name, const char8_t* argument) {
+		return caoco::astnode(astnode_enum::function_call_, u8"", ceval_leaf(astnode_enum::alnumus_, name),
+			ceval_leaf(astnode_enum::number_literal_, argument));
+	};
+
+	auto square_3 = call(u8"square", u8"3");
+	auto square_4 = call(u8"square", u8"4");
+	for (int i = 0; i < 10; i++) {
+		EXPECT_EQ(caoco::CFunctionCallEval{}(square_3, env).get<int>(), 9);
+		EXPECT_EQ(caoco::CFunctionCallEval{}(square_4, env).get<int>(), 16);
+	}
+	EXPECT_EQ(square->memo().misses(), 2);
+	EXPECT_EQ(square->memo().hits(), 18);
+	EXPECT_EQ(square->memo().size(), 2);
+
+	// The bytecode VM shares the cache.
+	caoco::bytecode_vm vm;
+	EXPECT_EQ(vm.run(square_3, env).get<int>(), 9);
+	EXPECT_EQ(square->memo().hits(), 19);
+
+	// Impure functions are evaluated at every call and see the current state.
+	auto shift_1 = call(u8"shift", u8"1");
+	EXPECT_EQ(caoco::CFunctionCallEval{}(shift_1, env).get<int>(), 2);
+	env.set_variable("outer", caoco::RTValue(caoco::RTValue::NUMBER, 10));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(shift_1, env).get<int>(), 11);
+	EXPECT_EQ(shift->memo().hits() + shift->memo().misses(), 0);
+
+	// #func inverse(x) { #return 1.0 / x; }; 0.0 and -0.0 are equal but are different arguments.
+	caoco::CFunctionDeclEval{}(ceval_function(u8"inverse", u8"x", ceval_binop(astnode_enum::division_,
+		ceval_leaf(astnode_enum::real_literal_, u8"1.0"), ceval_leaf(astnode_enum::alnumus_, u8"x"))), env);
+	auto inverse = [&env](const char8_t* argument) {
+		return caoco::CFunctionCallEval{}(caoco::astnode(astnode_enum::function_call_, u8"", ceval_leaf(astnode_enum::alnumus_, u8"inverse"),
+			ceval_leaf(astnode_enum::real_literal_, argument)), env).get<double>();
+	};
+	EXPECT_GT(inverse(u8"0.0"), 0.0);
+	EXPECT_LT(inverse(u8"-0.0"), 0.0);
+	EXPECT_GT(inverse(u8"0.0"), 0.0);
+	EXPECT_EQ(env.resolve_variable("inverse").value().function()->memo().size(), 2);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_MEMO_Redeclared
+TEST(ut_ConstEvaluator_Memo, Redeclared) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	env.create_variable("outer", caoco::RTValue(caoco::RTValue::NUMBER, 1));
+	auto x = [] { return ceval_leaf(astnode_enum::alnumus_, u8"x"); };
+	// #func helper(x) { #return x * x; }; #func caller(x) { #return helper(x); };
+	caoco::CFunctionDeclEval{}(ceval_function(u8"helper", u8"x", ceval_binop(astnode_enum::multiplication_, x(), x())), env);
+	caoco::CFunctionDeclEval{}(ceval_function(u8"caller", u8"x", ceval_call(u8"helper", x())), env);
+	auto caller = env.resolve_variable("caller").value().function();
+	auto call_3 = caoco::astnode(astnode_enum::function_call_, u8"", ceval_leaf(astnode_enum::alnumus_, u8"caller"),
+		ceval_leaf(astnode_enum::number_literal_, u8"3"));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(call_3, env).get<int>(), 9);
+	EXPECT_TRUE(caller->is_pure());
+	EXPECT_EQ(caller->memo().size(), 1);
+
+	// #func helper(x) { #return x + outer; }; The caller now reads outer through helper.
+	ASSERT_TRUE(env.delete_variable("helper"));
+	caoco::CFunctionDeclEval{}(ceval_function(u8"helper", u8"x",
+		ceval_binop(astnode_enum::addition_, x(), ceval_leaf(astnode_enum::alnumus_, u8"outer"))), env);
+	EXPECT_FALSE(caller->is_pure());
+	EXPECT_EQ(caller->memo().size(), 0);
+	EXPECT_EQ(caoco::CFunctionCallEval{}(call_3, env).get<int>(), 4);
+	env.set_variable("outer", caoco::RTValue(caoco::RTValue::NUMBER, 10));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(call_3, env).get<int>(), 13);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_MEMO_LruEviction
+TEST(ut_ConstEvaluator_Memo, LruEviction) {
+	using caoco::RTValue;
+	caoco::call_memo memo(2);
+	auto key = [](int i) { return RTValue(RTValue::NUMBER, i); };
+	auto insert = [&](int i) {
+		RTValue arg = key(i);
+		memo.insert({ &arg, 1 }, caoco::call_memo::hash_args({ &arg, 1 }), RTValue(RTValue::NUMBER, i * 10));
+	};
+	auto find = [&](int i) {
+		RTValue arg = key(i);
+		return memo.find({ &arg, 1 }, caoco::call_memo::hash_args({ &arg, 1 }));
+	};
+	insert(1);
+	insert(2);
+	ASSERT_NE(find(1), nullptr); // 1 is now the most recently used.
+	insert(3); // Evicts 2.
+	EXPECT_EQ(memo.size(), 2);
+	EXPECT_EQ(find(2), nullptr);
+	ASSERT_NE(find(1), nullptr);
+	EXPECT_EQ(find(3)->get<int>(), 30);
+	EXPECT_EQ(memo.hits(), 3);
+	EXPECT_EQ(memo.misses(), 1);
+
+	// Values of different types never share an entry, equal strings always do.
+	EXPECT_NE(RTValue(RTValue::NUMBER, 1).hash(), RTValue(RTValue::UNSIGNED, 1u).hash());
+	EXPECT_EQ(RTValue(RTValue::STRING, "a long string value").hash(), RTValue::interned("a long string value").hash());
+	EXPECT_FALSE(RTValue(RTValue::REAL, 0.0).identical(RTValue(RTValue::REAL, -0.0)));
+	EXPECT_TRUE(RTValue(RTValue::REAL, std::nan("")).identical(RTValue(RTValue::REAL, std::nan(""))));
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constant Evaluator Call Frame Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_CONST_EVALUATOR_CALLS
+#define CAOCO_TEST_CONST_EVALUATOR_CALLS_Recursion 1
+#define CAOCO_TEST_CONST_EVALUATOR_CALLS_MutualRecursion 1
+#define CAOCO_TEST_CONST_EVALUATOR_CALLS_Frames 1
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_CALLS_Recursion
+TEST(ut_ConstEvaluator_Calls, Recursion) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	auto n = [] { return ceval_leaf(astnode_enum::alnumus_, u8"n"); };
+	auto number = [](const char8_t* literal) { return ceval_leaf(astnode_enum::number_literal_, literal); };
+	// #func fact(n) { #if (n < 2) { #return 1; }; #return n * fact(n - 1); };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"fact", { u8"n" }, ceval_if_return(
+		ceval_binop(astnode_enum::less_than_, n(), number(u8"2")),
+		number(u8"1"),
+		ceval_binop(astnode_enum::multiplication_, n(), ceval_call(u8"fact", ceval_binop(astnode_enum::subtraction_, n(), number(u8"1")))))), env);
+	auto fact_10 = ceval_call(u8"fact", number(u8"10"));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(fact_10, env).get<int>(), 3628800);
+	caoco::bytecode_vm vm;
+	EXPECT_EQ(vm.run(fact_10, env).get<int>(), 3628800);
+	// Each activation restored the argument of the one it returned to, the slot is empty again.
+	auto fact = env.resolve_variable("fact").value().function();
+	EXPECT_EQ(fact->scope().at(fact->arg_slots().front()).type, caoco::RTValue::NONE);
+	// Recursion and the conditional only read n, each fact(n) is evaluated once.
+	EXPECT_TRUE(fact->is_pure());
+	EXPECT_EQ(fact->memo().size(), 10);
+
+	// #func sum(n) { #return n + sum(n); }; never returns, the call depth is bounded.
+	caoco::CFunctionDeclEval{}(ceval_function(u8"sum", u8"n",
+		ceval_binop(astnode_enum::addition_, n(), ceval_call(u8"sum", n()))), env);
+	EXPECT_THROW(caoco::CFunctionCallEval{}(ceval_call(u8"sum", number(u8"1")), env), std::runtime_error);
+	EXPECT_TRUE(caoco::call_frame::local_stack().empty());
+	EXPECT_EQ(caoco::CFunctionCallEval{}(fact_10, env).get<int>(), 3628800);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_CALLS_MutualRecursion
+TEST(ut_ConstEvaluator_Calls, MutualRecursion) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	auto n = [] { return ceval_leaf(astnode_enum::alnumus_, u8"n"); };
+	auto zero = [] { return ceval_leaf(astnode_enum::number_literal_, u8"0"); };
+	auto n_minus_1 = [&] { return ceval_binop(astnode_enum::subtraction_, n(), ceval_leaf(astnode_enum::number_literal_, u8"1")); };
+	// #func is_even(n) { #if (n == 0) { #return 1b; }; #return is_odd(n - 1); };
+	// #func is_odd(n) { #if (n == 0) { #return 0b; }; #return is_even(n - 1); };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"is_even", { u8"n" }, ceval_if_return(
+		ceval_binop(astnode_enum::equal_, n(), zero()), ceval_leaf(astnode_enum::bit_literal_, u8"1b"), ceval_call(u8"is_odd", n_minus_1()))), env);
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"is_odd", { u8"n" }, ceval_if_return(
+		ceval_binop(astnode_enum::equal_, n(), zero()), ceval_leaf(astnode_enum::bit_literal_, u8"0b"), ceval_call(u8"is_even", n_minus_1()))), env);
+	caoco::bytecode_vm vm;
+	for (int i = 0; i < 20; i++) {
+		sl_string literal = std::to_string(i);
+		auto call = ceval_call(u8"is_even", caoco::astnode(astnode_enum::number_literal_, sl_u8string(literal.begin(), literal.end())));
+		EXPECT_EQ(caoco::CFunctionCallEval{}(call, env).get<bool>(), i % 2 == 0);
+		EXPECT_EQ(vm.run(call, env).get<bool>(), i % 2 == 0);
+	}
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_CALLS_Frames
+TEST(ut_ConstEvaluator_Calls, Frames) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv env("global");
+	auto name = [](const char8_t* n) { return ceval_leaf(astnode_enum::alnumus_, n); };
+	// #func weigh(a, b, c) { #return a * 100 + b * 10 + c; };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"weigh", { u8"a", u8"b", u8"c" },
+		caoco::astnode(astnode_enum::functional_block_, u8"", caoco::astnode(astnode_enum::return_, u8"",
+			ceval_binop(astnode_enum::addition_,
+				ceval_binop(astnode_enum::addition_,
+					ceval_binop(astnode_enum::multiplication_, name(u8"a"), ceval_leaf(astnode_enum::number_literal_, u8"100")),
+					ceval_binop(astnode_enum::multiplication_, name(u8"b"), ceval_leaf(astnode_enum::number_literal_, u8"10"))),
+				name(u8"c"))))), env);
+	auto number = [](const char8_t* literal) { return ceval_leaf(astnode_enum::number_literal_, literal); };
+	// weigh(1, 2, weigh(3, 4, 5)), all arguments are bound and a nested call does not disturb the outer one.
+	caoco::astnode inner(astnode_enum::function_call_, u8"", name(u8"weigh"),
+		caoco::astnode(astnode_enum::arguments_, u8"", number(u8"3"), number(u8"4"), number(u8"5")));
+	caoco::astnode outer(astnode_enum::function_call_, u8"", name(u8"weigh"),
+		caoco::astnode(astnode_enum::arguments_, u8"", number(u8"1"), number(u8"2"), std::move(inner)));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(outer, env).get<int>(), 100 + 20 + 345);
+	caoco::bytecode_vm vm;
+	EXPECT_EQ(vm.run(outer, env).get<int>(), 100 + 20 + 345);
+
+	// Wrong argument counts throw and leave no frame behind.
+	caoco::astnode missing(astnode_enum::function_call_, u8"", name(u8"weigh"),
+		caoco::astnode(astnode_enum::arguments_, u8"", number(u8"1")));
+	EXPECT_THROW(caoco::CFunctionCallEval{}(missing, env), std::runtime_error);
+	EXPECT_TRUE(caoco::call_frame::local_stack().empty());
+
+	// Frames come from one stack, once it has grown calls allocate no frame storage.
+	auto n = [] { return ceval_leaf(astnode_enum::alnumus_, u8"n"); };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"count", { u8"n" }, ceval_if_return(
+		ceval_binop(astnode_enum::less_than_, n(), number(u8"1")), number(u8"0"),
+		ceval_binop(astnode_enum::addition_, number(u8"1"), ceval_call(u8"count", ceval_binop(astnode_enum::subtraction_, n(), number(u8"1")))))), env);
+	auto count_200 = ceval_call(u8"count", number(u8"200"));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(count_200, env).get<int>(), 200);
+	const auto* storage = caoco::call_frame::local_stack().data();
+	const sl_size capacity = caoco::call_frame::local_stack().capacity();
+	for (int i = 0; i < 10; i++) EXPECT_EQ(caoco::CFunctionCallEval{}(count_200, env).get<int>(), 200);
+	EXPECT_EQ(caoco::call_frame::local_stack().data(), storage);
+	EXPECT_EQ(caoco::call_frame::local_stack().capacity(), capacity);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constant Evaluator Environment Lifetime Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_CONST_EVALUATOR_ENV
+#define CAOCO_TEST_CONST_EVALUATOR_ENV_Regions 1
+#define CAOCO_TEST_CONST_EVALUATOR_ENV_BlockScopes 1
+#define CAOCO_TEST_CONST_EVALUATOR_ENV_ResolvedNames 1
+#define CAOCO_TEST_CONST_EVALUATOR_ENV_MemoryStability 1
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_ENV || CAOCO_TEST_CONST_EVALUATOR_SHAPES
+// #class name { #var member = value; };
+caoco::astnode ceval_class(const char8_t* name, const char8_t* member, caoco::astnode value) {
+	using astnode_enum = caoco::astnode_enum;
+	return caoco::astnode(astnode_enum::class_definition_, u8"", ceval_leaf(astnode_enum::alnumus_, name),
+		caoco::astnode(astnode_enum::pragmatic_block_, u8"", ceval_var(member, std::move(value))));
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_ENV
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+// Resident memory of the process in kB, 0 where it can't be read. Under AddressSanitizer freed blocks wait in
+// quarantine and count as resident, the reading is meaningless there.
+sl_size ceval_resident_kb() {
+#if defined(__SANITIZE_ADDRESS__)
+	return 0;
+#elif defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.WorkingSetSize / 1024;
+#else
+	std::ifstream status("/proc/self/status");
+	sl_string line;
+	while (std::getline(status, line)) {
+		if (line.rfind("VmRSS:", 0) == 0) return std::stoull(line.substr(6));
+	}
+	return 0;
+#endif
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_ENV_Regions
+TEST(ut_ConstEvaluator_Env, Regions) {
+	using astnode_enum = caoco::astnode_enum;
+	const sl_size live = caoco::rtenv::live_count();
+	{
+		caoco::rtenv global("global");
+		{
+			caoco::rtenv_scope block(global);
+			caoco::CVarDeclEval{}(ceval_var(u8"x", ceval_leaf(astnode_enum::number_literal_, u8"1")), block.env());
+			caoco::CFunctionDeclEval{}(ceval_function(u8"f", u8"n",
+				ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"n"), ceval_leaf(astnode_enum::alnumus_, u8"x"))), block.env());
+			caoco::CClassDeclEval{}(ceval_class(u8"C", u8"y", ceval_leaf(astnode_enum::number_literal_, u8"2")), block.env());
+			EXPECT_EQ(global.subenv_count(), 1);
+			EXPECT_EQ(block.env().subenv_count(), 2);
+			EXPECT_EQ(caoco::CFunctionCallEval{}(ceval_call(u8"f", ceval_leaf(astnode_enum::number_literal_, u8"2")), block.env()).get<int>(), 3);
+			EXPECT_EQ(block.env().resolve_variable("C").value().object()->get_member("y").get<int>(), 2);
+
+			// A failed redeclaration adds no scope.
+			EXPECT_THROW(caoco::CFunctionDeclEval{}(ceval_function(u8"f", u8"n", ceval_leaf(astnode_enum::alnumus_, u8"n")), block.env()), std::runtime_error);
+			EXPECT_THROW(caoco::CClassDeclEval{}(ceval_class(u8"C", u8"y", ceval_leaf(astnode_enum::number_literal_, u8"2")), block.env()), std::runtime_error);
+			EXPECT_EQ(block.env().subenv_count(), 2);
+		}
+		// The block, the function and class scopes in it, are gone.
+		EXPECT_EQ(global.subenv_count(), 0);
+		EXPECT_EQ(global.subenv_capacity(), 0);
+		EXPECT_FALSE(global.resolve_variable("x").valid());
+		EXPECT_EQ(caoco::rtenv::live_count(), live + 1);
+
+		// Released out of order, the storage waits for the next sub environment.
+		caoco::rtenv& first = global.add_subenv("first");
+		caoco::rtenv& second = global.add_subenv("second");
+		global.release_subenv(first);
+		EXPECT_EQ(global.subenv_count(), 1);
+		EXPECT_EQ(global.subenv_capacity(), 2);
+		caoco::rtenv& third = global.add_subenv("third");
+		EXPECT_EQ(&third, &first);
+		EXPECT_EQ(third.parent(), &global);
+		EXPECT_EQ(global.subenv_capacity(), 2);
+		EXPECT_THROW(third.release_subenv(second), std::runtime_error);
+
+		// A function value held outside the env it was declared in keeps its scope alive.
+		caoco::CFunctionDeclEval{}(ceval_function(u8"g", u8"n", ceval_leaf(astnode_enum::alnumus_, u8"n")), global);
+		{
+			caoco::rtenv_scope block(global);
+			block.env().create_variable("h", global.resolve_variable("g").value());
+			global.delete_variable("g");
+			EXPECT_EQ(global.subenv_count(), 4);
+		}
+		EXPECT_EQ(global.subenv_count(), 2);
+
+		// A function declared in a scope and held outside it: closing the scope reports it, the scope is kept so
+		// the function can still be called.
+		{
+			caoco::rtenv_scope block(global);
+			caoco::CFunctionDeclEval{}(ceval_function(u8"k", u8"n", ceval_leaf(astnode_enum::alnumus_, u8"n")), block.env());
+			global.create_variable("escaped", block.env().resolve_variable("k").value());
+			EXPECT_THROW(block.close(), std::runtime_error);
+		}
+		EXPECT_EQ(global.subenv_count(), 3);
+		EXPECT_EQ(caoco::CFunctionCallEval{}(ceval_call(u8"escaped", ceval_leaf(astnode_enum::number_literal_, u8"5")), global).get<int>(), 5);
+		global.delete_variable("escaped");
+		EXPECT_EQ(global.subenv_count(), 3);
+	}
+	EXPECT_EQ(caoco::rtenv::live_count(), live);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_ENV_BlockScopes
+TEST(ut_ConstEvaluator_Env, BlockScopes) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv global("global");
+	auto name = [](const char8_t* n) { return ceval_leaf(astnode_enum::alnumus_, n); };
+	auto number = [](const char8_t* literal) { return ceval_leaf(astnode_enum::number_literal_, literal); };
+	auto block = [](auto&&... statements) { return caoco::astnode(astnode_enum::functional_block_, u8"", std::move(statements)...); };
+	auto ret = [](caoco::astnode value) { return caoco::astnode(astnode_enum::return_, u8"", std::move(value)); };
+	// #func f(n) { #var y = n * 2; #if (n < 1) { #var z = 1; #return z; }; #return y + f(n - 1); };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"f", { u8"n" }, block(
+		ceval_var(u8"y", ceval_binop(astnode_enum::multiplication_, name(u8"n"), number(u8"2"))),
+		caoco::astnode(astnode_enum::conditional_statement_, u8"",
+			caoco::astnode(astnode_enum::if_, u8"", caoco::astnode(astnode_enum::expression_, u8"", ceval_binop(astnode_enum::less_than_, name(u8"n"), number(u8"1"))),
+				block(ceval_var(u8"z", number(u8"1")), ret(name(u8"z"))))),
+		ret(ceval_binop(astnode_enum::addition_, name(u8"y"),
+			ceval_call(u8"f", ceval_binop(astnode_enum::subtraction_, name(u8"n"), number(u8"1"))))))), global);
+	auto f = global.resolve_variable("f").value().function();
+	EXPECT_FALSE(f->is_pure());
+
+	// Each activation declares its own y, the clause its own z. Both are gone once the call returns.
+	auto f_3 = ceval_call(u8"f", number(u8"3"));
+	for (int i = 0; i < 3; i++) EXPECT_EQ(caoco::CFunctionCallEval{}(f_3, global).get<int>(), 6 + 4 + 2 + 1);
+	EXPECT_EQ(f->scope().subenv_count(), 0);
+	EXPECT_FALSE(f->scope().resolve_variable("y").valid());
+	caoco::bytecode_vm vm;
+	EXPECT_EQ(vm.run(f_3, global).get<int>(), 13);
+	EXPECT_EQ(f->scope().subenv_count(), 0);
+
+	// A failed call closes the scopes it opened.
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"g", { u8"n" }, block(
+		ceval_var(u8"y", name(u8"n")), ret(name(u8"missing")))), global);
+	EXPECT_THROW(caoco::CFunctionCallEval{}(ceval_call(u8"g", number(u8"1")), global), std::runtime_error);
+	EXPECT_EQ(global.resolve_variable("g").value().function()->scope().subenv_count(), 0);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_ENV_ResolvedNames
+TEST(ut_ConstEvaluator_Env, ResolvedNames) {
+	using astnode_enum = caoco::astnode_enum;
+	using caoco::RTValue;
+	caoco::rtenv global("global");
+	global.create_variable("x", RTValue(RTValue::NUMBER, 1));
+	auto name = [](const char8_t* n) { return ceval_leaf(astnode_enum::alnumus_, n); };
+	auto block = [](auto&&... statements) { return caoco::astnode(astnode_enum::functional_block_, u8"", std::move(statements)...); };
+	auto ret = [](caoco::astnode value) { return caoco::astnode(astnode_enum::return_, u8"", std::move(value)); };
+	// #func f(n) { #var y = n * 2; #return y + x; };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"f", { u8"n" }, block(
+		ceval_var(u8"y", ceval_binop(astnode_enum::multiplication_, name(u8"n"), ceval_leaf(astnode_enum::number_literal_, u8"2"))),
+		ret(ceval_binop(astnode_enum::addition_, name(u8"y"), name(u8"x"))))), global);
+	auto f = global.resolve_variable("f").value().function();
+	auto f_3 = ceval_call(u8"f", ceval_leaf(astnode_enum::number_literal_, u8"3"));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(f_3, global).get<int>(), 7);
+
+	// n is read in the block env opened by the declaration of y, y and x from the one below it.
+	const auto& body = f->body().children();
+	const auto* n = body.front().children().back().children().back().children().front().find_cache<caoco::name_slot>();
+	const auto& sum = body.back().children().back().children();
+	const auto* y = sum.front().find_cache<caoco::name_slot>();
+	const auto* x = sum.back().find_cache<caoco::name_slot>();
+	ASSERT_TRUE(n && y && x);
+	EXPECT_EQ(n->scope, &f->scope());
+	EXPECT_EQ(n->scope_depth, 1);
+	EXPECT_EQ(n->slot.depth, 1);
+	EXPECT_EQ(y->slot.depth, 0);
+	EXPECT_EQ(y->slot.slot, 0);
+	EXPECT_EQ(x->slot.depth, 2);
+	// The slots are relative to the block env, read from the scope itself they don't apply.
+	EXPECT_FALSE(x->valid_in(f->scope()));
+
+	// Deleting or shadowing x changes the generation of every env below global, the names are resolved again.
+	const auto generation = f->scope().generation();
+	global.delete_variable("x");
+	EXPECT_NE(f->scope().generation(), generation);
+	EXPECT_THROW(caoco::CFunctionCallEval{}(f_3, global), std::runtime_error);
+	global.create_variable("x", RTValue(RTValue::NUMBER, 10));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(f_3, global).get<int>(), 16);
+	f->scope().create_variable("x", RTValue(RTValue::NUMBER, 100));
+	EXPECT_EQ(caoco::CFunctionCallEval{}(f_3, global).get<int>(), 106);
+	EXPECT_EQ(x->slot.depth, 1);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_ENV_MemoryStability
+TEST(ut_ConstEvaluator_Env, MemoryStability) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::rtenv global("global");
+	auto x_var = ceval_var(u8"x", ceval_leaf(astnode_enum::number_literal_, u8"40"));
+	auto f_decl = ceval_function(u8"f", u8"n",
+		ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"n"), ceval_leaf(astnode_enum::alnumus_, u8"x")));
+	auto c_decl = ceval_class(u8"C", u8"y", ceval_leaf(astnode_enum::number_literal_, u8"2"));
+	auto f_call = ceval_call(u8"f", ceval_leaf(astnode_enum::number_literal_, u8"2"));
+	// Each iteration declares a variable, a function and a class in a block, then calls the function.
+	auto iterate = [&] {
+		caoco::rtenv_scope block(global);
+		caoco::CVarDeclEval{}(x_var, block.env());
+		caoco::CFunctionDeclEval{}(f_decl, block.env());
+		caoco::CClassDeclEval{}(c_decl, block.env());
+		return caoco::CFunctionCallEval{}(f_call, block.env()).get<int>();
+	};
+	for (int i = 0; i < 1000; i++) iterate();
+	const sl_size live = caoco::rtenv::live_count();
+	const sl_size live_bytes = heap_usage::local().live_bytes;
+	const sl_size resident = ceval_resident_kb();
+	int failures = 0;
+	for (int i = 0; i < 1'000'000; i++) failures += iterate() != 42;
+	EXPECT_EQ(failures, 0);
+	EXPECT_EQ(caoco::rtenv::live_count(), live);
+	EXPECT_EQ(global.subenv_count(), 0);
+	EXPECT_LE(global.subenv_capacity(), 1);
+	EXPECT_EQ(global.frame_size(), 0);
+	// Allow for allocator noise, a leak of one env per iteration would be hundreds of MB.
+	EXPECT_LE(heap_usage::local().live_bytes, live_bytes + 64 * 1024);
+	if (resident == 0) GTEST_SKIP() << "The resident set size can't be read on this platform.";
+	EXPECT_LE(ceval_resident_kb(), resident + 8 * 1024);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constant Evaluator Object Shape Tests
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_CONST_EVALUATOR_SHAPES
+#define CAOCO_TEST_CONST_EVALUATOR_SHAPES_Shapes 1
+#define CAOCO_TEST_CONST_EVALUATOR_SHAPES_InlineCaches 1
+#define CAOCO_TEST_CONST_EVALUATOR_SHAPES_AcrossThreads 1
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_SHAPES
+// #class name { #var first = 1; #var sound = sound; #func make_sound() { #return sound; }; };
+// Without first, the class has the members sound and make_sound only.
+caoco::astnode ceval_animal(const char8_t* name, const char8_t* first, const char8_t* sound) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::astnode body(astnode_enum::pragmatic_block_);
+	if (first) body.push_back(ceval_var(first, ceval_leaf(astnode_enum::number_literal_, u8"1")));
+	body.push_back(ceval_var(u8"sound", ceval_leaf(astnode_enum::string_literal_, sound)));
+	body.push_back(caoco::astnode(astnode_enum::method_definition_, u8"", ceval_leaf(astnode_enum::alnumus_, u8"make_sound"),
+		caoco::astnode(astnode_enum::arguments_),
+		caoco::astnode(astnode_enum::functional_block_, u8"", caoco::astnode(astnode_enum::return_, u8"", ceval_leaf(astnode_enum::alnumus_, u8"sound")))));
+	return caoco::astnode(astnode_enum::class_definition_, u8"", ceval_leaf(astnode_enum::alnumus_, name), std::move(body));
+}
+
+// object.member, or object.member() if call.
+caoco::astnode ceval_member(const char8_t* object, const char8_t* member, bool call) {
+	using astnode_enum = caoco::astnode_enum;
+	caoco::astnode access = call
+		? caoco::astnode(astnode_enum::function_call_, u8"", ceval_leaf(astnode_enum::alnumus_, member), caoco::astnode(astnode_enum::arguments_))
+		: ceval_leaf(astnode_enum::alnumus_, member);
+	return caoco::astnode(astnode_enum::period_, u8"", ceval_leaf(astnode_enum::alnumus_, object), std::move(access));
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_SHAPES_Shapes
+TEST(ut_ConstEvaluator_Shapes, Shapes) {
+	caoco::rtenv global("global");
+	caoco::CClassDeclEval{}(ceval_animal(u8"Dog", nullptr, u8"'woof'"), global);
+	caoco::CClassDeclEval{}(ceval_animal(u8"Cat", nullptr, u8"'meow'"), global);
+	caoco::CClassDeclEval{}(ceval_animal(u8"Bird", u8"legs", u8"'tweet'"), global);
+	auto dog = global.resolve_variable("Dog").value().object();
+	auto cat = global.resolve_variable("Cat").value().object();
+	auto bird = global.resolve_variable("Bird").value().object();
+
+	// Members added in the same order give the same shape, the values stay per object.
+	EXPECT_EQ(&dog->shape(), &cat->shape());
+	EXPECT_NE(&dog->shape(), &bird->shape());
+	EXPECT_EQ(dog->shape().member_count(), 2);
+	EXPECT_EQ(dog->member_slot("sound"), 0u);
+	EXPECT_EQ(bird->member_slot("sound"), 1u);
+	EXPECT_FALSE(dog->member_slot("legs").has_value());
+	EXPECT_EQ(dog->get_member("sound").get<sl_string>(), "woof");
+	EXPECT_EQ(cat->get_member("sound").get<sl_string>(), "meow");
+	EXPECT_EQ(bird->get_member("legs").get<int>(), 1);
+	EXPECT_THROW(dog->get_member("legs"), std::runtime_error);
+
+	// Shapes are reached by transitions from the empty shape, the same names lead to the same shape.
+	const caoco::object_shape& sound = caoco::object_shape::empty().with_member("sound");
+	EXPECT_EQ(&sound, &caoco::object_shape::empty().with_member("sound"));
+	EXPECT_EQ(&sound.with_member("make_sound"), &dog->shape());
+
+	// Adding a member moves only that object to a new shape.
+	EXPECT_THROW(dog->add_member("sound", caoco::RTValue(caoco::RTValue::NUMBER, 1)), std::runtime_error);
+	dog->add_member("tail", caoco::RTValue(caoco::RTValue::BIT, true));
+	EXPECT_NE(&dog->shape(), &cat->shape());
+	EXPECT_EQ(dog->get_member("tail").get<bool>(), true);
+	EXPECT_EQ(cat->shape().member_count(), 2);
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_SHAPES_AcrossThreads
+TEST(ut_ConstEvaluator_Shapes, AcrossThreads) {
+	// animal.make_sound(), evaluated on a thread which has ended, then on this one. The cache filled by the first
+	// thread refers to the shape objects built alike have on any thread.
+	const auto make_sound = ceval_member(u8"animal", u8"make_sound", true);
+	const auto& cache = make_sound.cache<caoco::member_cache>();
+	auto sound_of = [&make_sound](const char8_t* name, const char8_t* sound) {
+		caoco::rtenv global("global");
+		caoco::CClassDeclEval{}(ceval_animal(name, nullptr, sound), global);
+		global.create_variable("animal", global.resolve_variable(sl::to_str(sl_u8string(name))).value());
+		return caoco::CBinopEval{}(make_sound, global).get<sl_string>();
+	};
+	sl_string dog;
+	sl_thread([&] { dog = sound_of(u8"Dog", u8"'woof'"); }).join();
+	EXPECT_EQ(dog, "woof");
+	EXPECT_EQ(sound_of(u8"Cat", u8"'meow'"), "meow");
+	EXPECT_EQ(cache.state(), caoco::member_cache::e_state::monomorphic_);
+	EXPECT_EQ(cache.misses(), 1);
+	EXPECT_EQ(cache.hits(), 1);
+
+	// Threads declaring the same members at once reach the same shapes.
+	sl_vector<const caoco::object_shape*> shapes(4);
+	sl_vector<sl_thread> threads;
+	for (sl_size i = 0; i < shapes.size(); i++) {
+		threads.emplace_back([&shapes, i] {
+			const caoco::object_shape* shape = &caoco::object_shape::empty();
+			for (int member = 0; member < 100; member++) shape = &shape->with_member("m" + std::to_string(member));
+			shapes[i] = shape;
+		});
+	}
+	for (auto& thread : threads) thread.join();
+	for (const auto* shape : shapes) {
+		EXPECT_EQ(shape, shapes.front());
+		EXPECT_EQ(shape->member_count(), 100);
+	}
+}
+#endif
+
+#if CAOCO_TEST_CONST_EVALUATOR_SHAPES_InlineCaches
+TEST(ut_ConstEvaluator_Shapes, InlineCaches) {
+	using e_state = caoco::member_cache::e_state;
+	caoco::rtenv global("global");
+	// Dog and Cat share a shape, every other animal has one of its own.
+	caoco::CClassDeclEval{}(ceval_animal(u8"Dog", nullptr, u8"'woof'"), global);
+	caoco::CClassDeclEval{}(ceval_animal(u8"Cat", nullptr, u8"'meow'"), global);
+	caoco::CClassDeclEval{}(ceval_animal(u8"Bird", u8"legs", u8"'tweet'"), global);
+	caoco::CClassDeclEval{}(ceval_animal(u8"Fish", u8"fins", u8"'blub'"), global);
+	caoco::CClassDeclEval{}(ceval_animal(u8"Cow", u8"horns", u8"'moo'"), global);
+	caoco::CClassDeclEval{}(ceval_animal(u8"Horse", u8"hooves", u8"'neigh'"), global);
+	global.create_variable("animal", global.resolve_variable("Dog").value());
+
+	// animal.make_sound(), the cache is kept on the period node.
+	const auto make_sound = ceval_member(u8"animal", u8"make_sound", true);
+	const auto& cache = make_sound.cache<caoco::member_cache>();
+	EXPECT_EQ(cache.state(), e_state::uninitialized_);
+	auto sounds = [&](const char* animal, const char* expected, e_state state) {
+		global.set_variable("animal", global.resolve_variable(animal).value());
+		for (int i = 0; i < 10; i++) EXPECT_EQ(caoco::CBinopEval{}(make_sound, global).get<sl_string>(), expected);
+		EXPECT_EQ(cache.state(), state) << animal;
+	};
+	sounds("Dog", "woof", e_state::monomorphic_);
+	EXPECT_EQ(cache.misses(), 1);
+	EXPECT_EQ(cache.hits(), 9);
+	sounds("Cat", "meow", e_state::monomorphic_); // Same shape, no new miss.
+	EXPECT_EQ(cache.misses(), 1);
+	sounds("Bird", "tweet", e_state::polymorphic_);
+	sounds("Fish", "blub", e_state::polymorphic_);
+	sounds("Cow", "moo", e_state::polymorphic_);
+	EXPECT_EQ(cache.misses(), 4);
+	// A fifth shape is looked up by name at every access, the cached ones still hit.
+	sounds("Horse", "neigh", e_state::megamorphic_);
+	EXPECT_EQ(cache.misses(), 14);
+	sounds("Dog", "woof", e_state::megamorphic_);
+	EXPECT_EQ(cache.misses(), 14);
+
+	// Field reads, and the same accesses compiled for the VM, which keeps the caches in the chunk.
+	const auto sound = ceval_member(u8"animal", u8"sound", false);
+	EXPECT_EQ(caoco::CMemberAccessEval{}(sound, global).get<sl_string>(), "woof");
+	const auto chunk = caoco::bytecode_compiler::compile(make_sound, &global);
+	ASSERT_EQ(chunk.members.size(), 1);
+	caoco::bytecode_vm vm;
+	for (int i = 0; i < 10; i++) EXPECT_EQ(vm.run(chunk, global).get<sl_string>(), "woof");
+	global.set_variable("animal", global.resolve_variable("Bird").value());
+	EXPECT_EQ(vm.run(chunk, global).get<sl_string>(), "tweet");
+	EXPECT_EQ(chunk.members.front().cache.state(), e_state::polymorphic_);
+	EXPECT_EQ(chunk.members.front().cache.hits(), 9);
+	EXPECT_EQ(vm.run(sound, global).get<sl_string>(), "tweet");
+	// Member handlers hold the object and the method only while they run.
+	auto bird = global.resolve_variable("Bird").value().object();
+	auto bird_sound = bird->get_member("make_sound").function();
+	const auto object_refs = bird->ref_count();
+	const auto method_refs = bird_sound->ref_count();
+	const auto field = caoco::bytecode_compiler::compile(sound, &global);
+	for (int i = 0; i < 3; i++) {
+		EXPECT_EQ(vm.run(chunk, global).get<sl_string>(), "tweet");
+		EXPECT_EQ(vm.run(field, global).get<sl_string>(), "tweet");
+	}
+	EXPECT_EQ(bird->ref_count(), object_refs);
+	EXPECT_EQ(bird_sound->ref_count(), method_refs);
+
+	// A node holds a single type of cache.
+	struct other_cache : caoco::node_cache {};
+	EXPECT_THROW(make_sound.cache<other_cache>(), std::logic_error);
+
+	// Missing members and non objects throw.
+	EXPECT_THROW(caoco::CMemberAccessEval{}(ceval_member(u8"animal", u8"wings", false), global), std::runtime_error);
+	global.create_variable("number", caoco::RTValue(caoco::RTValue::NUMBER, 1));
+	EXPECT_THROW(caoco::CMemberAccessEval{}(ceval_member(u8"number", u8"sound", false), global), std::runtime_error);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAOCO_TEST_BENCHMARK
+#define CAOCO_TEST_BENCHMARK_AstMemoryPerNode 1
+#define CAOCO_TEST_BENCHMARK_PrattParserLinear 1
+#define CAOCO_TEST_BENCHMARK_LlkParserVsParseProgram 1
+#define CAOCO_TEST_BENCHMARK_BytecodeVmVsTreeWalker 1
+#define CAOCO_TEST_BENCHMARK_MemoVsDirectCall 1
+#endif
+
+#if CAOCO_TEST_BENCHMARK_AstMemoryPerNode
+TEST(ut_Benchmark, AstMemoryPerNode) {
+	// 20'000 statements of the form: a = b + 1;
+	SL_CXA statement_count = 20000;
+	sl_u8string source;
+	for (int i = 0; i < statement_count; i++) source += u8"a = b + 1;\n";
+	auto input_vec = sl::to_u8vec(source.c_str());
+	auto tokens = tokenizer(input_vec.cbegin(), input_vec.cend())().expected();
+	sl_vector<std::pair<tk_vector_cit, tk_vector_cit>> statements;
+	for (auto first = tokens.cbegin(), it = tokens.cbegin(); it != tokens.cend(); ++it) {
+		if (it->type_is(e_tk::semicolon_)) {
+			statements.emplace_back(first, it);
+			first = std::next(it);
+		}
+	}
+	ASSERT_EQ(statements.size(), statement_count);
+
+	// Both trees are built by the parser, the heap they hold is measured by the operator new hook.
+	const heap_usage before_heap = heap_usage::local();
+	ast tree{ e_ast::program_ };
+	for (const auto& [first, last] : statements)
+		tree.push_back(parse_expression_pratt(first, last).extract());
+	const heap_usage heap_tree = heap_usage::local().since(before_heap);
+
+	const heap_usage before_arena = heap_usage::local();
+	ast_arena arena;
+	auto program = arena.make(e_ast::program_);
+	for (const auto& [first, last] : statements)
+		arena.push_back(program, parse_expression_arena(first, last, arena).expected());
+	const heap_usage arena_tree = heap_usage::local().since(before_arena);
+
+	const double heap_bytes_per_node = static_cast<double>(heap_tree.live_bytes) / static_cast<double>(arena.node_count());
+	const double arena_bytes_per_node = static_cast<double>(arena_tree.live_bytes) / static_cast<double>(arena.node_count());
+	std::cout << "[ast] nodes: " << arena.node_count()
+		<< " | heap ast bytes/node: " << heap_bytes_per_node << " (" << heap_tree.allocations << " allocations)"
+		<< " | arena bytes/node: " << arena_bytes_per_node << " (" << arena_tree.allocations << " allocations)"
+		<< " | arena record bytes: " << sizeof(ast_arena::record) << std::endl;
+	EXPECT_EQ(arena.node_count(), statement_count * 5 + 1);
+	EXPECT_LT(arena_bytes_per_node, heap_bytes_per_node);
+	EXPECT_LT(arena_tree.allocations, heap_tree.allocations);
+}
+#endif
+
+#if CAOCO_TEST_BENCHMARK_PrattParserLinear
+TEST(ut_Benchmark, PrattParserLinear) {
+	// a + a * a - a * a + ... with 25'000, 50'000 and 100'000 operands.
+	auto make_tokens = [](sl_size operands) {
+		tk_vector tokens;
+		tokens.reserve(operands * 2);
+		const tk ops[] = { tk{ e_tk::addition_, u8"+" }, tk{ e_tk::multiplication_, u8"*" }, tk{ e_tk::subtraction_, u8"-" } };
+		for (sl_size i = 0; i < operands; i++) {
+			if (i) tokens.push_back(ops[i % 3]);
+			tokens.push_back(tk{ e_tk::alnumus_, u8"a" });
+		}
+		return tokens;
+	};
+	auto best_time = [](const tk_vector& tokens) {
+		double best = std::numeric_limits<double>::max();
+		for (int run = 0; run < 3; run++) {
+			auto start = std::chrono::steady_clock::now();
+			auto result = parse_expression_pratt(tokens.cbegin(), tokens.cend());
+			auto stop = std::chrono::steady_clock::now();
+			EXPECT_TRUE(result.valid());
+			best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+		}
+		return best;
+	};
+	auto small = make_tokens(25000);
+	auto large = make_tokens(100000);
+	double small_ms = best_time(small);
+	double large_ms = best_time(large);
+	std::cout << "[pratt] 25000 operands: " << small_ms << "ms | 100000 operands: " << large_ms << "ms" << std::endl;
+	// 4x the input, a quadratic parser would take 16x as long.
+	EXPECT_LT(large_ms, small_ms * 10.0 + 1.0);
+}
+#endif
+
+#if CAOCO_TEST_BENCHMARK_LlkParserVsParseProgram
+TEST(ut_Benchmark, LlkParserVsParseProgram) {
+	// 2'000 copies of the #enter block body of ut_Parser_LLK.MatchesParseProgram, 12'000 statements.
+	auto builder = make_llk_program(2000);
+	auto tokens = builder.build();
+	auto best_time = [](auto&& parse) {
+		double best = std::numeric_limits<double>::max();
+		for (int run = 0; run < 3; run++) {
+			auto start = std::chrono::steady_clock::now();
+			parse();
+			auto stop = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+		}
+		return best;
+	};
+	caoco::astnode expected;
+	caoco::llk_parser::result_type result = caoco::llk_parser::result_type::make_failure(tokens.cbegin(), "Not parsed.");
+	double recursive_ms = best_time([&]() { expected = caoco::parse_program(tokens.cbegin(), tokens.cend()); });
+	double llk_ms = best_time([&]() { result = caoco::llk_parser::parse(tokens.cbegin(), tokens.cend()); });
+	std::cout << "[llk] tokens: " << tokens.size() << " | parse_program: " << recursive_ms << "ms | llk_parser: " << llk_ms << "ms" << std::endl;
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	EXPECT_TRUE(caoco_ast_equal(result.expected(), expected));
+	// The program has no operator expressions, so the llk_parser kept none over their tokens and both parsed all of it.
+	EXPECT_EQ(count_expression_nodes(result.expected()), 0);
+
+	// With 2 operator expressions per body, only the llk_parser parses it. The time is for the statements: the
+	// expressions are kept as expression_ nodes over their tokens, not parsed.
+	auto expression_tokens = make_llk_program(2000, true).build();
+	double statements_ms = best_time([&]() { result = caoco::llk_parser::parse(expression_tokens.cbegin(), expression_tokens.cend()); });
+	std::cout << "[llk] tokens: " << expression_tokens.size() << " | llk_parser, expressions not parsed: " << statements_ms << "ms" << std::endl;
+	ASSERT_TRUE(result.valid()) << result.error_message();
+	EXPECT_EQ(count_expression_nodes(result.expected()), 2 * 2000);
+}
+#endif
+
+#if CAOCO_TEST_BENCHMARK_BytecodeVmVsTreeWalker
+TEST(ut_Benchmark, BytecodeVmVsTreeWalker) {
+	using astnode_enum = caoco::astnode_enum;
+	auto best_time = [](auto&& evaluate) {
+		double best = std::numeric_limits<double>::max();
+		for (int run = 0; run < 3; run++) {
+			auto start = std::chrono::steady_clock::now();
+			evaluate();
+			auto stop = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+		}
+		return best;
+	};
+	caoco::rtenv env("global");
+	env.create_variable("a", caoco::RTValue(caoco::RTValue::eType::NUMBER, 3));
+	caoco::bytecode_vm vm;
+
+	// Arithmetic: a / a - 7 + a / 7 ... with 1'000 operands, evaluated 200 times. Dividing keeps the value in range.
+	const astnode_enum ops[] = { astnode_enum::addition_, astnode_enum::division_, astnode_enum::subtraction_ };
+	caoco::astnode arithmetic = ceval_leaf(astnode_enum::alnumus_, u8"a");
+	for (int i = 1; i < 1000; i++)
+		arithmetic = ceval_binop(ops[i % 3], std::move(arithmetic),
+			i % 2 ? ceval_leaf(astnode_enum::alnumus_, u8"a") : ceval_leaf(astnode_enum::number_literal_, u8"7"));
+	caoco::RTValue walked, executed;
+	double walker_ms = best_time([&]() { for (int i = 0; i < 200; i++) walked = caoco::CBinopEval{}(arithmetic, env); });
+	auto arithmetic_chunk = caoco::bytecode_compiler::compile(arithmetic, &env);
+	double vm_ms = best_time([&]() { for (int i = 0; i < 200; i++) executed = vm.run(arithmetic_chunk, env); });
+	EXPECT_TRUE(ceval_equal(walked, executed));
+
+	// Calls: add(2) with #var forty = 40; #func add(x) { #return x + forty; }, 20'000 times.
+	// Reading forty makes add impure, so every call runs the body instead of hitting the call_memo.
+	env.create_variable("forty", caoco::RTValue(caoco::RTValue::NUMBER, 40));
+	caoco::CFunctionDeclEval{}(ceval_function(u8"add", u8"x",
+		ceval_binop(astnode_enum::addition_, ceval_leaf(astnode_enum::alnumus_, u8"x"),
+			ceval_leaf(astnode_enum::alnumus_, u8"forty"))), env);
+	caoco::astnode call(astnode_enum::function_call_, u8"", ceval_leaf(astnode_enum::alnumus_, u8"add"),
+		ceval_leaf(astnode_enum::number_literal_, u8"2"));
+	double walker_call_ms = best_time([&]() { for (int i = 0; i < 20000; i++) walked = caoco::CFunctionCallEval{}(call, env); });
+	auto call_chunk = caoco::bytecode_compiler::compile(call, &env);
+	double vm_call_ms = best_time([&]() { for (int i = 0; i < 20000; i++) executed = vm.run(call_chunk, env); });
+	EXPECT_TRUE(ceval_equal(walked, executed));
+
+	// Statements: steps(2) with #func steps(x) { #var y = x * 2; #if (y < forty) { #var z = y + forty; #return z; };
+	// #return y; }, 20'000 times.
+	auto name = [](const char8_t* n) { return ceval_leaf(astnode_enum::alnumus_, n); };
+	caoco::CFunctionDeclEval{}(ceval_function_block(u8"steps", { u8"x" }, caoco::astnode(astnode_enum::functional_block_, u8"",
+		ceval_var(u8"y", ceval_binop(astnode_enum::multiplication_, name(u8"x"), ceval_leaf(astnode_enum::number_literal_, u8"2"))),
+		caoco::astnode(astnode_enum::conditional_statement_, u8"",
+			caoco::astnode(astnode_enum::if_, u8"",
+				caoco::astnode(astnode_enum::expression_, u8"", ceval_binop(astnode_enum::less_than_, name(u8"y"), name(u8"forty"))),
+				caoco::astnode(astnode_enum::functional_block_, u8"",
+					ceval_var(u8"z", ceval_binop(astnode_enum::addition_, name(u8"y"), name(u8"forty"))),
+					caoco::astnode(astnode_enum::return_, u8"", name(u8"z"))))),
+		caoco::astnode(astnode_enum::return_, u8"", name(u8"y")))), env);
+	auto steps = ceval_call(u8"steps", ceval_leaf(astnode_enum::number_literal_, u8"2"));
+	double walker_steps_ms = best_time([&]() { for (int i = 0; i < 20000; i++) walked = caoco::CFunctionCallEval{}(steps, env); });
+	auto steps_chunk = caoco::bytecode_compiler::compile(steps, &env);
+	double vm_steps_ms = best_time([&]() { for (int i = 0; i < 20000; i++) executed = vm.run(steps_chunk, env); });
+	EXPECT_TRUE(ceval_equal(walked, executed));
+	EXPECT_EQ(executed.get<int>(), 44);
+
+	// Timings depend on the machine and its load, they are reported, not asserted.
+	std::cout << "[bench] arithmetic tree walker: " << walker_ms << "ms | vm: " << vm_ms << "ms"
+		<< " | calls tree walker: " << walker_call_ms << "ms | vm: " << vm_call_ms << "ms"
+		<< " | statements tree walker: " << walker_steps_ms << "ms | vm: " << vm_steps_ms << "ms" << std::endl;
+}
+#endif
+
+#if CAOCO_TEST_BENCHMARK_MemoVsDirectCall
+TEST(ut_Benchmark, MemoVsDirectCall) {
+	using astnode_enum = caoco::astnode_enum;
+	auto best_time = [](auto&& evaluate) {
+		double best = std::numeric_limits<double>::max();
+		for (int run = 0; run < 3; run++) {
+			auto start = std::chrono::steady_clock::now();
+			evaluate();
+			auto stop = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+		}
+		return best;
+	};
+	auto n = [] { return ceval_leaf(astnode_enum::alnumus_, u8"n"); };
+	auto number = [](int value) {
+		sl_string literal = std::to_string(value);
+		return caoco::astnode(astnode_enum::number_literal_, sl_u8string(literal.begin(), literal.end()));
+	};
+	// #func square(n) { #return n * n; }; called with 0 to 15, 20'000 times.
+	// #func fib(n) { #if (n < 2) { #return n; }; #return fib(n - 1) + fib(n - 2); }; fib(20).
+	auto declare = [&](caoco::rtenv& env) {
+		caoco::CFunctionDeclEval{}(ceval_function(u8"square", u8"n", ceval_binop(astnode_enum::multiplication_, n(), n())), env);
+		caoco::CFunctionDeclEval{}(ceval_function_block(u8"fib", { u8"n" }, ceval_if_return(
+			ceval_binop(astnode_enum::less_than_, n(), number(2)),
+			n(),
+			ceval_binop(astnode_enum::addition_,
+				ceval_call(u8"fib", ceval_binop(astnode_enum::subtraction_, n(), number(1))),
+				ceval_call(u8"fib", ceval_binop(astnode_enum::subtraction_, n(), number(2)))))), env);
+	};
+	sl_vector<caoco::astnode> squares;
+	for (int i = 0; i < 16; i++) squares.push_back(ceval_call(u8"square", number(i)));
+	auto fib_20 = ceval_call(u8"fib", number(20));
+
+	// Time of both calls with the default memo, then with a memo of no entries: every call runs the body.
+	double square_ms[2], fib_ms[2];
+	for (int memoised = 1; memoised >= 0; memoised--) {
+		caoco::rtenv env("global");
+		declare(env);
+		auto square = env.resolve_variable("square").value().function();
+		auto fib = env.resolve_variable("fib").value().function();
+		if (!memoised) {
+			square->memo() = caoco::call_memo(0);
+			fib->memo() = caoco::call_memo(0);
+		}
+		ASSERT_TRUE(square->is_pure() && fib->is_pure());
+		square_ms[memoised] = best_time([&]() {
+			for (int i = 0; i < 20000; i++) EXPECT_EQ(caoco::CFunctionCallEval{}(squares[i % 16], env).get<int>(), (i % 16) * (i % 16));
+		});
+		// Each run starts with an empty memo.
+		fib_ms[memoised] = best_time([&]() {
+			fib->memo().clear();
+			EXPECT_EQ(caoco::CFunctionCallEval{}(fib_20, env).get<int>(), 6765);
+		});
+		// A memoised fib runs its body once per argument, the first time it is called.
+		EXPECT_EQ(fib->memo().size(), memoised ? 21 : 0);
+	}
 
+	std::cout << "[bench] square direct: " << square_ms[0] << "ms | memo: " << square_ms[1] << "ms"
+		<< " | fib(20) direct: " << fib_ms[0] << "ms | memo: " << fib_ms[1] << "ms" << std::endl;
+	EXPECT_LT(square_ms[1], square_ms[0]);
+	EXPECT_LT(fib_ms[1], fib_ms[0]);
 }
 #endif
@@ -43,6 +43,127 @@ namespace caoco {
 			if_, else_, elif_, while_, for_, switch_, case_, default_, break_,
 			continue_, return_, into_,on_
 		};
+		// One row per enumerator in enum order, starting from none_ (-1).
+		struct type_traits {
+			e_type type;
+			sl_string_view name;
+			bool directive;
+		};
+		SL_CXSIN type_traits type_traits_table[] = {
+			// type, name, directive
+			{ e_type::none_, "none", false },
+			{ e_type::invalid_, "invalid", false },
+			{ e_type::eof_, "eof", false },
+			{ e_type::line_comment_, "line_comment", false },
+			{ e_type::block_comment_, "block_comment", false },
+			{ e_type::string_literal_, "string_literal", false },
+			{ e_type::number_literal_, "number_literal", false },
+			{ e_type::real_literal_, "real_literal", false },
+			{ e_type::byte_literal_, "byte_literal", false },
+			{ e_type::bit_literal_, "bit_literal", false },
+			{ e_type::unsigned_literal_, "unsigned_literal", false },
+			{ e_type::newline_, "newline", false },
+			{ e_type::whitespace_, "whitespace", false },
+			{ e_type::alnumus_, "alnumus", false },
+			{ e_type::simple_assignment_, "simple_assignment", false },
+			{ e_type::addition_assignment_, "addition_assignment", false },
+			{ e_type::subtraction_assignment_, "subtraction_assignment", false },
+			{ e_type::multiplication_assignment_, "multiplication_assignment", false },
+			{ e_type::division_assignment_, "division_assignment", false },
+			{ e_type::remainder_assignment_, "remainder_assignment", false },
+			{ e_type::bitwise_and_assignment_, "bitwise_and_assignment", false },
+			{ e_type::bitwise_or_assignment_, "bitwise_or_assignment", false },
+			{ e_type::bitwise_xor_assignment_, "bitwise_xor_assignment", false },
+			{ e_type::left_shift_assignment_, "left_shift_assignment", false },
+			{ e_type::right_shift_assignment_, "right_shift_assignment", false },
+			{ e_type::increment_, "increment", false },
+			{ e_type::decrement_, "decrement", false },
+			{ e_type::addition_, "addition", false },
+			{ e_type::subtraction_, "subtraction", false },
+			{ e_type::multiplication_, "multiplication", false },
+			{ e_type::division_, "division", false },
+			{ e_type::remainder_, "remainder", false },
+			{ e_type::bitwise_NOT_, "bitwise_NOT", false },
+			{ e_type::bitwise_AND_, "bitwise_AND", false },
+			{ e_type::bitwise_OR_, "bitwise_OR", false },
+			{ e_type::bitwise_XOR_, "bitwise_XOR", false },
+			{ e_type::bitwise_left_shift_, "bitwise_left_shift", false },
+			{ e_type::bitwise_right_shift_, "bitwise_right_shift", false },
+			{ e_type::negation_, "negation", false },
+			{ e_type::logical_AND_, "logical_AND", false },
+			{ e_type::logical_OR_, "logical_OR", false },
+			{ e_type::equal_, "equal", false },
+			{ e_type::not_equal_, "not_equal", false },
+			{ e_type::less_than_, "less_than", false },
+			{ e_type::greater_than_, "greater_than", false },
+			{ e_type::less_than_or_equal_, "less_than_or_equal", false },
+			{ e_type::greater_than_or_equal_, "greater_than_or_equal", false },
+			{ e_type::three_way_comparison_, "three_way_comparison", false },
+			{ e_type::open_scope_, "open_scope", false },
+			{ e_type::close_scope_, "close_scope", false },
+			{ e_type::open_list_, "open_list", false },
+			{ e_type::close_list_, "close_list", false },
+			{ e_type::open_frame_, "open_frame", false },
+			{ e_type::close_frame_, "close_frame", false },
+			{ e_type::eos_, "eos", false },
+			{ e_type::comma_, "comma", false },
+			{ e_type::period_, "period", false },
+			{ e_type::ellipsis_, "ellipsis", false },
+			{ e_type::at_operator_, "at_operator", false },
+			{ e_type::atype_, "atype_", true },
+			{ e_type::aidentity_, "aidentity_", true },
+			{ e_type::avalue_, "avalue_", true },
+			{ e_type::aint_, "aint_", true },
+			{ e_type::auint_, "auint_", true },
+			{ e_type::areal_, "areal_", true },
+			{ e_type::abyte_, "abyte_", true },
+			{ e_type::abit_, "abit_", true },
+			{ e_type::astr_, "astr_", true },
+			{ e_type::aarray_, "aarray_", true },
+			{ e_type::apointer_, "apointer_", true },
+			{ e_type::amemory_, "amemory_", true },
+			{ e_type::afunction_, "afunction_", true },
+			{ e_type::enter_, "enter_", true },
+			{ e_type::start_, "start_", true },
+			{ e_type::include_, "include_", true },
+			{ e_type::type_, "type_", true },
+			{ e_type::use_, "use", false },
+			{ e_type::var_, "var_", true },
+			{ e_type::class_, "class_", true },
+			{ e_type::func_, "func_", true },
+			{ e_type::print_, "print_", true },
+			{ e_type::none_literal_, "none_literal_", true },
+			{ e_type::obj_, "obj_", true },
+			{ e_type::private_, "private_", true },
+			{ e_type::macro_, "macro_", true },
+			{ e_type::endmacro_, "endmacro", false },
+			{ e_type::public_, "public_", true },
+			{ e_type::const_, "const_", true },
+			{ e_type::static_, "static_", true },
+			{ e_type::ref_, "ref_", true },
+			{ e_type::if_, "if_", true },
+			{ e_type::else_, "else_", true },
+			{ e_type::elif_, "elif_", true },
+			{ e_type::while_, "while_", true },
+			{ e_type::for_, "for_", true },
+			{ e_type::switch_, "switch_", true },
+			{ e_type::case_, "case_", true },
+			{ e_type::default_, "default_", true },
+			{ e_type::break_, "break_", true },
+			{ e_type::continue_, "continue_", true },
+			{ e_type::return_, "return_", true },
+			{ e_type::into_, "into_", true },
+			{ e_type::on_, "on_", true },
+		};
+		static_assert(std::size(type_traits_table) == static_cast<sl_size>(e_type::on_) + 2 && []() consteval {
+				for (sl_size i = 0; i < std::size(type_traits_table); i++)
+					if (static_cast<int>(type_traits_table[i].type) != static_cast<int>(i) - 1) return false;
+				return true;
+			}(), "caoco::tk::type_traits_table must have one row per e_type enumerator, in enum order.");
+		SL_CXS const type_traits& traits_of(e_type type) {
+			const sl_size index = static_cast<sl_size>(static_cast<int>(type) + 1);
+			return index < std::size(type_traits_table) ? type_traits_table[index] : type_traits_table[0];
+		}
 	private:
 		e_type type_;
 		sl_char8_vector_cit beg_;
@@ -89,169 +210,12 @@ namespace caoco {
 
 
 		// Fast type queries.
-		SL_CX bool is_directive() const noexcept {
-			//atype_, aidentity_, avalue_, aint_, auint_, areal_, abyte_,
-			//	abit_, astr_, aarray_, apointer_, amemory_, afunction_,
-			//	enter_, start_, include_, type_, var_, class_, func_, print_, none_literal_,
-			//	obj_, private_, macro_,
-			//	public_, const_, static_, ref_,
-			//	if_, else_, elif_, while_, for_, switch_, case_, default_, break_,
-			//	continue_, return_, into_, on_
-			return type_ == e_type::atype_ ||
-				type_ == e_type::aidentity_ ||
-				type_ == e_type::avalue_ ||
-				type_ == e_type::aint_ ||
-				type_ == e_type::auint_ ||
-				type_ == e_type::areal_ ||
-				type_ == e_type::abyte_ ||
-				type_ == e_type::abit_ ||
-				type_ == e_type::astr_ ||
-				type_ == e_type::aarray_ ||
-				type_ == e_type::apointer_ ||
-				type_ == e_type::amemory_ ||
-				type_ == e_type::afunction_ ||
-				type_ == e_type::enter_ ||
-				type_ == e_type::start_ ||
-				type_ == e_type::include_ ||
-				type_ == e_type::type_ ||
-				type_ == e_type::var_ ||
-				type_ == e_type::class_ ||
-				type_ == e_type::func_ ||
-				type_ == e_type::print_ ||
-				type_ == e_type::none_literal_ ||
-				type_ == e_type::obj_ ||
-				type_ == e_type::private_ ||
-				type_ == e_type::macro_ ||
-				type_ == e_type::public_ ||
-				type_ == e_type::const_ ||
-				type_ == e_type::static_ ||
-				type_ == e_type::ref_ ||
-				type_ == e_type::if_ ||
-				type_ == e_type::else_ ||
-				type_ == e_type::elif_ ||
-				type_ == e_type::while_ ||
-				type_ == e_type::for_ ||
-				type_ == e_type::switch_ ||
-				type_ == e_type::case_ ||
-				type_ == e_type::default_ ||
-				type_ == e_type::break_ ||
-				type_ == e_type::continue_ ||
-				type_ == e_type::return_ ||
-				type_ == e_type::into_ ||
-				type_ == e_type::on_;
-		}
+		SL_CX bool is_directive() const noexcept { return traits_of(type_).directive; }
 
 
 		// debug only
-		static constexpr caoco::sl_string type_to_string(e_type type) {
-			switch (type) {
-			case(e_type::none_): return "none";
-			case(e_type::invalid_): return "invalid";
-			case(e_type::eof_): return "eof";
-			case(e_type::line_comment_): return "line_comment";
-			case(e_type::block_comment_): return "block_comment";
-			case(e_type::string_literal_): return "string_literal";
-			case(e_type::number_literal_): return "number_literal";
-			case(e_type::real_literal_): return "real_literal";
-			case(e_type::newline_): return "newline";
-			case(e_type::whitespace_): return "whitespace";
-			case(e_type::alnumus_): return "alnumus";
-			case(e_type::simple_assignment_): return "simple_assignment";
-			case(e_type::addition_assignment_): return "addition_assignment";
-			case(e_type::subtraction_assignment_): return "subtraction_assignment";
-			case(e_type::multiplication_assignment_): return "multiplication_assignment";
-			case(e_type::division_assignment_): return "division_assignment";
-			case(e_type::remainder_assignment_): return "remainder_assignment";
-			case(e_type::bitwise_and_assignment_): return "bitwise_and_assignment";
-			case(e_type::bitwise_or_assignment_): return "bitwise_or_assignment";
-			case(e_type::bitwise_xor_assignment_): return "bitwise_xor_assignment";
-			case(e_type::left_shift_assignment_): return "left_shift_assignment";
-			case(e_type::right_shift_assignment_): return "right_shift_assignment";
-			case(e_type::increment_): return "increment";
-			case(e_type::decrement_): return "decrement";
-			case(e_type::addition_): return "addition";
-			case(e_type::subtraction_): return "subtraction";
-			case(e_type::multiplication_): return "multiplication";
-			case(e_type::division_): return "division";
-			case(e_type::remainder_): return "remainder";
-			case(e_type::bitwise_NOT_): return "bitwise_NOT";
-			case(e_type::bitwise_AND_): return "bitwise_AND";
-			case(e_type::bitwise_OR_): return "bitwise_OR";
-			case(e_type::bitwise_XOR_): return "bitwise_XOR";
-			case(e_type::bitwise_left_shift_): return "bitwise_left_shift";
-			case(e_type::bitwise_right_shift_): return "bitwise_right_shift";
-			case(e_type::negation_): return "negation";
-			case(e_type::logical_AND_): return "logical_AND";
-			case(e_type::logical_OR_): return "logical_OR";
-			case(e_type::equal_): return "equal";
-			case(e_type::not_equal_): return "not_equal";
-			case(e_type::less_than_): return "less_than";
-			case(e_type::greater_than_): return "greater_than";
-			case(e_type::less_than_or_equal_): return "less_than_or_equal";
-			case(e_type::greater_than_or_equal_): return "greater_than_or_equal";
-			case(e_type::three_way_comparison_): return "three_way_comparison";
-			case(e_type::open_scope_): return "open_scope";
-			case(e_type::close_scope_): return "close_scope";
-			case(e_type::open_list_): return "open_list";
-			case(e_type::close_list_): return "close_list";
-			case(e_type::open_frame_): return "open_frame";
-			case(e_type::close_frame_): return "close_frame";
-			case(e_type::eos_): return "eos";
-			case(e_type::comma_): return "comma";
-			case(e_type::period_): return "period";
-			case(e_type::ellipsis_): return "ellipsis";
-			case(e_type::atype_): return "atype_";
-			case(e_type::aidentity_): return "aidentity_";
-			case(e_type::avalue_): return "avalue_";
-			case(e_type::aint_): return "aint_";
-			case(e_type::auint_): return "auint_";
-			case(e_type::areal_): return "areal_";
-				//case(e_type::aureal_): return "aureal_";
-			case(e_type::abyte_): return "abyte_";
-			case(e_type::abit_): return "abit_";
-			case(e_type::aarray_): return "aarray_";
-			case(e_type::apointer_): return "apointer_";
-			case(e_type::amemory_): return "amemory_";
-			case(e_type::afunction_): return "afunction_";
-			case(e_type::enter_): return "enter_";
-			case(e_type::start_): return "start_";
-			case(e_type::type_): return "type_";
-			case(e_type::var_): return "var_";
-			case(e_type::class_): return "class_";
-			case(e_type::func_): return "func_";
-			case(e_type::print_): return "print_";
-			case(e_type::public_): return "public_";
-			case(e_type::const_): return "const_";
-			case(e_type::static_): return "static_";
-			case(e_type::ref_): return "ref_";
-			case(e_type::if_): return "if_";
-			case(e_type::else_): return "else_";
-			case(e_type::elif_): return "elif_";
-			case(e_type::while_): return "while_";
-			case(e_type::for_): return "for_";
-			case(e_type::switch_): return "switch_";
-			case(e_type::case_): return "case_";
-			case(e_type::default_): return "default_";
-			case(e_type::break_): return "break_";
-			case(e_type::continue_): return "continue_";
-			case(e_type::return_): return "return_";
-			case(e_type::into_): return "into_";
-			case(e_type::none_literal_): return "none_literal_";
-			case(e_type::bit_literal_): return "bit_literal";
-			case(e_type::byte_literal_): return "byte_literal";
-			case(e_type::unsigned_literal_): return "unsigned_literal";
-			case(e_type::obj_): return "obj_";
-			case(e_type::private_): return "private_";
-			case(e_type::macro_): return "macro_";
-			case(e_type::on_): return "on_";
-			case(e_type::include_): return "include_";
-			case(e_type::astr_): return "astr_";
-			default: return "This token type is not string-convertible. Please implement a string conversion for this token type in the token_type_to_string function in test.cpp.";
-			}
-		}
-		SL_CX caoco::sl_string type_to_string() const {
-			return tk::type_to_string(type_);
-		}
+		static constexpr sl_string_view type_to_string(e_type type) { return traits_of(type).name; }
+		SL_CX sl_string_view type_to_string() const { return traits_of(type_).name; }
 	};
 
 	using tk_enum = tk::e_type;
@@ -1,5 +1,6 @@
 #pragma once
 #include "cand_syntax.hpp"
+#include "scratch_arena.hpp"
 
 static const tk sentinel_end_token = e_tk::eof_;
 class tk_iterator {
@@ -167,7 +168,7 @@ public:
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		sl_stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		tk_iterator last_open = { begin, end };
 		tk_vector_cit last_closed = begin;
 		tk_vector_cit error_last_closed = begin;
@@ -289,7 +290,7 @@ public:
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		sl_stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		tk_iterator last_open = { begin, end };
 		tk_vector_cit last_closed = begin;
 		tk_vector_cit error_last_closed = begin;
@@ -413,7 +414,7 @@ public:
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		sl_stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		tk_iterator last_open = { begin, end };
 		tk_vector_cit last_closed = begin;
 		tk_vector_cit error_last_closed = begin;
@@ -533,13 +534,13 @@ public:
 	}
 
 	// Method for extracting a seperated parentheses scope. (<separator>)
-	static sl_vector<tk_scope> find_seperated_paren(tk_vector_cit begin, tk_vector_cit end, e_tk separator) {
-		sl_vector< tk_scope> scopes;
+	static scratch_vector<tk_scope> find_seperated_paren(tk_vector_cit begin, tk_vector_cit end, e_tk separator) {
+		scratch_vector<tk_scope> scopes;
 		if (begin->type() != e_tk::open_paren_) {
 			scopes.push_back(tk_scope{ false, begin, end });
 			return scopes;
 		}
-		sl_stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		tk_vector_cit last_closed = begin;
 		begin++; // Skip the open list token
 		for (auto i = begin; i < end;) {
@@ -571,21 +572,21 @@ public:
 			sl::advance(i, 1);
 		}
 	}
-	static sl_vector<tk_scope> find_seperated_paren(tk_iterator crsr, e_tk separator) {
+	static scratch_vector<tk_scope> find_seperated_paren(tk_iterator crsr, e_tk separator) {
 		return find_seperated_paren(crsr.it(), crsr.end(), separator);
 	}
-	static sl_vector<tk_scope> find_seperated_paren(tk_scope ls, e_tk separator) {
+	static scratch_vector<tk_scope> find_seperated_paren(tk_scope ls, e_tk separator) {
 		return find_seperated_paren(ls.begin(), ls.end(), separator);
 	}
 
 	// Method for extracting a seperated list scope. {<separator>}
-	static sl_vector<tk_scope> find_seperated_brace(tk_vector_cit begin, tk_vector_cit end, e_tk separator) {
-		sl_vector< tk_scope> scopes;
+	static scratch_vector<tk_scope> find_seperated_brace(tk_vector_cit begin, tk_vector_cit end, e_tk separator) {
+		scratch_vector<tk_scope> scopes;
 		if (begin->type() != e_tk::open_brace_) {
 			scopes.push_back(tk_scope{ false, begin, end });
 			return scopes;
 		}
-		sl_stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		tk_vector_cit last_closed = begin;
 		begin++; // Skip the open list token
 		for (auto i = begin; i < end;) {
@@ -617,21 +618,21 @@ public:
 			sl::advance(i, 1);
 		}
 	}
-	static sl_vector<tk_scope> find_seperated_brace(tk_iterator crsr, e_tk separator) {
+	static scratch_vector<tk_scope> find_seperated_brace(tk_iterator crsr, e_tk separator) {
 		return find_seperated_brace(crsr.it(), crsr.end(), separator);
 	}
-	static sl_vector<tk_scope> find_seperated_brace(tk_scope ls, e_tk separator) {
+	static scratch_vector<tk_scope> find_seperated_brace(tk_scope ls, e_tk separator) {
 		return find_seperated_brace(ls.begin(), ls.end(), separator);
 	}
 
 	// Method for extracting a seperated frame scope. [<separator>]
-	static sl_vector<tk_scope> find_seperated_bracket(tk_vector_cit begin, tk_vector_cit end, e_tk separator) {
-		sl_vector< tk_scope> scopes;
+	static scratch_vector<tk_scope> find_seperated_bracket(tk_vector_cit begin, tk_vector_cit end, e_tk separator) {
+		scratch_vector<tk_scope> scopes;
 		if (begin->type() != e_tk::open_bracket_) {
 			scopes.push_back(tk_scope{ false, begin, end });
 			return scopes;
 		}
-		sl_stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		tk_vector_cit last_closed = begin;
 		begin++; // Skip the open list token
 		for (auto i = begin; i < end;) {
@@ -663,10 +664,10 @@ public:
 			sl::advance(i, 1);
 		}
 	}
-	static sl_vector<tk_scope> find_seperated_bracket(tk_iterator crsr, e_tk separator) {
+	static scratch_vector<tk_scope> find_seperated_bracket(tk_iterator crsr, e_tk separator) {
 		return find_seperated_bracket(crsr.it(), crsr.end(), separator);
 	}
-	static sl_vector<tk_scope> find_seperated_bracket(const tk_scope & ls, e_tk separator) {
+	static scratch_vector<tk_scope> find_seperated_bracket(const tk_scope & ls, e_tk separator) {
 		return find_seperated_bracket(ls.begin(), ls.end(), separator);
 	}
 
@@ -675,7 +676,7 @@ public:
 		auto paren_scope_depth = 0;
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
-		std::stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		auto last_open = begin;
 		auto last_closed = begin;
 
@@ -778,7 +779,7 @@ public:
 		auto frame_scope_depth = 0;
 		auto list_scope_depth = 0;
 		//e_tk currrent_scope_type = e_tk::none_;
-		std::stack<e_tk> scope_type_history;
+		scratch_stack<e_tk> scope_type_history;
 		auto last_open = begin;
 		auto last_closed = begin;
 
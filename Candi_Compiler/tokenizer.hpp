@@ -100,7 +100,7 @@ constexpr tokenizer::tokenizer_result tokenizer::tokenize() {
 		if(!lex_result.valid()){
 			return  sl_expected<bool>::make_failure(lex_result.error_message());
 		}
-		tk result_token = lex_result.expected();
+		tk result_token = lex_result.extract();
 		sl_char8_vector_cit result_end = lex_result.always();
 			
 		if (result_token.type() == e_tk::none_) { // No match, try next lexer
@@ -131,6 +131,7 @@ constexpr tokenizer::tokenizer_result tokenizer::tokenize() {
 			// Set the line and col of the resulting token and emplace it into the output vector
 			result_token.set_line(current_line);
 			result_token.set_col(current_col);
+			result_token.set_offset(static_cast<sl_size>(std::distance(beg_, it)));
 			output_tokens.push_back(result_token);
 			it = result_end; // Advance the iterator to the end of lexing. Note lex end and token end may differ.
 			return sl_expected<bool>::make_success(true);